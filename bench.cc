@@ -0,0 +1,634 @@
+#include "ftl/buffer.h"
+#include "ftl/checksum.h"
+#include "ftl/parallel.h"
+#include "ftl/bit_stream.h"
+#include "ftl/framing.h"
+#include "ftl/static_buffer.h"
+#include "ftl/concurrent_buffer.h"
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+/**
+	BufferT/StreamBufferT热点路径的性能测试，基于Google Benchmark
+
+	对比：
+		byte_buffer           默认的SimpleBufferT
+		small_byte_buffer     带内联存储的SimpleBufferT
+		shared_byte_buffer    SharedBufferT
+		vector_buffer         VectorContinerT(std::vector)
+		Memcpy*               直接使用memcpy的基准
+
+	./make.sh bench
+	./bench --benchmark_filter=ReadBe
+*/
+
+using namespace ftl;
+using namespace ftl::buffer_internal;
+
+/////////////////////////////////////
+// construction
+
+template<typename Buffer>
+static void BM_Construct(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	for (auto _ : state) {
+		Buffer buf(size, 0);
+		benchmark::DoNotOptimize(buf.begin());
+	}
+}
+BENCHMARK_TEMPLATE(BM_Construct, byte_buffer)->Arg(16)->Arg(256)->Arg(64 << 10);
+BENCHMARK_TEMPLATE(BM_Construct, small_byte_buffer)->Arg(16)->Arg(256)->Arg(64 << 10);
+BENCHMARK_TEMPLATE(BM_Construct, shared_byte_buffer)->Arg(16)->Arg(256)->Arg(64 << 10);
+BENCHMARK_TEMPLATE(BM_Construct, vector_buffer)->Arg(16)->Arg(256)->Arg(64 << 10);
+
+static void BM_ConstructMalloc(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	for (auto _ : state) {
+		void* p = ::malloc(size);
+		std::memset(p, 0, size);
+		benchmark::DoNotOptimize(p);
+		::free(p);
+	}
+}
+BENCHMARK(BM_ConstructMalloc)->Arg(16)->Arg(256)->Arg(64 << 10);
+
+/////////////////////////////////////
+// append growth
+
+template<typename Buffer>
+static void BM_AppendByte(benchmark::State& state) {
+	const size_t count = (size_t)state.range(0);
+	for (auto _ : state) {
+		Buffer buf;
+		for (size_t i = 0; i < count; i++)
+			buf.append((uint8_t)i);
+		benchmark::DoNotOptimize(buf.begin());
+	}
+	state.SetBytesProcessed(state.iterations() * count);
+}
+BENCHMARK_TEMPLATE(BM_AppendByte, byte_buffer)->Arg(64)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_AppendByte, small_byte_buffer)->Arg(64)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_AppendByte, shared_byte_buffer)->Arg(64)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_AppendByte, vector_buffer)->Arg(64)->Arg(4096);
+
+template<typename Buffer>
+static void BM_AppendBe32(benchmark::State& state) {
+	const size_t count = (size_t)state.range(0);
+	for (auto _ : state) {
+		Buffer buf;
+		for (size_t i = 0; i < count; i++)
+			buf.append_be((uint32_t)i);
+		benchmark::DoNotOptimize(buf.begin());
+	}
+	state.SetBytesProcessed(state.iterations() * count * sizeof(uint32_t));
+}
+BENCHMARK_TEMPLATE(BM_AppendBe32, byte_buffer)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_AppendBe32, shared_byte_buffer)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_AppendBe32, vector_buffer)->Arg(1024);
+
+template<typename Buffer>
+static void BM_AppendBlock(benchmark::State& state) {
+	const size_t block = (size_t)state.range(0);
+	std::vector<uint8_t> src(block, 1);
+	for (auto _ : state) {
+		Buffer buf;
+		for (size_t i = 0; i < 64; i++)
+			buf.append(&src.front(), block);
+		benchmark::DoNotOptimize(buf.begin());
+	}
+	state.SetBytesProcessed(state.iterations() * 64 * block);
+}
+BENCHMARK_TEMPLATE(BM_AppendBlock, byte_buffer)->Arg(64)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_AppendBlock, vector_buffer)->Arg(64)->Arg(4096);
+
+static void BM_AppendBlockVector(benchmark::State& state) {
+	const size_t block = (size_t)state.range(0);
+	std::vector<uint8_t> src(block, 1);
+	for (auto _ : state) {
+		std::vector<uint8_t> buf;
+		for (size_t i = 0; i < 64; i++)
+			buf.insert(buf.end(), src.begin(), src.end());
+		benchmark::DoNotOptimize(buf.data());
+	}
+	state.SetBytesProcessed(state.iterations() * 64 * block);
+}
+BENCHMARK(BM_AppendBlockVector)->Arg(64)->Arg(4096);
+
+/////////////////////////////////////
+// read_be/write_le，覆盖所有is_endian_basictype
+
+static const size_t kValueBufferSize = 4096;
+
+template<typename Buffer, typename T>
+static void BM_ReadBe(benchmark::State& state) {
+	Buffer buf(kValueBufferSize, 1);
+	const size_t count = kValueBufferSize / sizeof(T);
+	for (auto _ : state) {
+		for (size_t i = 0; i < count; i++)
+			benchmark::DoNotOptimize(buf.template read_be<T>(i * sizeof(T)));
+	}
+	state.SetBytesProcessed(state.iterations() * count * sizeof(T));
+}
+
+template<typename Buffer, typename T>
+static void BM_WriteLe(benchmark::State& state) {
+	Buffer buf(kValueBufferSize, 0);
+	const size_t count = kValueBufferSize / sizeof(T);
+	for (auto _ : state) {
+		for (size_t i = 0; i < count; i++)
+			buf.write_le((T)i, i * sizeof(T));
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * count * sizeof(T));
+}
+
+// 不做边界检查和字节序转换的基准
+template<typename T>
+static void BM_MemcpyRead(benchmark::State& state) {
+	std::vector<uint8_t> buf(kValueBufferSize, 1);
+	const size_t count = kValueBufferSize / sizeof(T);
+	for (auto _ : state) {
+		for (size_t i = 0; i < count; i++) {
+			T value;
+			std::memcpy(&value, &buf[i * sizeof(T)], sizeof(T));
+			benchmark::DoNotOptimize(value);
+		}
+	}
+	state.SetBytesProcessed(state.iterations() * count * sizeof(T));
+}
+
+#define FTL_BENCH_ENDIAN_TYPE(T) \
+	BENCHMARK_TEMPLATE(BM_ReadBe, byte_buffer, T); \
+	BENCHMARK_TEMPLATE(BM_ReadBe, vector_buffer, T); \
+	BENCHMARK_TEMPLATE(BM_WriteLe, byte_buffer, T); \
+	BENCHMARK_TEMPLATE(BM_WriteLe, vector_buffer, T); \
+	BENCHMARK_TEMPLATE(BM_MemcpyRead, T)
+
+FTL_BENCH_ENDIAN_TYPE(int16_t);
+FTL_BENCH_ENDIAN_TYPE(uint16_t);
+FTL_BENCH_ENDIAN_TYPE(int32_t);
+FTL_BENCH_ENDIAN_TYPE(uint32_t);
+FTL_BENCH_ENDIAN_TYPE(int64_t);
+FTL_BENCH_ENDIAN_TYPE(uint64_t);
+FTL_BENCH_ENDIAN_TYPE(float);
+FTL_BENCH_ENDIAN_TYPE(double);
+
+#undef FTL_BENCH_ENDIAN_TYPE
+
+/////////////////////////////////////
+// slice
+
+template<typename Buffer>
+static void BM_Slice(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	Buffer buf(size, 1);
+	for (auto _ : state) {
+		Buffer slice = buf.slice(size / 4, size / 2);
+		benchmark::DoNotOptimize(slice.size());
+	}
+}
+BENCHMARK_TEMPLATE(BM_Slice, byte_buffer)->Arg(256)->Arg(64 << 10);
+BENCHMARK_TEMPLATE(BM_Slice, shared_byte_buffer)->Arg(256)->Arg(64 << 10);
+BENCHMARK_TEMPLATE(BM_Slice, vector_buffer)->Arg(256)->Arg(64 << 10);
+
+/////////////////////////////////////
+// stream sequential decode
+
+template<typename Buffer>
+static void BM_StreamDecode(benchmark::State& state) {
+	// 一条消息：uint16 + uint32 + uint64 + double
+	const size_t message_size = 2 + 4 + 8 + 8;
+	const size_t count = 1024;
+	Buffer data(message_size * count, 1);
+	for (auto _ : state) {
+		// 移动进出stream，不计入复制的开销
+		StreamBufferT<uint8_t, Buffer> stream(std::move(data));
+		while (!stream.read_eof()) {
+			benchmark::DoNotOptimize(stream.template read_be<uint16_t>());
+			benchmark::DoNotOptimize(stream.template read_be<uint32_t>());
+			benchmark::DoNotOptimize(stream.template read_be<uint64_t>());
+			benchmark::DoNotOptimize(stream.template read_be<double>());
+		}
+		data = std::move(stream.buf());
+	}
+	state.SetBytesProcessed(state.iterations() * message_size * count);
+}
+BENCHMARK_TEMPLATE(BM_StreamDecode, byte_buffer);
+BENCHMARK_TEMPLATE(BM_StreamDecode, shared_byte_buffer);
+BENCHMARK_TEMPLATE(BM_StreamDecode, vector_buffer);
+
+static void BM_StreamDecodeMemcpy(benchmark::State& state) {
+	const size_t message_size = 2 + 4 + 8 + 8;
+	const size_t count = 1024;
+	std::vector<uint8_t> data(message_size * count, 1);
+	for (auto _ : state) {
+		const uint8_t* p = data.data();
+		const uint8_t* end = p + data.size();
+		while (p < end) {
+			uint16_t a; uint32_t b; uint64_t c; double d;
+			std::memcpy(&a, p, 2); p += 2;
+			std::memcpy(&b, p, 4); p += 4;
+			std::memcpy(&c, p, 8); p += 8;
+			std::memcpy(&d, p, 8); p += 8;
+			benchmark::DoNotOptimize(a);
+			benchmark::DoNotOptimize(b);
+			benchmark::DoNotOptimize(c);
+			benchmark::DoNotOptimize(d);
+		}
+	}
+	state.SetBytesProcessed(state.iterations() * message_size * count);
+}
+BENCHMARK(BM_StreamDecodeMemcpy);
+
+/////////////////////////////////////
+// varint
+
+static byte_buffer MakeVarintBuffer(size_t count) {
+	byte_buffer buf;
+	for (size_t i = 0; i < count; i++)
+		buf.append_varint((uint64_t)(i * 2654435761ULL) >> (i % 57));
+	return buf;
+}
+
+static void BM_AppendVarint(benchmark::State& state) {
+	const size_t count = 1024;
+	for (auto _ : state) {
+		byte_buffer buf;
+		for (size_t i = 0; i < count; i++)
+			buf.append_varint((uint64_t)(i * 2654435761ULL) >> (i % 57));
+		benchmark::DoNotOptimize(buf.begin());
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_AppendVarint);
+
+// 1024个uint32_t加上长度前缀：逐个append_be / append_be_vector
+static void BM_AppendVectorLoop(benchmark::State& state) {
+	std::vector<uint32_t> values(1024, 0x01020304);
+	for (auto _ : state) {
+		byte_buffer buf;
+		buf.append_varint((uint32_t)values.size());
+		for (size_t i = 0; i < values.size(); i++)
+			buf.append_be(values[i]);
+		benchmark::DoNotOptimize(buf.begin());
+	}
+	state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_AppendVectorLoop);
+
+static void BM_AppendVector(benchmark::State& state) {
+	std::vector<uint32_t> values(1024, 0x01020304);
+	for (auto _ : state) {
+		byte_buffer buf;
+		buf.append_be_vector(values);
+		benchmark::DoNotOptimize(buf.begin());
+	}
+	state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_AppendVector);
+
+// 解码到预先分配的vector
+static void BM_ReadVector(benchmark::State& state) {
+	byte_buffer buf;
+	buf.append_be_vector(std::vector<uint32_t>(1024, 0x01020304));
+	std::vector<uint32_t> values;
+	for (auto _ : state) {
+		buf.read_be_vector(0, values);
+		benchmark::DoNotOptimize(values.data());
+	}
+	state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_ReadVector);
+
+// 64个string->string的map
+static void BM_AppendMap(benchmark::State& state) {
+	std::map<std::string, std::string> headers;
+	for (int i = 0; i < 64; i++)
+		headers["header-" + std::to_string(i)] = std::string(24, 'v');
+	for (auto _ : state) {
+		byte_buffer buf;
+		buf.append_be_map(headers);
+		benchmark::DoNotOptimize(buf.begin());
+	}
+	state.SetItemsProcessed(state.iterations() * headers.size());
+}
+BENCHMARK(BM_AppendMap);
+
+static void BM_ReadVarint(benchmark::State& state) {
+	const size_t count = 1024;
+	byte_buffer buf = MakeVarintBuffer(count);
+	for (auto _ : state) {
+		size_t offset = 0;
+		size_t length = 0;
+		for (size_t i = 0; i < count; i++) {
+			benchmark::DoNotOptimize(buf.read_varint<uint64_t>(offset, &length));
+			offset += length;
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ReadVarint);
+
+static void BM_ReadVarintArray(benchmark::State& state) {
+	const size_t count = 1024;
+	byte_buffer buf = MakeVarintBuffer(count);
+	std::vector<uint64_t> values(count);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(buf.read_varint_array(0, &values.front(), count));
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ReadVarintArray);
+
+/////////////////////////////////////
+// bulk copy
+
+template<typename Buffer>
+static void BM_WriteBytes(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	std::vector<uint8_t> src(size, 1);
+	Buffer buf(size, 0);
+	for (auto _ : state) {
+		buf.write_bytes(&src.front(), size, 0);
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK_TEMPLATE(BM_WriteBytes, byte_buffer)->Arg(64)->Arg(4096)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_WriteBytes, vector_buffer)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+static void BM_Memcpy(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	std::vector<uint8_t> src(size, 1);
+	std::vector<uint8_t> dst(size, 0);
+	for (auto _ : state) {
+		std::memcpy(dst.data(), src.data(), size);
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_Memcpy)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+/////////////////////////////////////
+// search，state.range(1)为Search::Isa
+
+static byte_buffer MakeTextBuffer(size_t size) {
+	byte_buffer buf(size, 'a');
+	for (size_t i = 0; i < size; i += 61)
+		buf.write((uint8_t)' ', i);
+	buf.write_bytes("\r\n", 2, size - 2);
+	return buf;
+}
+
+static void BM_FindPattern(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	if (!Search::set_isa((Search::Isa)state.range(1))) {
+		state.SkipWithError("isa not supported");
+		return;
+	}
+	byte_buffer buf = MakeTextBuffer(size);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(buf.find("\r\n", 2));
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+	Search::set_isa(Search::detect());
+}
+BENCHMARK(BM_FindPattern)->ArgsProduct({ { 4096, 1 << 20 }, { Search::kScalar, Search::kSse2, Search::kAvx2 } });
+
+static void BM_ReadBeArray(benchmark::State& state) {
+	typedef buffer_internal::ByteSwapKernels ByteSwapKernels;
+	if (!ByteSwapKernels::set_isa((ByteSwapKernels::Isa)state.range(0))) {
+		state.SkipWithError("isa not supported");
+		return;
+	}
+	byte_buffer buf(kValueBufferSize, 1);
+	uint32_t values[kValueBufferSize / 4];
+	for (auto _ : state) {
+		buf.read_be_array(0, values, kValueBufferSize / 4);
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * kValueBufferSize);
+	ByteSwapKernels::set_isa(ByteSwapKernels::detect());
+}
+BENCHMARK(BM_ReadBeArray)->Arg(buffer_internal::ByteSwapKernels::kScalar)->Arg(buffer_internal::ByteSwapKernels::kSsse3)->Arg(buffer_internal::ByteSwapKernels::kAvx2);
+
+static void BM_FindFirstOf(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	if (!Search::set_isa((Search::Isa)state.range(1))) {
+		state.SkipWithError("isa not supported");
+		return;
+	}
+	byte_buffer buf = MakeTextBuffer(size);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(buf.find_first_of("\r\n", 2));
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+	Search::set_isa(Search::detect());
+}
+BENCHMARK(BM_FindFirstOf)->ArgsProduct({ { 4096, 1 << 20 }, { Search::kScalar, Search::kSse2, Search::kAvx2 } });
+
+static void BM_Compare(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	if (!Search::set_isa((Search::Isa)state.range(1))) {
+		state.SkipWithError("isa not supported");
+		return;
+	}
+	byte_buffer a = MakeTextBuffer(size);
+	byte_buffer b = MakeTextBuffer(size);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(a == b);
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+	Search::set_isa(Search::detect());
+}
+BENCHMARK(BM_Compare)->ArgsProduct({ { 4096, 1 << 20 }, { Search::kScalar, Search::kSse2, Search::kAvx2 } });
+
+static void BM_Crc32c(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	if (!Crc32cKernel::set_isa((Crc32cKernel::Isa)state.range(1))) {
+		state.SkipWithError("isa not supported");
+		return;
+	}
+	byte_buffer buf = MakeTextBuffer(size);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(checksum<Crc32c>(buf));
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+	Crc32cKernel::set_isa(Crc32cKernel::detect());
+}
+BENCHMARK(BM_Crc32c)->ArgsProduct({ { 256, 4096, 1 << 20 }, { Crc32cKernel::kScalar, Crc32cKernel::kSse42, Crc32cKernel::kSse42Pclmul } });
+
+template<typename Checksum>
+static void BM_Checksum(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	byte_buffer buf = MakeTextBuffer(size);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(checksum<Checksum>(buf));
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK_TEMPLATE(BM_Checksum, Adler32)->Arg(4096)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Checksum, XXHash32)->Arg(4096)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Checksum, XXHash64)->Arg(4096)->Arg(1 << 20);
+
+// range(1)为LargeCopy::Method，阈值设置为0，所有拷贝都使用指定的实现
+static void BM_LargeCopy(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	if (!LargeCopy::set_method((LargeCopy::Method)state.range(1))) {
+		state.SkipWithError("method not supported");
+		return;
+	}
+	size_t threshold = LargeCopy::threshold();
+	LargeCopy::set_threshold(0);
+	byte_buffer src(size, 1);
+	for (auto _ : state) {
+		byte_buffer copy(src);
+		benchmark::DoNotOptimize(copy.begin());
+	}
+	LargeCopy::set_threshold(threshold);
+	LargeCopy::set_method(LargeCopy::detect());
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_LargeCopy)->ArgsProduct({ { 64 << 10, 4 << 20, 64 << 20 }, { LargeCopy::kMemcpy, LargeCopy::kRepMovsb, LargeCopy::kNonTemporal } });
+
+// range(1)为0时串行
+static void BM_ParallelCopy(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	ParallelPolicy policy = state.range(1) ? ParallelPolicy() : ParallelPolicy::serial();
+	byte_buffer src(size, 1);
+	for (auto _ : state) {
+		byte_buffer copy = parallel_copy(src, policy);
+		benchmark::DoNotOptimize(copy.begin());
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ParallelCopy)->ArgsProduct({ { 1 << 20, 256 << 20 }, { 0, 1 } })->UseRealTime();
+
+static void BM_ParallelCrc32c(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	ParallelPolicy policy = state.range(1) ? ParallelPolicy() : ParallelPolicy::serial();
+	byte_buffer src(size, 1);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(parallel_checksum<Crc32c>(src, policy));
+	}
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ParallelCrc32c)->ArgsProduct({ { 1 << 20, 256 << 20 }, { 0, 1 } })->UseRealTime();
+
+// range(0)为每个字段的位数
+static void BM_BitRead(benchmark::State& state) {
+	const unsigned n = (unsigned)state.range(0);
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	BitStreamT<byte_streambuffer> bits(stream);
+	const size_t count = 64 * 1024 * 8 / n;
+	for (size_t i = 0; i < count; i++) {
+		bits.write_bits(i * 2654435761U, n);
+	}
+	bits.sync_write();
+	for (auto _ : state) {
+		bits.reset_read();
+		uint64_t sum = 0;
+		for (size_t i = 0; i < count; i++) {
+			sum += bits.read_bits(n);
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_BitRead)->Arg(1)->Arg(5)->Arg(13)->Arg(32);
+
+static void BM_ReadUe(benchmark::State& state) {
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	BitStreamT<byte_streambuffer> bits(stream);
+	const size_t count = 16 * 1024;
+	for (size_t i = 0; i < count; i++) {
+		bits.write_ue(i % 300);
+	}
+	bits.sync_write();
+	for (auto _ : state) {
+		bits.reset_read();
+		uint64_t sum = 0;
+		for (size_t i = 0; i < count; i++) {
+			sum += bits.read_ue();
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ReadUe);
+
+// range(0)为每帧的大小，一次遍历64KB中所有的帧
+static void BM_FrameReader(benchmark::State& state) {
+	const size_t size = (size_t)state.range(0);
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	Be32LengthPrefix format;
+	std::vector<uint8_t> payload(size, 1);
+	const size_t count = 64 * 1024 / (size + 4);
+	for (size_t i = 0; i < count; i++) {
+		format.write(stream, &payload.front(), payload.size());
+	}
+	for (auto _ : state) {
+		size_t total = 0;
+		for (BufferSpanT<const uint8_t> frame : frames(stream, format)) {
+			total += frame.size();
+		}
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_FrameReader)->Arg(16)->Arg(256)->Arg(4096);
+
+// 构造一个64字节的包，Buffer为byte_buffer或StaticBufferT<64>
+template<typename Buffer>
+static void BM_BuildPacket(benchmark::State& state) {
+	uint32_t seq = 0;
+	for (auto _ : state) {
+		StreamBufferT<uint8_t, Buffer> packet(StreamBufferT<uint8_t, Buffer>::kGrowableWrite);
+		packet.write_be(uint16_t(0x0800));
+		packet.write_be(seq++);
+		for (int i = 0; i < 7; i++) {
+			packet.write_le(uint64_t(i));
+		}
+		benchmark::DoNotOptimize(packet.buf().begin());
+	}
+}
+BENCHMARK_TEMPLATE(BM_BuildPacket, byte_buffer);
+BENCHMARK_TEMPLATE(BM_BuildPacket, StaticBufferT<64>);
+
+// 多个线程追加64字节的记录，第0个线程定期取走：ConcurrentAppendBufferT / 互斥锁保护的byte_buffer
+static void BM_ConcurrentAppend(benchmark::State& state) {
+	static byte_concurrent_buffer* batch;
+	if (state.thread_index() == 0)
+		batch = new byte_concurrent_buffer(1 << 20);
+	uint8_t record[64] = { 0 };
+	byte_buffer out;
+	size_t n = 0;
+	for (auto _ : state) {
+		batch->append(record, sizeof(record));
+		if (state.thread_index() == 0 && ++n % 1024 == 0)
+			batch->take(out);
+	}
+	state.SetBytesProcessed(state.iterations() * sizeof(record));
+	if (state.thread_index() == 0)
+		delete batch;
+}
+BENCHMARK(BM_ConcurrentAppend)->Threads(1)->Threads(4)->Threads(8);
+
+static void BM_MutexAppend(benchmark::State& state) {
+	static std::mutex mutex;
+	static byte_buffer batch;
+	uint8_t record[64] = { 0 };
+	size_t n = 0;
+	for (auto _ : state) {
+		std::lock_guard<std::mutex> lock(mutex);
+		batch.append(record, sizeof(record));
+		if (state.thread_index() == 0 && ++n % 1024 == 0)
+			batch.truncate(0);
+	}
+	state.SetBytesProcessed(state.iterations() * sizeof(record));
+}
+BENCHMARK(BM_MutexAppend)->Threads(1)->Threads(4)->Threads(8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,327 @@
+#ifndef FTL_ALIGNED_ALLOCATOR_H_
+#define FTL_ALIGNED_ALLOCATOR_H_
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#endif
+
+#include <mutex>
+#include <unordered_map>
+
+#include "buffer.h"
+
+/**
+	AlignedAllocator，按照Alignment对齐分配内存，作为SimpleBufferT的_Alloc参数使用
+
+	对齐：
+		Alignment为2的幂，不超过4096，用于对齐的SIMD读取，4096可以用于O_DIRECT
+
+		typedef SimpleBufferT<uint8_t, AlignedAllocator<uint8_t, 4096> > direct_continer;
+
+	大页：
+		HugePageThreshold不为0时，不小于HugePageThreshold的块使用匿名映射，
+		Linux先尝试MAP_HUGETLB，没有预留大页时使用普通映射并且madvise(MADV_HUGEPAGE)使用透明大页，
+		reallocate使用mremap，不需要复制数据；
+		Windows尝试MEM_LARGE_PAGES(需要SeLockMemoryPrivilege权限)，失败时使用普通的VirtualAlloc
+		映射的块不在映射内保存头部，大小等信息记录在MappedBlockTable中，数据从映射的起点开始，
+		N * 2M的请求只映射N * 2M，并且按照2M对齐
+
+		huge_byte_buffer batch(256 * 1024 * 1024);  // 超过2M使用大页
+*/
+
+#ifndef FTL_HUGE_PAGE_SIZE
+#define FTL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+namespace ftl {
+
+	namespace buffer_internal {
+
+		struct AlignedBlockHeader {
+			uint64_t size;		// 可用字节数，不含头部
+			uint64_t mapped;	// 映射的总字节数，0表示在堆上分配
+			uint32_t huge_tlb;	// 是否为MAP_HUGETLB/MEM_LARGE_PAGES映射
+			uint32_t reserved;
+		};
+
+		inline size_t SystemPageSize() {
+#ifdef _WIN32
+			SYSTEM_INFO info;
+			::GetSystemInfo(&info);
+			return (size_t)info.dwPageSize;
+#else
+			return (size_t)::sysconf(_SC_PAGESIZE);
+#endif
+		}
+
+		inline size_t RoundUpTo(size_t value, size_t align) {
+			return (value + align - 1) / align * align;
+		}
+
+		/**
+			映射块的头部信息，以数据地址为键，只在映射和解除映射时加锁，块的数量很少
+			对象不析构，静态对象的析构函数中仍然可以释放块
+		*/
+		class MappedBlockTable {
+		public:
+			static MappedBlockTable& instance() {
+				static MappedBlockTable* table = new MappedBlockTable();
+				return *table;
+			}
+
+			void insert(const void* p, const AlignedBlockHeader& header) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				blocks_[p] = header;
+			}
+
+			bool find(const void* p, AlignedBlockHeader& header) const {
+				std::lock_guard<std::mutex> lock(mutex_);
+				std::unordered_map<const void*, AlignedBlockHeader>::const_iterator it = blocks_.find(p);
+				if (it == blocks_.end())
+					return false;
+				header = it->second;
+				return true;
+			}
+
+			void erase(const void* p) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				blocks_.erase(p);
+			}
+
+		private:
+			mutable std::mutex mutex_;
+			std::unordered_map<const void*, AlignedBlockHeader> blocks_;
+		};
+
+		// 匿名映射至少size个字节，header.mapped返回实际映射的字节数，失败时返回nullptr
+		// 不小于FTL_HUGE_PAGE_SIZE的映射按照FTL_HUGE_PAGE_SIZE对齐，透明大页才能覆盖整个块
+		inline void* MapPages(size_t size, AlignedBlockHeader& header) {
+#ifdef _WIN32
+			size_t large_page = (size_t)::GetLargePageMinimum();
+			if (large_page > 0) {
+				size_t length = RoundUpTo(size, large_page);
+				void* p = ::VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (p) {
+					header.mapped = length;
+					header.huge_tlb = 1;
+					return p;
+				}
+			}
+			size_t length = RoundUpTo(size, SystemPageSize());
+			void* p = ::VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if (!p)
+				return nullptr;
+			header.mapped = length;
+			header.huge_tlb = 0;
+			return p;
+#else
+#if defined(MAP_HUGETLB)
+			size_t huge_length = RoundUpTo(size, FTL_HUGE_PAGE_SIZE);
+			void* huge = ::mmap(nullptr, huge_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (huge != MAP_FAILED) {
+				header.mapped = huge_length;
+				header.huge_tlb = 1;
+				return huge;
+			}
+#endif
+			size_t length = RoundUpTo(size, SystemPageSize());
+			// 多映射一个大页，再去掉前后不对齐的部分
+			size_t slack = (length >= (size_t)FTL_HUGE_PAGE_SIZE ? (size_t)FTL_HUGE_PAGE_SIZE : 0);
+			void* mapping = ::mmap(nullptr, length + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mapping == MAP_FAILED)
+				return nullptr;
+			void* p = mapping;
+			if (slack) {
+				uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+				uintptr_t aligned = (start + slack - 1) & ~(uintptr_t)(slack - 1);
+				if (aligned > start)
+					::munmap(mapping, (size_t)(aligned - start));
+				if (aligned - start < slack)
+					::munmap(reinterpret_cast<void*>(aligned + length), (size_t)(slack - (aligned - start)));
+				p = reinterpret_cast<void*>(aligned);
+			}
+#if defined(MADV_HUGEPAGE)
+			::madvise(p, length, MADV_HUGEPAGE);
+#endif
+			header.mapped = length;
+			header.huge_tlb = 0;
+			return p;
+#endif
+		}
+
+		inline void UnmapPages(void* p, const AlignedBlockHeader& header) {
+#ifdef _WIN32
+			::VirtualFree(p, 0, MEM_RELEASE);
+#else
+			::munmap(p, (size_t)header.mapped);
+#endif
+		}
+
+		// 修改映射的大小，可能移动地址，不支持时返回nullptr，由调用者复制
+		inline void* RemapPages(void* p, size_t size, AlignedBlockHeader& header) {
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+			size_t length = RoundUpTo(size, header.huge_tlb ? (size_t)FTL_HUGE_PAGE_SIZE : SystemPageSize());
+			if (length == header.mapped)
+				return p;
+			void* np = ::mremap(p, (size_t)header.mapped, length, MREMAP_MAYMOVE);
+			if (np == MAP_FAILED)
+				return nullptr;
+			header.mapped = length;
+			return np;
+#else
+			return nullptr;
+#endif
+		}
+
+		inline void* AlignedHeapAllocate(size_t alignment, size_t size) {
+#ifdef _WIN32
+			return ::_aligned_malloc(size, alignment);
+#else
+			void* p = nullptr;
+			if (::posix_memalign(&p, alignment, size) != 0)
+				return nullptr;
+			return p;
+#endif
+		}
+
+		inline void AlignedHeapFree(void* p) {
+#ifdef _WIN32
+			::_aligned_free(p);
+#else
+			::free(p);
+#endif
+		}
+
+		/**
+			堆上的块在数据前面保留HEADER_SIZE个字节保存AlignedBlockHeader，HEADER_SIZE是Alignment的倍数，
+			所以数据和块的起始地址对齐方式相同；映射的块数据就是映射的起点，头部保存在MappedBlockTable中
+			映射的起点按页对齐，只有页对齐的指针需要查找MappedBlockTable
+		*/
+		template<typename T, size_t Alignment = 64, size_t HugePageThreshold = 0>
+		struct AlignedAllocator {
+			static_assert(Alignment >= sizeof(void*) && (Alignment & (Alignment - 1)) == 0, "Alignment must be power of 2");
+			static_assert(Alignment <= 4096, "Alignment can not exceed page size");
+
+			static const size_t ALIGNMENT = Alignment;
+			static const size_t HUGE_PAGE_THRESHOLD = HugePageThreshold;
+			static const size_t HEADER_SIZE = (sizeof(AlignedBlockHeader) + Alignment - 1) / Alignment * Alignment;
+
+			T* allocate(size_t size) {
+				AlignedBlockHeader header;
+				header.size = size;
+				header.mapped = 0;
+				header.huge_tlb = 0;
+				header.reserved = 0;
+				if (use_pages(size)) {
+					void* base = MapPages(size, header);
+					if (!base)
+						return nullptr;
+					MappedBlockTable::instance().insert(base, header);
+					return reinterpret_cast<T*>(base);
+				}
+				void* base = AlignedHeapAllocate(Alignment, HEADER_SIZE + size);
+				if (!base)
+					return nullptr;
+				return attach(base, header);
+			}
+
+			void deallocate(T* p) {
+				if (!p)
+					return;
+				AlignedBlockHeader header;
+				if (find_mapped(p, header)) {
+					MappedBlockTable::instance().erase(p);
+					UnmapPages(p, header);
+				} else {
+					AlignedHeapFree(reinterpret_cast<uint8_t*>(p) - HEADER_SIZE);
+				}
+			}
+
+			T* reallocate(T* p, size_t size) {
+				if (!p)
+					return allocate(size);
+				AlignedBlockHeader header;
+				bool is_mapped = find_mapped(p, header);
+				if (!is_mapped)
+					header = *header_of(p);
+				// 映射之间使用mremap
+				if (is_mapped && use_pages(size)) {
+					AlignedBlockHeader new_header = header;
+					void* base = RemapPages(p, size, new_header);
+					if (base) {
+						new_header.size = size;
+						MappedBlockTable& table = MappedBlockTable::instance();
+						table.erase(p);
+						table.insert(base, new_header);
+						return reinterpret_cast<T*>(base);
+					}
+				}
+				T* np = allocate(size);
+				if (np) {
+					std::memcpy(np, p, std::min<size_t>(size, (size_t)header.size));
+					deallocate(p);
+				}
+				return np;
+			}
+
+			// p是否使用映射分配
+			static bool mapped(const T* p) {
+				AlignedBlockHeader header;
+				return p && find_mapped(p, header);
+			}
+
+			// p是否使用MAP_HUGETLB/MEM_LARGE_PAGES映射
+			static bool huge_tlb(const T* p) {
+				AlignedBlockHeader header;
+				return p && find_mapped(p, header) && header.huge_tlb != 0;
+			}
+
+		private:
+			static inline bool use_pages(size_t size) {
+				return HugePageThreshold > 0 && size >= HugePageThreshold;
+			}
+
+			// 不使用映射或者指针不按页对齐时不查表，堆上分配的块不加锁
+			static inline bool find_mapped(const T* p, AlignedBlockHeader& header) {
+				if (HugePageThreshold == 0 || (reinterpret_cast<uintptr_t>(p) & (page_size() - 1)) != 0)
+					return false;
+				return MappedBlockTable::instance().find(p, header);
+			}
+
+			static size_t page_size() {
+				static const size_t page = SystemPageSize();
+				return page;
+			}
+
+			static inline AlignedBlockHeader* header_of(const T* p) {
+				return reinterpret_cast<AlignedBlockHeader*>(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(p)) - sizeof(AlignedBlockHeader));
+			}
+
+			static inline T* attach(void* base, const AlignedBlockHeader& header) {
+				T* p = reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(base) + HEADER_SIZE);
+				*header_of(p) = header;
+				return p;
+			}
+		};
+
+		template<typename T, size_t Alignment, size_t HugePageThreshold>
+		const size_t AlignedAllocator<T, Alignment, HugePageThreshold>::HEADER_SIZE;
+
+	} // namespace buffer_internal
+
+	typedef BufferT<uint8_t, buffer_internal::SimpleBufferT<uint8_t, buffer_internal::AlignedAllocator<uint8_t, 64> > > aligned_byte_buffer;
+	typedef StreamBufferT<uint8_t, aligned_byte_buffer> aligned_byte_streambuffer;
+	typedef BufferT<uint8_t, buffer_internal::SimpleBufferT<uint8_t, buffer_internal::AlignedAllocator<uint8_t, 64, FTL_HUGE_PAGE_SIZE> > > huge_byte_buffer;
+	typedef StreamBufferT<uint8_t, huge_byte_buffer> huge_byte_streambuffer;
+
+} // namespace ftl
+
+#endif // FTL_ALIGNED_ALLOCATOR_H_
@@ -0,0 +1,303 @@
+#ifndef FTL_BIT_STREAM_H_
+#define FTL_BIT_STREAM_H_
+
+#include "buffer.h"
+
+/**
+	BitStreamT，在StreamBufferT上按位读写，和StreamBufferT共享同一块内存，用于H.264/AAC等码流和按位打包的数据
+	高位在前(MSB first)，和H.264/AAC的约定相同
+
+	读取：
+		从StreamBufferT的read_index开始，一次按照大端加载8个字节到64位的缓存，之后的read_bits()只做移位；
+		StreamBufferT的read_index只在sync_read()时前进到已经读取的字节之后
+
+		BitStreamT<> bits(stream);
+		uint64_t type = bits.read_bits(5);
+		uint64_t width = bits.read_ue();          // 无符号指数哥伦布编码
+		int64_t delta = bits.read_se();           // 有符号指数哥伦布编码
+		bits.sync_read();                         // 丢弃不足一个字节的位，stream从下一个字节继续读取
+
+	写入：
+		写入64位的缓存，满64位时通过write_be(uint64_t)写入StreamBufferT；
+		sync_write()补0到字节边界，把缓存的数据写入StreamBufferT
+
+		bits.write_bits(1, 1);
+		bits.write_ue(100);
+		bits.sync_write();
+
+	包装期间不能对StreamBufferT调用compact()，直接读写StreamBufferT之前先调用sync_read()/sync_write()
+	读取越界时抛出std::out_of_range，不改变读取的位置
+*/
+
+namespace ftl {
+
+	template<typename Stream = StreamBufferT<uint8_t> >
+	class BitStreamT {
+	public:
+		typedef typename Stream::size_type size_type;
+		typedef typename Stream::value_type value_type;
+
+		static_assert(sizeof(value_type) == 1, "BitStreamT need 8bit value_type");
+
+		// 一次refill()之后缓存中至少有这么多位(数据足够时)，不超过这个长度的读取只需要一次检查
+		static const unsigned MIN_CACHED_BITS = 56;
+
+		explicit BitStreamT(Stream& stream):
+			stream_(stream),
+			read_cache_(0),
+			read_bits_(0),
+			read_pos_(stream.read_index()),
+			write_cache_(0),
+			write_bits_(0) {
+		}
+
+		// 读取n(<= 64)位，高位在前
+		inline uint64_t read_bits(unsigned n) {
+			if (n > MIN_CACHED_BITS)
+				return read_long_bits(n);
+			if (read_bits_ < n) {
+				refill();
+				if (FTL_BUFFER_UNLIKELY(read_bits_ < n))
+					xran(n);
+			}
+			return consume(n);
+		}
+
+		inline bool read_bit() {
+			return read_bits(1) != 0;
+		}
+
+		// 返回之后的n(<= 56)位，不移动读取的位置
+		inline uint64_t peek_bits(unsigned n) {
+			if (read_bits_ < n) {
+				refill();
+				if (FTL_BUFFER_UNLIKELY(read_bits_ < n))
+					xran(n);
+			}
+			return n == 0 ? 0 : read_cache_ >> (64 - n);
+		}
+
+		void skip_bits(size_type n) {
+			if (n <= read_bits_) {
+				consume((unsigned)n);
+				return;
+			}
+			if (FTL_BUFFER_UNLIKELY(n > bits_left()))
+				xran(n);
+			// 整字节直接移动位置，不经过缓存
+			n -= read_bits_;
+			read_cache_ = 0;
+			read_bits_ = 0;
+			read_pos_ += n / 8;
+			n %= 8;
+			if (n > 0) {
+				refill();
+				consume((unsigned)n);
+			}
+		}
+
+		/**
+			无符号指数哥伦布编码ue(v)：lz个0，1，lz位的后缀，值为(1 << lz | 后缀) - 1
+			缓存中已经有完整的编码时，通过最高位1的位置一次取出
+		*/
+		uint64_t read_ue() {
+			if (read_bits_ < 32)
+				refill();
+			if (read_cache_ != 0) {
+				unsigned lz = 63 - buffer_internal::Log2Floor64(read_cache_);
+				if (2 * lz + 1 <= read_bits_)
+					return consume(2 * lz + 1) - 1;
+			}
+			return read_ue_slow();
+		}
+
+		// 有符号指数哥伦布编码se(v)：k为奇数时是(k + 1) / 2，偶数时是-(k / 2)
+		int64_t read_se() {
+			uint64_t k = read_ue();
+			return (k & 1) ? (int64_t)((k >> 1) + 1) : -(int64_t)(k >> 1);
+		}
+
+		// 丢弃到下一个字节边界
+		void align_read() {
+			consume(read_bits_ & 7);
+		}
+
+		bool read_aligned() const {
+			return (read_bits_ & 7) == 0;
+		}
+
+		// 剩余可以读取的位数
+		size_type bits_left() const {
+			size_type size = stream_.data_end();
+			return (size > read_pos_ ? (size - read_pos_) * 8 : 0) + read_bits_;
+		}
+
+		// 丢弃不足一个字节的位，StreamBufferT的read_index前进到已经读取的字节之后
+		void sync_read() {
+			align_read();
+			size_type index = read_pos_ - read_bits_ / 8;
+			if (index > stream_.read_index())
+				stream_.read_span(index - stream_.read_index());
+			reset_read();
+		}
+
+		// 直接读取StreamBufferT之后，从新的read_index重新开始
+		void reset_read() {
+			read_cache_ = 0;
+			read_bits_ = 0;
+			read_pos_ = stream_.read_index();
+		}
+
+		// 写入v的低n(<= 64)位，高位在前
+		inline void write_bits(uint64_t v, unsigned n) {
+			if (n == 0)
+				return;
+			if (n < 64)
+				v &= ((uint64_t)1 << n) - 1;
+			unsigned free = 64 - write_bits_;
+			if (n < free) {
+				write_cache_ |= v << (free - n);
+				write_bits_ += n;
+				return;
+			}
+			// 填满64位，整体按照大端写入
+			unsigned rest = n - free;
+			write_cache_ |= v >> rest;
+			stream_.write_be(write_cache_);
+			write_cache_ = rest ? v << (64 - rest) : 0;
+			write_bits_ = rest;
+		}
+
+		inline void write_bit(bool v) {
+			write_bits(v ? 1 : 0, 1);
+		}
+
+		// v不能是UINT64_MAX，编码需要129位
+		void write_ue(uint64_t v) {
+			uint64_t x = v + 1;
+			unsigned len = buffer_internal::Log2Floor64(x) + 1;
+			write_bits(0, len - 1);
+			write_bits(x, len);
+		}
+
+		// v不能是INT64_MIN
+		void write_se(int64_t v) {
+			write_ue(v > 0 ? (uint64_t)v * 2 - 1 : (uint64_t)(-v) * 2);
+		}
+
+		// 补0到字节边界
+		void align_write() {
+			write_bits(0, (8 - (write_bits_ & 7)) & 7);
+		}
+
+		bool write_aligned() const {
+			return (write_bits_ & 7) == 0;
+		}
+
+		// 已经写入、还没有进入StreamBufferT的位数
+		unsigned pending_bits() const {
+			return write_bits_;
+		}
+
+		// 补0到字节边界，缓存的数据写入StreamBufferT
+		void sync_write() {
+			align_write();
+			if (write_bits_ > 0) {
+				uint8_t bytes[8];
+				buffer_internal::Endian::write<uint8_t, uint64_t, buffer_internal::Endian::kBigEndian>(bytes, write_cache_);
+				stream_.write_bytes(bytes, write_bits_ / 8);
+			}
+			write_cache_ = 0;
+			write_bits_ = 0;
+		}
+
+		Stream& stream() {
+			return stream_;
+		}
+
+	private:
+		Stream& stream_;
+		// 读取的缓存，有效的位在高位，read_pos_是下一个加载到缓存的字节
+		uint64_t read_cache_;
+		unsigned read_bits_;
+		size_type read_pos_;
+		// 写入的缓存，有效的位在高位
+		uint64_t write_cache_;
+		unsigned write_bits_;
+
+		BitStreamT(const BitStreamT&);
+		BitStreamT& operator=(const BitStreamT&);
+
+		// 取出缓存的高n位，调用者保证n <= read_bits_
+		inline uint64_t consume(unsigned n) {
+			if (n == 0)
+				return 0;
+			uint64_t rv = read_cache_ >> (64 - n);
+			read_cache_ = n < 64 ? read_cache_ << n : 0;
+			read_bits_ -= n;
+			return rv;
+		}
+
+		/**
+			把缓存补到至少MIN_CACHED_BITS位：剩余不少于8个字节时一次按照大端加载8个字节，
+			只前进完整放入缓存的字节，多出来的低位和下次加载的内容相同，或运算不会改变结果
+		*/
+		inline void refill() {
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(stream_.buf().continer().begin());
+			size_type size = stream_.data_end();
+			if (read_pos_ + 8 <= size) {
+				read_cache_ |= buffer_internal::Endian::read<uint8_t, uint64_t, buffer_internal::Endian::kBigEndian>(data + read_pos_) >> read_bits_;
+				unsigned n = (63 - read_bits_) >> 3;
+				read_pos_ += n;
+				read_bits_ += n * 8;
+				return;
+			}
+			while (read_bits_ <= MIN_CACHED_BITS && read_pos_ < size) {
+				read_cache_ |= (uint64_t)data[read_pos_++] << (56 - read_bits_);
+				read_bits_ += 8;
+			}
+		}
+
+		FTL_BUFFER_NOINLINE uint64_t read_long_bits(unsigned n) {
+			if (FTL_BUFFER_UNLIKELY(n > 64 || n > bits_left()))
+				xran(n);
+			uint64_t hi = read_bits(n - 32);
+			return (hi << 32) | read_bits(32);
+		}
+
+		FTL_BUFFER_NOINLINE uint64_t read_ue_slow() {
+			// 编码不完整时恢复读取的位置
+			uint64_t cache = read_cache_;
+			unsigned bits = read_bits_;
+			size_type pos = read_pos_;
+			unsigned lz = 0;
+			bool found = false;
+			while (lz <= 63 && bits_left() > 0) {
+				if ((found = read_bit()))
+					break;
+				lz++;
+			}
+			if (FTL_BUFFER_UNLIKELY(!found || bits_left() < lz)) {
+				read_cache_ = cache;
+				read_bits_ = bits;
+				read_pos_ = pos;
+				xran(2 * lz + 1);
+			}
+			return (((uint64_t)1 << lz) | read_bits(lz)) - 1;
+		}
+
+		[[noreturn]] FTL_BUFFER_NOINLINE FTL_BUFFER_COLD void xran(size_type need_bits) const {
+			FTL_BUFFER_STAT(bounds_failures, 1);
+			char buf[96];
+			snprintf(buf, sizeof(buf), "BitStreamT(%p) read, bits_left=%08zx, need_bits=%08zx",
+				(const void*)this, (size_t)bits_left(), (size_t)need_bits);
+			throw std::out_of_range(std::string(buf));
+		}
+	};
+
+	template<typename Stream>
+	const unsigned BitStreamT<Stream>::MIN_CACHED_BITS;
+
+} // namespace ftl
+
+#endif // FTL_BIT_STREAM_H_
@@ -1,2 +1,2 @@
-#include "ftl/buffer.h"
-
+#include "ftl/buffer.h"
+
@@ -1,1097 +1,4505 @@
-#ifndef FTL_BUFFER_H_
-#define FTL_BUFFER_H_
-
-#include <vector>
-#include <cstdint>
-#include <cstring>
-#include <type_traits>
-#include <algorithm>
-#include <string>
-#include <stdexcept>
-
-/**
-	BufferStreamBuffer࣬ṩԻĶд
-
-	죺
-		BufferStreamBufferṩ๹죺ⲿⲿ
-		ⲿڲʹãⲿʹü򵥷㣬磺
-		byte_buffer buffer(32, 0); // һ32ֽڵģʼֵΪ0Ļ
-		byte_buffer buffer(p, 10); // ⲿP10ֽ
-
-		ⲿҪǿٶдڴʹ
-		byte_buffer buffer = byte_buffer::ref(p, 10); // ⲿָָp
-
-	д룺
-		дṩ˶Ի͵Ķдṩ˴С˴
-
-		buffer.write((uint8_t)10, 0);  // 0λд10Ϊuint8_t
-		buffer.write((double)15.0f, 0); // 0λдdouble 15.0
-		buffer.write_be((uint16_t)0xffee, 0); // ˷ʽд0xffee
-		buffer.write_le((uint16_t)0xffee, 0); // Сηʽд0xffee
-
-		write_bytesṩдchar* /signed char* /unsigned char*
-
-		⣬ṩappendĩβдݣ÷ᵼbufferref͵buffer
-		ôп
-
-		writeдˣλóС׳쳣
-
-	ȡ
-		ȡṩԼС֧֣磺
-		buffer.read<char>(0); // 0λãȡһchar
-		buffer.read_be<uint16_t>(0); // 0λãմ˷ʽȡһuint16_t
-		buffer.read_le<uint16_t>(0); // 0λãС˷ʽȡһuint16_t
-
-	ʽд
-		ʹStreamBufferôڲάдλãⲿڶдʱ򣬲Ҫλò
-		ͨread_eof/write_eofжǷ˽β
-*/
-
-namespace ftl {
-
-    namespace buffer_internal {
-
-        template<typename _Ty>
-        class VectorContinerT {
-        public:
-            typedef _Ty value_type;
-			typedef _Ty& reference;
-			typedef _Ty& const_reference;
-            typedef _Ty* pointer;
-            typedef const _Ty* const_pointer;
-            typedef _Ty* iterator;
-            typedef const _Ty* const_iterator;
-            typedef size_t size_type;
-
-            VectorContinerT() {}
-
-            VectorContinerT(size_type size, const _Ty& value):
-                buf_(size, value) { }
-
-            VectorContinerT(const VectorContinerT& other):
-                buf_(other.buf_){ }
-
-            VectorContinerT(VectorContinerT&& other) :
-                buf_(std::move(other.buf_)){ }
-
-            size_type size() const {
-                return buf_.size();
-            }
-
-            bool empty() const {
-                return buf_.empty();
-            }
-
-            void resize(size_type size) {
-                buf_.resize(size);
-            }
-
-			iterator begin() {
-                return buf_._Myfirst();
-            }
-
-			const_iterator begin() const {
-                return buf_._Myfirst();
-            }
-
-			iterator end() {
-                return buf_._Myend();
-            }
-
-			const_iterator end() const {
-                return buf_._Myend();
-            }
-
-            size_type capacity() const{
-                return buf_.capacity();
-            }
-
-            void shrink() {
-                buf_.shrink_to_fit();
-            }
-
-            void shrink_to_fit() {
-                buf_.shrink_to_fit();
-            }
-
-            void clear() {
-                buf_.clear();
-            }
-
-            VectorContinerT& operator=(const VectorContinerT& other) {
-				buf_.resize(other.size());
-				std::memcpy(begin(), other.begin(), other.size());
-				return *this;
-            }
-
-            VectorContinerT& operator=(VectorContinerT&& other) {
-				buf_ = std::move(other.buf_);
-				return *this;
-            }
-
-        private:
-            std::vector<_Ty> buf_;
-        };
-
-        template<typename T>
-        struct DefaultAllocator {
-            T* allocate(size_t size) {
-                return reinterpret_cast<T*>(::malloc(size));
-            }
-
-            void deallocate(T* p) {
-                return ::free(p);
-            }
-
-            T* reallocate(T* p, size_t size) {
-                return reinterpret_cast<T*>(::realloc(p, size));
-            }
-        };
-
-        template<typename _Ty, typename _Alloc = DefaultAllocator<_Ty>, int DefaultMiniReserveSize = 32>
-        class SimpleBufferT {
-			static const int DEFAULT_SHRINK_TRIGGER_COUNT = 2;
-			static const int DEFAULT_MINI_SIZE = DefaultMiniReserveSize;
-        public:
-            typedef _Ty value_type;
-			typedef _Ty& reference;
-			typedef _Ty& const_reference;
-            typedef _Ty* pointer;
-            typedef const _Ty* const_pointer;
-            typedef _Ty* iterator;
-            typedef const _Ty* const_iterator;
-            typedef size_t size_type;			
-
-            SimpleBufferT():
-                buf_(nullptr),
-                size_(0),
-                capacity_(0),
-				shrink_counter_(0),
-                ref_(false){
-            }
-
-            SimpleBufferT(const SimpleBufferT& other):
-				buf_(nullptr),
-				size_(other.size()),
-				capacity_(0),
-				shrink_counter_(0),
-				ref_(false) {
-				reserve(other.size());
-				memcpy(begin(), other.begin(), other.size());
-            }
-
-			explicit SimpleBufferT(size_t size) :
-				buf_(nullptr),
-				size_(size),
-				capacity_(0),
-				shrink_counter_(0),
-				ref_(false) {
-				reserve(size);
-				size_ = size;
-			}
-
-            SimpleBufferT(size_t size, const _Ty& val):
-				buf_(nullptr),
-				size_(size),
-				capacity_(0),
-				shrink_counter_(0),
-				ref_(false) {
-				reserve(size);
-				size_ = size;
-				std::memset(begin(), val, size);
-            }
-
-            SimpleBufferT(const_pointer buf, size_type size):
-				buf_(nullptr),
-				size_(size),
-				capacity_(0),
-				shrink_counter_(0),
-				ref_(false) {
-				if (buf != nullptr && size > 0) {
-					reserve(size);
-					size_ = size;
-					std::memcpy(begin(), buf, size);
-				}
-            }
-
-			explicit SimpleBufferT(const std::vector<_Ty>& vec):
-				buf_(nullptr),
-				size_(0),
-				capacity_(0),
-				shrink_counter_(0),
-				ref_(false) {
-				if (vec.size() > 0) {
-					reserve(vec.size());
-					size_ = vec.size();
-					std::memcpy(begin(), &vec.front(), size_);
-				}
-            }
-            
-            SimpleBufferT(SimpleBufferT&& other) {
-                buf_ = other.buf_;
-                size_ = other.size_;
-                capacity_ = other.capacity_;
-				shrink_counter_ = other.shrink_counter_;
-				ref_ = other.ref_;
-				alloc_ = std::move(other.alloc_);
-
-                other.buf_ = nullptr;
-                other.size_ = 0;
-                other.capacity_ = 0;
-				other.ref_ = false;
-				other.shrink_counter_ = 0;
-            }
-
-			static SimpleBufferT ref(std::vector<_Ty>* vec) {
-				SimpleBufferT simple_buffer;
-				if (vec->empty()) {
-					simple_buffer.buf_ = nullptr;
-					simple_buffer.size_ = 0;
-					simple_buffer.capacity_ = 0;
-					simple_buffer.ref_ = false;
-					simple_buffer.shrink_counter_ = 0;
-				}
-				else {
-					simple_buffer.buf_ = &vec->front();
-					simple_buffer.capacity_ = simple_buffer.size_ = vec->size();
-					simple_buffer.ref_ = true;
-					simple_buffer.shrink_counter_ = 0;
-				}
-				return std::move(simple_buffer);
-			}
-
-			static SimpleBufferT ref(pointer buf, size_type size) {
-				SimpleBufferT simple_buffer;
-				if (buf != nullptr && size > 0) {
-					simple_buffer.buf_ = buf;
-					simple_buffer.capacity_ = simple_buffer.size_ = size;
-					simple_buffer.ref_ = true;
-				}
-				return std::move(simple_buffer);
-			}
-
-            ~SimpleBufferT() {
-				if (buf_ && !ref_) {
-					alloc_.deallocate(buf_);
-				}
-            }
-
-			SimpleBufferT& operator=(const SimpleBufferT& other) {
-				if (!other.empty()) {
-					resize(other.size());
-					ref_ = false;
-					shrink_counter_ = 0;
-					std::memcpy(buf_, other.buf_, size_);
-				}
-				else {
-					resize(0);
-				}
-				return *this;
-			}
-
-			SimpleBufferT& operator=(SimpleBufferT&& other) {
-				if (!other.empty()) {
-					buf_ = other.buf_;
-					size_ = other.size_;
-					capacity_ = other.capacity_;
-					shrink_counter_ = other.shrink_counter_;
-					ref_ = other.ref_;
-					alloc_ = std::move(other.alloc_);
-
-					other.buf_ = nullptr;
-					other.size_ = 0;
-					other.capacity_ = 0;
-					other.ref_ = false;
-					other.shrink_counter_ = 0;
-				}
-				else {
-					resize(0);
-				}
-				return *this;
-			}
-
-            inline iterator begin() {
-                return buf_;
-            }
-
-            inline const_iterator begin() const {
-                return buf_;
-            }
-
-            inline iterator end() {
-                return buf_ + size_;
-            }
-
-            inline const_iterator end() const {
-                return buf_ + size_;
-            }
-
-            size_type size() const {
-                return size_;
-            }
-
-			size_type capacity() const {
-				return capacity_;
-			}
-
-            void resize(size_type size) {
-                if (size == 0) {
-                    clear();
-                } else if (size > capacity_) {
-                    reserve(size);
-                }                
-                size_ = size;
-            }
-
-			void push_back(const value_type& val) {
-				size_type size = size_;
-				resize(size_ + sizeof(val));
-				buf_[size] = val;
-			}
-
-			void push_back(const SimpleBufferT& other) {
-				if (!other.empty()) {
-					size_type size = size_;
-					resize(size_ + other.size());
-					std::memcpy(begin() + size, other.buf_, other.size());
-				}
-			}
-
-			void shrink() {
-				if (size_ > 0 && size_ < 2 * capacity_) {
-					if (++shrink_counter_ > DEFAULT_SHRINK_TRIGGER_COUNT) {
-						reserve(size_);
-						shrink_counter_ = 0;
-					}
-				} else {
-					shrink_counter_ = 0;
-				}
-			}
-
-			void shrink_to_fit() {
-				if (size_ > 0) {
-					reserve(size_);
-				}
-				shrink_counter_ = 0;
-			}
-
-            bool empty() const {
-                return !size_;
-            }
-
-            void clear() {
-                if (buf_ && !ref_)
-                    alloc_.deallocate(buf_);
-                buf_ = nullptr;
-                size_ = 0;
-				ref_ = false;
-                capacity_ = 0;
-				shrink_counter_ = 0;
-            }
-
-        private:
-            pointer buf_;
-            size_type size_;
-            size_type capacity_;
-			int shrink_counter_;
-			_Alloc alloc_;
-            bool ref_;
-
-            void reserve(size_type size) {
-                if (size > capacity_) {
-                    capacity_ = std::max<size_type>(size, 2 * capacity_);
-                    capacity_ = std::max<size_type>(DEFAULT_MINI_SIZE, capacity_);
-                } else if (size < capacity_) {
-                    capacity_ = size;
-                } else {
-                    return;
-                }
-
-				pointer p = nullptr;
-				if (!ref_) {
-					p = alloc_.reallocate(buf_, capacity_);
-				} else {
-					p = alloc_.allocate(capacity_);
-					std::memcpy(p, buf_, size_);
-					ref_ = false;
-				}
-
-                if (!p)
-                    throw std::bad_alloc();
-
-                buf_ = p;
-            }
-        };
-
-		/**
-			ǷҪС˵Ļ
-			char/signed char/unsigned char֮⣬Ϊtrue
-		*/
-		template<typename T>
-		struct is_endian_basictype :std::false_type {};
-		template<>
-		struct is_endian_basictype<int16_t> :std::true_type {};
-		template<>
-		struct is_endian_basictype<uint16_t> :std::true_type {};
-		template<>
-		struct is_endian_basictype<int32_t> :std::true_type {};
-		template<>
-		struct is_endian_basictype<uint32_t> :std::true_type {};
-		template<>
-		struct is_endian_basictype<int64_t> :std::true_type {};
-		template<>
-		struct is_endian_basictype<uint64_t> :std::true_type {};
-		template<>
-		struct is_endian_basictype<float> :std::true_type {};
-		template<>
-		struct is_endian_basictype<double> :std::true_type {};
-
-		template<typename T>
-		struct is_8bit_basictype : std::false_type {};
-		template<>
-		struct is_8bit_basictype<char> : std::true_type {};
-		template<>
-		struct is_8bit_basictype<int8_t> : std::true_type {};
-		template<>
-		struct is_8bit_basictype<uint8_t> : std::true_type {};
-
-		class Endian {
-		public:
-			enum Endianness {
-				kBigEndian = 0,
-				kLittleEndian = 1
-			};
-
-			static inline void Swizzle(char* start, unsigned int len) {
-				char* end = start + len - 1;
-				while (start < end) {
-					char tmp = *start;
-					*start++ = *end;
-					*end-- = tmp;
-				}
-			}
-
-			static inline bool detect_big_endian(void) {
-				union {
-					uint32_t i;
-					char c[4];
-				} bint = { 0x01020304 };
-
-				return bint.c[0] == 1;
-			}
-
-			static inline Endianness CurrentEndian() {
-				static const Endianness endian =
-					(detect_big_endian() == true ? kBigEndian : kLittleEndian);
-				return endian;
-			}
-
-			static bool isBigEndian() {
-				static bool big_endian = detect_big_endian();
-				return big_endian;
-			}
-
-			template<typename _Ty, typename _RetTy, enum Endianness endianness>
-			static inline typename std::enable_if<is_endian_basictype<_RetTy>::value, _RetTy>::type
-				read(const _Ty* buf) {
-				union NoAlias {
-					_RetTy val;
-					char bytes[sizeof(_RetTy)];
-				};
-				union NoAlias na;
-				std::memcpy(na.bytes, buf, sizeof(_RetTy));
-				if (CurrentEndian() != endianness)
-					Swizzle(na.bytes, sizeof(_RetTy));
-				return na.val;
-			}
-
-			template<typename _Ty, typename _SrcTy, enum Endianness endianness>
-			static inline typename std::enable_if<is_endian_basictype<_SrcTy>::value, _Ty>::type*
-				write(_Ty* buf, const _SrcTy& value) {
-				union NoAlias {
-					_SrcTy val;
-					char bytes[sizeof(value)];
-				};
-				union NoAlias na = { value };
-				if (CurrentEndian() != endianness)
-					Swizzle(na.bytes, sizeof(value));
-				return reinterpret_cast<_Ty*>(std::memcpy(buf, na.bytes, sizeof(value)));
-			}
-		};
-        
-    } // namespace buffer_internal
-
-    template<typename _Ty, typename Continer = buffer_internal::SimpleBufferT<_Ty> >
-    class BufferT {
-    public:
-		typedef typename Continer::value_type value_type;
-		typedef typename Continer::reference reference;
-		typedef typename Continer::const_reference const_reference;
-		typedef typename Continer::pointer pointer;
-		typedef typename Continer::const_pointer const_pointer;
-		typedef typename Continer::iterator iterator;
-		typedef typename Continer::const_iterator const_iterator;
-		typedef typename Continer::size_type size_type;
-
-		BufferT() { }
-
-		BufferT(const BufferT& other):
-			continer_(other.continer_){
-
-		}
-
-		BufferT(BufferT&& other):
-			continer_(std::move(other.continer_)){
-
-		}
-		
-		explicit BufferT(size_type size):
-			continer_(size){
-
-		}
-
-		BufferT(size_type size, const value_type& val):
-			continer_(size, val){
-
-		}
-
-		BufferT(const_pointer buf, size_type size):
-			continer_(buf, size){
-
-		}
-
-		BufferT(const_pointer begin, const_pointer end) :
-			continer_(begin, end) {
-
-		}
-
-		explicit BufferT(const std::vector<_Ty>& vec):
-			continer_(vec){
-
-		}
-
-		explicit BufferT(std::vector<_Ty>&& vec) :
-			continer_(std::move(vec)) {
-
-		}
-
-		static BufferT ref(pointer buf, size_type size) {
-			Continer tmp = Continer::ref(buf, size);
-			BufferT rv;
-			rv.continer_ = std::move(tmp);
-			return rv;
-		}
-
-		static BufferT ref(std::vector<_Ty>* vec) {
-			Continer tmp = Continer::ref(vec);
-			BufferT rv;
-			rv.continer_ = std::move(tmp);
-			return rv;
-		}
-
-		void xran(size_t pos, size_t need_size) const {
-			char buf[80];
-			sprintf(buf, "BufferT(%08x), size=%08x, pos=%08x, need_size=%08x", (uint32_t)this, size(), pos, need_size);
-			throw std::out_of_range(std::string(buf));
-		}
-
-		pointer begin() { 
-			return continer_.begin();  
-		}
-
-		const_pointer begin() const {
-			return continer_.begin();
-		}
-
-		pointer end() {
-			return continer_.end();
-		}
-
-		const_pointer end() const {
-			return continer_.end();
-		}
-
-		size_type size() const {
-			return continer_.size();
-		}
-
-		size_type capacity() const {
-			return continer_.capacity();
-		}
-
-		void shrink() {
-			continer_.shrink();
-		}
-
-		void fill(const value_type& value, size_type offset, size_type count = 0) {
-			if (count == 0 || (offset + count) > size())
-				count = size() - offset;
-			std::fill(continer_.begin() + offset, continer_.begin() + offset + count, value);
-		}
-
-		BufferT slice(size_type offset, size_type count) const {
-			if (empty())
-				return BufferT();
-			else {
-				if (count + offset >= size())
-					return BufferT(begin() + offset, size() - offset);
-				else
-					return BufferT(begin() + offset, count);
-			}
-		}
-
-		void append(const std::vector<_Ty>& vec) {
-			if (!vec.empty()) {
-				size_type size = size;
-				continer_.resize(continer_.size() + vec.size());
-				std::memcpy(continer_.begin() + size, &vec.front(), vec.size());
-			}
-		}
-
-		BufferT& operator=(const BufferT& other) {
-			if (other.empty()) {
-				continer_.resize(0);
-			}
-			else {
-				continer_.resize(other.size());
-				std::memcpy(continer_.begin(), other.continer_.begin(), other.size());
-			}
-			return *this;
-		}
-
-		BufferT& operator+=(const BufferT& other) {
-			continer_.push_back(other.continer_);
-			return *this;
-		}
-
-		BufferT& operator+=(const std::vector<_Ty>& vec) {
-			if (!vec.empty()) {
-				size_type size = size;
-				continer_.resize(continer_.size() + vec.size());
-				std::memcpy(continer_.begin() + size, &vec.front(), vec.size());
-			}
-			return *this;
-		}
-
-		BufferT& operator=(BufferT&& other) {
-			continer_ = std::move(other.continer_);
-			return *this;
-		}
-
-		bool operator==(const BufferT& other) const {
-			if (other.size() == size())
-				return std::memcmp(continer_.begin(), other.continer_.begin(), size()) == 0;
-			else
-				return false;
-		}
-
-		bool empty() const {
-			return continer_.empty();
-		}
-
-		void resize(size_type size) {
-			continer_.resize(size);
-		}
-
-		void clear() {
-			return continer_.clear();
-		}
-
-		///////////////////////////////////////
-		// read functions
-		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
-		inline _RetTy read(size_type offset) const{
-			static_assert(buffer_internal::is_endian_basictype<_RetTy>::value, 
-				"read_le<>/read_be<>, only support int16_t/uint16_t, "
-				"int32_t/uint32_t, int64_t/uint64_t, float/double, "
-				"call read<>()/read_char/read_byte to read uint8_t/int8_t/char");
-			if (offset + sizeof(_RetTy) > size())
-				xran(offset, sizeof(_RetTy));
-
-			return buffer_internal::Endian::read<_Ty, _RetTy, endianness>(continer_.begin() + offset);
-		}
-
-		template<typename _RetTy>
-		inline _RetTy read_le(size_type offset) const {
-			return read<_RetTy, buffer_internal::Endian::kLittleEndian>(offset);
-		}
-
-		template<typename _RetTy>
-		inline _RetTy read_be(size_type offset) const {
-			return read<_RetTy, buffer_internal::Endian::kBigEndian>(offset);
-		}
-
-		// ݵǰֽȡ
-		template<typename _RetTy>
-		inline _RetTy read(size_type offset, 
-			typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value>::type* dummy = 0) const {
-			if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kBigEndian)
-				return read<_RetTy, buffer_internal::Endian::kBigEndian>(offset);
-			else
-				return read<_RetTy, buffer_internal::Endian::kLittleEndian>(offset);
-		}
-
-		template<typename _RetTy>
-		inline _RetTy read(size_type offset,
-			typename std::enable_if<buffer_internal::is_8bit_basictype<_RetTy>::value>::type* dummy = 0) const {
-			if (offset >= size())
-				xran(offset, sizeof(char));
-			return *(continer_.begin() + offset);
-		}
-
-		/*template<>
-		inline uint8_t read(size_type offset) const {
-			return read_byte(offset);
-		}
-
-		template<>
-		inline int8_t read<int8_t>(size_type offset) const {
-			return read_char(offset);
-		}
-
-		template<>
-		inline char read<char>(size_type offset) const {
-			return read_char(offset);
-		}*/
-
-		inline uint8_t read_byte(size_type offset) const {
-			if (offset >= size())
-				xran(offset, sizeof(uint8_t));
-			return *(continer_.begin() + offset);
-		}
-
-		inline char read_char(size_type offset) const {
-			if (offset >= size())
-				xran(offset, sizeof(char));
-			return *(continer_.begin() + offset);
-		}
-
-		/////////////////////////////////////////////////
-		// write functions
-		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
-		inline void write(const _SrcTy& value, size_t offset) {
-			static_assert(buffer_internal::is_endian_basictype<_SrcTy>::value,
-				"write_le/write_be, only support int16_t/uint16_t, "
-				"int32_t/uint32_t, int64_t/uint64_t, float/double, "
-				"call write() to write char/uint8_t/int8_t");
-			if (offset + sizeof(value) > size())
-				xran(offset, sizeof(value));
-			buffer_internal::Endian::write<_Ty, _SrcTy, endianness>(continer_.begin() + offset, value);
-		}
-
-		template<typename _SrcTy>
-		inline void write_le(const _SrcTy& value, size_t offset) {
-			return write<_SrcTy, buffer_internal::Endian::kLittleEndian>(value, offset);
-		}
-
-		template<typename _SrcTy>
-		inline void write_be(const _SrcTy& value, size_t offset) {
-			return write<_SrcTy, buffer_internal::Endian::kBigEndian>(value, offset);
-		}
-
-		template<typename _SrcTy>
-		inline void write(const _SrcTy& value, size_t offset,
-			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kBigEndian)
-				write<_SrcTy, buffer_internal::Endian::kBigEndian>(value, offset);
-			else
-				write<_SrcTy, buffer_internal::Endian::kLittleEndian>(value, offset);
-		}
-
-		template<typename _SrcTy>
-		inline void write(const _SrcTy& value, size_t offset, 
-			typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			if (offset >= size())
-				xran(offset, sizeof(value));
-			*(continer_.begin() + offset) = value;
-		}
-
-		// д뻺֧֣char*/signed char*(int8_t*)/unsigned char*(uint8_t)
-		template<typename _SrcTy>
-		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type*
-			write_bytes(const _SrcTy* buf, size_type buf_size, size_type offset = 0) {
-			if (offset + buf_size > size())
-				xran(offset, buf_size);
-			return reinterpret_cast<_SrcTy*>(std::memcpy(continer_.begin() + offset, buf, buf_size));
-		}
-
-		/////////////////////////////////////
-		// append functions
-		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
-		inline void append(const _SrcTy& value) {
-			static_assert(buffer_internal::is_endian_basictype<_SrcTy>::value, 
-				"append_le/append_be, only support int16_t/uint16_t, "
-				"int32_t/uint32_t, int64_t/uint64_t, float/double, "
-				"call append() to write char/uint8_t/int8_t");
-			size_type offset = size();
-			EnsureWritableBytes(size(), sizeof(value));
-			write<_SrcTy, endianness>(value, offset);
-		}
-
-		template<typename _SrcTy>
-		inline void append_le(const _SrcTy& value) {
-			append<_SrcTy, buffer_internal::Endian::kLittleEndian>(value);
-		}
-
-		template<typename _SrcTy>
-		inline void append_be(const _SrcTy& value) {
-			append<_SrcTy, buffer_internal::Endian::kBigEndian>(value);
-		}
-
-		template<typename _SrcTy>
-		inline void append(const _SrcTy& value,
-			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kBigEndian)
-				append<_SrcTy, buffer_internal::Endian::kBigEndian>(value);
-			else
-				append<_SrcTy, buffer_internal::Endian::kLittleEndian>(value);
-		}
-
-		// for char/signed char/unsigned char
-		template<typename _SrcTy>
-		inline void append(const _SrcTy& value,
-			typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			size_t offset = size();
-			EnsureWritableBytes(size(), sizeof(value));
-			*(continer_.begin() + offset) = value;
-		}
-
-        template<typename _SrcTy>
-        inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type*
-            append(const _SrcTy* buf, size_type buf_size) {
-            size_type offset = size();
-            EnsureWritableBytes(offset, buf_size);
-            return reinterpret_cast<_SrcTy*>(std::memcpy(continer_.begin() + offset, buf, buf_size));
-        }
-
-		template<typename _RetTy>
-		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_RetTy>::value, _RetTy>::type*
-			cast_to() {
-			return reinterpret_cast<_RetTy*>(begin());
-		}
-
-		template<typename _SrcTy>
-		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type*
-			append(const std::vector<_SrcTy>* vec) {
-			if (vec != nullptr && !vec->empty()) {
-				return append<_SrcTy>(&vec->front(), vec->size());
-			} else {
-				return nullptr;
-			}
-		}
-
-    private:
-        Continer continer_;
-
-		inline void EnsureWritableBytes(size_t offset, size_t size) {
-			if (offset + size > continer_.size()) {
-				continer_.resize(continer_.size() + (offset + size - continer_.size()));
-			}
-		}
-    };
-
-
-	/////////////////////////////////////////////////////////////////////
-	// class stream_buffer
-	template<typename _Ty, typename Buffer = BufferT<_Ty> >
-	class StreamBufferT {
-	public:
-		typedef typename Buffer::value_type value_type;
-		typedef typename Buffer::reference reference;
-		typedef typename Buffer::const_reference const_reference;
-		typedef typename Buffer::pointer pointer;
-		typedef typename Buffer::const_pointer const_pointer;
-		typedef typename Buffer::iterator iterator;
-		typedef typename Buffer::const_iterator const_iterator;
-		typedef typename Buffer::size_type size_type;
-
-		StreamBufferT():
-			read_index_(0),
-			write_index_(0){
-
-		}
-
-		StreamBufferT(const StreamBufferT& other):
-			buffer_(other.buffer_),
-			write_index_(other.write_index_),
-			read_index_(other.read_index_){
-
-		}
-
-		StreamBufferT(StreamBufferT&& other):
-			buffer_(std::move(other.buffer_)),
-			read_index_(std::move(other.read_index_)),
-			write_index_(std::move(other.write_index_)){
-
-		}
-
-		StreamBufferT(const_pointer buf, size_type size):
-			buffer_(buf, size),
-			read_index_(0),
-			write_index_(0) {
-
-		}
-
-		StreamBufferT(size_type size, const _Ty& value):
-			buffer_(size, value),
-			read_index_(0),
-			write_index_(0) {
-
-		}
-
-		static StreamBufferT ref(pointer buf, size_type size) {
-			if (buf != nullptr && size > 0) {
-				Buffer buffer = Buffer::ref(buf, size);
-				StreamBufferT rv;
-				rv.buffer_ = std::move(buffer);
-				return rv;
-			} else {
-				return StreamBufferT();
-			}
-		}
-
-		static StreamBufferT ref(std::vector<pointer>* vec) {
-			if (vec != nullptr && vec->size() > 0) {
-				Buffer buf = Buffer::ref(vec);
-				StreamBufferT rv;
-				rv.buffer_ = std::move(buf);
-				return rv;
-			} else {
-				return StreamBufferT();
-			}			
-		}
-
-		inline bool empty() const {
-			return buffer_.empty();
-		}
-
-		inline bool read_eof() const {
-			return (read_index_ >= buffer_.size());
-		}
-
-		inline bool write_eof() const {
-			return (write_index_ >= buffer_.size());
-		}
-
-		void xran(size_type need_size, bool read_action) {
-			char buf[80];
-			if (read_action)
-				sprintf(buf, "StreamBufferT(%08x) read, size=%08x, read_index=%08x, need_size=%08x",
-				(uint32_t)this, buffer_.size(), read_index_, need_size);
-			else
-				sprintf(buf, "StreamBufferT(%08x) write, size=%08x, write_index=%08x, need_size=%08x",
-				(uint32_t)this, buffer_.size(), write_index_, need_size);
-			throw std::out_of_range(std::string(buf));
-		}
-		
-		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
-		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
-			read() {
-				if (read_index_ + sizeof(_RetTy) > buffer_.size())
-					xran(sizeof(_RetTy), true);
-				size_type offset = read_index_;
-				read_index_ += sizeof(_RetTy);
-				return buffer_internal::Endian::read<_Ty, _RetTy, endianness>(buffer_.begin() + offset);
-		}
-
-		template<typename _RetTy>
-		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_RetTy>::value, _RetTy>::type 
-			read() {
-				if (read_index_ + sizeof(_RetTy) > buffer_.size())
-					xran(sizeof(_RetTy), true);
-				return *(buffer_.begin() + (read_index_ ++ ));
-		}
-
-		template<typename _RetTy>
-		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
-			read_le() {
-				return read<_RetTy, buffer_internal::Endian::kLittleEndian>();
-		}
-
-		template<typename _RetTy>
-		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
-			read_be() {
-				return read<_RetTy, buffer_internal::Endian::kBigEndian>();
-		}
-
-		template<typename _RetTy>
-		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
-			read(){
-				if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kLittleEndian)
-					return read_le<_RetTy>();
-				else
-					return read_be<_RetTy>();
-		}
-
-		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
-		inline void write(const _SrcTy& value, 
-			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			if (write_index_ + sizeof(_SrcTy) > buffer_.size())
-				xran(sizeof(_SrcTy), false);
-			size_type offset = write_index_;
-			write_index_ += sizeof(_SrcTy);
-			buffer_internal::Endian::write<_Ty, _SrcTy, endianness>(buffer_.begin() + offset, value);
-		}
-
-		template<typename _SrcTy>
-		inline void write(const _SrcTy& value, 
-			typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			if (write_index_ + sizeof(_SrcTy) > buffer_.size())
-				xran(sizeof(_SrcTy), false);
-			*(buffer_.begin() + write_index_++) = value;
-		}
-
-		template<typename _SrcTy>
-		inline void write_le(const _SrcTy& value, 
-			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			write<_SrcTy, buffer_internal::Endian::kLittleEndian>(value);
-		}
-
-		template<typename _SrcTy>
-		inline void write_be(const _SrcTy& value, 
-			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			write<_SrcTy, buffer_internal::Endian::kBigEndian>(value);
-		}
-
-		template<typename _SrcTy>
-		inline void write(const _SrcTy& value, 
-			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
-			if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kLittleEndian)
-				return write_le<_SrcTy>(value);
-			else
-				return write_be<_SrcTy>(value);
-		}
-
-		// д뻺֧֣char*/signed char*(int8_t*)/unsigned char*(uint8_t)
-		template<typename _SrcTy>
-		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type*
-			write_bytes(const _SrcTy* buf, size_type buf_size) {
-			if (write_index_ + buf_size > size())
-				xran(buf_size, false);
-			size_type offset = write_index_;
-			write_index_ += buf_size;
-			return reinterpret_cast<_SrcTy*>(std::memcpy(buffer_.begin() + offset, buf, buf_size));
-		}
-
-		Buffer& buf() {
-			return buffer_;
-		}
-
-		const Buffer& buf() const {
-			return buffer_;
-		}
-
-	private:
-		size_type read_index_;
-		size_type write_index_;
-		Buffer buffer_;
-	};
-
-	typedef BufferT<uint8_t> byte_buffer;
-	typedef StreamBufferT<uint8_t> byte_streambuffer;
-    typedef BufferT<char> char_buffer;
-    //typedef BufferT<uint8_t, buffer_internal::VectorContinerT<uint8_t> > vector_buffer;
-
-} // namespace ftl
-
+#ifndef FTL_BUFFER_H_
+#define FTL_BUFFER_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+#include <atomic>
+#include <new>
+#include <memory>
+#include <map>
+#include <unordered_map>
+
+// 编译时确定主机字节序，无法确定时在运行时检测
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define FTL_BUFFER_HOST_BIG_ENDIAN 1
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define FTL_BUFFER_HOST_BIG_ENDIAN 0
+#elif defined(_WIN32) || defined(__x86_64__) || defined(__i386__) || defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) || defined(_M_ARM64)
+#define FTL_BUFFER_HOST_BIG_ENDIAN 0
+#endif
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#include <intrin.h>
+#endif
+
+// 越界检查失败的路径：不内联、标记为冷代码，让内联的读写函数保持短小
+#if defined(_MSC_VER)
+#define FTL_BUFFER_NOINLINE __declspec(noinline)
+#define FTL_BUFFER_COLD
+#define FTL_BUFFER_UNLIKELY(x) (x)
+#elif defined(__GNUC__)
+#define FTL_BUFFER_NOINLINE __attribute__((noinline))
+#define FTL_BUFFER_COLD __attribute__((cold))
+#define FTL_BUFFER_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define FTL_BUFFER_NOINLINE
+#define FTL_BUFFER_COLD
+#define FTL_BUFFER_UNLIKELY(x) (x)
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FTL_BUFFER_NEON
+#include <arm_neon.h>
+#endif
+
+// Search、ByteSwapKernels的运行时选择：x86以SSE2为基础，SSSE3/AVX2的函数单独指定target，不需要-mssse3/-mavx2
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FTL_BUFFER_X86_SIMD
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(__GNUC__)
+#include <cpuid.h>
+#define FTL_BUFFER_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define FTL_BUFFER_TARGET_AVX2 __attribute__((target("avx2")))
+#define FTL_BUFFER_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define FTL_BUFFER_TARGET_PCLMUL __attribute__((target("sse4.2,pclmul")))
+#else
+#define FTL_BUFFER_TARGET_SSSE3
+#define FTL_BUFFER_TARGET_AVX2
+#define FTL_BUFFER_TARGET_SSE42
+#define FTL_BUFFER_TARGET_PCLMUL
+#endif
+#endif
+
+#if defined(__BMI2__)
+#define FTL_BUFFER_BMI2
+#include <immintrin.h>
+#endif
+
+#if defined(FTL_BUFFER_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#endif
+
+// 定义FTL_BUFFER_STATS时统计分配、复制、越界等次数，未定义时FTL_BUFFER_STAT不产生任何代码
+#if defined(FTL_BUFFER_STATS)
+#include <mutex>
+#define FTL_BUFFER_STAT(name, n) ::ftl::buffer_internal::BufferStats::local().name.add(n)
+#define FTL_BUFFER_STAT_COPY(name, bytes) ::ftl::buffer_internal::BufferStats::copied(&::ftl::buffer_internal::BufferStats::ThreadCounters::name, bytes)
+#else
+#define FTL_BUFFER_STAT(name, n) ((void)0)
+#define FTL_BUFFER_STAT_COPY(name, bytes) ((void)0)
+#endif
+
+/**
+	Buffer和StreamBuffer类，提供对缓冲区的读写
+
+	构造：
+		Buffer和StreamBuffer提供两大类构造：拷贝外部缓冲区和引用外部缓冲区
+		拷贝外部缓冲区成内部使用，不依赖外部，使用简单方便，例如：
+		byte_buffer buffer(32, 0); // 构造一个32字节的，初始值为0的缓冲区
+		byte_buffer buffer(p, 10); // 从外部缓冲区P拷贝10字节
+
+		引用外部缓冲区，主要是快速读写内存数据使用
+		byte_buffer buffer = byte_buffer::ref(p, 10); // 引用外部缓冲区，内置指针指向p
+
+	写入：
+		写入提供了对基础数据类型的读写，并且提供了大小端处理
+
+		buffer.write((uint8_t)10, 0);  // 在0位置写入10，类型为uint8_t
+		buffer.write((double)15.0f, 0); // 在0位置写入double 15.0
+		buffer.write_be((uint16_t)0xffee, 0); // 大端方式写入0xffee
+		buffer.write_le((uint16_t)0xffee, 0); // 小段方式写入0xffee
+
+		write_bytes提供写入char* /signed char* /unsigned char*功能
+
+		另外，还提供了append方法在末尾写入数据，该方法会导致buffer的增大，如果是ref类型的buffer
+		那么将会进行拷贝操作
+
+		而write写人，如果位置超过大小，则会抛出异常
+
+	读取：
+		读取提供基础数据类型以及大小端支持，例如：
+		buffer.read<char>(0); // 从0位置，读取一个char
+		buffer.read_be<uint16_t>(0); // 从0位置，按照大端方式读取一个uint16_t
+		buffer.read_le<uint16_t>(0); // 从0位置，按照小端方式读取一个uint16_t
+
+	流式读写：
+		如果使用StreamBuffer，那么内部维护读写的位置，外部在读写的时候，不需要传递位置参数
+		通过read_eof/write_eof来判断是否到了结尾
+*/
+
+namespace ftl {
+
+    namespace buffer_internal {
+
+#if defined(FTL_BUFFER_STATS)
+		/**
+			BufferStats，线程本地的统计计数，只有当前线程写入，不需要原子的读改写；
+			snapshot()汇总所有线程(包括已经退出的线程)
+
+				BufferStats::Counters counters = BufferStats::snapshot();
+				printf("%s\n", counters.to_string().c_str());
+
+			set_copy_hook()设置复制时的回调，可以在回调中记录调用栈，找到发生复制的位置
+		*/
+		class BufferStats {
+		public:
+			struct Counters {
+				uint64_t alloc_count;		// 分配内存的次数
+				uint64_t alloc_bytes;
+				uint64_t realloc_count;		// 扩大/缩小已有内存的次数
+				uint64_t copy_count;		// 拷贝构造/赋值、slice()等复制数据的次数
+				uint64_t copy_bytes;
+				uint64_t promote_count;		// ref()引用的外部内存转为自己持有的次数
+				uint64_t promote_bytes;
+				uint64_t bounds_failures;	// 越界检查失败的次数
+
+				Counters() {
+					std::memset(this, 0, sizeof(*this));
+				}
+
+				Counters& operator+=(const Counters& other) {
+					alloc_count += other.alloc_count;
+					alloc_bytes += other.alloc_bytes;
+					realloc_count += other.realloc_count;
+					copy_count += other.copy_count;
+					copy_bytes += other.copy_bytes;
+					promote_count += other.promote_count;
+					promote_bytes += other.promote_bytes;
+					bounds_failures += other.bounds_failures;
+					return *this;
+				}
+
+				std::string to_string() const {
+					char buf[320];
+					snprintf(buf, sizeof(buf), "alloc_count=%llu alloc_bytes=%llu realloc_count=%llu copy_count=%llu copy_bytes=%llu "
+						"promote_count=%llu promote_bytes=%llu bounds_failures=%llu",
+						(unsigned long long)alloc_count, (unsigned long long)alloc_bytes, (unsigned long long)realloc_count,
+						(unsigned long long)copy_count, (unsigned long long)copy_bytes, (unsigned long long)promote_count,
+						(unsigned long long)promote_bytes, (unsigned long long)bounds_failures);
+					return std::string(buf);
+				}
+			};
+
+			struct Counter {
+				std::atomic<uint64_t> value;
+
+				Counter():
+					value(0) {
+				}
+
+				// 只有所属线程写入
+				inline void add(uint64_t n) {
+					value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+				}
+
+				inline uint64_t get() const {
+					return value.load(std::memory_order_relaxed);
+				}
+			};
+
+			struct ThreadCounters {
+				Counter alloc_count;
+				Counter alloc_bytes;
+				Counter realloc_count;
+				Counter copy_count;
+				Counter copy_bytes;
+				Counter promote_count;
+				Counter promote_bytes;
+				Counter bounds_failures;
+				ThreadCounters* prev;
+				ThreadCounters* next;
+
+				ThreadCounters():
+					prev(nullptr),
+					next(nullptr) {
+					std::lock_guard<std::mutex> lock(mutex());
+					next = head();
+					if (next)
+						next->prev = this;
+					head() = this;
+				}
+
+				// 线程退出时计数合并到retired()
+				~ThreadCounters() {
+					std::lock_guard<std::mutex> lock(mutex());
+					retired() += get();
+					if (prev)
+						prev->next = next;
+					else
+						head() = next;
+					if (next)
+						next->prev = prev;
+				}
+
+				Counters get() const {
+					Counters rv;
+					rv.alloc_count = alloc_count.get();
+					rv.alloc_bytes = alloc_bytes.get();
+					rv.realloc_count = realloc_count.get();
+					rv.copy_count = copy_count.get();
+					rv.copy_bytes = copy_bytes.get();
+					rv.promote_count = promote_count.get();
+					rv.promote_bytes = promote_bytes.get();
+					rv.bounds_failures = bounds_failures.get();
+					return rv;
+				}
+
+				void reset() {
+					Counter* counters[] = { &alloc_count, &alloc_bytes, &realloc_count, &copy_count,
+						&copy_bytes, &promote_count, &promote_bytes, &bounds_failures };
+					for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+						counters[i]->value.store(0, std::memory_order_relaxed);
+				}
+			};
+
+			typedef void (*CopyHook)(const char* name, size_t bytes);
+
+			static ThreadCounters& local() {
+				static thread_local ThreadCounters counters;
+				return counters;
+			}
+
+			// 当前线程的计数
+			static Counters thread_snapshot() {
+				return local().get();
+			}
+
+			// 所有线程的计数
+			static Counters snapshot() {
+				std::lock_guard<std::mutex> lock(mutex());
+				Counters rv = retired();
+				for (ThreadCounters* p = head(); p; p = p->next)
+					rv += p->get();
+				return rv;
+			}
+
+			// 清零所有线程的计数，其他线程同时写入时可能丢失少量计数
+			static void reset() {
+				std::lock_guard<std::mutex> lock(mutex());
+				retired() = Counters();
+				for (ThreadCounters* p = head(); p; p = p->next)
+					p->reset();
+			}
+
+			static void set_copy_hook(CopyHook hook) {
+				copy_hook().store(hook, std::memory_order_release);
+			}
+
+			// 记录一次复制，name为copy_bytes或者promote_bytes
+			static void copied(Counter ThreadCounters::* bytes_counter, size_t bytes) {
+				ThreadCounters& counters = local();
+				const char* name;
+				if (bytes_counter == &ThreadCounters::promote_bytes) {
+					counters.promote_count.add(1);
+					name = "promote";
+				} else {
+					counters.copy_count.add(1);
+					name = "copy";
+				}
+				(counters.*bytes_counter).add(bytes);
+				CopyHook hook = copy_hook().load(std::memory_order_acquire);
+				if (FTL_BUFFER_UNLIKELY(hook != nullptr))
+					hook(name, bytes);
+			}
+
+		private:
+			static std::mutex& mutex() {
+				static std::mutex m;
+				return m;
+			}
+
+			static ThreadCounters*& head() {
+				static ThreadCounters* p = nullptr;
+				return p;
+			}
+
+			static Counters& retired() {
+				static Counters counters;
+				return counters;
+			}
+
+			static std::atomic<CopyHook>& copy_hook() {
+				static std::atomic<CopyHook> hook(nullptr);
+				return hook;
+			}
+		};
+#endif
+
+        template<typename _Ty>
+        class VectorContinerT {
+        public:
+            typedef _Ty value_type;
+			typedef _Ty& reference;
+			typedef _Ty& const_reference;
+            typedef _Ty* pointer;
+            typedef const _Ty* const_pointer;
+            typedef _Ty* iterator;
+            typedef const _Ty* const_iterator;
+            typedef size_t size_type;
+
+            VectorContinerT() {}
+
+            explicit VectorContinerT(size_type size):
+                buf_(size) { }
+
+            VectorContinerT(size_type size, const _Ty& value):
+                buf_(size, value) { }
+
+            VectorContinerT(const_pointer buf, size_type size):
+                buf_(buf, buf + size) { }
+
+            VectorContinerT(const_pointer begin, const_pointer end):
+                buf_(begin, end) { }
+
+            explicit VectorContinerT(const std::vector<_Ty>& vec):
+                buf_(vec) { }
+
+            explicit VectorContinerT(std::vector<_Ty>&& vec):
+                buf_(std::move(vec)) { }
+
+            VectorContinerT(const VectorContinerT& other):
+                buf_(other.buf_){ }
+
+            VectorContinerT(VectorContinerT&& other) :
+                buf_(std::move(other.buf_)){ }
+
+			static VectorContinerT adopt(std::vector<_Ty>&& vec) {
+				return VectorContinerT(std::move(vec));
+			}
+
+			// 交出内部的vector，不复制，之后为空
+			std::vector<_Ty> release_vector() {
+				std::vector<_Ty> rv;
+				rv.swap(buf_);
+				return rv;
+			}
+
+            size_type size() const {
+                return buf_.size();
+            }
+
+            bool empty() const {
+                return buf_.empty();
+            }
+
+            void resize(size_type size) {
+                buf_.resize(size);
+            }
+
+			void truncate(size_type size) {
+				if (size < buf_.size())
+					buf_.resize(size);
+			}
+
+			iterator begin() {
+                return buf_.data();
+            }
+
+			const_iterator begin() const {
+                return buf_.data();
+            }
+
+			iterator end() {
+                return buf_.data() + buf_.size();
+            }
+
+			const_iterator end() const {
+                return buf_.data() + buf_.size();
+            }
+
+            size_type capacity() const{
+                return buf_.capacity();
+            }
+
+            void reserve(size_type size) {
+                buf_.reserve(size);
+            }
+
+            void push_back(const VectorContinerT& other) {
+                buf_.insert(buf_.end(), other.buf_.begin(), other.buf_.end());
+            }
+
+            void shrink() {
+                buf_.shrink_to_fit();
+            }
+
+            void shrink_to_fit() {
+                buf_.shrink_to_fit();
+            }
+
+            void clear() {
+                buf_.clear();
+            }
+
+            VectorContinerT slice(size_type offset, size_type count) const {
+                return VectorContinerT(begin() + offset, count);
+            }
+
+            VectorContinerT& operator=(const VectorContinerT& other) {
+				buf_ = other.buf_;
+				return *this;
+            }
+
+            VectorContinerT& operator=(VectorContinerT&& other) {
+				buf_ = std::move(other.buf_);
+				return *this;
+            }
+
+        private:
+            std::vector<_Ty> buf_;
+        };
+
+        template<typename T>
+        struct DefaultAllocator {
+            T* allocate(size_t size) {
+                return reinterpret_cast<T*>(::malloc(size));
+            }
+
+            void deallocate(T* p) {
+                return ::free(p);
+            }
+
+            T* reallocate(T* p, size_t size) {
+                return reinterpret_cast<T*>(::realloc(p, size));
+            }
+        };
+
+		// v不能为0
+		inline unsigned CountTrailingZeros64(uint64_t v) {
+#if defined(__GNUC__)
+			return (unsigned)__builtin_ctzll(v);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+			unsigned long index;
+			_BitScanForward64(&index, v);
+			return (unsigned)index;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			if (_BitScanForward(&index, (unsigned long)v))
+				return (unsigned)index;
+			_BitScanForward(&index, (unsigned long)(v >> 32));
+			return (unsigned)index + 32;
+#else
+			unsigned n = 0;
+			while (!(v & 1)) {
+				v >>= 1;
+				n++;
+			}
+			return n;
+#endif
+		}
+
+		// 最高位1的位置，v不能为0
+		inline unsigned Log2Floor64(uint64_t v) {
+#if defined(__GNUC__)
+			return 63 - (unsigned)__builtin_clzll(v);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+			unsigned long index;
+			_BitScanReverse64(&index, v);
+			return (unsigned)index;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			if (_BitScanReverse(&index, (unsigned long)(v >> 32)))
+				return (unsigned)index + 32;
+			_BitScanReverse(&index, (unsigned long)v);
+			return (unsigned)index;
+#else
+			unsigned n = 0;
+			while (v >>= 1)
+				n++;
+			return n;
+#endif
+		}
+
+		/**
+			大块拷贝：超过threshold()的拷贝可以不经过普通的memcpy，避免把目标和源一起挤出缓存
+				kMemcpy         始终使用memcpy，默认
+				kRepMovsb       rep movsb，支持ERMS(Enhanced REP MOVSB)的CPU上由微码选择最好的方式
+				kNonTemporal    SSE2的非时间性存储(movntdq)，目标不经过缓存直接写入内存，结束时sfence
+
+			实测rep movsb和非时间性存储在常见的大小上都比memcpy慢，所以默认使用memcpy，
+			只有拷贝之后很久不会读取目标(冷数据、只写一次)时才通过set_method()打开；
+			阈值默认为最后一级缓存的3/4(和glibc的non_temporal_threshold相同)，检测不到时为1MB，
+			编译时定义FTL_BUFFER_LARGE_COPY_THRESHOLD可以指定固定的阈值。源和目标不能重叠，语义和memcpy相同
+		*/
+		class LargeCopy {
+		public:
+			enum Method {
+				kMemcpy = 0,
+				kRepMovsb = 1,
+				kNonTemporal = 2
+			};
+
+			// 每次处理64字节(一条缓存行)，提前预取的距离
+			static const size_t PREFETCH_DISTANCE = 512;
+
+			static inline void* copy(void* dst, const void* src, size_t n) {
+				if (FTL_BUFFER_UNLIKELY(n >= threshold()))
+					return copy_large(dst, src, n);
+				return std::memcpy(dst, src, n);
+			}
+
+			static size_t threshold() {
+				return threshold_ref().load(std::memory_order_relaxed);
+			}
+
+			// 修改阈值，SIZE_MAX表示不使用大块拷贝
+			static void set_threshold(size_t n) {
+				threshold_ref().store(n, std::memory_order_relaxed);
+			}
+
+			// 当前使用的实现
+			static Method method() {
+				return (Method)method_ref().load(std::memory_order_relaxed);
+			}
+
+			// 默认的实现，总是kMemcpy，kRepMovsb/kNonTemporal需要通过set_method()打开
+			static Method detect() {
+				return kMemcpy;
+			}
+
+			// 默认的阈值：FTL_BUFFER_LARGE_COPY_THRESHOLD，或者最后一级缓存的3/4
+			static size_t default_threshold() {
+#if defined(FTL_BUFFER_LARGE_COPY_THRESHOLD)
+				return FTL_BUFFER_LARGE_COPY_THRESHOLD;
+#else
+				size_t llc = last_level_cache_size();
+				return llc ? llc / 4 * 3 : DEFAULT_THRESHOLD;
+#endif
+			}
+
+			// 最后一级缓存的字节数，x86通过cpuid读取(Intel leaf 4，AMD leaf 0x80000006)，检测不到时返回0
+			static size_t last_level_cache_size() {
+#if defined(FTL_BUFFER_X86_SIMD) && (defined(__GNUC__) || defined(_MSC_VER))
+				size_t rv = 0;
+				unsigned info[4];
+				if (cpuid(0, 0, info) >= 4) {
+					for (unsigned i = 0; i < 16; i++) {
+						cpuid(4, i, info);
+						unsigned type = info[0] & 0x1f;
+						if (type == 0)
+							break;
+						// 数据缓存或者统一缓存：ways * partitions * line size * sets
+						if (type == 1 || type == 3) {
+							size_t size = (size_t)((info[1] >> 22) + 1) * (((info[1] >> 12) & 0x3ff) + 1) * ((info[1] & 0xfff) + 1) * ((size_t)info[2] + 1);
+							rv = std::max<size_t>(rv, size);
+						}
+					}
+				}
+				if (rv == 0 && cpuid(0x80000000u, 0, info) >= 0x80000006u) {
+					cpuid(0x80000006u, 0, info);
+					// EDX[31:18]为L3的大小，单位512K；ECX[31:16]为L2的大小，单位1K
+					size_t l3 = (size_t)(info[3] >> 18) * 512 * 1024;
+					size_t l2 = (size_t)(info[2] >> 16) * 1024;
+					rv = l3 ? l3 : l2;
+				}
+				return rv;
+#else
+				return 0;
+#endif
+			}
+
+			// 指定使用的实现，用于测试和性能对比，CPU不支持时返回false
+			static bool set_method(Method m) {
+				if (!supported(m))
+					return false;
+				method_ref().store(m, std::memory_order_relaxed);
+				return true;
+			}
+
+			static bool supported(Method m) {
+				switch (m) {
+				case kMemcpy:
+					return true;
+#if defined(FTL_BUFFER_X86_SIMD) && (defined(__GNUC__) || defined(_MSC_VER))
+				case kRepMovsb:
+					// 没有ERMS的CPU上也能执行，只是比memcpy慢
+					return true;
+				case kNonTemporal:
+					return true;
+#endif
+				default:
+					return false;
+				}
+			}
+
+			static const size_t DEFAULT_THRESHOLD = 1024 * 1024;
+
+			// CPU是否支持ERMS，rep movsb在这些CPU上才有竞争力
+			static bool cpu_has_erms() {
+#if defined(FTL_BUFFER_X86_SIMD) && defined(__GNUC__)
+				unsigned a, b, c, d;
+				if (__get_cpuid_max(0, nullptr) < 7)
+					return false;
+				__cpuid_count(7, 0, a, b, c, d);
+				return (b & (1 << 9)) != 0;
+#elif defined(FTL_BUFFER_X86_SIMD) && defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 9)) != 0;
+#else
+				return false;
+#endif
+			}
+
+		private:
+			static std::atomic<size_t>& threshold_ref() {
+				static std::atomic<size_t> n(default_threshold());
+				return n;
+			}
+
+#if defined(FTL_BUFFER_X86_SIMD) && (defined(__GNUC__) || defined(_MSC_VER))
+			// 返回eax
+			static unsigned cpuid(unsigned leaf, unsigned subleaf, unsigned (&info)[4]) {
+#if defined(__GNUC__)
+				__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#else
+				int regs[4];
+				__cpuidex(regs, (int)leaf, (int)subleaf);
+				for (int i = 0; i < 4; i++)
+					info[i] = (unsigned)regs[i];
+#endif
+				return info[0];
+			}
+#endif
+
+			static std::atomic<int>& method_ref() {
+				static std::atomic<int> m(detect());
+				return m;
+			}
+
+			FTL_BUFFER_NOINLINE static void* copy_large(void* dst, const void* src, size_t n) {
+				switch (method()) {
+#if defined(FTL_BUFFER_X86_SIMD) && (defined(__GNUC__) || defined(_MSC_VER))
+				case kRepMovsb:
+					CopyRepMovsb(static_cast<uint8_t*>(dst), static_cast<const uint8_t*>(src), n);
+					return dst;
+				case kNonTemporal:
+					CopyNonTemporal(static_cast<uint8_t*>(dst), static_cast<const uint8_t*>(src), n);
+					return dst;
+#endif
+				default:
+					return std::memcpy(dst, src, n);
+				}
+			}
+
+#if defined(FTL_BUFFER_X86_SIMD) && (defined(__GNUC__) || defined(_MSC_VER))
+			static void CopyRepMovsb(uint8_t* dst, const uint8_t* src, size_t n) {
+#if defined(__GNUC__)
+				__asm__ __volatile__("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+#else
+				__movsb(dst, src, n);
+#endif
+			}
+
+			static void CopyNonTemporal(uint8_t* dst, const uint8_t* src, size_t n) {
+				// 先用memcpy把目标对齐到16字节，movntdq要求目标对齐
+				size_t head = (16 - (size_t)(reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+				if (head > n)
+					head = n;
+				std::memcpy(dst, src, head);
+				dst += head;
+				src += head;
+				n -= head;
+				for (; n >= 64; n -= 64, dst += 64, src += 64) {
+					_mm_prefetch(reinterpret_cast<const char*>(src) + PREFETCH_DISTANCE, _MM_HINT_NTA);
+					__m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+					__m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+					__m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+					__m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dst), x0);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), x1);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), x2);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), x3);
+				}
+				// 非时间性存储是弱序的，之后的普通写入和其他线程都要能看到
+				_mm_sfence();
+				std::memcpy(dst, src, n);
+			}
+#endif
+		};
+
+		/**
+			SimpleBufferT的增长/收缩策略：
+				grow(capacity, size, mini_size)         需要容纳size个元素时新的容量
+				shrink(size, capacity, counter)        shrink()时新的容量，0表示不收缩，counter是每个对象的计数
+
+			增长：
+				GeometricGrowth<Num, Den>       按照Num/Den倍增长，默认2倍
+				PageRoundedGrowth<Growth, N>    在Growth的基础上，超过一页时按照N字节对齐
+				SizeClassGrowth<Growth>         在Growth的基础上，按照jemalloc的size class对齐，避免分配器内部的浪费，
+				                                定义FTL_BUFFER_JEMALLOC时使用nallocx
+			收缩：
+				CounterShrink<Trigger>                  使用不到一半容量的次数超过Trigger时收缩到size
+				HysteresisShrink<Num, Den, Trigger>     使用低于Num/Den容量的次数超过Trigger时收缩到2倍size，
+				                                        避免在边界附近反复扩大/收缩
+
+			typedef SimpleBufferT<uint8_t, DefaultAllocator<uint8_t>, 32, 0,
+				BufferPolicyT<SizeClassGrowth<GeometricGrowth<3, 2> >, HysteresisShrink<1, 4, 8> > > compact_continer;
+		*/
+		template<size_t Num = 2, size_t Den = 1>
+		struct GeometricGrowth {
+			static_assert(Num > Den && Den > 0, "GeometricGrowth need Num/Den > 1");
+
+			static inline size_t grow(size_t capacity, size_t size, size_t mini_size) {
+				size_t rv = capacity + capacity / Den * (Num - Den);
+				if (rv < capacity)
+					rv = size;
+				return std::max<size_t>(std::max<size_t>(rv, size), mini_size);
+			}
+		};
+
+		template<typename Growth = GeometricGrowth<>, size_t PageSize = 4096>
+		struct PageRoundedGrowth {
+			static_assert(PageSize > 0 && (PageSize & (PageSize - 1)) == 0, "PageSize need power of 2");
+
+			static inline size_t grow(size_t capacity, size_t size, size_t mini_size) {
+				size_t rv = Growth::grow(capacity, size, mini_size);
+				if (rv >= PageSize && rv + (PageSize - 1) > rv)
+					rv = (rv + (PageSize - 1)) & ~(PageSize - 1);
+				return rv;
+			}
+		};
+
+		template<typename Growth = GeometricGrowth<> >
+		struct SizeClassGrowth {
+			static inline size_t grow(size_t capacity, size_t size, size_t mini_size) {
+				return size_class(Growth::grow(capacity, size, mini_size));
+			}
+
+			// jemalloc的size class：16字节以内按照8字节，128字节以内按照16字节(8, 16, 32, 48, 64, 80 ... 128)，之后每个2的幂之间分为4级
+			static inline size_t size_class(size_t size) {
+#if defined(FTL_BUFFER_JEMALLOC)
+				return ::nallocx(size, 0);
+#else
+				if (size <= 16)
+					return (size + 7) & ~(size_t)7;
+				if (size <= 128)
+					return (size + 15) & ~(size_t)15;
+				size_t spacing = (size_t)1 << (Log2Floor64(size - 1) - 2);
+				size_t rv = (size + spacing - 1) & ~(spacing - 1);
+				return rv < size ? size : rv;
+#endif
+			}
+		};
+
+		template<int Trigger = 2>
+		struct CounterShrink {
+			static inline size_t shrink(size_t size, size_t capacity, int& counter) {
+				if (size > 0 && 2 * size < capacity) {
+					if (++counter > Trigger) {
+						counter = 0;
+						return size;
+					}
+				} else {
+					counter = 0;
+				}
+				return 0;
+			}
+		};
+
+		template<size_t Num = 1, size_t Den = 4, int Trigger = 4>
+		struct HysteresisShrink {
+			static_assert(Num < Den && Num > 0, "HysteresisShrink need 0 < Num/Den < 1");
+
+			static inline size_t shrink(size_t size, size_t capacity, int& counter) {
+				if (size > 0 && size < capacity / Den * Num) {
+					if (++counter > Trigger) {
+						counter = 0;
+						return 2 * size;
+					}
+				} else {
+					counter = 0;
+				}
+				return 0;
+			}
+		};
+
+		template<typename Growth = GeometricGrowth<>, typename Shrink = CounterShrink<> >
+		struct BufferPolicyT {
+			static inline size_t grow(size_t capacity, size_t size, size_t mini_size) {
+				return Growth::grow(capacity, size, mini_size);
+			}
+
+			static inline size_t shrink(size_t size, size_t capacity, int& counter) {
+				return Shrink::shrink(size, capacity, counter);
+			}
+		};
+
+		typedef BufferPolicyT<> DefaultBufferPolicy;
+
+		/**
+			SimpleBufferT的内联存储，InlineSize > 0时，不超过InlineSize的数据直接保存在对象内部，
+			不需要分配内存；InlineSize == 0时没有任何开销
+		*/
+		template<typename _Ty, int InlineSize>
+		class InlineStorageT {
+		protected:
+			_Ty* inline_data() {
+				return inline_buf_;
+			}
+
+			const _Ty* inline_data() const {
+				return inline_buf_;
+			}
+
+		private:
+			_Ty inline_buf_[InlineSize];
+		};
+
+		template<typename _Ty>
+		class InlineStorageT<_Ty, 0> {
+		protected:
+			_Ty* inline_data() {
+				return nullptr;
+			}
+
+			const _Ty* inline_data() const {
+				return nullptr;
+			}
+		};
+
+		// SimpleBufferT接管的外部内存，对象释放时一起释放；kind用于release_vector()/release_string()时原样归还
+		struct ForeignStorage {
+			enum Kind {
+				kVector = 0,
+				kString = 1,
+				kUniquePtr = 2
+			};
+
+			explicit ForeignStorage(Kind k) :
+				kind(k) { }
+
+			virtual ~ForeignStorage() {}
+
+			Kind kind;
+		};
+
+		template<typename _Storage, ForeignStorage::Kind K>
+		struct ForeignStorageT : public ForeignStorage {
+			explicit ForeignStorageT(_Storage&& s) :
+				ForeignStorage(K),
+				storage(std::move(s)) { }
+
+			_Storage storage;
+		};
+
+		// SimpleBufferT::release()返回的内存用_Alloc释放
+		template<typename _Ty, typename _Alloc>
+		struct AllocatorDeleter {
+			AllocatorDeleter() {}
+
+			explicit AllocatorDeleter(const _Alloc& a) :
+				alloc(a) { }
+
+			void operator()(_Ty* p) {
+				alloc.deallocate(p);
+			}
+
+			_Alloc alloc;
+		};
+
+        template<typename _Ty, typename _Alloc = DefaultAllocator<_Ty>, int DefaultMiniReserveSize = 32, int InlineSize = 0,
+			typename Policy = DefaultBufferPolicy>
+        class SimpleBufferT : private InlineStorageT<_Ty, InlineSize> {
+			static const int DEFAULT_MINI_SIZE = DefaultMiniReserveSize;
+			static const int INLINE_SIZE = InlineSize;
+			typedef InlineStorageT<_Ty, InlineSize> InlineStorage;
+        public:
+            typedef _Ty value_type;
+			typedef _Ty& reference;
+			typedef _Ty& const_reference;
+            typedef _Ty* pointer;
+            typedef const _Ty* const_pointer;
+            typedef _Ty* iterator;
+            typedef const _Ty* const_iterator;
+            typedef size_t size_type;
+			typedef AllocatorDeleter<_Ty, _Alloc> deleter_type;
+
+            SimpleBufferT():
+                buf_(InlineStorage::inline_data()),
+                size_(0),
+                capacity_(INLINE_SIZE),
+				shrink_counter_(0),
+                ref_(false),
+				foreign_(nullptr) {
+            }
+
+            SimpleBufferT(const SimpleBufferT& other):
+				buf_(InlineStorage::inline_data()),
+				size_(0),
+				capacity_(INLINE_SIZE),
+				shrink_counter_(0),
+				ref_(false),
+				foreign_(nullptr) {
+				reallocate(other.size());
+				size_ = other.size();
+				if (size_ > 0) {
+					LargeCopy::copy(begin(), other.begin(), size_);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size_);
+				}
+            }
+
+			explicit SimpleBufferT(size_t size) :
+				buf_(InlineStorage::inline_data()),
+				size_(0),
+				capacity_(INLINE_SIZE),
+				shrink_counter_(0),
+				ref_(false),
+				foreign_(nullptr) {
+				reallocate(size);
+				size_ = size;
+			}
+
+            SimpleBufferT(size_t size, const _Ty& val):
+				buf_(InlineStorage::inline_data()),
+				size_(0),
+				capacity_(INLINE_SIZE),
+				shrink_counter_(0),
+				ref_(false),
+				foreign_(nullptr) {
+				reallocate(size);
+				size_ = size;
+				std::memset(begin(), val, size);
+            }
+
+            SimpleBufferT(const_pointer buf, size_type size):
+				buf_(InlineStorage::inline_data()),
+				size_(0),
+				capacity_(INLINE_SIZE),
+				shrink_counter_(0),
+				ref_(false),
+				foreign_(nullptr) {
+				if (buf != nullptr && size > 0) {
+					reallocate(size);
+					size_ = size;
+					LargeCopy::copy(begin(), buf, size);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size);
+				}
+            }
+
+			explicit SimpleBufferT(const std::vector<_Ty>& vec):
+				buf_(InlineStorage::inline_data()),
+				size_(0),
+				capacity_(INLINE_SIZE),
+				shrink_counter_(0),
+				ref_(false),
+				foreign_(nullptr) {
+				if (vec.size() > 0) {
+					reallocate(vec.size());
+					size_ = vec.size();
+					LargeCopy::copy(begin(), &vec.front(), size_);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size_);
+				}
+            }
+
+			// 接管vec的内存，不复制：增长超过vec.size()时才复制到_Alloc分配的内存；vec总是被清空
+			explicit SimpleBufferT(std::vector<_Ty>&& vec):
+				buf_(InlineStorage::inline_data()),
+				size_(0),
+				capacity_(INLINE_SIZE),
+				shrink_counter_(0),
+				ref_(false),
+				foreign_(nullptr) {
+				if (vec.size() <= (size_type)INLINE_SIZE) {
+					if (!vec.empty())
+						std::memcpy(buf_, &vec.front(), vec.size());
+					size_ = vec.size();
+					vec.clear();
+				} else {
+					adopt_foreign(new ForeignStorageT<std::vector<_Ty>, ForeignStorage::kVector>(std::move(vec)));
+				}
+			}
+
+            SimpleBufferT(SimpleBufferT&& other) {
+				steal(other);
+            }
+
+			static SimpleBufferT ref(std::vector<_Ty>* vec) {
+				SimpleBufferT simple_buffer;
+				if (!vec->empty()) {
+					simple_buffer.buf_ = &vec->front();
+					simple_buffer.capacity_ = simple_buffer.size_ = vec->size();
+					simple_buffer.ref_ = true;
+					simple_buffer.shrink_counter_ = 0;
+				}
+				return simple_buffer;
+			}
+
+			static SimpleBufferT ref(pointer buf, size_type size) {
+				SimpleBufferT simple_buffer;
+				if (buf != nullptr && size > 0) {
+					simple_buffer.buf_ = buf;
+					simple_buffer.capacity_ = simple_buffer.size_ = size;
+					simple_buffer.ref_ = true;
+				}
+				return simple_buffer;
+			}
+
+			static SimpleBufferT adopt(std::vector<_Ty>&& vec) {
+				return SimpleBufferT(std::move(vec));
+			}
+
+			// 接管str的内存，不复制，只用于8位的_Ty
+			static SimpleBufferT adopt(std::string&& str) {
+				static_assert(sizeof(_Ty) == 1, "adopt(std::string&&) need 8bit value_type");
+				SimpleBufferT simple_buffer;
+				if (str.size() <= (size_type)INLINE_SIZE) {
+					if (!str.empty())
+						std::memcpy(simple_buffer.buf_, str.data(), str.size());
+					simple_buffer.size_ = str.size();
+					str.clear();
+				} else {
+					simple_buffer.adopt_foreign(new ForeignStorageT<std::string, ForeignStorage::kString>(std::move(str)));
+				}
+				return simple_buffer;
+			}
+
+			// 接管size个元素，用p的deleter释放；deleter_type是_Alloc分配的内存，直接作为自己的内存
+			template<typename _Deleter>
+			static SimpleBufferT adopt(std::unique_ptr<_Ty[], _Deleter>&& p, size_type size) {
+				SimpleBufferT simple_buffer;
+				if (!p || size == 0)
+					return simple_buffer;
+				if (size <= (size_type)INLINE_SIZE) {
+					std::memcpy(simple_buffer.buf_, p.get(), size);
+					simple_buffer.size_ = size;
+					p.reset();
+				} else {
+					pointer data = p.get();
+					simple_buffer.adopt_foreign(new ForeignStorageT<std::unique_ptr<_Ty[], _Deleter>, ForeignStorage::kUniquePtr>(std::move(p)));
+					simple_buffer.buf_ = data;
+					simple_buffer.capacity_ = simple_buffer.size_ = size;
+				}
+				return simple_buffer;
+			}
+
+			static SimpleBufferT adopt(std::unique_ptr<_Ty[], deleter_type>&& p, size_type size) {
+				SimpleBufferT simple_buffer;
+				if (!p || size == 0)
+					return simple_buffer;
+				if (size <= (size_type)INLINE_SIZE) {
+					std::memcpy(simple_buffer.buf_, p.get(), size);
+					simple_buffer.size_ = size;
+					p.reset();
+				} else {
+					simple_buffer.alloc_ = p.get_deleter().alloc;
+					simple_buffer.buf_ = p.release();
+					simple_buffer.capacity_ = simple_buffer.size_ = size;
+				}
+				return simple_buffer;
+			}
+
+			// 交出数据，之后为空；内存是adopt()接管的vector时不复制，否则复制一次
+			std::vector<_Ty> release_vector() {
+				std::vector<_Ty> rv;
+				if (foreign_ && foreign_->kind == ForeignStorage::kVector) {
+					rv.swap(static_cast<ForeignStorageT<std::vector<_Ty>, ForeignStorage::kVector>*>(foreign_)->storage);
+					rv.resize(size_);
+				} else if (size_ > 0) {
+					rv.assign(buf_, buf_ + size_);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size_);
+				}
+				clear();
+				return rv;
+			}
+
+			// 交出数据，之后为空；内存是adopt()接管的string时不复制，否则复制一次
+			std::string release_string() {
+				static_assert(sizeof(_Ty) == 1, "release_string() need 8bit value_type");
+				std::string rv;
+				if (foreign_ && foreign_->kind == ForeignStorage::kString) {
+					rv.swap(static_cast<ForeignStorageT<std::string, ForeignStorage::kString>*>(foreign_)->storage);
+					rv.resize(size_);
+				} else if (size_ > 0) {
+					rv.assign(reinterpret_cast<const char*>(buf_), size_);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size_);
+				}
+				clear();
+				return rv;
+			}
+
+			// 交出_Alloc分配的内存，*size为元素个数，之后为空；内联、ref()或者接管的外部内存先复制一次
+			std::unique_ptr<_Ty[], deleter_type> release(size_type* size) {
+				pointer p = nullptr;
+				*size = size_;
+				if (owned()) {
+					p = buf_;
+					buf_ = InlineStorage::inline_data();
+				} else if (size_ > 0) {
+					p = alloc_.allocate(size_);
+					if (!p)
+						throw std::bad_alloc();
+					FTL_BUFFER_STAT(alloc_count, 1);
+					FTL_BUFFER_STAT(alloc_bytes, size_);
+					LargeCopy::copy(p, buf_, size_);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size_);
+				}
+				clear();
+				return std::unique_ptr<_Ty[], deleter_type>(p, deleter_type(alloc_));
+			}
+
+            ~SimpleBufferT() {
+				if (owned()) {
+					alloc_.deallocate(buf_);
+				}
+				delete foreign_;
+            }
+
+			SimpleBufferT& operator=(const SimpleBufferT& other) {
+				if (this == &other)
+					return *this;
+				if (!other.empty()) {
+					resize(other.size());
+					shrink_counter_ = 0;
+					LargeCopy::copy(buf_, other.buf_, size_);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size_);
+				}
+				else {
+					resize(0);
+				}
+				return *this;
+			}
+
+			SimpleBufferT& operator=(SimpleBufferT&& other) {
+				if (this == &other)
+					return *this;
+				if (!other.empty()) {
+					if (owned())
+						alloc_.deallocate(buf_);
+					drop_foreign();
+					steal(other);
+				}
+				else {
+					resize(0);
+				}
+				return *this;
+			}
+
+            inline iterator begin() {
+                return buf_;
+            }
+
+            inline const_iterator begin() const {
+                return buf_;
+            }
+
+            inline iterator end() {
+                return buf_ + size_;
+            }
+
+            inline const_iterator end() const {
+                return buf_ + size_;
+            }
+
+            size_type size() const {
+                return size_;
+            }
+
+			size_type capacity() const {
+				return capacity_;
+			}
+
+			// 只扩大容量，不改变size
+			void reserve(size_type size) {
+				if (size > capacity_)
+					reallocate(size);
+			}
+
+			// prepare()写入之后增加size，不初始化数据，调用者保证不超过capacity
+			void commit(size_type count) {
+				size_ += count;
+			}
+
+			// 减小size，不释放内存
+			void truncate(size_type size) {
+				if (size < size_)
+					size_ = size;
+			}
+
+            void resize(size_type size) {
+                if (size == 0) {
+                    clear();
+                } else if (size > capacity_) {
+                    reallocate(size);
+                }                
+                size_ = size;
+            }
+
+			void push_back(const value_type& val) {
+				size_type size = size_;
+				resize(size_ + sizeof(val));
+				buf_[size] = val;
+			}
+
+			void push_back(const SimpleBufferT& other) {
+				if (!other.empty()) {
+					size_type size = size_;
+					resize(size_ + other.size());
+					LargeCopy::copy(begin() + size, other.buf_, other.size());
+				}
+			}
+
+			// 是否收缩、收缩到多大由Policy决定
+			void shrink() {
+				if (ref_)
+					return;
+				size_type capacity = Policy::shrink(size_, capacity_, shrink_counter_);
+				if (capacity > 0 && capacity < capacity_)
+					reallocate(std::max<size_type>(capacity, size_));
+			}
+
+			void shrink_to_fit() {
+				if (size_ > 0) {
+					reallocate(size_);
+				}
+				shrink_counter_ = 0;
+			}
+
+            bool empty() const {
+                return !size_;
+            }
+
+            void clear() {
+                if (owned())
+                    alloc_.deallocate(buf_);
+                buf_ = InlineStorage::inline_data();
+                size_ = 0;
+				ref_ = false;
+				drop_foreign();
+                capacity_ = INLINE_SIZE;
+				shrink_counter_ = 0;
+            }
+
+			SimpleBufferT slice(size_type offset, size_type count) const {
+				return SimpleBufferT(buf_ + offset, count);
+			}
+
+			// 数据是否保存在对象内部
+			bool is_inline() const {
+				return INLINE_SIZE > 0 && buf_ == InlineStorage::inline_data();
+			}
+
+        private:
+            pointer buf_;
+            size_type size_;
+            size_type capacity_;
+			int shrink_counter_;
+			_Alloc alloc_;
+            bool ref_;
+			// 不为空时buf_是接管的外部内存，和ref()一样增长时复制
+			ForeignStorage* foreign_;
+
+			inline bool owned() const {
+				return buf_ && !ref_ && !is_inline();
+			}
+
+			void adopt_foreign(ForeignStorage* foreign) {
+				foreign_ = foreign;
+				ref_ = true;
+				if (foreign->kind == ForeignStorage::kVector) {
+					std::vector<_Ty>& vec = static_cast<ForeignStorageT<std::vector<_Ty>, ForeignStorage::kVector>*>(foreign)->storage;
+					buf_ = &vec.front();
+					capacity_ = size_ = vec.size();
+				} else if (foreign->kind == ForeignStorage::kString) {
+					std::string& str = static_cast<ForeignStorageT<std::string, ForeignStorage::kString>*>(foreign)->storage;
+					buf_ = reinterpret_cast<pointer>(&str[0]);
+					capacity_ = size_ = str.size();
+				}
+			}
+
+			void drop_foreign() {
+				delete foreign_;
+				foreign_ = nullptr;
+			}
+
+			void steal(SimpleBufferT& other) {
+				if (other.is_inline()) {
+					buf_ = InlineStorage::inline_data();
+					std::memcpy(buf_, other.buf_, other.size_);
+				} else {
+					buf_ = other.buf_;
+				}
+				size_ = other.size_;
+				capacity_ = other.capacity_;
+				shrink_counter_ = other.shrink_counter_;
+				ref_ = other.ref_;
+				foreign_ = other.foreign_;
+				alloc_ = std::move(other.alloc_);
+
+				other.buf_ = other.InlineStorage::inline_data();
+				other.size_ = 0;
+				other.capacity_ = INLINE_SIZE;
+				other.ref_ = false;
+				other.foreign_ = nullptr;
+				other.shrink_counter_ = 0;
+			}
+
+            void reallocate(size_type size) {
+				size_type capacity;
+                if (size > capacity_) {
+                    capacity = Policy::grow(capacity_, size, DEFAULT_MINI_SIZE);
+                } else if (size < capacity_) {
+                    capacity = size;
+                } else {
+                    return;
+                }
+
+				// 收缩到内联存储可以容纳的大小，数据搬回对象内部
+				if (capacity <= (size_type)INLINE_SIZE) {
+					if (!is_inline()) {
+						pointer inline_buf = InlineStorage::inline_data();
+						if (INLINE_SIZE > 0 && size_ > 0)
+							std::memcpy(inline_buf, buf_, size_);
+						if (owned())
+							alloc_.deallocate(buf_);
+						buf_ = inline_buf;
+						ref_ = false;
+						drop_foreign();
+					}
+					capacity_ = INLINE_SIZE;
+					return;
+				}
+
+				pointer p = nullptr;
+				if (owned()) {
+					p = alloc_.reallocate(buf_, capacity);
+					FTL_BUFFER_STAT(realloc_count, 1);
+				} else {
+					p = alloc_.allocate(capacity);
+					FTL_BUFFER_STAT(alloc_count, 1);
+					FTL_BUFFER_STAT(alloc_bytes, capacity);
+					if (p && size_ > 0) {
+						LargeCopy::copy(p, buf_, size_);
+						if (ref_)
+							FTL_BUFFER_STAT_COPY(promote_bytes, size_);
+					}
+				}
+
+                if (!p)
+                    throw std::bad_alloc();
+
+                buf_ = p;
+				ref_ = false;
+				drop_foreign();
+				capacity_ = capacity;
+            }
+        };
+
+		/**
+			SharedBufferT，引用计数、写时复制的容器，用于BufferT
+			拷贝构造/赋值、slice()只增加引用计数，多个对象共享同一块内存；
+			通过非const的begin()/end()写入，或者增长时，如果内存被共享，才复制一份
+
+			引用计数是原子的，不同线程可以各自持有共享同一块内存的对象，但是同一个对象不能多线程同时访问
+		*/
+		template<typename _Ty, typename _Alloc = DefaultAllocator<_Ty>, int DefaultMiniReserveSize = 32>
+		class SharedBufferT {
+			static const int DEFAULT_MINI_SIZE = DefaultMiniReserveSize;
+		public:
+			typedef _Ty value_type;
+			typedef _Ty& reference;
+			typedef _Ty& const_reference;
+			typedef _Ty* pointer;
+			typedef const _Ty* const_pointer;
+			typedef _Ty* iterator;
+			typedef const _Ty* const_iterator;
+			typedef size_t size_type;
+
+			SharedBufferT():
+				block_(nullptr),
+				buf_(nullptr),
+				size_(0),
+				ref_(false) {
+			}
+
+			SharedBufferT(const SharedBufferT& other):
+				block_(nullptr),
+				buf_(nullptr),
+				size_(0),
+				ref_(false) {
+				assign(other);
+			}
+
+			explicit SharedBufferT(size_type size):
+				block_(nullptr),
+				buf_(nullptr),
+				size_(0),
+				ref_(false) {
+				if (size > 0) {
+					allocate_block(size, size);
+					size_ = size;
+				}
+			}
+
+			SharedBufferT(size_type size, const _Ty& val):
+				block_(nullptr),
+				buf_(nullptr),
+				size_(0),
+				ref_(false) {
+				if (size > 0) {
+					allocate_block(size, size);
+					size_ = size;
+					std::memset(buf_, val, size);
+				}
+			}
+
+			SharedBufferT(const_pointer buf, size_type size):
+				block_(nullptr),
+				buf_(nullptr),
+				size_(0),
+				ref_(false) {
+				if (buf != nullptr && size > 0) {
+					allocate_block(size, size);
+					size_ = size;
+					LargeCopy::copy(buf_, buf, size);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size);
+				}
+			}
+
+			explicit SharedBufferT(const std::vector<_Ty>& vec):
+				block_(nullptr),
+				buf_(nullptr),
+				size_(0),
+				ref_(false) {
+				if (!vec.empty()) {
+					allocate_block(vec.size(), vec.size());
+					size_ = vec.size();
+					LargeCopy::copy(buf_, &vec.front(), size_);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size_);
+				}
+			}
+
+			SharedBufferT(SharedBufferT&& other):
+				block_(other.block_),
+				buf_(other.buf_),
+				size_(other.size_),
+				ref_(other.ref_),
+				alloc_(std::move(other.alloc_)) {
+				other.block_ = nullptr;
+				other.buf_ = nullptr;
+				other.size_ = 0;
+				other.ref_ = false;
+			}
+
+			static SharedBufferT ref(std::vector<_Ty>* vec) {
+				SharedBufferT shared_buffer;
+				if (!vec->empty()) {
+					shared_buffer.buf_ = &vec->front();
+					shared_buffer.size_ = vec->size();
+					shared_buffer.ref_ = true;
+				}
+				return shared_buffer;
+			}
+
+			static SharedBufferT ref(pointer buf, size_type size) {
+				SharedBufferT shared_buffer;
+				if (buf != nullptr && size > 0) {
+					shared_buffer.buf_ = buf;
+					shared_buffer.size_ = size;
+					shared_buffer.ref_ = true;
+				}
+				return shared_buffer;
+			}
+
+			~SharedBufferT() {
+				release();
+			}
+
+			SharedBufferT& operator=(const SharedBufferT& other) {
+				if (this != &other) {
+					release();
+					assign(other);
+				}
+				return *this;
+			}
+
+			SharedBufferT& operator=(SharedBufferT&& other) {
+				if (this != &other) {
+					release();
+					block_ = other.block_;
+					buf_ = other.buf_;
+					size_ = other.size_;
+					ref_ = other.ref_;
+					alloc_ = std::move(other.alloc_);
+
+					other.block_ = nullptr;
+					other.buf_ = nullptr;
+					other.size_ = 0;
+					other.ref_ = false;
+				}
+				return *this;
+			}
+
+			// 返回[offset, offset + count)的视图，和当前对象共享内存，不复制
+			SharedBufferT slice(size_type offset, size_type count) const {
+				SharedBufferT view;
+				if (offset < size_ && count > 0) {
+					view.block_ = block_;
+					view.buf_ = buf_ + offset;
+					view.size_ = std::min<size_type>(count, size_ - offset);
+					view.ref_ = ref_;
+					if (block_)
+						block_->refs.fetch_add(1, std::memory_order_relaxed);
+				}
+				return view;
+			}
+
+			// 非const访问意味着写入，被共享时先复制
+			inline iterator begin() {
+				detach();
+				return buf_;
+			}
+
+			inline const_iterator begin() const {
+				return buf_;
+			}
+
+			inline iterator end() {
+				detach();
+				return buf_ + size_;
+			}
+
+			inline const_iterator end() const {
+				return buf_ + size_;
+			}
+
+			size_type size() const {
+				return size_;
+			}
+
+			size_type capacity() const {
+				if (block_)
+					return block_->capacity - (buf_ - block_->data());
+				return size_;
+			}
+
+			bool empty() const {
+				return !size_;
+			}
+
+			// 只扩大容量，引用外部内存或者和其他对象共享时复制一份，保证之后可以直接写入
+			void reserve(size_type size) {
+				size = std::max<size_type>(size, size_);
+				if (ref_ || shared() || !block_ || size > capacity())
+					reallocate_block(std::max<size_type>(DEFAULT_MINI_SIZE, size));
+			}
+
+			void commit(size_type count) {
+				size_ += count;
+			}
+
+			void truncate(size_type size) {
+				if (size < size_)
+					size_ = size;
+			}
+
+			// 是否和其他对象共享内存
+			bool shared() const {
+				return block_ && block_->refs.load(std::memory_order_acquire) > 1;
+			}
+
+			void resize(size_type size) {
+				if (size == 0) {
+					clear();
+				} else if (size > size_) {
+					if (ref_ || shared() || !block_ || size > capacity()) {
+						size_type capacity = std::max<size_type>(size, 2 * this->capacity());
+						capacity = std::max<size_type>(DEFAULT_MINI_SIZE, capacity);
+						reallocate_block(capacity);
+					}
+					size_ = size;
+				} else {
+					size_ = size;
+				}
+			}
+
+			void push_back(const value_type& val) {
+				size_type size = size_;
+				resize(size_ + 1);
+				buf_[size] = val;
+			}
+
+			void push_back(const SharedBufferT& other) {
+				if (!other.empty()) {
+					// other可能就是自己，先持有一份引用
+					SharedBufferT keep(other.ref_ ? SharedBufferT() : other);
+					const_pointer src = other.buf_;
+					size_type count = other.size_;
+					size_type size = size_;
+					resize(size_ + count);
+					LargeCopy::copy(buf_ + size, src, count);
+				}
+			}
+
+			void shrink() {
+				if (block_ && !shared() && capacity() > 2 * size_)
+					shrink_to_fit();
+			}
+
+			void shrink_to_fit() {
+				if (block_ && !shared() && capacity() > size_)
+					reallocate_block(size_);
+			}
+
+			void clear() {
+				release();
+			}
+
+		private:
+			struct Block {
+				std::atomic<long> refs;
+				size_type capacity;
+
+				pointer data() {
+					return reinterpret_cast<pointer>(this + 1);
+				}
+			};
+
+			Block* block_;
+			pointer buf_;
+			size_type size_;
+			bool ref_;
+			_Alloc alloc_;
+
+			void assign(const SharedBufferT& other) {
+				if (other.empty())
+					return;
+				if (other.ref_) {
+					// 引用外部的缓冲区，拷贝时复制一份，和SimpleBufferT保持一致
+					allocate_block(other.size_, other.size_);
+					size_ = other.size_;
+					LargeCopy::copy(buf_, other.buf_, size_);
+					FTL_BUFFER_STAT_COPY(copy_bytes, size_);
+				} else {
+					block_ = other.block_;
+					buf_ = other.buf_;
+					size_ = other.size_;
+					block_->refs.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			void release() {
+				if (block_ && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					block_->~Block();
+					alloc_.deallocate(reinterpret_cast<pointer>(block_));
+				}
+				block_ = nullptr;
+				buf_ = nullptr;
+				size_ = 0;
+				ref_ = false;
+			}
+
+			// 分配新的内存块，复制copy_size个字节，不修改size_
+			void allocate_block(size_type capacity, size_type copy_size) {
+				pointer p = alloc_.allocate(sizeof(Block) + capacity);
+				if (!p)
+					throw std::bad_alloc();
+				Block* block = new (p) Block;
+				block->refs.store(1, std::memory_order_relaxed);
+				block->capacity = capacity;
+				FTL_BUFFER_STAT(alloc_count, 1);
+				FTL_BUFFER_STAT(alloc_bytes, capacity);
+				copy_size = std::min<size_type>(copy_size, size_);
+				if (copy_size > 0) {
+					LargeCopy::copy(block->data(), buf_, copy_size);
+					// 引用外部内存时转为自己持有，否则是共享内存写入前复制
+					if (ref_)
+						FTL_BUFFER_STAT_COPY(promote_bytes, copy_size);
+					else
+						FTL_BUFFER_STAT_COPY(copy_bytes, copy_size);
+				}
+				size_type size = size_;
+				release();
+				block_ = block;
+				buf_ = block->data();
+				size_ = size;
+			}
+
+			void reallocate_block(size_type capacity) {
+				if (block_ && !shared() && buf_ == block_->data()) {
+					pointer p = alloc_.reallocate(reinterpret_cast<pointer>(block_), sizeof(Block) + capacity);
+					if (!p)
+						throw std::bad_alloc();
+					FTL_BUFFER_STAT(realloc_count, 1);
+					block_ = reinterpret_cast<Block*>(p);
+					block_->capacity = capacity;
+					buf_ = block_->data();
+				} else {
+					allocate_block(capacity, size_);
+				}
+			}
+
+			void detach() {
+				if (shared())
+					allocate_block(size_, size_);
+			}
+		};
+
+		// 容器是否提供commit()，BufferT::prepare()需要在不初始化的空间写入之后直接增加size
+		template<typename C>
+		struct has_commit {
+			template<typename U> static char test(decltype(&U::commit));
+			template<typename U> static long test(...);
+			static const bool value = sizeof(test<C>(0)) == 1;
+		};
+
+		/**
+			是否需要处理大小端的基础类型
+			除了char/signed char/unsigned char之外，都为true
+		*/
+		template<typename T>
+		struct is_endian_basictype :std::false_type {};
+		template<>
+		struct is_endian_basictype<int16_t> :std::true_type {};
+		template<>
+		struct is_endian_basictype<uint16_t> :std::true_type {};
+		template<>
+		struct is_endian_basictype<int32_t> :std::true_type {};
+		template<>
+		struct is_endian_basictype<uint32_t> :std::true_type {};
+		template<>
+		struct is_endian_basictype<int64_t> :std::true_type {};
+		template<>
+		struct is_endian_basictype<uint64_t> :std::true_type {};
+		template<>
+		struct is_endian_basictype<float> :std::true_type {};
+		template<>
+		struct is_endian_basictype<double> :std::true_type {};
+
+		template<typename T>
+		struct is_8bit_basictype : std::false_type {};
+		template<>
+		struct is_8bit_basictype<char> : std::true_type {};
+		template<>
+		struct is_8bit_basictype<int8_t> : std::true_type {};
+		template<>
+		struct is_8bit_basictype<uint8_t> : std::true_type {};
+
+		// varint支持的类型，有符号类型使用zigzag编码
+		template<typename T>
+		struct is_varint_type : std::false_type {};
+		template<>
+		struct is_varint_type<uint32_t> : std::true_type {};
+		template<>
+		struct is_varint_type<uint64_t> : std::true_type {};
+
+		template<typename T>
+		struct is_zigzag_type : std::false_type {};
+		template<>
+		struct is_zigzag_type<int32_t> : std::true_type {};
+		template<>
+		struct is_zigzag_type<int64_t> : std::true_type {};
+
+		/**
+			批量字节序翻转，dst和src可以是同一块内存，count为元素个数
+			编译时打开-mavx2/-mssse3(或/arch:AVX2)、ARM NEON时使用向量指令，否则逐个元素翻转
+		*/
+		template<size_t N>
+		struct UIntOfSize;
+		template<>
+		struct UIntOfSize<2> { typedef uint16_t type; };
+		template<>
+		struct UIntOfSize<4> { typedef uint32_t type; };
+		template<>
+		struct UIntOfSize<8> { typedef uint64_t type; };
+
+		// 单个整数的字节序翻转，优先使用编译器内建函数，一般编译为一条bswap/rev指令
+		inline uint16_t ByteSwap(uint16_t v) {
+#if defined(_MSC_VER)
+			return _byteswap_ushort(v);
+#elif defined(__GNUC__)
+			return __builtin_bswap16(v);
+#else
+			return (uint16_t)((v >> 8) | (v << 8));
+#endif
+		}
+
+		inline uint32_t ByteSwap(uint32_t v) {
+#if defined(_MSC_VER)
+			return _byteswap_ulong(v);
+#elif defined(__GNUC__)
+			return __builtin_bswap32(v);
+#else
+			return (v >> 24) | ((v >> 8) & 0x0000ff00u) | ((v << 8) & 0x00ff0000u) | (v << 24);
+#endif
+		}
+
+		inline uint64_t ByteSwap(uint64_t v) {
+#if defined(_MSC_VER)
+			return _byteswap_uint64(v);
+#elif defined(__GNUC__)
+			return __builtin_bswap64(v);
+#else
+			return ((uint64_t)ByteSwap((uint32_t)v) << 32) | ByteSwap((uint32_t)(v >> 32));
+#endif
+		}
+
+		template<size_t N>
+		struct ByteSwapArray;
+
+		template<size_t N>
+		struct ByteSwapArrayScalar {
+			static inline void copy(char* dst, const char* src, size_t count) {
+				typedef typename UIntOfSize<N>::type uint_type;
+				for (size_t i = 0; i < count; i++, dst += N, src += N) {
+					uint_type v;
+					std::memcpy(&v, src, N);
+					v = ByteSwap(v);
+					std::memcpy(dst, &v, N);
+				}
+			}
+		};
+
+#if defined(FTL_BUFFER_X86_SIMD)
+		// 16字节内的翻转掩码，AVX2的_mm256_shuffle_epi8也是按照128位分别处理，使用同一个掩码
+		template<size_t N>
+		struct ByteSwapMask {
+			static const uint8_t value[16];
+		};
+
+#define FTL_BUFFER_BYTESWAP_INDEX(i) (uint8_t)(((i) / N) * N + (N - 1 - (i) % N))
+		template<size_t N>
+		const uint8_t ByteSwapMask<N>::value[16] = {
+			FTL_BUFFER_BYTESWAP_INDEX(0), FTL_BUFFER_BYTESWAP_INDEX(1), FTL_BUFFER_BYTESWAP_INDEX(2), FTL_BUFFER_BYTESWAP_INDEX(3),
+			FTL_BUFFER_BYTESWAP_INDEX(4), FTL_BUFFER_BYTESWAP_INDEX(5), FTL_BUFFER_BYTESWAP_INDEX(6), FTL_BUFFER_BYTESWAP_INDEX(7),
+			FTL_BUFFER_BYTESWAP_INDEX(8), FTL_BUFFER_BYTESWAP_INDEX(9), FTL_BUFFER_BYTESWAP_INDEX(10), FTL_BUFFER_BYTESWAP_INDEX(11),
+			FTL_BUFFER_BYTESWAP_INDEX(12), FTL_BUFFER_BYTESWAP_INDEX(13), FTL_BUFFER_BYTESWAP_INDEX(14), FTL_BUFFER_BYTESWAP_INDEX(15)
+		};
+#undef FTL_BUFFER_BYTESWAP_INDEX
+#endif
+
+		/**
+			ByteSwapArray的向量实现，和Search一样在第一次使用时按照CPU选择，不依赖编译参数；
+			每个函数处理bytes中16字节(AVX2为32字节)整数倍的部分，返回处理的字节数，剩余的部分由ByteSwapArrayScalar处理
+		*/
+		class ByteSwapKernels {
+		public:
+			enum Isa {
+				kScalar = 0,
+				kSsse3 = 1,
+				kAvx2 = 2,
+				kNeon = 3
+			};
+
+			typedef size_t (*Kernel)(char* dst, const char* src, size_t bytes);
+
+			// 当前使用的实现
+			static Isa isa() {
+				return kernels().isa;
+			}
+
+			// 检测到的最好的实现
+			static Isa detect() {
+#if defined(FTL_BUFFER_X86_SIMD)
+				return cpu_has_avx2() ? kAvx2 : (cpu_has_ssse3() ? kSsse3 : kScalar);
+#elif defined(FTL_BUFFER_NEON)
+				return kNeon;
+#else
+				return kScalar;
+#endif
+			}
+
+			// 指定使用的实现，用于测试和性能对比，CPU不支持时返回false；不能和字节序转换同时调用
+			static bool set_isa(Isa isa) {
+				if (!supported(isa))
+					return false;
+				kernels() = make_kernels(isa);
+				return true;
+			}
+
+			static bool supported(Isa isa) {
+				switch (isa) {
+				case kScalar:
+					return true;
+#if defined(FTL_BUFFER_X86_SIMD)
+				case kSsse3:
+					return cpu_has_ssse3();
+				case kAvx2:
+					return cpu_has_avx2();
+#elif defined(FTL_BUFFER_NEON)
+				case kNeon:
+					return true;
+#endif
+				default:
+					return false;
+				}
+			}
+
+			// N为2、4、8
+			template<size_t N>
+			static inline Kernel kernel() {
+				static_assert(N == 2 || N == 4 || N == 8, "N must be 2, 4 or 8");
+				return kernels().swap[N == 2 ? 0 : (N == 4 ? 1 : 2)];
+			}
+
+		private:
+			struct Kernels {
+				Isa isa;
+				Kernel swap[3];
+			};
+
+			static Kernels& kernels() {
+				static Kernels k = make_kernels(detect());
+				return k;
+			}
+
+			static Kernels make_kernels(Isa isa) {
+				Kernels k;
+				k.isa = kScalar;
+				k.swap[0] = &SwapScalar;
+				k.swap[1] = &SwapScalar;
+				k.swap[2] = &SwapScalar;
+#if defined(FTL_BUFFER_X86_SIMD)
+				if (isa == kSsse3) {
+					k.isa = kSsse3;
+					k.swap[0] = &SwapSsse3<2>;
+					k.swap[1] = &SwapSsse3<4>;
+					k.swap[2] = &SwapSsse3<8>;
+				} else if (isa == kAvx2) {
+					k.isa = kAvx2;
+					k.swap[0] = &SwapAvx2<2>;
+					k.swap[1] = &SwapAvx2<4>;
+					k.swap[2] = &SwapAvx2<8>;
+				}
+#elif defined(FTL_BUFFER_NEON)
+				if (isa == kNeon) {
+					k.isa = kNeon;
+					k.swap[0] = &SwapNeon<2>;
+					k.swap[1] = &SwapNeon<4>;
+					k.swap[2] = &SwapNeon<8>;
+				}
+#endif
+				return k;
+			}
+
+			static size_t SwapScalar(char*, const char*, size_t) {
+				return 0;
+			}
+
+#if defined(FTL_BUFFER_X86_SIMD)
+			static bool cpu_has_ssse3() {
+#if defined(__GNUC__)
+				return __builtin_cpu_supports("ssse3") != 0;
+#elif defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 1);
+				return (info[2] & (1 << 9)) != 0;
+#else
+				return false;
+#endif
+			}
+
+			static bool cpu_has_avx2() {
+#if defined(__GNUC__)
+				return __builtin_cpu_supports("avx2") != 0;
+#elif defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+				__cpuid(info, 1);
+				// OSXSAVE和AVX，并且操作系统保存YMM寄存器
+				if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+					return false;
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#else
+				return false;
+#endif
+			}
+
+			template<size_t N>
+			FTL_BUFFER_TARGET_SSSE3 static size_t SwapSsse3(char* dst, const char* src, size_t bytes) {
+				const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ByteSwapMask<N>::value));
+				size_t i = 0;
+				for (; i + 16 <= bytes; i += 16) {
+					__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(v, mask));
+				}
+				return i;
+			}
+
+			template<size_t N>
+			FTL_BUFFER_TARGET_AVX2 static size_t SwapAvx2(char* dst, const char* src, size_t bytes) {
+				const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ByteSwapMask<N>::value));
+				const __m256i mask256 = _mm256_broadcastsi128_si256(mask);
+				size_t i = 0;
+				for (; i + 32 <= bytes; i += 32) {
+					__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(v, mask256));
+				}
+				if (i + 16 <= bytes) {
+					__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(v, mask));
+					i += 16;
+				}
+				return i;
+			}
+#elif defined(FTL_BUFFER_NEON)
+			template<size_t N>
+			static size_t SwapNeon(char* dst, const char* src, size_t bytes) {
+				size_t i = 0;
+				for (; i + 16 <= bytes; i += 16) {
+					uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+					if (N == 2)
+						v = vrev16q_u8(v);
+					else if (N == 4)
+						v = vrev32q_u8(v);
+					else
+						v = vrev64q_u8(v);
+					vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), v);
+				}
+				return i;
+			}
+#endif
+		};
+
+		template<size_t N>
+		struct ByteSwapArray {
+			// 不足16字节时不经过函数指针
+			static inline void copy(char* dst, const char* src, size_t count) {
+				size_t bytes = count * N;
+				size_t i = 0;
+				if (bytes >= 16)
+					i = ByteSwapKernels::kernel<N>()(dst, src, bytes);
+				ByteSwapArrayScalar<N>::copy(dst + i, src + i, (bytes - i) / N);
+			}
+		};
+
+		class Endian {
+		public:
+			enum Endianness {
+				kBigEndian = 0,
+				kLittleEndian = 1
+			};
+
+			static inline void Swizzle(char* start, unsigned int len) {
+				char* end = start + len - 1;
+				while (start < end) {
+					char tmp = *start;
+					*start++ = *end;
+					*end-- = tmp;
+				}
+			}
+
+			static inline bool detect_big_endian(void) {
+				union {
+					uint32_t i;
+					char c[4];
+				} bint = { 0x01020304 };
+
+				return bint.c[0] == 1;
+			}
+
+#if defined(FTL_BUFFER_HOST_BIG_ENDIAN)
+			// 编译时已知，比较结果是常量，不同字节序的分支会被直接去掉
+			static const Endianness kHostEndian = (FTL_BUFFER_HOST_BIG_ENDIAN ? kBigEndian : kLittleEndian);
+
+			static inline Endianness CurrentEndian() {
+				return kHostEndian;
+			}
+
+			static inline bool isBigEndian() {
+				return kHostEndian == kBigEndian;
+			}
+#else
+			static inline Endianness CurrentEndian() {
+				static const Endianness endian =
+					(detect_big_endian() == true ? kBigEndian : kLittleEndian);
+				return endian;
+			}
+
+			static bool isBigEndian() {
+				static bool big_endian = detect_big_endian();
+				return big_endian;
+			}
+#endif
+
+			// 按照整数加载，memcpy会被编译为一次非对齐的读取，需要时再翻转
+			template<typename _Ty, typename _RetTy, enum Endianness endianness>
+			static inline typename std::enable_if<is_endian_basictype<_RetTy>::value, _RetTy>::type
+				read(const _Ty* buf) {
+				typename UIntOfSize<sizeof(_RetTy)>::type v;
+				std::memcpy(&v, buf, sizeof(_RetTy));
+				if (CurrentEndian() != endianness)
+					v = ByteSwap(v);
+				_RetTy rv;
+				std::memcpy(&rv, &v, sizeof(_RetTy));
+				return rv;
+			}
+
+			template<typename _Ty, typename _SrcTy, enum Endianness endianness>
+			static inline typename std::enable_if<is_endian_basictype<_SrcTy>::value, _Ty>::type*
+				write(_Ty* buf, const _SrcTy& value) {
+				typename UIntOfSize<sizeof(_SrcTy)>::type v;
+				std::memcpy(&v, &value, sizeof(_SrcTy));
+				if (CurrentEndian() != endianness)
+					v = ByteSwap(v);
+				return reinterpret_cast<_Ty*>(std::memcpy(buf, &v, sizeof(_SrcTy)));
+			}
+
+			// 批量读取count个_RetTy
+			template<typename _Ty, typename _RetTy, enum Endianness endianness>
+			static inline typename std::enable_if<is_endian_basictype<_RetTy>::value>::type
+				read_array(const _Ty* buf, _RetTy* dst, size_t count) {
+				if (CurrentEndian() == endianness)
+					std::memcpy(dst, buf, count * sizeof(_RetTy));
+				else
+					ByteSwapArray<sizeof(_RetTy)>::copy(reinterpret_cast<char*>(dst), reinterpret_cast<const char*>(buf), count);
+			}
+
+			// 批量写入count个_SrcTy
+			template<typename _Ty, typename _SrcTy, enum Endianness endianness>
+			static inline typename std::enable_if<is_endian_basictype<_SrcTy>::value>::type
+				write_array(_Ty* buf, const _SrcTy* src, size_t count) {
+				if (CurrentEndian() == endianness)
+					std::memcpy(buf, src, count * sizeof(_SrcTy));
+				else
+					ByteSwapArray<sizeof(_SrcTy)>::copy(reinterpret_cast<char*>(buf), reinterpret_cast<const char*>(src), count);
+			}
+		};
+
+		/**
+			varint(LEB128)编解码，每个字节低7位为数据，最高位表示后面还有字节
+			剩余数据不少于8个字节时一次读取8个字节，通过结束位的位置计算长度，
+			打开-mbmi2时使用pext，否则通过移位合并，避免逐字节的分支
+		*/
+		struct Varint {
+			template<typename T>
+			struct MaxLength {
+				enum { value = (sizeof(T) * 8 + 6) / 7 };
+			};
+
+			template<typename T>
+			static inline size_t length(T value) {
+				return (Log2Floor64((uint64_t)value | 1) * 9 + 73) / 64;
+			}
+
+			// 返回写入的字节数，p至少要有MaxLength<T>::value个字节
+			template<typename T>
+			static inline size_t encode(uint8_t* p, T value) {
+				uint64_t v = value;
+				size_t n = 0;
+				while (v >= 0x80) {
+					p[n++] = (uint8_t)(v | 0x80);
+					v >>= 7;
+				}
+				p[n++] = (uint8_t)v;
+				return n;
+			}
+
+			// 返回读取的字节数，数据不完整或者超过T的最大长度时返回0
+			template<typename T>
+			static inline size_t decode(const uint8_t* p, size_t avail, T& value) {
+				if (avail >= 8) {
+					uint64_t word = Endian::read<uint8_t, uint64_t, Endian::kLittleEndian>(p);
+					uint64_t stop = ~word & 0x8080808080808080ULL;
+					if (stop != 0) {
+						size_t n = (CountTrailingZeros64(stop) >> 3) + 1;
+						if (FTL_BUFFER_UNLIKELY(n > (size_t)MaxLength<T>::value))
+							return 0;
+						uint64_t bits = word & (stop ^ (stop - 1));
+#if defined(FTL_BUFFER_BMI2)
+						value = (T)_pext_u64(bits, 0x7f7f7f7f7f7f7f7fULL);
+#else
+						bits = (bits & 0x007f007f007f007fULL) | ((bits & 0x7f007f007f007f00ULL) >> 1);
+						bits = (bits & 0x00003fff00003fffULL) | ((bits & 0x3fff00003fff0000ULL) >> 2);
+						bits = (bits & 0x000000000fffffffULL) | ((bits & 0x0fffffff00000000ULL) >> 4);
+						value = (T)bits;
+#endif
+						return n;
+					}
+				}
+				return decode_slow(p, avail, value);
+			}
+
+			// 批量解码，返回解码的个数，consumed返回读取的字节数
+			template<typename T>
+			static inline size_t decode_array(const uint8_t* p, size_t avail, T* dst, size_t count, size_t* consumed) {
+				size_t offset = 0;
+				size_t i = 0;
+				for (; i < count; i++) {
+					size_t n = decode(p + offset, avail - offset, dst[i]);
+					if (FTL_BUFFER_UNLIKELY(n == 0))
+						break;
+					offset += n;
+				}
+				*consumed = offset;
+				return i;
+			}
+
+			template<typename T>
+			static size_t decode_slow(const uint8_t* p, size_t avail, T& value) {
+				uint64_t result = 0;
+				size_t max_length = std::min<size_t>(avail, (size_t)MaxLength<T>::value);
+				for (size_t i = 0; i < max_length; i++) {
+					result |= (uint64_t)(p[i] & 0x7f) << (7 * i);
+					if (!(p[i] & 0x80)) {
+						value = (T)result;
+						return i + 1;
+					}
+				}
+				return 0;
+			}
+
+			static inline uint32_t ZigZagEncode(int32_t value) {
+				return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+			}
+
+			static inline uint64_t ZigZagEncode(int64_t value) {
+				return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+			}
+
+			static inline int32_t ZigZagDecode(uint32_t value) {
+				return (int32_t)((value >> 1) ^ (0 - (value & 1)));
+			}
+
+			static inline int64_t ZigZagDecode(uint64_t value) {
+				return (int64_t)((value >> 1) ^ (0 - (value & 1)));
+			}
+		};
+
+		/**
+			STL容器和字符串的编码，容器都是varint长度前缀 + 元素：
+				char/int8_t/uint8_t             1个字节
+				16/32/64位整数、float/double    sizeof(T)个字节，按照endianness
+				std::string                     varint(字节数) + 字节
+				std::vector<T>                  varint(个数) + 元素，元素是整数/float/double时整体复制或者翻转字节序
+				std::map/std::unordered_map     varint(个数) + 每个元素的key + value
+				std::pair                       first + second
+			size()计算编码之后的长度，encode()写入调用者已经检查过的空间，返回写入之后的位置，
+			decode()返回读取之后的位置，数据不完整时返回nullptr；kFixedSize是定长类型的长度，变长类型为0
+		*/
+		template<typename T, enum Endian::Endianness endianness, typename Enable = void>
+		struct Serializer;
+
+		template<typename T, enum Endian::Endianness endianness>
+		struct Serializer<T, endianness, typename std::enable_if<is_8bit_basictype<T>::value>::type> {
+			enum { kFixedSize = 1 };
+
+			static inline size_t size(const T&) {
+				return 1;
+			}
+
+			static inline uint8_t* encode(uint8_t* p, const T& value) {
+				*p = (uint8_t)value;
+				return p + 1;
+			}
+
+			static inline const uint8_t* decode(const uint8_t* p, const uint8_t* end, T& value) {
+				if (FTL_BUFFER_UNLIKELY(p == end))
+					return nullptr;
+				value = (T)*p;
+				return p + 1;
+			}
+		};
+
+		template<typename T, enum Endian::Endianness endianness>
+		struct Serializer<T, endianness, typename std::enable_if<is_endian_basictype<T>::value>::type> {
+			enum { kFixedSize = sizeof(T) };
+
+			static inline size_t size(const T&) {
+				return sizeof(T);
+			}
+
+			static inline uint8_t* encode(uint8_t* p, const T& value) {
+				Endian::write<uint8_t, T, endianness>(p, value);
+				return p + sizeof(T);
+			}
+
+			static inline const uint8_t* decode(const uint8_t* p, const uint8_t* end, T& value) {
+				if (FTL_BUFFER_UNLIKELY((size_t)(end - p) < sizeof(T)))
+					return nullptr;
+				value = Endian::read<uint8_t, T, endianness>(p);
+				return p + sizeof(T);
+			}
+		};
+
+		// 长度前缀
+		struct SerializerCount {
+			static inline size_t size(size_t count) {
+				return Varint::length((uint64_t)count);
+			}
+
+			static inline uint8_t* encode(uint8_t* p, size_t count) {
+				return p + Varint::encode(p, (uint64_t)count);
+			}
+
+			// 每个元素至少min_size个字节，个数超过剩余的数据时直接失败，不会按照错误的个数分配内存
+			static inline const uint8_t* decode(const uint8_t* p, const uint8_t* end, size_t min_size, size_t& count) {
+				uint64_t n = 0;
+				size_t k = Varint::decode(p, end - p, n);
+				if (FTL_BUFFER_UNLIKELY(k == 0 || n > (uint64_t)(end - p - k) / min_size))
+					return nullptr;
+				count = (size_t)n;
+				return p + k;
+			}
+		};
+
+		template<typename _Traits, typename _Alloc, enum Endian::Endianness endianness>
+		struct Serializer<std::basic_string<char, _Traits, _Alloc>, endianness> {
+			typedef std::basic_string<char, _Traits, _Alloc> string_type;
+
+			enum { kFixedSize = 0 };
+
+			static inline size_t size(const string_type& str) {
+				return SerializerCount::size(str.size()) + str.size();
+			}
+
+			static inline uint8_t* encode(uint8_t* p, const string_type& str) {
+				p = SerializerCount::encode(p, str.size());
+				if (!str.empty())
+					std::memcpy(p, str.data(), str.size());
+				return p + str.size();
+			}
+
+			static inline const uint8_t* decode(const uint8_t* p, const uint8_t* end, string_type& str) {
+				size_t n = 0;
+				if (FTL_BUFFER_UNLIKELY((p = SerializerCount::decode(p, end, 1, n)) == nullptr))
+					return nullptr;
+				str.assign(reinterpret_cast<const char*>(p), n);
+				return p + n;
+			}
+		};
+
+		template<typename T, typename _Alloc, enum Endian::Endianness endianness>
+		struct Serializer<std::vector<T, _Alloc>, endianness> {
+			typedef std::vector<T, _Alloc> vector_type;
+			typedef Serializer<T, endianness> element_serializer;
+			// 1：8位整数直接复制，2：整数/float/double按照endianness整体复制或者翻转，0：逐个编码
+			typedef std::integral_constant<int, is_8bit_basictype<T>::value ? 1 : (is_endian_basictype<T>::value ? 2 : 0)> kind;
+
+			enum { kFixedSize = 0 };
+
+			static inline size_t size(const vector_type& vec) {
+				size_t rv = SerializerCount::size(vec.size());
+				if (element_serializer::kFixedSize != 0)
+					return rv + vec.size() * element_serializer::kFixedSize;
+				for (size_t i = 0; i < vec.size(); i++)
+					rv += element_serializer::size(vec[i]);
+				return rv;
+			}
+
+			static inline uint8_t* encode(uint8_t* p, const vector_type& vec) {
+				p = SerializerCount::encode(p, vec.size());
+				return vec.empty() ? p : encode_elements(p, vec, kind());
+			}
+
+			static inline const uint8_t* decode(const uint8_t* p, const uint8_t* end, vector_type& vec) {
+				size_t n = 0;
+				if (FTL_BUFFER_UNLIKELY((p = SerializerCount::decode(p, end,
+					element_serializer::kFixedSize != 0 ? element_serializer::kFixedSize : 1, n)) == nullptr))
+					return nullptr;
+				vec.resize(n);
+				return n == 0 ? p : decode_elements(p, end, vec, kind());
+			}
+
+		private:
+			static inline uint8_t* encode_elements(uint8_t* p, const vector_type& vec, std::integral_constant<int, 1>) {
+				std::memcpy(p, &vec.front(), vec.size());
+				return p + vec.size();
+			}
+
+			static inline uint8_t* encode_elements(uint8_t* p, const vector_type& vec, std::integral_constant<int, 2>) {
+				Endian::write_array<uint8_t, T, endianness>(p, &vec.front(), vec.size());
+				return p + vec.size() * sizeof(T);
+			}
+
+			static inline uint8_t* encode_elements(uint8_t* p, const vector_type& vec, std::integral_constant<int, 0>) {
+				for (size_t i = 0; i < vec.size(); i++)
+					p = element_serializer::encode(p, vec[i]);
+				return p;
+			}
+
+			// 个数已经按照kFixedSize检查过
+			static inline const uint8_t* decode_elements(const uint8_t* p, const uint8_t*, vector_type& vec, std::integral_constant<int, 1>) {
+				std::memcpy(&vec.front(), p, vec.size());
+				return p + vec.size();
+			}
+
+			static inline const uint8_t* decode_elements(const uint8_t* p, const uint8_t*, vector_type& vec, std::integral_constant<int, 2>) {
+				Endian::read_array<uint8_t, T, endianness>(p, &vec.front(), vec.size());
+				return p + vec.size() * sizeof(T);
+			}
+
+			static inline const uint8_t* decode_elements(const uint8_t* p, const uint8_t* end, vector_type& vec, std::integral_constant<int, 0>) {
+				for (size_t i = 0; i < vec.size() && p != nullptr; i++)
+					p = element_serializer::decode(p, end, vec[i]);
+				return p;
+			}
+		};
+
+		template<typename T1, typename T2, enum Endian::Endianness endianness>
+		struct Serializer<std::pair<T1, T2>, endianness> {
+			typedef Serializer<typename std::remove_const<T1>::type, endianness> first_serializer;
+			typedef Serializer<T2, endianness> second_serializer;
+
+			enum { kFixedSize = (first_serializer::kFixedSize != 0 && second_serializer::kFixedSize != 0) ?
+				first_serializer::kFixedSize + second_serializer::kFixedSize : 0 };
+
+			static inline size_t size(const std::pair<T1, T2>& value) {
+				return first_serializer::size(value.first) + second_serializer::size(value.second);
+			}
+
+			static inline uint8_t* encode(uint8_t* p, const std::pair<T1, T2>& value) {
+				return second_serializer::encode(first_serializer::encode(p, value.first), value.second);
+			}
+
+			static inline const uint8_t* decode(const uint8_t* p, const uint8_t* end, std::pair<T1, T2>& value) {
+				p = first_serializer::decode(p, end, value.first);
+				return p ? second_serializer::decode(p, end, value.second) : nullptr;
+			}
+		};
+
+		template<typename _KeyTy, typename _ValTy, typename _Compare, typename _Alloc>
+		inline void SerializerReserve(std::map<_KeyTy, _ValTy, _Compare, _Alloc>&, size_t) {
+		}
+
+		template<typename _KeyTy, typename _ValTy, typename _Hash, typename _Pred, typename _Alloc>
+		inline void SerializerReserve(std::unordered_map<_KeyTy, _ValTy, _Hash, _Pred, _Alloc>& map, size_t count) {
+			map.reserve(count);
+		}
+
+		// std::map/std::unordered_map共同的实现，解码之前清空map
+		template<typename _MapTy, enum Endian::Endianness endianness>
+		struct MapSerializer {
+			typedef typename _MapTy::key_type key_type;
+			typedef typename _MapTy::mapped_type mapped_type;
+			typedef Serializer<key_type, endianness> key_serializer;
+			typedef Serializer<mapped_type, endianness> mapped_serializer;
+
+			enum { kFixedSize = 0 };
+			enum { kElementSize = (key_serializer::kFixedSize != 0 && mapped_serializer::kFixedSize != 0) ?
+				key_serializer::kFixedSize + mapped_serializer::kFixedSize : 0 };
+
+			static inline size_t size(const _MapTy& map) {
+				size_t rv = SerializerCount::size(map.size());
+				if (kElementSize != 0)
+					return rv + map.size() * kElementSize;
+				for (typename _MapTy::const_iterator it = map.begin(); it != map.end(); ++it)
+					rv += key_serializer::size(it->first) + mapped_serializer::size(it->second);
+				return rv;
+			}
+
+			static inline uint8_t* encode(uint8_t* p, const _MapTy& map) {
+				p = SerializerCount::encode(p, map.size());
+				for (typename _MapTy::const_iterator it = map.begin(); it != map.end(); ++it)
+					p = mapped_serializer::encode(key_serializer::encode(p, it->first), it->second);
+				return p;
+			}
+
+			static inline const uint8_t* decode(const uint8_t* p, const uint8_t* end, _MapTy& map) {
+				size_t n = 0;
+				if (FTL_BUFFER_UNLIKELY((p = SerializerCount::decode(p, end, kElementSize != 0 ? kElementSize : 1, n)) == nullptr))
+					return nullptr;
+				map.clear();
+				SerializerReserve(map, n);
+				key_type key;
+				mapped_type value;
+				for (size_t i = 0; i < n; i++) {
+					if (FTL_BUFFER_UNLIKELY((p = key_serializer::decode(p, end, key)) == nullptr ||
+						(p = mapped_serializer::decode(p, end, value)) == nullptr))
+						return nullptr;
+					// std::map按照key的顺序编码，总是插入到末尾
+					map.emplace_hint(map.end(), std::move(key), std::move(value));
+				}
+				return p;
+			}
+		};
+
+		template<typename _KeyTy, typename _ValTy, typename _Compare, typename _Alloc, enum Endian::Endianness endianness>
+		struct Serializer<std::map<_KeyTy, _ValTy, _Compare, _Alloc>, endianness>:
+			MapSerializer<std::map<_KeyTy, _ValTy, _Compare, _Alloc>, endianness> {
+		};
+
+		template<typename _KeyTy, typename _ValTy, typename _Hash, typename _Pred, typename _Alloc, enum Endian::Endianness endianness>
+		struct Serializer<std::unordered_map<_KeyTy, _ValTy, _Hash, _Pred, _Alloc>, endianness>:
+			MapSerializer<std::unordered_map<_KeyTy, _ValTy, _Hash, _Pred, _Alloc>, endianness> {
+		};
+
+		/**
+			Search，字节查找和比较，运行时选择实现：
+				x86   SSE2为基础，CPU支持时使用AVX2(不需要-mavx2)
+				ARM   NEON
+				其他  标量实现
+
+			返回的位置都相对于p，找不到时返回npos；mismatch()返回第一个不同的位置，全部相同时返回n
+		*/
+		class Search {
+		public:
+			static const size_t npos = static_cast<size_t>(-1);
+			// find_first_of()的集合不超过这个大小时使用SIMD，更大的集合使用256位的表
+			static const size_t MAX_SIMD_SET_SIZE = 16;
+
+			enum Isa {
+				kScalar = 0,
+				kSse2 = 1,
+				kAvx2 = 2,
+				kNeon = 3
+			};
+
+			static inline size_t find_byte(const uint8_t* p, size_t n, uint8_t c) {
+				return kernels().find_byte(p, n, c);
+			}
+
+			static inline size_t find(const uint8_t* p, size_t n, const uint8_t* pattern, size_t m) {
+				if (m == 0)
+					return 0;
+				if (m > n)
+					return npos;
+				if (m == 1)
+					return kernels().find_byte(p, n, pattern[0]);
+				return kernels().find(p, n, pattern, m);
+			}
+
+			static inline size_t find_first_of(const uint8_t* p, size_t n, const uint8_t* set, size_t set_size) {
+				if (set_size == 0)
+					return npos;
+				if (set_size == 1)
+					return kernels().find_byte(p, n, set[0]);
+				if (set_size > MAX_SIMD_SET_SIZE)
+					return FindFirstOfScalar(p, n, set, set_size);
+				return kernels().find_first_of(p, n, set, set_size);
+			}
+
+			static inline size_t mismatch(const uint8_t* a, const uint8_t* b, size_t n) {
+				return kernels().mismatch(a, b, n);
+			}
+
+			static inline bool equal(const uint8_t* a, const uint8_t* b, size_t n) {
+				return a == b || kernels().mismatch(a, b, n) == n;
+			}
+
+			// 按照无符号字节的字典序比较，返回-1/0/1
+			static inline int compare(const uint8_t* a, size_t a_size, const uint8_t* b, size_t b_size) {
+				size_t n = std::min<size_t>(a_size, b_size);
+				size_t i = (a == b ? n : kernels().mismatch(a, b, n));
+				if (i < n)
+					return a[i] < b[i] ? -1 : 1;
+				return a_size < b_size ? -1 : (a_size > b_size ? 1 : 0);
+			}
+
+			// 当前使用的实现
+			static Isa isa() {
+				return kernels().isa;
+			}
+
+			// 检测到的最好的实现
+			static Isa detect() {
+#if defined(FTL_BUFFER_X86_SIMD)
+				return cpu_has_avx2() ? kAvx2 : kSse2;
+#elif defined(FTL_BUFFER_NEON)
+				return kNeon;
+#else
+				return kScalar;
+#endif
+			}
+
+			// 指定使用的实现，用于测试和性能对比，CPU不支持时返回false；不能和查找函数同时调用
+			static bool set_isa(Isa isa) {
+				if (!supported(isa))
+					return false;
+				kernels() = make_kernels(isa);
+				return true;
+			}
+
+			static bool supported(Isa isa) {
+				switch (isa) {
+				case kScalar:
+					return true;
+#if defined(FTL_BUFFER_X86_SIMD)
+				case kSse2:
+					return true;
+				case kAvx2:
+					return cpu_has_avx2();
+#elif defined(FTL_BUFFER_NEON)
+				case kNeon:
+					return true;
+#endif
+				default:
+					return false;
+				}
+			}
+
+		private:
+			struct Kernels {
+				Isa isa;
+				size_t (*find_byte)(const uint8_t* p, size_t n, uint8_t c);
+				size_t (*find)(const uint8_t* p, size_t n, const uint8_t* pattern, size_t m);
+				size_t (*find_first_of)(const uint8_t* p, size_t n, const uint8_t* set, size_t set_size);
+				size_t (*mismatch)(const uint8_t* a, const uint8_t* b, size_t n);
+			};
+
+			static Kernels& kernels() {
+				static Kernels k = make_kernels(detect());
+				return k;
+			}
+
+			static Kernels make_kernels(Isa isa) {
+				Kernels k;
+				k.isa = kScalar;
+				k.find_byte = &FindByteScalar;
+				k.find = &FindScalar;
+				k.find_first_of = &FindFirstOfScalar;
+				k.mismatch = &MismatchScalar;
+#if defined(FTL_BUFFER_X86_SIMD)
+				if (isa == kSse2) {
+					k.isa = kSse2;
+					k.find_byte = &FindByteSse2;
+					k.find = &FindSse2;
+					k.find_first_of = &FindFirstOfSse2;
+					k.mismatch = &MismatchSse2;
+				} else if (isa == kAvx2) {
+					k.isa = kAvx2;
+					k.find_byte = &FindByteAvx2;
+					k.find = &FindAvx2;
+					k.find_first_of = &FindFirstOfAvx2;
+					k.mismatch = &MismatchAvx2;
+				}
+#elif defined(FTL_BUFFER_NEON)
+				if (isa == kNeon) {
+					k.isa = kNeon;
+					k.find_byte = &FindByteNeon;
+					k.find = &FindNeon;
+					k.find_first_of = &FindFirstOfNeon;
+					k.mismatch = &MismatchNeon;
+				}
+#endif
+				return k;
+			}
+
+			static inline size_t offset(size_t base, size_t pos) {
+				return pos == npos ? npos : base + pos;
+			}
+
+			/////////////////////////////////////
+			// 标量实现，也用于SIMD实现的尾部
+
+			static size_t FindByteScalar(const uint8_t* p, size_t n, uint8_t c) {
+				const void* r = n > 0 ? std::memchr(p, c, n) : nullptr;
+				return r ? (size_t)(reinterpret_cast<const uint8_t*>(r) - p) : npos;
+			}
+
+			static size_t FindScalar(const uint8_t* p, size_t n, const uint8_t* pattern, size_t m) {
+				if (m > n)
+					return npos;
+				size_t i = 0;
+				while (i + m <= n) {
+					size_t pos = FindByteScalar(p + i, n - m + 1 - i, pattern[0]);
+					if (pos == npos)
+						return npos;
+					i += pos;
+					if (std::memcmp(p + i + 1, pattern + 1, m - 1) == 0)
+						return i;
+					i++;
+				}
+				return npos;
+			}
+
+			static size_t FindFirstOfScalar(const uint8_t* p, size_t n, const uint8_t* set, size_t set_size) {
+				bool table[256] = { false };
+				for (size_t i = 0; i < set_size; i++)
+					table[set[i]] = true;
+				for (size_t i = 0; i < n; i++) {
+					if (table[p[i]])
+						return i;
+				}
+				return npos;
+			}
+
+			static size_t MismatchScalar(const uint8_t* a, const uint8_t* b, size_t n) {
+				size_t i = 0;
+				for (; i + 8 <= n; i += 8) {
+					uint64_t x, y;
+					std::memcpy(&x, a + i, 8);
+					std::memcpy(&y, b + i, 8);
+					if (x != y)
+						break;
+				}
+				for (; i < n; i++) {
+					if (a[i] != b[i])
+						return i;
+				}
+				return n;
+			}
+
+#if defined(FTL_BUFFER_X86_SIMD)
+			static bool cpu_has_avx2() {
+#if defined(__GNUC__)
+				return __builtin_cpu_supports("avx2") != 0;
+#elif defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+				__cpuid(info, 1);
+				// OSXSAVE和AVX，并且操作系统保存YMM寄存器
+				if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+					return false;
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#else
+				return false;
+#endif
+			}
+
+			static inline __m128i load128(const uint8_t* p) {
+				return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			}
+
+			static size_t FindByteSse2(const uint8_t* p, size_t n, uint8_t c) {
+				const __m128i needle = _mm_set1_epi8((char)c);
+				size_t i = 0;
+				for (; i + 16 <= n; i += 16) {
+					unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(load128(p + i), needle));
+					if (mask)
+						return i + CountTrailingZeros64(mask);
+				}
+				return offset(i, FindByteScalar(p + i, n - i, c));
+			}
+
+			// 首尾两个字节同时匹配的位置才比较中间的字节
+			static size_t FindSse2(const uint8_t* p, size_t n, const uint8_t* pattern, size_t m) {
+				const __m128i first = _mm_set1_epi8((char)pattern[0]);
+				const __m128i last = _mm_set1_epi8((char)pattern[m - 1]);
+				size_t i = 0;
+				for (; i + m - 1 + 16 <= n; i += 16) {
+					__m128i eq = _mm_and_si128(_mm_cmpeq_epi8(load128(p + i), first), _mm_cmpeq_epi8(load128(p + i + m - 1), last));
+					unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+					while (mask) {
+						unsigned j = CountTrailingZeros64(mask);
+						if (std::memcmp(p + i + j + 1, pattern + 1, m - 2) == 0)
+							return i + j;
+						mask &= mask - 1;
+					}
+				}
+				return offset(i, FindScalar(p + i, n - i, pattern, m));
+			}
+
+			static size_t FindFirstOfSse2(const uint8_t* p, size_t n, const uint8_t* set, size_t set_size) {
+				__m128i needles[MAX_SIMD_SET_SIZE];
+				for (size_t k = 0; k < set_size; k++)
+					needles[k] = _mm_set1_epi8((char)set[k]);
+				size_t i = 0;
+				for (; i + 16 <= n; i += 16) {
+					__m128i v = load128(p + i);
+					__m128i eq = _mm_cmpeq_epi8(v, needles[0]);
+					for (size_t k = 1; k < set_size; k++)
+						eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, needles[k]));
+					unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+					if (mask)
+						return i + CountTrailingZeros64(mask);
+				}
+				return offset(i, FindFirstOfScalar(p + i, n - i, set, set_size));
+			}
+
+			static size_t MismatchSse2(const uint8_t* a, const uint8_t* b, size_t n) {
+				size_t i = 0;
+				for (; i + 16 <= n; i += 16) {
+					unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(load128(a + i), load128(b + i)));
+					if (mask != 0xffff)
+						return i + CountTrailingZeros64(~mask & 0xffff);
+				}
+				return i + MismatchScalar(a + i, b + i, n - i);
+			}
+
+			FTL_BUFFER_TARGET_AVX2 static inline __m256i load256(const uint8_t* p) {
+				return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			}
+
+			FTL_BUFFER_TARGET_AVX2 static size_t FindByteAvx2(const uint8_t* p, size_t n, uint8_t c) {
+				const __m256i needle = _mm256_set1_epi8((char)c);
+				size_t i = 0;
+				// 每次处理64字节，没有匹配时只需要一次movemask
+				for (; i + 64 <= n; i += 64) {
+					__m256i eq0 = _mm256_cmpeq_epi8(load256(p + i), needle);
+					__m256i eq1 = _mm256_cmpeq_epi8(load256(p + i + 32), needle);
+					if (_mm256_movemask_epi8(_mm256_or_si256(eq0, eq1))) {
+						uint64_t mask = (uint32_t)_mm256_movemask_epi8(eq0) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(eq1) << 32);
+						return i + CountTrailingZeros64(mask);
+					}
+				}
+				for (; i + 32 <= n; i += 32) {
+					unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(load256(p + i), needle));
+					if (mask)
+						return i + CountTrailingZeros64(mask);
+				}
+				return offset(i, FindByteSse2(p + i, n - i, c));
+			}
+
+			FTL_BUFFER_TARGET_AVX2 static size_t FindAvx2(const uint8_t* p, size_t n, const uint8_t* pattern, size_t m) {
+				const __m256i first = _mm256_set1_epi8((char)pattern[0]);
+				const __m256i last = _mm256_set1_epi8((char)pattern[m - 1]);
+				size_t i = 0;
+				for (; i + m - 1 + 64 <= n; i += 64) {
+					__m256i eq0 = _mm256_and_si256(_mm256_cmpeq_epi8(load256(p + i), first), _mm256_cmpeq_epi8(load256(p + i + m - 1), last));
+					__m256i eq1 = _mm256_and_si256(_mm256_cmpeq_epi8(load256(p + i + 32), first), _mm256_cmpeq_epi8(load256(p + i + 32 + m - 1), last));
+					if (!_mm256_movemask_epi8(_mm256_or_si256(eq0, eq1)))
+						continue;
+					uint64_t mask = (uint32_t)_mm256_movemask_epi8(eq0) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(eq1) << 32);
+					while (mask) {
+						unsigned j = CountTrailingZeros64(mask);
+						if (std::memcmp(p + i + j + 1, pattern + 1, m - 2) == 0)
+							return i + j;
+						mask &= mask - 1;
+					}
+				}
+				for (; i + m - 1 + 32 <= n; i += 32) {
+					__m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(load256(p + i), first), _mm256_cmpeq_epi8(load256(p + i + m - 1), last));
+					unsigned mask = (unsigned)_mm256_movemask_epi8(eq);
+					while (mask) {
+						unsigned j = CountTrailingZeros64(mask);
+						if (std::memcmp(p + i + j + 1, pattern + 1, m - 2) == 0)
+							return i + j;
+						mask &= mask - 1;
+					}
+				}
+				return offset(i, FindSse2(p + i, n - i, pattern, m));
+			}
+
+			FTL_BUFFER_TARGET_AVX2 static size_t FindFirstOfAvx2(const uint8_t* p, size_t n, const uint8_t* set, size_t set_size) {
+				__m256i needles[MAX_SIMD_SET_SIZE];
+				for (size_t k = 0; k < set_size; k++)
+					needles[k] = _mm256_set1_epi8((char)set[k]);
+				size_t i = 0;
+				for (; i + 32 <= n; i += 32) {
+					__m256i v = load256(p + i);
+					__m256i eq = _mm256_cmpeq_epi8(v, needles[0]);
+					for (size_t k = 1; k < set_size; k++)
+						eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(v, needles[k]));
+					unsigned mask = (unsigned)_mm256_movemask_epi8(eq);
+					if (mask)
+						return i + CountTrailingZeros64(mask);
+				}
+				return offset(i, FindFirstOfSse2(p + i, n - i, set, set_size));
+			}
+
+			FTL_BUFFER_TARGET_AVX2 static size_t MismatchAvx2(const uint8_t* a, const uint8_t* b, size_t n) {
+				size_t i = 0;
+				for (; i + 64 <= n; i += 64) {
+					__m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(load256(a + i), load256(b + i)),
+						_mm256_cmpeq_epi8(load256(a + i + 32), load256(b + i + 32)));
+					if ((unsigned)_mm256_movemask_epi8(eq) != 0xffffffffu)
+						break;
+				}
+				for (; i + 32 <= n; i += 32) {
+					unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(load256(a + i), load256(b + i)));
+					if (mask != 0xffffffffu)
+						return i + CountTrailingZeros64(~mask & 0xffffffffu);
+				}
+				return i + MismatchSse2(a + i, b + i, n - i);
+			}
+#elif defined(FTL_BUFFER_NEON)
+			// 每个字节对应掩码中的4位
+			static inline uint64_t neon_mask(uint8x16_t eq) {
+				return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+			}
+
+			static size_t FindByteNeon(const uint8_t* p, size_t n, uint8_t c) {
+				const uint8x16_t needle = vdupq_n_u8(c);
+				size_t i = 0;
+				for (; i + 16 <= n; i += 16) {
+					uint64_t mask = neon_mask(vceqq_u8(vld1q_u8(p + i), needle));
+					if (mask)
+						return i + CountTrailingZeros64(mask) / 4;
+				}
+				return offset(i, FindByteScalar(p + i, n - i, c));
+			}
+
+			static size_t FindNeon(const uint8_t* p, size_t n, const uint8_t* pattern, size_t m) {
+				const uint8x16_t first = vdupq_n_u8(pattern[0]);
+				const uint8x16_t last = vdupq_n_u8(pattern[m - 1]);
+				size_t i = 0;
+				for (; i + m - 1 + 16 <= n; i += 16) {
+					uint64_t mask = neon_mask(vandq_u8(vceqq_u8(vld1q_u8(p + i), first), vceqq_u8(vld1q_u8(p + i + m - 1), last)));
+					while (mask) {
+						unsigned j = CountTrailingZeros64(mask) / 4;
+						if (std::memcmp(p + i + j + 1, pattern + 1, m - 2) == 0)
+							return i + j;
+						mask &= ~(0xfULL << (j * 4));
+					}
+				}
+				return offset(i, FindScalar(p + i, n - i, pattern, m));
+			}
+
+			static size_t FindFirstOfNeon(const uint8_t* p, size_t n, const uint8_t* set, size_t set_size) {
+				uint8x16_t needles[MAX_SIMD_SET_SIZE];
+				for (size_t k = 0; k < set_size; k++)
+					needles[k] = vdupq_n_u8(set[k]);
+				size_t i = 0;
+				for (; i + 16 <= n; i += 16) {
+					uint8x16_t v = vld1q_u8(p + i);
+					uint8x16_t eq = vceqq_u8(v, needles[0]);
+					for (size_t k = 1; k < set_size; k++)
+						eq = vorrq_u8(eq, vceqq_u8(v, needles[k]));
+					uint64_t mask = neon_mask(eq);
+					if (mask)
+						return i + CountTrailingZeros64(mask) / 4;
+				}
+				return offset(i, FindFirstOfScalar(p + i, n - i, set, set_size));
+			}
+
+			static size_t MismatchNeon(const uint8_t* a, const uint8_t* b, size_t n) {
+				size_t i = 0;
+				for (; i + 16 <= n; i += 16) {
+					uint64_t mask = neon_mask(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+					if (mask != ~0ULL)
+						return i + CountTrailingZeros64(~mask) / 4;
+				}
+				return i + MismatchScalar(a + i, b + i, n - i);
+			}
+#endif
+		};
+        
+    } // namespace buffer_internal
+
+	/**
+		BufferSpanT，经过一次越界检查之后的缓冲区视图，读写函数不再逐次检查
+		由BufferT::span()/StreamBufferT::read_span()/write_span()创建，不持有内存，
+		视图的生命周期不能超过创建它的buffer，期间buffer也不能改变大小
+
+			BufferSpanT<const uint8_t> header = buffer.span(0, 10);  // 只检查一次
+			header.read_be<uint16_t>(0);
+			header.read_be<uint32_t>(2);
+
+		_Ty为const类型时只能读取
+	*/
+	template<typename _Ty>
+	class BufferSpanT {
+	public:
+		typedef _Ty value_type;
+		typedef _Ty* pointer;
+		typedef _Ty* iterator;
+		typedef size_t size_type;
+
+		BufferSpanT():
+			data_(nullptr),
+			size_(0) {
+		}
+
+		BufferSpanT(pointer data, size_type size):
+			data_(data),
+			size_(size) {
+		}
+
+		inline pointer begin() const {
+			return data_;
+		}
+
+		inline pointer end() const {
+			return data_ + size_;
+		}
+
+		inline size_type size() const {
+			return size_;
+		}
+
+		inline bool empty() const {
+			return size_ == 0;
+		}
+
+		// 不检查范围
+		inline BufferSpanT subspan(size_type offset, size_type count) const {
+			return BufferSpanT(data_ + offset, count);
+		}
+
+		///////////////////////////////////////
+		// read functions, 不检查范围
+		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+			read(size_type offset) const {
+			return buffer_internal::Endian::read<_Ty, _RetTy, endianness>(data_ + offset);
+		}
+
+		template<typename _RetTy>
+		inline _RetTy read_le(size_type offset) const {
+			return read<_RetTy, buffer_internal::Endian::kLittleEndian>(offset);
+		}
+
+		template<typename _RetTy>
+		inline _RetTy read_be(size_type offset) const {
+			return read<_RetTy, buffer_internal::Endian::kBigEndian>(offset);
+		}
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_RetTy>::value, _RetTy>::type
+			read(size_type offset) const {
+			return (_RetTy)data_[offset];
+		}
+
+		inline uint8_t read_byte(size_type offset) const {
+			return (uint8_t)data_[offset];
+		}
+
+		inline char read_char(size_type offset) const {
+			return (char)data_[offset];
+		}
+
+		template<typename _RetTy>
+		inline void read_be_array(size_type offset, _RetTy* dst, size_type count) const {
+			buffer_internal::Endian::read_array<_Ty, _RetTy, buffer_internal::Endian::kBigEndian>(data_ + offset, dst, count);
+		}
+
+		template<typename _RetTy>
+		inline void read_le_array(size_type offset, _RetTy* dst, size_type count) const {
+			buffer_internal::Endian::read_array<_Ty, _RetTy, buffer_internal::Endian::kLittleEndian>(data_ + offset, dst, count);
+		}
+
+		/////////////////////////////////////////////////
+		// write functions, 不检查范围
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value>::type
+			write(const _SrcTy& value, size_type offset) const {
+			buffer_internal::Endian::write<_Ty, _SrcTy, endianness>(data_ + offset, value);
+		}
+
+		template<typename _SrcTy>
+		inline void write_le(const _SrcTy& value, size_type offset) const {
+			write<_SrcTy, buffer_internal::Endian::kLittleEndian>(value, offset);
+		}
+
+		template<typename _SrcTy>
+		inline void write_be(const _SrcTy& value, size_type offset) const {
+			write<_SrcTy, buffer_internal::Endian::kBigEndian>(value, offset);
+		}
+
+		template<typename _SrcTy>
+		inline void write(const _SrcTy& value, size_type offset,
+			typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) const {
+			data_[offset] = value;
+		}
+
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value>::type
+			write_bytes(const _SrcTy* buf, size_type buf_size, size_type offset = 0) const {
+			std::memcpy(data_ + offset, buf, buf_size);
+		}
+
+		template<typename _SrcTy>
+		inline void write_be_array(const _SrcTy* src, size_type count, size_type offset) const {
+			buffer_internal::Endian::write_array<_Ty, _SrcTy, buffer_internal::Endian::kBigEndian>(data_ + offset, src, count);
+		}
+
+		template<typename _SrcTy>
+		inline void write_le_array(const _SrcTy* src, size_type count, size_type offset) const {
+			buffer_internal::Endian::write_array<_Ty, _SrcTy, buffer_internal::Endian::kLittleEndian>(data_ + offset, src, count);
+		}
+
+	private:
+		pointer data_;
+		size_type size_;
+	};
+
+    template<typename _Ty, typename Continer = buffer_internal::SimpleBufferT<_Ty> >
+    class BufferT {
+    public:
+		typedef typename Continer::value_type value_type;
+		typedef typename Continer::reference reference;
+		typedef typename Continer::const_reference const_reference;
+		typedef typename Continer::pointer pointer;
+		typedef typename Continer::const_pointer const_pointer;
+		typedef typename Continer::iterator iterator;
+		typedef typename Continer::const_iterator const_iterator;
+		typedef typename Continer::size_type size_type;
+		typedef Continer continer_type;
+
+		static const size_type npos = static_cast<size_type>(-1);
+
+		// 默认、拷贝、移动和从容器构造是constexpr，容器是字面类型(例如StaticContinerT)时可以在编译期构造
+		constexpr BufferT() { }
+
+		constexpr BufferT(const BufferT& other):
+			continer_(other.continer_){
+
+		}
+
+		constexpr BufferT(BufferT&& other):
+			continer_(static_cast<Continer&&>(other.continer_)){
+
+		}
+		
+		explicit BufferT(size_type size):
+			continer_(size){
+
+		}
+
+		BufferT(size_type size, const value_type& val):
+			continer_(size, val){
+
+		}
+
+		BufferT(const_pointer buf, size_type size):
+			continer_(buf, size){
+
+		}
+
+		BufferT(const_pointer begin, const_pointer end) :
+			continer_(begin, end) {
+
+		}
+
+		explicit BufferT(const std::vector<_Ty>& vec):
+			continer_(vec){
+
+		}
+
+		explicit BufferT(std::vector<_Ty>&& vec) :
+			continer_(std::move(vec)) {
+
+		}
+
+		// 直接使用一个已经构造好的容器，例如MappedFileT
+		constexpr explicit BufferT(Continer&& continer) :
+			continer_(static_cast<Continer&&>(continer)) {
+
+		}
+
+		static BufferT ref(pointer buf, size_type size) {
+			Continer tmp = Continer::ref(buf, size);
+			BufferT rv;
+			rv.continer_ = std::move(tmp);
+			return rv;
+		}
+
+		static BufferT ref(std::vector<_Ty>* vec) {
+			Continer tmp = Continer::ref(vec);
+			BufferT rv;
+			rv.continer_ = std::move(tmp);
+			return rv;
+		}
+
+		// 接管外部的内存，不复制，由容器决定是否支持：SimpleBufferT/VectorContinerT支持vector，
+		// SimpleBufferT还支持string和unique_ptr
+		static BufferT adopt(std::vector<_Ty>&& vec) {
+			Continer tmp = Continer::adopt(std::move(vec));
+			BufferT rv;
+			rv.continer_ = std::move(tmp);
+			return rv;
+		}
+
+		static BufferT adopt(std::string&& str) {
+			Continer tmp = Continer::adopt(std::move(str));
+			BufferT rv;
+			rv.continer_ = std::move(tmp);
+			return rv;
+		}
+
+		template<typename _Deleter>
+		static BufferT adopt(std::unique_ptr<_Ty[], _Deleter>&& p, size_type size) {
+			Continer tmp = Continer::adopt(std::move(p), size);
+			BufferT rv;
+			rv.continer_ = std::move(tmp);
+			return rv;
+		}
+
+		// 交出数据，之后为空；是adopt()接管的同类内存时不复制，用于把数据交给第三方接口
+		std::vector<_Ty> release_vector() {
+			return continer_.release_vector();
+		}
+
+		std::string release_string() {
+			return continer_.release_string();
+		}
+
+		template<typename C = Continer>
+		std::unique_ptr<_Ty[], typename C::deleter_type> release(size_type* size) {
+			return continer_.release(size);
+		}
+
+		[[noreturn]] FTL_BUFFER_NOINLINE FTL_BUFFER_COLD void xran(size_t pos, size_t need_size) const {
+			FTL_BUFFER_STAT(bounds_failures, 1);
+			char buf[96];
+			snprintf(buf, sizeof(buf), "BufferT(%p), size=%08zx, pos=%08zx, need_size=%08zx",
+				(const void*)this, (size_t)size(), pos, need_size);
+			throw std::out_of_range(std::string(buf));
+		}
+
+		pointer begin() { 
+			return continer_.begin();  
+		}
+
+		const_pointer begin() const {
+			return continer_.begin();
+		}
+
+		pointer end() {
+			return continer_.end();
+		}
+
+		const_pointer end() const {
+			return continer_.end();
+		}
+
+		constexpr size_type size() const {
+			return continer_.size();
+		}
+
+		constexpr size_type capacity() const {
+			return continer_.capacity();
+		}
+
+		Continer& continer() {
+			return continer_;
+		}
+
+		constexpr const Continer& continer() const {
+			return continer_;
+		}
+
+		void shrink() {
+			continer_.shrink();
+		}
+
+		void fill(const value_type& value, size_type offset, size_type count = 0) {
+			if (count == 0 || (offset + count) > size())
+				count = size() - offset;
+			std::fill(continer_.begin() + offset, continer_.begin() + offset + count, value);
+		}
+
+		// 是否复制由容器决定，SharedBufferT返回共享内存的视图
+		BufferT slice(size_type offset, size_type count) const {
+			BufferT rv;
+			if (offset < size()) {
+				if (count + offset >= size())
+					count = size() - offset;
+				rv.continer_ = continer_.slice(offset, count);
+			}
+			return rv;
+		}
+
+		// 检查一次[offset, offset + count)的范围，返回不再检查的视图
+		BufferSpanT<const _Ty> span(size_type offset, size_type count) const {
+			if (FTL_BUFFER_UNLIKELY(offset > size() || count > size() - offset))
+				xran(offset, count);
+			return BufferSpanT<const _Ty>(continer_.begin() + offset, count);
+		}
+
+		BufferSpanT<_Ty> span(size_type offset, size_type count) {
+			if (FTL_BUFFER_UNLIKELY(offset > size() || count > size() - offset))
+				xran(offset, count);
+			return BufferSpanT<_Ty>(continer_.begin() + offset, count);
+		}
+
+		void append(const std::vector<_Ty>& vec) {
+			if (!vec.empty()) {
+				size_type size = continer_.size();
+				continer_.resize(size + vec.size());
+				buffer_internal::LargeCopy::copy(continer_.begin() + size, &vec.front(), vec.size());
+			}
+		}
+
+		BufferT& operator=(const BufferT& other) {
+			continer_ = other.continer_;
+			return *this;
+		}
+
+		BufferT& operator+=(const BufferT& other) {
+			continer_.push_back(other.continer_);
+			return *this;
+		}
+
+		BufferT& operator+=(const std::vector<_Ty>& vec) {
+			append(vec);
+			return *this;
+		}
+
+		BufferT& operator=(BufferT&& other) {
+			continer_ = std::move(other.continer_);
+			return *this;
+		}
+
+		bool operator==(const BufferT& other) const {
+			return equal(other.continer_.begin(), other.size());
+		}
+
+		/////////////////////////////////////
+		// search functions，使用buffer_internal::Search，找不到时返回npos
+
+		// 从pos开始查找value
+		size_type find(const _Ty& value, size_type pos = 0) const {
+			if (pos >= size())
+				return npos;
+			return result(pos, buffer_internal::Search::find_byte(bytes() + pos, size() - pos, (uint8_t)value));
+		}
+
+		// 从pos开始查找pattern，例如查找"\r\n"
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, size_type>::type
+			find(const _SrcTy* pattern, size_type count, size_type pos = 0) const {
+			if (pos > size())
+				return npos;
+			return result(pos, buffer_internal::Search::find(bytes() + pos, size() - pos,
+				reinterpret_cast<const uint8_t*>(pattern), count));
+		}
+
+		// 从pos开始查找set中任意一个元素
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, size_type>::type
+			find_first_of(const _SrcTy* set, size_type count, size_type pos = 0) const {
+			if (pos >= size())
+				return npos;
+			return result(pos, buffer_internal::Search::find_first_of(bytes() + pos, size() - pos,
+				reinterpret_cast<const uint8_t*>(set), count));
+		}
+
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, bool>::type
+			equal(const _SrcTy* buf, size_type count) const {
+			return count == size() && buffer_internal::Search::equal(bytes(), reinterpret_cast<const uint8_t*>(buf), count);
+		}
+
+		// 按照无符号字节的字典序比较，返回-1/0/1
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, int>::type
+			compare(const _SrcTy* buf, size_type count) const {
+			return buffer_internal::Search::compare(bytes(), size(), reinterpret_cast<const uint8_t*>(buf), count);
+		}
+
+		int compare(const BufferT& other) const {
+			return compare(other.continer_.begin(), other.size());
+		}
+
+		bool empty() const {
+			return continer_.empty();
+		}
+
+		void resize(size_type size) {
+			continer_.resize(size);
+		}
+
+		// 预留至少count个元素的容量，不改变size()
+		void reserve(size_type count) {
+			continer_.reserve(count);
+		}
+
+		// 减小size()，不释放内存，resize(0)会释放内存
+		void truncate(size_type size) {
+			continer_.truncate(size);
+		}
+
+		/**
+			返回size()之后count个可写元素的视图，不初始化，写入之后调用commit()增加size()，例如：
+				BufferSpanT<uint8_t> space = buffer.prepare(4096);
+				ssize_t n = recv(fd, space.begin(), space.size(), 0);
+				if (n > 0)
+					buffer.commit(n);
+			视图在下一次改变容量之前有效，容器需要提供commit()，VectorContinerT/MappedFileT不支持(编译失败)
+		*/
+		BufferSpanT<_Ty> prepare(size_type count) {
+			static_assert(buffer_internal::has_commit<Continer>::value, "prepare()/commit() requires a continer with commit()");
+			size_type offset = size();
+			continer_.reserve(offset + count);
+			return BufferSpanT<_Ty>(continer_.begin() + offset, count);
+		}
+
+		void commit(size_type count) {
+			if (FTL_BUFFER_UNLIKELY(count > capacity() - size()))
+				xran(size(), count);
+			continer_.commit(count);
+		}
+
+		void clear() {
+			return continer_.clear();
+		}
+
+		///////////////////////////////////////
+		// read functions
+		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
+		inline _RetTy read(size_type offset) const{
+			static_assert(buffer_internal::is_endian_basictype<_RetTy>::value, 
+				"read_le<>/read_be<>, only support int16_t/uint16_t, "
+				"int32_t/uint32_t, int64_t/uint64_t, float/double, "
+				"call read<>()/read_char/read_byte to read uint8_t/int8_t/char");
+			if (FTL_BUFFER_UNLIKELY(offset + sizeof(_RetTy) > size()))
+				xran(offset, sizeof(_RetTy));
+
+			return buffer_internal::Endian::read<_Ty, _RetTy, endianness>(continer_.begin() + offset);
+		}
+
+		template<typename _RetTy>
+		inline _RetTy read_le(size_type offset) const {
+			return read<_RetTy, buffer_internal::Endian::kLittleEndian>(offset);
+		}
+
+		template<typename _RetTy>
+		inline _RetTy read_be(size_type offset) const {
+			return read<_RetTy, buffer_internal::Endian::kBigEndian>(offset);
+		}
+
+		// 根据当前的字节序来读取
+		template<typename _RetTy>
+		inline _RetTy read(size_type offset, 
+			typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value>::type* dummy = 0) const {
+			if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kBigEndian)
+				return read<_RetTy, buffer_internal::Endian::kBigEndian>(offset);
+			else
+				return read<_RetTy, buffer_internal::Endian::kLittleEndian>(offset);
+		}
+
+		template<typename _RetTy>
+		inline _RetTy read(size_type offset,
+			typename std::enable_if<buffer_internal::is_8bit_basictype<_RetTy>::value>::type* dummy = 0) const {
+			if (FTL_BUFFER_UNLIKELY(offset >= size()))
+				xran(offset, sizeof(char));
+			return *(continer_.begin() + offset);
+		}
+
+		/*template<>
+		inline uint8_t read(size_type offset) const {
+			return read_byte(offset);
+		}
+
+		template<>
+		inline int8_t read<int8_t>(size_type offset) const {
+			return read_char(offset);
+		}
+
+		template<>
+		inline char read<char>(size_type offset) const {
+			return read_char(offset);
+		}*/
+
+		inline uint8_t read_byte(size_type offset) const {
+			if (FTL_BUFFER_UNLIKELY(offset >= size()))
+				xran(offset, sizeof(uint8_t));
+			return *(continer_.begin() + offset);
+		}
+
+		inline char read_char(size_type offset) const {
+			if (FTL_BUFFER_UNLIKELY(offset >= size()))
+				xran(offset, sizeof(char));
+			return *(continer_.begin() + offset);
+		}
+
+		// 从offset位置批量读取count个_RetTy到dst
+		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
+		inline void read_array(size_type offset, _RetTy* dst, size_type count) const {
+			static_assert(buffer_internal::is_endian_basictype<_RetTy>::value,
+				"read_le_array<>/read_be_array<>, only support int16_t/uint16_t, "
+				"int32_t/uint32_t, int64_t/uint64_t, float/double");
+			if (FTL_BUFFER_UNLIKELY(offset > size() || count > (size() - offset) / sizeof(_RetTy)))
+				xran(offset, count * sizeof(_RetTy));
+			buffer_internal::Endian::read_array<_Ty, _RetTy, endianness>(continer_.begin() + offset, dst, count);
+		}
+
+		template<typename _RetTy>
+		inline void read_le_array(size_type offset, _RetTy* dst, size_type count) const {
+			read_array<_RetTy, buffer_internal::Endian::kLittleEndian>(offset, dst, count);
+		}
+
+		template<typename _RetTy>
+		inline void read_be_array(size_type offset, _RetTy* dst, size_type count) const {
+			read_array<_RetTy, buffer_internal::Endian::kBigEndian>(offset, dst, count);
+		}
+
+		/////////////////////////////////////////////////
+		// write functions
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
+		inline void write(const _SrcTy& value, size_t offset) {
+			static_assert(buffer_internal::is_endian_basictype<_SrcTy>::value,
+				"write_le/write_be, only support int16_t/uint16_t, "
+				"int32_t/uint32_t, int64_t/uint64_t, float/double, "
+				"call write() to write char/uint8_t/int8_t");
+			if (FTL_BUFFER_UNLIKELY(offset + sizeof(value) > size()))
+				xran(offset, sizeof(value));
+			buffer_internal::Endian::write<_Ty, _SrcTy, endianness>(continer_.begin() + offset, value);
+		}
+
+		template<typename _SrcTy>
+		inline void write_le(const _SrcTy& value, size_t offset) {
+			return write<_SrcTy, buffer_internal::Endian::kLittleEndian>(value, offset);
+		}
+
+		template<typename _SrcTy>
+		inline void write_be(const _SrcTy& value, size_t offset) {
+			return write<_SrcTy, buffer_internal::Endian::kBigEndian>(value, offset);
+		}
+
+		template<typename _SrcTy>
+		inline void write(const _SrcTy& value, size_t offset,
+			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kBigEndian)
+				write<_SrcTy, buffer_internal::Endian::kBigEndian>(value, offset);
+			else
+				write<_SrcTy, buffer_internal::Endian::kLittleEndian>(value, offset);
+		}
+
+		template<typename _SrcTy>
+		inline void write(const _SrcTy& value, size_t offset, 
+			typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			if (FTL_BUFFER_UNLIKELY(offset >= size()))
+				xran(offset, sizeof(value));
+			*(continer_.begin() + offset) = value;
+		}
+
+		// 写入缓冲区，仅支持：char*/signed char*(int8_t*)/unsigned char*(uint8_t)
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type*
+			write_bytes(const _SrcTy* buf, size_type buf_size, size_type offset = 0) {
+			if (FTL_BUFFER_UNLIKELY(offset + buf_size > size()))
+				xran(offset, buf_size);
+			return reinterpret_cast<_SrcTy*>(buffer_internal::LargeCopy::copy(continer_.begin() + offset, buf, buf_size));
+		}
+
+		// 在offset位置批量写入count个_SrcTy
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
+		inline void write_array(const _SrcTy* src, size_type count, size_type offset) {
+			static_assert(buffer_internal::is_endian_basictype<_SrcTy>::value,
+				"write_le_array/write_be_array, only support int16_t/uint16_t, "
+				"int32_t/uint32_t, int64_t/uint64_t, float/double");
+			if (FTL_BUFFER_UNLIKELY(offset > size() || count > (size() - offset) / sizeof(_SrcTy)))
+				xran(offset, count * sizeof(_SrcTy));
+			buffer_internal::Endian::write_array<_Ty, _SrcTy, endianness>(continer_.begin() + offset, src, count);
+		}
+
+		template<typename _SrcTy>
+		inline void write_le_array(const _SrcTy* src, size_type count, size_type offset) {
+			write_array<_SrcTy, buffer_internal::Endian::kLittleEndian>(src, count, offset);
+		}
+
+		template<typename _SrcTy>
+		inline void write_be_array(const _SrcTy* src, size_type count, size_type offset) {
+			write_array<_SrcTy, buffer_internal::Endian::kBigEndian>(src, count, offset);
+		}
+
+		/////////////////////////////////////
+		// append functions
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
+		inline void append(const _SrcTy& value) {
+			static_assert(buffer_internal::is_endian_basictype<_SrcTy>::value, 
+				"append_le/append_be, only support int16_t/uint16_t, "
+				"int32_t/uint32_t, int64_t/uint64_t, float/double, "
+				"call append() to write char/uint8_t/int8_t");
+			size_type offset = size();
+			EnsureWritableBytes(size(), sizeof(value));
+			write<_SrcTy, endianness>(value, offset);
+		}
+
+		template<typename _SrcTy>
+		inline void append_le(const _SrcTy& value) {
+			append<_SrcTy, buffer_internal::Endian::kLittleEndian>(value);
+		}
+
+		template<typename _SrcTy>
+		inline void append_be(const _SrcTy& value) {
+			append<_SrcTy, buffer_internal::Endian::kBigEndian>(value);
+		}
+
+		template<typename _SrcTy>
+		inline void append(const _SrcTy& value,
+			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kBigEndian)
+				append<_SrcTy, buffer_internal::Endian::kBigEndian>(value);
+			else
+				append<_SrcTy, buffer_internal::Endian::kLittleEndian>(value);
+		}
+
+		// for char/signed char/unsigned char
+		template<typename _SrcTy>
+		inline void append(const _SrcTy& value,
+			typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			size_t offset = size();
+			EnsureWritableBytes(size(), sizeof(value));
+			*(continer_.begin() + offset) = value;
+		}
+
+        template<typename _SrcTy>
+        inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type*
+            append(const _SrcTy* buf, size_type buf_size) {
+            size_type offset = size();
+            EnsureWritableBytes(offset, buf_size);
+            return reinterpret_cast<_SrcTy*>(buffer_internal::LargeCopy::copy(continer_.begin() + offset, buf, buf_size));
+        }
+
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
+		inline void append_array(const _SrcTy* src, size_type count) {
+			size_type offset = size();
+			EnsureWritableBytes(offset, count * sizeof(_SrcTy));
+			write_array<_SrcTy, endianness>(src, count, offset);
+		}
+
+		template<typename _SrcTy>
+		inline void append_le_array(const _SrcTy* src, size_type count) {
+			append_array<_SrcTy, buffer_internal::Endian::kLittleEndian>(src, count);
+		}
+
+		template<typename _SrcTy>
+		inline void append_be_array(const _SrcTy* src, size_type count) {
+			append_array<_SrcTy, buffer_internal::Endian::kBigEndian>(src, count);
+		}
+
+		/////////////////////////////////////
+		// varint functions
+		// uint32_t/uint64_t使用varint，int32_t/int64_t使用zigzag + varint
+
+		// 从offset位置读取一个varint，length返回读取的字节数
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_varint_type<_RetTy>::value, _RetTy>::type
+			read_varint(size_type offset, size_type* length = nullptr) const {
+			_RetTy value = 0;
+			size_type n = 0;
+			if (FTL_BUFFER_UNLIKELY(offset >= size() ||
+				(n = buffer_internal::Varint::decode(data_at(offset), size() - offset, value)) == 0))
+				xran(offset, buffer_internal::Varint::MaxLength<_RetTy>::value);
+			if (length != nullptr)
+				*length = n;
+			return value;
+		}
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_zigzag_type<_RetTy>::value, _RetTy>::type
+			read_zigzag(size_type offset, size_type* length = nullptr) const {
+			typedef typename std::make_unsigned<_RetTy>::type unsigned_type;
+			return buffer_internal::Varint::ZigZagDecode(read_varint<unsigned_type>(offset, length));
+		}
+
+		// 从offset位置连续读取count个varint到dst，返回读取的字节数
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_varint_type<_RetTy>::value, size_type>::type
+			read_varint_array(size_type offset, _RetTy* dst, size_type count) const {
+			size_t consumed = 0;
+			if (FTL_BUFFER_UNLIKELY(offset > size() ||
+				buffer_internal::Varint::decode_array(data_at(offset), size() - offset, dst, count, &consumed) != count))
+				xran(offset + consumed, buffer_internal::Varint::MaxLength<_RetTy>::value);
+			return consumed;
+		}
+
+		// 在offset位置写入一个varint，返回写入的字节数
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_varint_type<_SrcTy>::value, size_type>::type
+			write_varint(const _SrcTy& value, size_type offset) {
+			size_type n = buffer_internal::Varint::length(value);
+			if (FTL_BUFFER_UNLIKELY(offset > size() || n > size() - offset))
+				xran(offset, n);
+			encode_varint(value, offset);
+			return n;
+		}
+
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_zigzag_type<_SrcTy>::value, size_type>::type
+			write_zigzag(const _SrcTy& value, size_type offset) {
+			return write_varint(buffer_internal::Varint::ZigZagEncode(value), offset);
+		}
+
+		// 追加一个varint，只扩展一次空间，返回写入的字节数
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_varint_type<_SrcTy>::value, size_type>::type
+			append_varint(const _SrcTy& value) {
+			size_type offset = size();
+			size_type n = buffer_internal::Varint::length(value);
+			EnsureWritableBytes(offset, n);
+			encode_varint(value, offset);
+			return n;
+		}
+
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_zigzag_type<_SrcTy>::value, size_type>::type
+			append_zigzag(const _SrcTy& value) {
+			return append_varint(buffer_internal::Varint::ZigZagEncode(value));
+		}
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_RetTy>::value, _RetTy>::type*
+			cast_to() {
+			return reinterpret_cast<_RetTy*>(begin());
+		}
+
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type*
+			append(const std::vector<_SrcTy>* vec) {
+			if (vec != nullptr && !vec->empty()) {
+				return append<_SrcTy>(&vec->front(), vec->size());
+			} else {
+				return nullptr;
+			}
+		}
+
+		/////////////////////////////////////
+		// STL container functions
+		// 编码格式见buffer_internal::Serializer，先计算编码之后的总长度，只扩展一次空间，
+		// 整数/float/double的vector整体复制或者翻转字节序；读取时解码到调用者的容器，复用容器已有的容量，
+		// 数据不完整时抛出std::out_of_range，容器的内容不确定
+		//   buf.append_string(name);
+		//   buf.append_be_vector(ids);               // varint(个数) + 每个元素的大端
+		//   size_type n = buf.read_string(0, name);
+		//   buf.read_be_vector(n, ids);
+
+		// 追加string/vector/map/pair以及它们的嵌套，返回写入的字节数
+		template<enum buffer_internal::Endian::Endianness endianness, typename _SrcTy>
+		size_type append_serialized(const _SrcTy& value) {
+			typedef buffer_internal::Serializer<_SrcTy, endianness> serializer;
+			size_type offset = size();
+			size_type n = serializer::size(value);
+			EnsureWritableBytes(offset, n);
+			serializer::encode(reinterpret_cast<uint8_t*>(continer_.begin() + offset), value);
+			return n;
+		}
+
+		// varint(字节数) + 字节
+		size_type append_string(const std::string& str) {
+			return append_serialized<buffer_internal::Endian::kBigEndian>(str);
+		}
+
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness, typename _Alloc>
+		size_type append_vector(const std::vector<_SrcTy, _Alloc>& vec) {
+			return append_serialized<endianness>(vec);
+		}
+
+		template<typename _SrcTy, typename _Alloc>
+		size_type append_le_vector(const std::vector<_SrcTy, _Alloc>& vec) {
+			return append_serialized<buffer_internal::Endian::kLittleEndian>(vec);
+		}
+
+		template<typename _SrcTy, typename _Alloc>
+		size_type append_be_vector(const std::vector<_SrcTy, _Alloc>& vec) {
+			return append_serialized<buffer_internal::Endian::kBigEndian>(vec);
+		}
+
+		// std::map/std::unordered_map
+		template<enum buffer_internal::Endian::Endianness endianness, typename _MapTy>
+		size_type append_map(const _MapTy& map) {
+			return append_serialized<endianness>(map);
+		}
+
+		template<typename _MapTy>
+		size_type append_le_map(const _MapTy& map) {
+			return append_serialized<buffer_internal::Endian::kLittleEndian>(map);
+		}
+
+		template<typename _MapTy>
+		size_type append_be_map(const _MapTy& map) {
+			return append_serialized<buffer_internal::Endian::kBigEndian>(map);
+		}
+
+		// 从offset位置解码到value，返回读取的字节数
+		template<enum buffer_internal::Endian::Endianness endianness, typename _RetTy>
+		size_type read_serialized(size_type offset, _RetTy& value) const {
+			const uint8_t* p = nullptr;
+			if (FTL_BUFFER_UNLIKELY(offset > size() ||
+				(p = buffer_internal::Serializer<_RetTy, endianness>::decode(data_at(offset), bytes() + size(), value)) == nullptr))
+				xdecode(offset);
+			return (size_type)(p - data_at(offset));
+		}
+
+		size_type read_string(size_type offset, std::string& str) const {
+			return read_serialized<buffer_internal::Endian::kBigEndian>(offset, str);
+		}
+
+		// 返回append_string()写入的字节的视图，不复制，length返回包括长度前缀在内读取的字节数
+		BufferSpanT<const _Ty> read_string_span(size_type offset, size_type* length = nullptr) const {
+			size_t n = 0;
+			const uint8_t* p = nullptr;
+			if (FTL_BUFFER_UNLIKELY(offset > size() ||
+				(p = buffer_internal::SerializerCount::decode(data_at(offset), bytes() + size(), 1, n)) == nullptr))
+				xdecode(offset);
+			size_type prefix = (size_type)(p - data_at(offset));
+			if (length != nullptr)
+				*length = prefix + n;
+			return BufferSpanT<const _Ty>(continer_.begin() + offset + prefix, n);
+		}
+
+		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness, typename _Alloc>
+		size_type read_vector(size_type offset, std::vector<_RetTy, _Alloc>& vec) const {
+			return read_serialized<endianness>(offset, vec);
+		}
+
+		template<typename _RetTy, typename _Alloc>
+		size_type read_le_vector(size_type offset, std::vector<_RetTy, _Alloc>& vec) const {
+			return read_serialized<buffer_internal::Endian::kLittleEndian>(offset, vec);
+		}
+
+		template<typename _RetTy, typename _Alloc>
+		size_type read_be_vector(size_type offset, std::vector<_RetTy, _Alloc>& vec) const {
+			return read_serialized<buffer_internal::Endian::kBigEndian>(offset, vec);
+		}
+
+		// 解码之前清空map
+		template<enum buffer_internal::Endian::Endianness endianness, typename _MapTy>
+		size_type read_map(size_type offset, _MapTy& map) const {
+			return read_serialized<endianness>(offset, map);
+		}
+
+		template<typename _MapTy>
+		size_type read_le_map(size_type offset, _MapTy& map) const {
+			return read_serialized<buffer_internal::Endian::kLittleEndian>(offset, map);
+		}
+
+		template<typename _MapTy>
+		size_type read_be_map(size_type offset, _MapTy& map) const {
+			return read_serialized<buffer_internal::Endian::kBigEndian>(offset, map);
+		}
+
+    private:
+        Continer continer_;
+
+		inline void EnsureWritableBytes(size_t offset, size_t size) {
+			if (offset + size > continer_.size()) {
+				continer_.resize(continer_.size() + (offset + size - continer_.size()));
+			}
+		}
+
+		inline const uint8_t* data_at(size_type offset) const {
+			return reinterpret_cast<const uint8_t*>(continer_.begin() + offset);
+		}
+
+		// [offset, offset + Varint::length(value))已经检查过
+		template<typename _SrcTy>
+		inline void encode_varint(const _SrcTy& value, size_type offset) {
+			buffer_internal::Varint::encode(reinterpret_cast<uint8_t*>(continer_.begin() + offset), value);
+		}
+
+		inline const uint8_t* bytes() const {
+			return reinterpret_cast<const uint8_t*>(continer_.begin());
+		}
+
+		static inline size_type result(size_type pos, size_t found) {
+			return found == buffer_internal::Search::npos ? npos : pos + (size_type)found;
+		}
+
+		// 解码失败，需要的长度超过剩余的数据
+		[[noreturn]] FTL_BUFFER_NOINLINE FTL_BUFFER_COLD void xdecode(size_type offset) const {
+			xran(offset, offset < size() ? size() - offset + 1 : 1);
+		}
+    };
+
+	template<typename _Ty, typename Continer>
+	const typename BufferT<_Ty, Continer>::size_type BufferT<_Ty, Continer>::npos;
+
+
+	/////////////////////////////////////////////////////////////////////
+	// class stream_buffer
+	template<typename _Ty, typename Buffer = BufferT<_Ty> >
+	class StreamBufferT {
+	public:
+		typedef typename Buffer::value_type value_type;
+		typedef typename Buffer::reference reference;
+		typedef typename Buffer::const_reference const_reference;
+		typedef typename Buffer::pointer pointer;
+		typedef typename Buffer::const_pointer const_pointer;
+		typedef typename Buffer::iterator iterator;
+		typedef typename Buffer::const_iterator const_iterator;
+		typedef typename Buffer::size_type size_type;
+
+		static const size_type npos = Buffer::npos;
+
+		/**
+			写入模式：
+				kFixedWrite      写入超过buffer_.size()时抛出异常
+				kGrowableWrite   写入超过buffer_.size()时按照容器的增长策略扩大buffer，buffer_.size()跟随write_index_
+		*/
+		enum WriteMode {
+			kFixedWrite,
+			kGrowableWrite
+		};
+
+		StreamBufferT():
+			read_index_(0),
+			write_index_(0),
+			prepared_(0),
+			write_mode_(kFixedWrite){
+
+		}
+
+		StreamBufferT(const StreamBufferT& other):
+			buffer_(other.buffer_),
+			read_index_(other.read_index_),
+			write_index_(other.write_index_),
+			prepared_(other.prepared_),
+			write_mode_(other.write_mode_){
+
+		}
+
+		StreamBufferT(StreamBufferT&& other):
+			buffer_(std::move(other.buffer_)),
+			read_index_(std::move(other.read_index_)),
+			write_index_(std::move(other.write_index_)),
+			prepared_(other.prepared_),
+			write_mode_(other.write_mode_){
+
+		}
+
+		// 指定写入模式，预留capacity个元素的容量，例如作为网络读写缓冲区：
+		//   byte_streambuffer stream(byte_streambuffer::kGrowableWrite, 4096);
+		explicit StreamBufferT(WriteMode mode, size_type capacity = 0):
+			read_index_(0),
+			write_index_(0),
+			prepared_(0),
+			write_mode_(mode) {
+			if (capacity > 0)
+				buffer_.reserve(capacity);
+		}
+
+		StreamBufferT(const_pointer buf, size_type size):
+			buffer_(buf, size),
+			read_index_(0),
+			write_index_(0),
+			prepared_(0),
+			write_mode_(kFixedWrite) {
+
+		}
+
+		StreamBufferT(size_type size, const _Ty& value):
+			buffer_(size, value),
+			read_index_(0),
+			write_index_(0),
+			prepared_(0),
+			write_mode_(kFixedWrite) {
+
+		}
+
+		explicit StreamBufferT(Buffer&& buffer):
+			buffer_(std::move(buffer)),
+			read_index_(0),
+			write_index_(0),
+			prepared_(0),
+			write_mode_(kFixedWrite) {
+
+		}
+
+		static StreamBufferT ref(pointer buf, size_type size) {
+			if (buf != nullptr && size > 0) {
+				Buffer buffer = Buffer::ref(buf, size);
+				StreamBufferT rv;
+				rv.buffer_ = std::move(buffer);
+				return rv;
+			} else {
+				return StreamBufferT();
+			}
+		}
+
+		static StreamBufferT ref(std::vector<pointer>* vec) {
+			if (vec != nullptr && vec->size() > 0) {
+				Buffer buf = Buffer::ref(vec);
+				StreamBufferT rv;
+				rv.buffer_ = std::move(buf);
+				return rv;
+			} else {
+				return StreamBufferT();
+			}			
+		}
+
+		inline bool empty() const {
+			return buffer_.empty();
+		}
+
+		inline bool read_eof() const {
+			return (read_index_ >= data_end());
+		}
+
+		inline bool write_eof() const {
+			return (write_index_ >= buffer_.size());
+		}
+
+		[[noreturn]] FTL_BUFFER_NOINLINE FTL_BUFFER_COLD void xran(size_type need_size, bool read_action) const {
+			FTL_BUFFER_STAT(bounds_failures, 1);
+			char buf[96];
+			if (read_action)
+				snprintf(buf, sizeof(buf), "StreamBufferT(%p) read, size=%08zx, read_index=%08zx, need_size=%08zx",
+				(const void*)this, (size_t)buffer_.size(), (size_t)read_index_, (size_t)need_size);
+			else
+				snprintf(buf, sizeof(buf), "StreamBufferT(%p) write, size=%08zx, write_index=%08zx, need_size=%08zx",
+				(const void*)this, (size_t)buffer_.size(), (size_t)write_index_, (size_t)need_size);
+			throw std::out_of_range(std::string(buf));
+		}
+		
+		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+			read() {
+				if (FTL_BUFFER_UNLIKELY(read_index_ + sizeof(_RetTy) > data_end()))
+					xran(sizeof(_RetTy), true);
+				size_type offset = read_index_;
+				read_index_ += sizeof(_RetTy);
+				return buffer_internal::Endian::read<_Ty, _RetTy, endianness>(read_begin() + offset);
+		}
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_RetTy>::value, _RetTy>::type 
+			read() {
+				if (FTL_BUFFER_UNLIKELY(read_index_ + sizeof(_RetTy) > data_end()))
+					xran(sizeof(_RetTy), true);
+				return *(read_begin() + (read_index_ ++ ));
+		}
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+			read_le() {
+				return read<_RetTy, buffer_internal::Endian::kLittleEndian>();
+		}
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+			read_be() {
+				return read<_RetTy, buffer_internal::Endian::kBigEndian>();
+		}
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+			read(){
+				if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kLittleEndian)
+					return read_le<_RetTy>();
+				else
+					return read_be<_RetTy>();
+		}
+
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
+		inline void write(const _SrcTy& value, 
+			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			check_write(sizeof(_SrcTy));
+			size_type offset = write_index_;
+			write_index_ += sizeof(_SrcTy);
+			buffer_internal::Endian::write<_Ty, _SrcTy, endianness>(buffer_.begin() + offset, value);
+		}
+
+		template<typename _SrcTy>
+		inline void write(const _SrcTy& value, 
+			typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			check_write(sizeof(_SrcTy));
+			*(buffer_.begin() + write_index_++) = value;
+		}
+
+		template<typename _SrcTy>
+		inline void write_le(const _SrcTy& value, 
+			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			write<_SrcTy, buffer_internal::Endian::kLittleEndian>(value);
+		}
+
+		template<typename _SrcTy>
+		inline void write_be(const _SrcTy& value, 
+			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			write<_SrcTy, buffer_internal::Endian::kBigEndian>(value);
+		}
+
+		template<typename _SrcTy>
+		inline void write(const _SrcTy& value, 
+			typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kLittleEndian)
+				return write_le<_SrcTy>(value);
+			else
+				return write_be<_SrcTy>(value);
+		}
+
+		// 写入缓冲区，仅支持：char*/signed char*(int8_t*)/unsigned char*(uint8_t)
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type*
+			write_bytes(const _SrcTy* buf, size_type buf_size) {
+			check_write(buf_size);
+			size_type offset = write_index_;
+			write_index_ += buf_size;
+			return reinterpret_cast<_SrcTy*>(buffer_internal::LargeCopy::copy(buffer_.begin() + offset, buf, buf_size));
+		}
+
+		// 批量读取count个_RetTy到dst
+		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value>::type
+			read_array(_RetTy* dst, size_type count) {
+			if (FTL_BUFFER_UNLIKELY(read_index_ > data_end() || count > (data_end() - read_index_) / sizeof(_RetTy)))
+				xran(count * sizeof(_RetTy), true);
+			size_type offset = read_index_;
+			read_index_ += count * sizeof(_RetTy);
+			buffer_internal::Endian::read_array<_Ty, _RetTy, endianness>(read_begin() + offset, dst, count);
+		}
+
+		template<typename _RetTy>
+		inline void read_le_array(_RetTy* dst, size_type count) {
+			read_array<_RetTy, buffer_internal::Endian::kLittleEndian>(dst, count);
+		}
+
+		template<typename _RetTy>
+		inline void read_be_array(_RetTy* dst, size_type count) {
+			read_array<_RetTy, buffer_internal::Endian::kBigEndian>(dst, count);
+		}
+
+		// 批量写入count个_SrcTy
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value>::type
+			write_array(const _SrcTy* src, size_type count) {
+			if (FTL_BUFFER_UNLIKELY(write_index_ > buffer_.size() || count > (buffer_.size() - write_index_) / sizeof(_SrcTy)))
+				grow_write(count * sizeof(_SrcTy));
+			size_type offset = write_index_;
+			write_index_ += count * sizeof(_SrcTy);
+			buffer_internal::Endian::write_array<_Ty, _SrcTy, endianness>(buffer_.begin() + offset, src, count);
+		}
+
+		template<typename _SrcTy>
+		inline void write_le_array(const _SrcTy* src, size_type count) {
+			write_array<_SrcTy, buffer_internal::Endian::kLittleEndian>(src, count);
+		}
+
+		template<typename _SrcTy>
+		inline void write_be_array(const _SrcTy* src, size_type count) {
+			write_array<_SrcTy, buffer_internal::Endian::kBigEndian>(src, count);
+		}
+
+		// 检查一次剩余的可读长度，read_index_前进count，返回不再检查的视图
+		BufferSpanT<const _Ty> read_span(size_type count) {
+			if (FTL_BUFFER_UNLIKELY(read_index_ > data_end() || count > data_end() - read_index_))
+				xran(count, true);
+			size_type offset = read_index_;
+			read_index_ += count;
+			return BufferSpanT<const _Ty>(read_begin() + offset, count);
+		}
+
+		// 检查一次剩余的可写长度，write_index_前进count，返回不再检查的视图
+		BufferSpanT<_Ty> write_span(size_type count) {
+			check_write(count);
+			size_type offset = write_index_;
+			write_index_ += count;
+			return BufferSpanT<_Ty>(buffer_.begin() + offset, count);
+		}
+
+		// 预留至少count个元素的容量
+		void reserve(size_type count) {
+			buffer_.reserve(count);
+		}
+
+		/**
+			返回write_index_之后count个可写元素的视图，写入之后调用commit()移动write_index_
+			kGrowableWrite时空间不足扩大buffer，新增的空间不初始化，commit()之前不属于可读的数据(data_end())；
+			kFixedWrite时超过buffer_.size()抛出std::out_of_range
+				BufferSpanT<uint8_t> space = stream.prepare(4096);
+				ssize_t n = recv(fd, space.begin(), space.size(), 0);
+				if (n > 0)
+					stream.commit(n);
+		*/
+		BufferSpanT<_Ty> prepare(size_type count) {
+			if (write_mode_ == kGrowableWrite) {
+				size_type end = data_end();
+				if (buffer_.size() < write_index_ + count)
+					buffer_.resize(write_index_ + count);
+				prepared_ = buffer_.size() - end;
+			} else if (FTL_BUFFER_UNLIKELY(write_index_ > buffer_.size() || count > buffer_.size() - write_index_)) {
+				xran(count, false);
+			}
+			return BufferSpanT<_Ty>(buffer_.begin() + write_index_, count);
+		}
+
+		void commit(size_type count) {
+			if (FTL_BUFFER_UNLIKELY(write_index_ > buffer_.size() || count > buffer_.size() - write_index_))
+				xran(count, false);
+			write_index_ += count;
+			if (write_mode_ == kGrowableWrite) {
+				buffer_.truncate(write_index_);
+				prepared_ = 0;
+			}
+		}
+
+		/////////////////////////////////////
+		// varint functions
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_varint_type<_RetTy>::value, _RetTy>::type
+			read_varint() {
+			_RetTy value = 0;
+			size_type n = 0;
+			if (FTL_BUFFER_UNLIKELY(read_index_ >= data_end() ||
+				(n = buffer_internal::Varint::decode(reinterpret_cast<const uint8_t*>(read_begin() + read_index_),
+					data_end() - read_index_, value)) == 0))
+				xran(buffer_internal::Varint::MaxLength<_RetTy>::value, true);
+			read_index_ += n;
+			return value;
+		}
+
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_zigzag_type<_RetTy>::value, _RetTy>::type
+			read_zigzag() {
+			typedef typename std::make_unsigned<_RetTy>::type unsigned_type;
+			return buffer_internal::Varint::ZigZagDecode(read_varint<unsigned_type>());
+		}
+
+		// 连续读取count个varint到dst
+		template<typename _RetTy>
+		inline typename std::enable_if<buffer_internal::is_varint_type<_RetTy>::value>::type
+			read_varint_array(_RetTy* dst, size_type count) {
+			size_t consumed = 0;
+			if (FTL_BUFFER_UNLIKELY(read_index_ > data_end() ||
+				buffer_internal::Varint::decode_array(reinterpret_cast<const uint8_t*>(read_begin() + read_index_),
+					data_end() - read_index_, dst, count, &consumed) != count))
+				xran(buffer_internal::Varint::MaxLength<_RetTy>::value, true);
+			read_index_ += consumed;
+		}
+
+		// 返回写入的字节数
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_varint_type<_SrcTy>::value, size_type>::type
+			write_varint(const _SrcTy& value) {
+			size_type n = buffer_internal::Varint::length(value);
+			check_write(n);
+			buffer_internal::Varint::encode(reinterpret_cast<uint8_t*>(buffer_.begin() + write_index_), value);
+			write_index_ += n;
+			return n;
+		}
+
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_zigzag_type<_SrcTy>::value, size_type>::type
+			write_zigzag(const _SrcTy& value) {
+			return write_varint(buffer_internal::Varint::ZigZagEncode(value));
+		}
+
+		/////////////////////////////////////
+		// STL container functions，格式和BufferT::append_serialized()相同，写入时只检查一次空间，
+		// 读取失败时抛出std::out_of_range，read_index_不变，容器的内容不确定
+		//   stream.write_string(method);
+		//   stream.write_be_vector(args);
+		//   stream.read_string(method);
+		//   stream.read_be_vector(args);             // 复用args已有的容量
+
+		template<enum buffer_internal::Endian::Endianness endianness, typename _SrcTy>
+		size_type write_serialized(const _SrcTy& value) {
+			typedef buffer_internal::Serializer<_SrcTy, endianness> serializer;
+			size_type n = serializer::size(value);
+			check_write(n);
+			serializer::encode(reinterpret_cast<uint8_t*>(buffer_.begin() + write_index_), value);
+			write_index_ += n;
+			return n;
+		}
+
+		size_type write_string(const std::string& str) {
+			return write_serialized<buffer_internal::Endian::kBigEndian>(str);
+		}
+
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness, typename _Alloc>
+		size_type write_vector(const std::vector<_SrcTy, _Alloc>& vec) {
+			return write_serialized<endianness>(vec);
+		}
+
+		template<typename _SrcTy, typename _Alloc>
+		size_type write_le_vector(const std::vector<_SrcTy, _Alloc>& vec) {
+			return write_serialized<buffer_internal::Endian::kLittleEndian>(vec);
+		}
+
+		template<typename _SrcTy, typename _Alloc>
+		size_type write_be_vector(const std::vector<_SrcTy, _Alloc>& vec) {
+			return write_serialized<buffer_internal::Endian::kBigEndian>(vec);
+		}
+
+		template<enum buffer_internal::Endian::Endianness endianness, typename _MapTy>
+		size_type write_map(const _MapTy& map) {
+			return write_serialized<endianness>(map);
+		}
+
+		template<typename _MapTy>
+		size_type write_le_map(const _MapTy& map) {
+			return write_serialized<buffer_internal::Endian::kLittleEndian>(map);
+		}
+
+		template<typename _MapTy>
+		size_type write_be_map(const _MapTy& map) {
+			return write_serialized<buffer_internal::Endian::kBigEndian>(map);
+		}
+
+		template<enum buffer_internal::Endian::Endianness endianness, typename _RetTy>
+		void read_serialized(_RetTy& value) {
+			if (FTL_BUFFER_UNLIKELY(read_index_ > data_end()))
+				xdecode();
+			const uint8_t* begin = reinterpret_cast<const uint8_t*>(read_begin() + read_index_);
+			const uint8_t* p = buffer_internal::Serializer<_RetTy, endianness>::decode(begin,
+				reinterpret_cast<const uint8_t*>(read_begin() + data_end()), value);
+			if (FTL_BUFFER_UNLIKELY(p == nullptr))
+				xdecode();
+			read_index_ += (size_type)(p - begin);
+		}
+
+		void read_string(std::string& str) {
+			read_serialized<buffer_internal::Endian::kBigEndian>(str);
+		}
+
+		// 返回write_string()写入的字节的视图，不复制
+		BufferSpanT<const _Ty> read_string_span() {
+			if (FTL_BUFFER_UNLIKELY(read_index_ > data_end()))
+				xdecode();
+			const uint8_t* begin = reinterpret_cast<const uint8_t*>(read_begin() + read_index_);
+			size_t n = 0;
+			const uint8_t* p = buffer_internal::SerializerCount::decode(begin,
+				reinterpret_cast<const uint8_t*>(read_begin() + data_end()), 1, n);
+			if (FTL_BUFFER_UNLIKELY(p == nullptr))
+				xdecode();
+			read_index_ += (size_type)(p - begin);
+			return read_span(n);
+		}
+
+		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness, typename _Alloc>
+		void read_vector(std::vector<_RetTy, _Alloc>& vec) {
+			read_serialized<endianness>(vec);
+		}
+
+		template<typename _RetTy, typename _Alloc>
+		void read_le_vector(std::vector<_RetTy, _Alloc>& vec) {
+			read_serialized<buffer_internal::Endian::kLittleEndian>(vec);
+		}
+
+		template<typename _RetTy, typename _Alloc>
+		void read_be_vector(std::vector<_RetTy, _Alloc>& vec) {
+			read_serialized<buffer_internal::Endian::kBigEndian>(vec);
+		}
+
+		template<enum buffer_internal::Endian::Endianness endianness, typename _MapTy>
+		void read_map(_MapTy& map) {
+			read_serialized<endianness>(map);
+		}
+
+		template<typename _MapTy>
+		void read_le_map(_MapTy& map) {
+			read_serialized<buffer_internal::Endian::kLittleEndian>(map);
+		}
+
+		template<typename _MapTy>
+		void read_be_map(_MapTy& map) {
+			read_serialized<buffer_internal::Endian::kBigEndian>(map);
+		}
+
+		/////////////////////////////////////
+		// search functions，在未读取的数据[read_index_, size())中查找，返回相对于read_index_的位置
+		//   size_type n = stream.find("\r\n", 2);
+		//   if (n != byte_streambuffer::npos) line = stream.read_span(n + 2);
+
+		size_type find(const _Ty& value) const {
+			return relative(buffer_.find(value, read_index_), 1);
+		}
+
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, size_type>::type
+			find(const _SrcTy* pattern, size_type count) const {
+			return relative(buffer_.find(pattern, count, read_index_), count);
+		}
+
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, size_type>::type
+			find_first_of(const _SrcTy* set, size_type count) const {
+			return relative(buffer_.find_first_of(set, count, read_index_), 1);
+		}
+
+		// 未读取的数据是否以buf开始
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, bool>::type
+			starts_with(const _SrcTy* buf, size_type count) const {
+			return read_index_ <= data_end() && count <= data_end() - read_index_ &&
+				buffer_internal::Search::equal(reinterpret_cast<const uint8_t*>(read_begin() + read_index_),
+					reinterpret_cast<const uint8_t*>(buf), count);
+		}
+
+		// 未读取的数据和buf比较
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, bool>::type
+			equal(const _SrcTy* buf, size_type count) const {
+			return compare(buf, count) == 0;
+		}
+
+		template<typename _SrcTy>
+		typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, int>::type
+			compare(const _SrcTy* buf, size_type count) const {
+			size_type end = data_end();
+			size_type offset = std::min<size_type>(read_index_, end);
+			return buffer_internal::Search::compare(reinterpret_cast<const uint8_t*>(read_begin() + offset),
+				end - offset, reinterpret_cast<const uint8_t*>(buf), count);
+		}
+
+		WriteMode write_mode() const {
+			return write_mode_;
+		}
+
+		void set_write_mode(WriteMode mode) {
+			write_mode_ = mode;
+		}
+
+		/**
+			丢弃已经读取的数据，把[read_index_, size())移动到头部，read_index_归0，write_index_相应前移，
+			kGrowableWrite时buffer_.size()同时减小，容量不变
+				ssize_t n = recv(fd, stream.prepare(4096).begin(), 4096, 0);
+				...
+				stream.commit(n);
+				while (...) stream.read_be<uint32_t>();
+				stream.compact();
+		*/
+		void compact() {
+			if (read_index_ == 0)
+				return;
+			size_type size = buffer_.size();
+			size_type consumed = std::min<size_type>(read_index_, size);
+			if (consumed < size) {
+				pointer p = buffer_.begin();
+				std::memmove(p, p + consumed, (size - consumed) * sizeof(_Ty));
+			}
+			read_index_ = 0;
+			write_index_ -= std::min<size_type>(write_index_, consumed);
+			if (write_mode_ == kGrowableWrite)
+				buffer_.truncate(size - consumed);
+		}
+
+		Buffer& buf() {
+			return buffer_;
+		}
+
+		const Buffer& buf() const {
+			return buffer_;
+		}
+
+		size_type read_index() const {
+			return read_index_;
+		}
+
+		size_type write_index() const {
+			return write_index_;
+		}
+
+		// 可读数据的结尾：kGrowableWrite时prepare()之后、commit()之前不包括预留的空间，其他时候等于buf().size()
+		size_type data_end() const {
+			size_type size = buffer_.size();
+			if (prepared_ == 0)
+				return size;
+			// 预留之后通过write_*()写入的数据仍然可读
+			size_type end = prepared_ < size ? size - prepared_ : 0;
+			return std::min<size_type>(size, std::max<size_type>(end, write_index_));
+		}
+
+	private:
+		Buffer buffer_;
+		size_type read_index_;
+		size_type write_index_;
+		size_type prepared_;        // prepare()扩大、还没有commit()的元素个数
+		WriteMode write_mode_;
+
+		// 可写空间不足时调用
+		inline void check_write(size_type count) {
+			if (FTL_BUFFER_UNLIKELY(write_index_ > buffer_.size() || count > buffer_.size() - write_index_))
+				grow_write(count);
+		}
+
+		// 只有kGrowableWrite时扩大buffer，否则抛出异常
+		FTL_BUFFER_NOINLINE void grow_write(size_type count) {
+			if (write_mode_ != kGrowableWrite)
+				xran(count, false);
+			buffer_.resize(write_index_ + count);
+		}
+
+		// 读取时只使用const访问，避免SharedBufferT这类容器发生复制
+		inline const_pointer read_begin() const {
+			return buffer_.begin();
+		}
+
+		// 匹配的count个元素超出data_end()时同样没有找到
+		inline size_type relative(size_type pos, size_type count) const {
+			return pos == npos || pos + count > data_end() ? npos : pos - read_index_;
+		}
+
+		// 解码失败，需要的长度超过剩余的数据
+		[[noreturn]] FTL_BUFFER_NOINLINE FTL_BUFFER_COLD void xdecode() const {
+			xran(read_index_ < data_end() ? data_end() - read_index_ + 1 : 1, true);
+		}
+	};
+
+	template<typename _Ty, typename Buffer>
+	const typename StreamBufferT<_Ty, Buffer>::size_type StreamBufferT<_Ty, Buffer>::npos;
+
+	typedef BufferT<uint8_t> byte_buffer;
+	typedef StreamBufferT<uint8_t> byte_streambuffer;
+    typedef BufferT<char> char_buffer;
+	typedef BufferT<uint8_t, buffer_internal::SimpleBufferT<uint8_t, buffer_internal::DefaultAllocator<uint8_t>, 32, 64> > small_byte_buffer;
+	typedef StreamBufferT<uint8_t, small_byte_buffer> small_byte_streambuffer;
+	typedef BufferT<uint8_t, buffer_internal::SharedBufferT<uint8_t> > shared_byte_buffer;
+	typedef StreamBufferT<uint8_t, shared_byte_buffer> shared_byte_streambuffer;
+    typedef BufferT<uint8_t, buffer_internal::VectorContinerT<uint8_t> > vector_buffer;
+
+} // namespace ftl
+
 #endif // FTL_MEMORY_SIMPLE_BUFFER_H_
\ No newline at end of file
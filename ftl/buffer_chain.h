@@ -0,0 +1,389 @@
+#ifndef FTL_BUFFER_CHAIN_H_
+#define FTL_BUFFER_CHAIN_H_
+
+#include <deque>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/uio.h>
+#endif
+
+#include "buffer.h"
+
+/**
+	BufferChainT，由多个BufferT分段组成的缓冲区
+
+	追加：
+		append(Buffer&&)/append(const Buffer&)直接把buffer链接到尾部，不复制数据，
+		如果Buffer使用SharedBufferT，const引用的追加也只是增加引用计数
+
+		byte_buffer_chain chain;
+		chain.append(std::move(header));
+		chain.append(std::move(payload));
+		chain.append_be(uint32_t(0xffeeddcc));	// 小数据写入尾部的分段
+
+	发送：
+		to_iovec()导出struct iovec数组，用于writev/sendmsg，发送完成后调用consume()丢弃已发送的数据
+
+		struct iovec iov[16];
+		size_t count = chain.to_iovec(iov, 16);
+		ssize_t n = writev(fd, iov, count);
+		chain.consume(n);
+
+	读取：
+		reader()返回一个流式的读取游标，可以跨分段读取
+*/
+
+namespace ftl {
+
+	template<typename _Ty, typename Buffer = BufferT<_Ty> >
+	class BufferChainT {
+	public:
+		typedef typename Buffer::value_type value_type;
+		typedef typename Buffer::pointer pointer;
+		typedef typename Buffer::const_pointer const_pointer;
+		typedef typename Buffer::size_type size_type;
+
+		BufferChainT():
+			size_(0),
+			front_offset_(0),
+			tail_owned_(false) {
+		}
+
+		BufferChainT(const BufferChainT& other):
+			segments_(other.segments_),
+			size_(other.size_),
+			front_offset_(other.front_offset_),
+			tail_owned_(other.tail_owned_) {
+		}
+
+		BufferChainT(BufferChainT&& other):
+			segments_(std::move(other.segments_)),
+			size_(other.size_),
+			front_offset_(other.front_offset_),
+			tail_owned_(other.tail_owned_) {
+			other.clear();
+		}
+
+		BufferChainT& operator=(const BufferChainT& other) {
+			segments_ = other.segments_;
+			size_ = other.size_;
+			front_offset_ = other.front_offset_;
+			tail_owned_ = other.tail_owned_;
+			return *this;
+		}
+
+		BufferChainT& operator=(BufferChainT&& other) {
+			segments_ = std::move(other.segments_);
+			size_ = other.size_;
+			front_offset_ = other.front_offset_;
+			tail_owned_ = other.tail_owned_;
+			other.clear();
+			return *this;
+		}
+
+		inline size_type size() const {
+			return size_;
+		}
+
+		inline bool empty() const {
+			return size_ == 0;
+		}
+
+		inline size_type segment_count() const {
+			return segments_.size();
+		}
+
+		const Buffer& segment(size_type index) const {
+			return segments_[index];
+		}
+
+		// 第index个分段中未被consume的数据
+		BufferSpanT<const value_type> segment_span(size_type index) const {
+			size_type skip = (index == 0 ? front_offset_ : 0);
+			return BufferSpanT<const value_type>(segments_[index].begin() + skip, segments_[index].size() - skip);
+		}
+
+		void clear() {
+			segments_.clear();
+			size_ = 0;
+			front_offset_ = 0;
+			tail_owned_ = false;
+		}
+
+		/////////////////////////////////////
+		// append functions
+
+		// 链接一个分段，不复制数据
+		void append(Buffer&& buffer) {
+			if (!buffer.empty()) {
+				size_ += buffer.size();
+				segments_.push_back(std::move(buffer));
+				tail_owned_ = false;
+			}
+		}
+
+		void append(const Buffer& buffer) {
+			if (!buffer.empty()) {
+				size_ += buffer.size();
+				segments_.push_back(buffer);
+				tail_owned_ = false;
+			}
+		}
+
+		void append(BufferChainT&& other) {
+			if (other.empty())
+				return;
+			if (other.front_offset_ > 0)
+				other.compact_front();
+			for (size_type i = 0; i < other.segments_.size(); i++)
+				segments_.push_back(std::move(other.segments_[i]));
+			size_ += other.size_;
+			tail_owned_ = other.tail_owned_;
+			other.clear();
+		}
+
+		// 小数据复制到chain自己的尾部分段，避免产生大量很小的分段
+		template<typename _SrcTy>
+		inline typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, void>::type
+			append(const _SrcTy* buf, size_type buf_size) {
+			if (buf_size > 0) {
+				tail().append(buf, buf_size);
+				size_ += buf_size;
+			}
+		}
+
+		template<typename _SrcTy>
+		inline void append(const _SrcTy& value,
+			typename std::enable_if<buffer_internal::is_8bit_basictype<_SrcTy>::value, _SrcTy>::type* dummy = 0) {
+			tail().append(value);
+			size_ += sizeof(value);
+		}
+
+		template<typename _SrcTy>
+		inline void append_be(const _SrcTy& value) {
+			tail().append_be(value);
+			size_ += sizeof(value);
+		}
+
+		template<typename _SrcTy>
+		inline void append_le(const _SrcTy& value) {
+			tail().append_le(value);
+			size_ += sizeof(value);
+		}
+
+		// 丢弃头部的count个字节，一般用于writev部分发送之后
+		void consume(size_type count) {
+			count = std::min<size_type>(count, size_);
+			size_ -= count;
+			while (count > 0) {
+				size_type left = segments_.front().size() - front_offset_;
+				if (count < left) {
+					front_offset_ += count;
+					break;
+				}
+				count -= left;
+				segments_.pop_front();
+				front_offset_ = 0;
+			}
+			if (segments_.empty())
+				tail_owned_ = false;
+		}
+
+		// 合并为一个连续的buffer
+		Buffer flatten() const {
+			Buffer rv(size_);
+			size_type offset = 0;
+			for (size_type i = 0; i < segments_.size(); i++) {
+				size_type skip = (i == 0 ? front_offset_ : 0);
+				const Buffer& segment = segments_[i];
+				rv.write_bytes(segment.begin() + skip, segment.size() - skip, offset);
+				offset += segment.size() - skip;
+			}
+			return rv;
+		}
+
+#ifdef _WIN32
+		// 导出WSABUF数组，用于WSASend，返回填充的个数
+		size_type to_wsabuf(WSABUF* bufs, size_type max_count) const {
+			size_type count = std::min<size_type>(max_count, segments_.size());
+			for (size_type i = 0; i < count; i++) {
+				size_type skip = (i == 0 ? front_offset_ : 0);
+				bufs[i].buf = (char*)(segments_[i].begin() + skip);
+				bufs[i].len = (ULONG)(segments_[i].size() - skip);
+			}
+			return count;
+		}
+#else
+		// 导出iovec数组，用于writev/sendmsg，返回填充的个数
+		size_type to_iovec(struct iovec* iov, size_type max_count) const {
+			size_type count = std::min<size_type>(max_count, segments_.size());
+			for (size_type i = 0; i < count; i++) {
+				size_type skip = (i == 0 ? front_offset_ : 0);
+				iov[i].iov_base = (void*)(segments_[i].begin() + skip);
+				iov[i].iov_len = segments_[i].size() - skip;
+			}
+			return count;
+		}
+
+		std::vector<struct iovec> to_iovec() const {
+			std::vector<struct iovec> iov(segments_.size());
+			if (!iov.empty())
+				iov.resize(to_iovec(&iov.front(), iov.size()));
+			return iov;
+		}
+#endif
+
+		/**
+			流式读取游标，和StreamBufferT的read接口一致，可以跨分段读取
+			游标不持有数据，读取期间chain不能修改
+		*/
+		class Reader {
+		public:
+			explicit Reader(const BufferChainT& chain):
+				chain_(chain),
+				segment_(0),
+				offset_(chain.front_offset_),
+				read_index_(0) {
+			}
+
+			inline bool read_eof() const {
+				return read_index_ >= chain_.size();
+			}
+
+			inline size_type remaining() const {
+				return chain_.size() - read_index_;
+			}
+
+			template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
+			inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+				read() {
+				if (FTL_BUFFER_UNLIKELY(remaining() < sizeof(_RetTy)))
+					xran(sizeof(_RetTy));
+				const Buffer& segment = chain_.segments_[segment_];
+				if (offset_ + sizeof(_RetTy) <= segment.size()) {
+					_RetTy rv = buffer_internal::Endian::read<_Ty, _RetTy, endianness>(segment.begin() + offset_);
+					advance(sizeof(_RetTy));
+					return rv;
+				}
+				// 跨越分段，先拼接到临时缓冲区
+				_Ty tmp[sizeof(_RetTy)];
+				read_bytes(tmp, sizeof(_RetTy));
+				return buffer_internal::Endian::read<_Ty, _RetTy, endianness>(tmp);
+			}
+
+			template<typename _RetTy>
+			inline typename std::enable_if<buffer_internal::is_8bit_basictype<_RetTy>::value, _RetTy>::type
+				read() {
+				if (read_eof())
+					xran(sizeof(_RetTy));
+				_RetTy rv = *(chain_.segments_[segment_].begin() + offset_);
+				advance(1);
+				return rv;
+			}
+
+			template<typename _RetTy>
+			inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+				read_be() {
+				return read<_RetTy, buffer_internal::Endian::kBigEndian>();
+			}
+
+			template<typename _RetTy>
+			inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+				read_le() {
+				return read<_RetTy, buffer_internal::Endian::kLittleEndian>();
+			}
+
+			template<typename _RetTy>
+			inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, _RetTy>::type
+				read() {
+				if (buffer_internal::Endian::CurrentEndian() == buffer_internal::Endian::kLittleEndian)
+					return read_le<_RetTy>();
+				else
+					return read_be<_RetTy>();
+			}
+
+			// 读取count个字节到buf
+			template<typename _DstTy>
+			inline typename std::enable_if<buffer_internal::is_8bit_basictype<_DstTy>::value, void>::type
+				read_bytes(_DstTy* buf, size_type count) {
+				if (remaining() < count)
+					xran(count);
+				while (count > 0) {
+					const Buffer& segment = chain_.segments_[segment_];
+					size_type n = std::min<size_type>(count, segment.size() - offset_);
+					std::memcpy(buf, segment.begin() + offset_, n);
+					buf += n;
+					count -= n;
+					advance(n);
+				}
+			}
+
+			void skip(size_type count) {
+				if (remaining() < count)
+					xran(count);
+				while (count > 0) {
+					size_type n = std::min<size_type>(count, chain_.segments_[segment_].size() - offset_);
+					count -= n;
+					advance(n);
+				}
+			}
+
+		private:
+			const BufferChainT& chain_;
+			size_type segment_;
+			size_type offset_;
+			size_type read_index_;
+
+			// n不能超过当前分段剩余的长度
+			inline void advance(size_type n) {
+				offset_ += n;
+				read_index_ += n;
+				if (offset_ >= chain_.segments_[segment_].size() && segment_ + 1 < chain_.segments_.size()) {
+					segment_++;
+					offset_ = 0;
+				}
+			}
+
+			[[noreturn]] FTL_BUFFER_NOINLINE FTL_BUFFER_COLD void xran(size_type need_size) const {
+				char buf[96];
+				snprintf(buf, sizeof(buf), "BufferChainT::Reader(%p), size=%08zx, read_index=%08zx, need_size=%08zx",
+					(const void*)this, (size_t)chain_.size(), (size_t)read_index_, (size_t)need_size);
+				throw std::out_of_range(std::string(buf));
+			}
+		};
+
+		Reader reader() const {
+			return Reader(*this);
+		}
+
+	private:
+		std::deque<Buffer> segments_;
+		size_type size_;
+		size_type front_offset_;	// 第一个分段中已经被consume的字节数
+		bool tail_owned_;			// 最后一个分段是否由chain自己创建，链接进来的分段不写入
+
+		Buffer& tail() {
+			if (!tail_owned_) {
+				segments_.push_back(Buffer());
+				tail_owned_ = true;
+			}
+			return segments_.back();
+		}
+
+		// 把第一个分段中已经consume的部分去掉
+		void compact_front() {
+			Buffer& front = segments_.front();
+			front = front.slice(front_offset_, front.size() - front_offset_);
+			front_offset_ = 0;
+		}
+	};
+
+	typedef BufferChainT<uint8_t> byte_buffer_chain;
+	typedef BufferChainT<uint8_t, shared_byte_buffer> shared_byte_buffer_chain;
+
+} // namespace ftl
+
+#endif // FTL_BUFFER_CHAIN_H_
@@ -0,0 +1,316 @@
+#ifndef FTL_BUFFER_POOL_H_
+#define FTL_BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstdlib>
+
+#include "buffer.h"
+#include "thread_cache.h"
+
+/**
+	BufferPool，按容量分桶缓存释放的缓冲区内存，作为SimpleBufferT的_Alloc参数(PoolAllocator)使用
+
+	分桶：
+		256/512/1K/.../8M字节，共16个桶，申请的大小向上取整到桶的大小，
+		同一个桶内的reallocate不需要移动数据；大于8M的请求直接走malloc/free
+
+	回收：
+		buffer析构时内存放回当前线程的缓存，下次申请同一个桶时直接复用，不经过malloc/free，
+		每个线程每个桶最多缓存max_blocks_per_bucket个块，总共不超过max_cached_bytes，超过的直接free
+
+		pooled_byte_streambuffer stream(pooled_byte_streambuffer::kGrowableWrite, 4096);
+		...
+		// stream析构之后内存回到线程缓存
+
+	统计：
+		计数保存在每个线程的缓存中(thread_cache.h的ThreadStatsT)，命中和回收时不修改共享的原子变量，
+		stats()加锁求和，线程退出时计数合并到pool
+
+	释放：
+		trim()通知所有线程丢弃缓存，各线程在下次访问pool时释放，trim_thread()立即释放当前线程的缓存，
+		线程退出时缓存自动释放
+*/
+
+namespace ftl {
+
+	class BufferPool {
+	public:
+		static const size_t MIN_BLOCK_SIZE = 256;
+		static const unsigned int BUCKET_COUNT = 16;
+		static const uint32_t LARGE_BUCKET = 0xffffffff;
+
+		struct Stats {
+			size_t hit_count;		// 从线程缓存中复用的次数
+			size_t miss_count;		// 缓存为空，调用malloc的次数
+			size_t free_count;		// 超过限制或者trim时调用free的次数
+			size_t cached_bytes;	// 所有线程缓存中的字节数
+		};
+
+		struct BlockHeader {
+			uint32_t bucket;
+			uint32_t reserved;
+			uint64_t size;		// 块的可用字节数，不含头部
+		};
+
+		typedef buffer_internal::FreeNode FreeNode;
+
+		// 统计计数的下标，每个线程缓存一份Counters
+		enum Counter {
+			kHitCount = 0,
+			kMissCount,
+			kFreeCount,
+			kCachedBytes,
+			kCounterCount
+		};
+
+		typedef buffer_internal::ThreadStatsT<kCounterCount> Counters;
+
+		explicit BufferPool(size_t max_blocks_per_bucket = 32, size_t max_cached_bytes = 16 * 1024 * 1024):
+			max_blocks_per_bucket_(max_blocks_per_bucket),
+			max_cached_bytes_(max_cached_bytes),
+			epoch_(1) {
+		}
+
+		// 修改每个线程的缓存限制，已经缓存的块在下次释放时按照新的限制处理
+		void set_limits(size_t max_blocks_per_bucket, size_t max_cached_bytes) {
+			max_blocks_per_bucket_.store(max_blocks_per_bucket, std::memory_order_relaxed);
+			max_cached_bytes_.store(max_cached_bytes, std::memory_order_relaxed);
+		}
+
+		size_t max_blocks_per_bucket() const {
+			return max_blocks_per_bucket_.load(std::memory_order_relaxed);
+		}
+
+		size_t max_cached_bytes() const {
+			return max_cached_bytes_.load(std::memory_order_relaxed);
+		}
+
+		// 所有线程的缓存在下次访问时释放
+		void trim() {
+			epoch_.fetch_add(1, std::memory_order_acq_rel);
+		}
+
+		uint32_t epoch() const {
+			return epoch_.load(std::memory_order_acquire);
+		}
+
+		// 所有线程的计数之和，加锁遍历线程缓存，不用于快速路径
+		Stats stats() const {
+			size_t values[kCounterCount];
+			registry_.sum(values);
+			Stats rv;
+			rv.hit_count = values[kHitCount];
+			rv.miss_count = values[kMissCount];
+			rv.free_count = values[kFreeCount];
+			rv.cached_bytes = values[kCachedBytes];
+			return rv;
+		}
+
+		static inline unsigned int bucket(size_t size) {
+			unsigned int rv = 0;
+			while (rv < BUCKET_COUNT && bucket_size(rv) < size)
+				rv++;
+			return rv;
+		}
+
+		static inline size_t bucket_size(unsigned int bucket) {
+			return MIN_BLOCK_SIZE << bucket;
+		}
+
+		static inline BlockHeader* header(void* p) {
+			return reinterpret_cast<BlockHeader*>(p) - 1;
+		}
+
+		/////////////////////////////////////
+		// 以下由线程缓存调用
+
+		void attach(Counters* counters) {
+			registry_.attach(counters);
+		}
+
+		void detach(Counters* counters) {
+			registry_.detach(counters);
+		}
+
+		static BlockHeader* allocate_block(unsigned int bucket_index, size_t size) {
+			size_t block_size = (bucket_index == BUCKET_COUNT ? size : bucket_size(bucket_index));
+			BlockHeader* h = reinterpret_cast<BlockHeader*>(::malloc(sizeof(BlockHeader) + block_size));
+			if (!h)
+				return nullptr;
+			h->bucket = (bucket_index == BUCKET_COUNT ? LARGE_BUCKET : bucket_index);
+			h->reserved = 0;
+			h->size = block_size;
+			return h;
+		}
+
+		static void free_block(BlockHeader* h) {
+			::free(h);
+		}
+
+	private:
+		std::atomic<size_t> max_blocks_per_bucket_;
+		std::atomic<size_t> max_cached_bytes_;
+		std::atomic<uint32_t> epoch_;
+		buffer_internal::StatsRegistryT<kCounterCount> registry_;
+
+		BufferPool(const BufferPool&);
+		BufferPool& operator=(const BufferPool&);
+	};
+
+	namespace buffer_internal {
+
+		/**
+			线程本地的分桶缓存，不加锁，空闲链表和统计计数使用thread_cache.h中和SlabThreadCache相同的组件
+		*/
+		class BufferPoolCache {
+		public:
+			explicit BufferPoolCache(BufferPool& pool):
+				pool_(pool),
+				epoch_(pool.epoch()),
+				cached_bytes_(0) {
+				pool_.attach(&counters_);
+			}
+
+			~BufferPoolCache() {
+				release();
+				pool_.detach(&counters_);
+			}
+
+			inline void* allocate(size_t size) {
+				check_epoch();
+				unsigned int index = BufferPool::bucket(size);
+				if (index < BufferPool::BUCKET_COUNT) {
+					if (FreeNode* node = cache_.pop(index)) {
+						BufferPool::BlockHeader* h = reinterpret_cast<BufferPool::BlockHeader*>(node);
+						cached_bytes_ -= (size_t)h->size;
+						counters_.add(BufferPool::kHitCount, 1);
+						counters_.sub(BufferPool::kCachedBytes, (size_t)h->size);
+						return h + 1;
+					}
+				}
+				BufferPool::BlockHeader* h = BufferPool::allocate_block(index, size);
+				if (!h)
+					return nullptr;
+				if (h->bucket != BufferPool::LARGE_BUCKET)
+					counters_.add(BufferPool::kMissCount, 1);
+				return h + 1;
+			}
+
+			inline void deallocate(void* p) {
+				if (!p)
+					return;
+				check_epoch();
+				BufferPool::BlockHeader* h = BufferPool::header(p);
+				if (h->bucket == BufferPool::LARGE_BUCKET) {
+					BufferPool::free_block(h);
+					return;
+				}
+				unsigned int index = h->bucket;
+				if (cache_.count(index) >= pool_.max_blocks_per_bucket() ||
+					cached_bytes_ + (size_t)h->size > pool_.max_cached_bytes()) {
+					counters_.add(BufferPool::kFreeCount, 1);
+					BufferPool::free_block(h);
+					return;
+				}
+				cache_.push(index, reinterpret_cast<FreeNode*>(h));
+				cached_bytes_ += (size_t)h->size;
+				counters_.add(BufferPool::kCachedBytes, (size_t)h->size);
+			}
+
+			inline void* reallocate(void* p, size_t size) {
+				if (!p)
+					return allocate(size);
+				BufferPool::BlockHeader* h = BufferPool::header(p);
+				if (size <= h->size)
+					return p;
+				if (h->bucket == BufferPool::LARGE_BUCKET && BufferPool::bucket(size) == BufferPool::BUCKET_COUNT) {
+					BufferPool::BlockHeader* nh = reinterpret_cast<BufferPool::BlockHeader*>(::realloc(h, sizeof(BufferPool::BlockHeader) + size));
+					if (!nh)
+						return nullptr;
+					nh->size = size;
+					return nh + 1;
+				}
+				void* np = allocate(size);
+				if (np) {
+					std::memcpy(np, p, (size_t)h->size);
+					deallocate(p);
+				}
+				return np;
+			}
+
+			// 释放当前线程缓存的所有块
+			void release() {
+				Counters& counters = counters_;
+				cache_.drain([&counters](unsigned int, FreeNode* node) {
+					BufferPool::BlockHeader* h = reinterpret_cast<BufferPool::BlockHeader*>(node);
+					counters.add(BufferPool::kFreeCount, 1);
+					counters.sub(BufferPool::kCachedBytes, (size_t)h->size);
+					BufferPool::free_block(h);
+				});
+				cached_bytes_ = 0;
+			}
+
+			size_t cached_bytes() const {
+				return cached_bytes_;
+			}
+
+		private:
+			typedef BufferPool::FreeNode FreeNode;
+			typedef BufferPool::Counters Counters;
+
+			BufferPool& pool_;
+			uint32_t epoch_;
+			size_t cached_bytes_;
+			FreeListCacheT<BufferPool::BUCKET_COUNT> cache_;
+			Counters counters_;
+
+			inline void check_epoch() {
+				uint32_t epoch = pool_.epoch();
+				if (FTL_BUFFER_UNLIKELY(epoch != epoch_)) {
+					release();
+					epoch_ = epoch;
+				}
+			}
+		};
+
+		// 默认的全局pool，自定义pool时提供同样的static instance()即可
+		struct DefaultBufferPool {
+			static BufferPool& instance() {
+				static BufferPool pool;
+				return pool;
+			}
+		};
+
+		template<typename T, typename Pool = DefaultBufferPool>
+		struct PoolAllocator {
+			T* allocate(size_t size) {
+				return reinterpret_cast<T*>(cache().allocate(size));
+			}
+
+			void deallocate(T* p) {
+				return cache().deallocate(p);
+			}
+
+			T* reallocate(T* p, size_t size) {
+				return reinterpret_cast<T*>(cache().reallocate(p, size));
+			}
+
+			// 立即释放当前线程缓存的块
+			static void trim_thread() {
+				cache().release();
+			}
+
+			static BufferPoolCache& cache() {
+				static thread_local BufferPoolCache thread_cache(Pool::instance());
+				return thread_cache;
+			}
+		};
+
+	} // namespace buffer_internal
+
+	typedef BufferT<uint8_t, buffer_internal::SimpleBufferT<uint8_t, buffer_internal::PoolAllocator<uint8_t> > > pooled_byte_buffer;
+	typedef StreamBufferT<uint8_t, pooled_byte_buffer> pooled_byte_streambuffer;
+
+} // namespace ftl
+
+#endif // FTL_BUFFER_POOL_H_
@@ -0,0 +1,797 @@
+#ifndef FTL_CHECKSUM_H_
+#define FTL_CHECKSUM_H_
+
+#include "buffer.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/**
+	校验和：Crc32c/Adler32/XXHash32/XXHash64，直接计算BufferT/BufferSpanT/StreamBufferT的数据，不需要复制
+
+	增量计算：
+		append()可以多次调用，value()返回当前的结果
+
+		Crc32c crc;
+		crc.append(header);                       // BufferT/BufferSpanT
+		crc.append(payload.span(0, 100));
+		uint32_t value = crc.value();
+
+		checksum<Crc32c>(buffer);                // 整个buffer
+		checksum<XXHash64>(buffer, 8, 100);      // [8, 108)，越界时抛出异常
+		checksum<Adler32>(stream);               // StreamBufferT未读取的数据
+
+	写入时计算：
+		ChecksumStreamT包装StreamBufferT，写入之后立即计算新写入的数据，数据还在cache中，不需要再读一遍
+
+		ChecksumStreamT<Crc32c> writer(stream);
+		writer.write_be(uint32_t(1));
+		writer.write_bytes(p, size);
+		stream.write_be(writer.value());         // 在StreamBufferT上直接写入的数据不计算
+
+	Crc32c的实现：
+		x86   运行时检测SSE4.2的crc32指令，支持PCLMUL时3路并行计算，再通过无进位乘法合并
+		ARM   编译时打开crc扩展(-march=armv8-a+crc)时使用__crc32cd
+		其他  slicing-by-8查表
+*/
+
+namespace ftl {
+
+	namespace buffer_internal {
+
+		class Crc32cKernel {
+		public:
+			// Castagnoli多项式，反射形式
+			static const uint32_t POLY = 0x82f63b78;
+
+			enum Isa {
+				kScalar = 0,
+				kSse42 = 1,			// crc32指令
+				kSse42Pclmul = 2,	// crc32指令3路并行，pclmul合并
+				kArmCrc = 3
+			};
+
+			// crc为没有取反的寄存器值
+			static inline uint32_t update(uint32_t crc, const uint8_t* p, size_t n) {
+				return kernels().update(crc, p, n);
+			}
+
+			static Isa isa() {
+				return kernels().isa;
+			}
+
+			static Isa detect() {
+#if defined(FTL_BUFFER_X86_SIMD)
+				if (!cpu_has(kSse42))
+					return kScalar;
+				return cpu_has(kSse42Pclmul) ? kSse42Pclmul : kSse42;
+#elif defined(__ARM_FEATURE_CRC32)
+				return kArmCrc;
+#else
+				return kScalar;
+#endif
+			}
+
+			// 指定使用的实现，用于测试和性能对比，CPU不支持时返回false；不能和计算函数同时调用
+			static bool set_isa(Isa isa) {
+				if (isa != kScalar && isa > detect())
+					return false;
+#if !defined(FTL_BUFFER_X86_SIMD)
+				if (isa == kSse42 || isa == kSse42Pclmul)
+					return false;
+#endif
+				kernels() = make_kernels(isa);
+				return true;
+			}
+
+			// 计算x^n mod P，反射形式，第i位对应x^(31-i)
+			static uint32_t xpow(size_t n) {
+				uint32_t a = 0x80000000u;
+				while (n--)
+					a = (a >> 1) ^ ((a & 1) ? POLY : 0);
+				return a;
+			}
+
+			// a * b mod P，反射形式
+			static uint32_t multiply(uint32_t a, uint32_t b) {
+				uint32_t m = 0x80000000u, p = 0;
+				for (; m != 0 && a != 0; m >>= 1) {
+					if (a & m) {
+						p ^= b;
+						a ^= m;
+					}
+					b = (b >> 1) ^ ((b & 1) ? POLY : 0);
+				}
+				return p;
+			}
+
+			// x^(8 * bytes) mod P，按照x^(2^k)平方展开，O(log(bytes))
+			static uint32_t xpow8n(uint64_t bytes) {
+				const uint32_t* table = square_table().t;
+				uint32_t p = 0x80000000u;
+				for (unsigned int k = 3; bytes != 0; bytes >>= 1, k++) {
+					if (bytes & 1)
+						p = multiply(table[k & 31], p);
+				}
+				return p;
+			}
+
+			static uint32_t UpdateScalar(uint32_t crc, const uint8_t* p, size_t n) {
+				const uint32_t (*t)[256] = tables().t;
+				for (; n >= 8; n -= 8, p += 8) {
+					uint32_t lo, hi;
+					std::memcpy(&lo, p, 4);
+					std::memcpy(&hi, p + 4, 4);
+					if (Endian::CurrentEndian() == Endian::kBigEndian) {
+						lo = ByteSwap(lo);
+						hi = ByteSwap(hi);
+					}
+					lo ^= crc;
+					crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+						t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+				}
+				while (n--)
+					crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+				return crc;
+			}
+
+		private:
+			struct Kernels {
+				Isa isa;
+				uint32_t (*update)(uint32_t crc, const uint8_t* p, size_t n);
+			};
+
+			struct Tables {
+				uint32_t t[8][256];
+
+				Tables() {
+					for (uint32_t i = 0; i < 256; i++) {
+						uint32_t crc = i;
+						for (int k = 0; k < 8; k++)
+							crc = (crc >> 1) ^ ((crc & 1) ? POLY : 0);
+						t[0][i] = crc;
+					}
+					for (uint32_t i = 0; i < 256; i++) {
+						for (int k = 1; k < 8; k++)
+							t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+					}
+				}
+			};
+
+			static const Tables& tables() {
+				static Tables t;
+				return t;
+			}
+
+			// t[k] = x^(2^k) mod P，x^(2^32)开始循环
+			struct SquareTable {
+				uint32_t t[32];
+
+				SquareTable() {
+					t[0] = 0x40000000u;
+					for (int k = 1; k < 32; k++)
+						t[k] = multiply(t[k - 1], t[k - 1]);
+				}
+			};
+
+			static const SquareTable& square_table() {
+				static SquareTable t;
+				return t;
+			}
+
+			static Kernels& kernels() {
+				static Kernels k = make_kernels(detect());
+				return k;
+			}
+
+			static Kernels make_kernels(Isa isa) {
+				Kernels k;
+				k.isa = kScalar;
+				k.update = &UpdateScalar;
+#if defined(FTL_BUFFER_X86_SIMD)
+				if (isa == kSse42) {
+					k.isa = kSse42;
+					k.update = &UpdateSse42;
+				} else if (isa == kSse42Pclmul) {
+					shift_constants();
+					k.isa = kSse42Pclmul;
+					k.update = &UpdateSse42Pclmul;
+				}
+#elif defined(__ARM_FEATURE_CRC32)
+				if (isa == kArmCrc) {
+					k.isa = kArmCrc;
+					k.update = &UpdateArm;
+				}
+#endif
+				return k;
+			}
+
+#if defined(FTL_BUFFER_X86_SIMD)
+			// 3路并行时每一路的字节数，大的数据使用LONG_BLOCK，剩余的部分使用SHORT_BLOCK
+			static const size_t LONG_BLOCK = 1024;
+			static const size_t SHORT_BLOCK = 128;
+
+			/**
+				crc(A|B) = crc(A) * x^(8|B|) mod P ^ crc(B)，
+				两个32位的反射多项式做无进位乘法，结果相当于乘积再乘以x，crc32指令再乘以x^32，
+				所以和K = x^(8|B| - 33) mod P相乘之后用crc32指令约简
+			*/
+			struct ShiftConstants {
+				uint32_t long1;
+				uint32_t long2;
+				uint32_t short1;
+				uint32_t short2;
+
+				ShiftConstants():
+					long1(xpow(8 * LONG_BLOCK - 33)),
+					long2(xpow(16 * LONG_BLOCK - 33)),
+					short1(xpow(8 * SHORT_BLOCK - 33)),
+					short2(xpow(16 * SHORT_BLOCK - 33)) {
+				}
+			};
+
+			static const ShiftConstants& shift_constants() {
+				static ShiftConstants k;
+				return k;
+			}
+
+			static bool cpu_has(Isa isa) {
+#if defined(__GNUC__)
+				if (isa == kSse42)
+					return __builtin_cpu_supports("sse4.2") != 0;
+				return __builtin_cpu_supports("sse4.2") != 0 && __builtin_cpu_supports("pclmul") != 0;
+#elif defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 1);
+				if (isa == kSse42)
+					return (info[2] & (1 << 20)) != 0;
+				return (info[2] & (1 << 20)) != 0 && (info[2] & (1 << 1)) != 0;
+#else
+				return false;
+#endif
+			}
+
+			FTL_BUFFER_TARGET_SSE42 static inline uint32_t crc32_u64(uint32_t crc, const uint8_t* p) {
+#if defined(__x86_64__) || defined(_M_X64)
+				uint64_t v;
+				std::memcpy(&v, p, 8);
+				return (uint32_t)_mm_crc32_u64(crc, v);
+#else
+				uint32_t lo, hi;
+				std::memcpy(&lo, p, 4);
+				std::memcpy(&hi, p + 4, 4);
+				return _mm_crc32_u32(_mm_crc32_u32(crc, lo), hi);
+#endif
+			}
+
+			FTL_BUFFER_TARGET_SSE42 static uint32_t UpdateSse42(uint32_t crc, const uint8_t* p, size_t n) {
+				for (; n >= 8; n -= 8, p += 8)
+					crc = crc32_u64(crc, p);
+				while (n--)
+					crc = _mm_crc32_u8(crc, *p++);
+				return crc;
+			}
+
+			// crc * x^(8 * count)，k为对应的常量
+			FTL_BUFFER_TARGET_PCLMUL static inline uint32_t shift(uint32_t crc, uint32_t k) {
+				__m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc), _mm_cvtsi32_si128((int)k), 0);
+				uint8_t bytes[16];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(bytes), product);
+				uint32_t zero = 0;
+				return crc32_u64(zero, bytes);
+			}
+
+			FTL_BUFFER_TARGET_PCLMUL static inline uint32_t update3(uint32_t crc, const uint8_t* p, size_t block, uint32_t k1, uint32_t k2) {
+				uint32_t crc1 = 0, crc2 = 0;
+				for (size_t i = 0; i < block; i += 8) {
+					crc = crc32_u64(crc, p + i);
+					crc1 = crc32_u64(crc1, p + block + i);
+					crc2 = crc32_u64(crc2, p + 2 * block + i);
+				}
+				return shift(crc, k2) ^ shift(crc1, k1) ^ crc2;
+			}
+
+			FTL_BUFFER_TARGET_PCLMUL static uint32_t UpdateSse42Pclmul(uint32_t crc, const uint8_t* p, size_t n) {
+				const ShiftConstants& k = shift_constants();
+				for (; n >= 3 * LONG_BLOCK; n -= 3 * LONG_BLOCK, p += 3 * LONG_BLOCK)
+					crc = update3(crc, p, LONG_BLOCK, k.long1, k.long2);
+				for (; n >= 3 * SHORT_BLOCK; n -= 3 * SHORT_BLOCK, p += 3 * SHORT_BLOCK)
+					crc = update3(crc, p, SHORT_BLOCK, k.short1, k.short2);
+				return UpdateSse42(crc, p, n);
+			}
+#elif defined(__ARM_FEATURE_CRC32)
+			static uint32_t UpdateArm(uint32_t crc, const uint8_t* p, size_t n) {
+				for (; n >= 8; n -= 8, p += 8) {
+					uint64_t v;
+					std::memcpy(&v, p, 8);
+					crc = __crc32cd(crc, v);
+				}
+				while (n--)
+					crc = __crc32cb(crc, *p++);
+				return crc;
+			}
+#endif
+		};
+
+		// 读取小端的值，XXHash按照小端定义
+		template<typename T>
+		inline T ReadLittle(const uint8_t* p) {
+			return Endian::read<uint8_t, T, Endian::kLittleEndian>(p);
+		}
+
+		inline uint32_t RotateLeft32(uint32_t v, int r) {
+			return (v << r) | (v >> (32 - r));
+		}
+
+		inline uint64_t RotateLeft64(uint64_t v, int r) {
+			return (v << r) | (v >> (64 - r));
+		}
+
+	} // namespace buffer_internal
+
+	/**
+		所有的校验和都提供同样的接口：
+			append(p, size) / append(buffer) / append(span)  增加数据
+			value()  当前的结果，不影响之后继续append
+			reset()  重新开始
+	*/
+	template<typename Derived>
+	class ChecksumT {
+	public:
+		template<typename _Ty, typename Continer>
+		void append(const BufferT<_Ty, Continer>& buf) {
+			derived().append(buf.continer().begin(), buf.size());
+		}
+
+		template<typename _Ty>
+		void append(const BufferSpanT<_Ty>& span) {
+			derived().append(span.begin(), span.size());
+		}
+
+	private:
+		Derived& derived() {
+			return static_cast<Derived&>(*this);
+		}
+	};
+
+	class Crc32c : public ChecksumT<Crc32c> {
+	public:
+		typedef uint32_t value_type;
+		using ChecksumT<Crc32c>::append;
+
+		// value为之前计算的结果，用于继续计算
+		explicit Crc32c(uint32_t value = 0):
+			crc_(~value) {
+		}
+
+		void append(const void* data, size_t size) {
+			crc_ = buffer_internal::Crc32cKernel::update(crc_, reinterpret_cast<const uint8_t*>(data), size);
+		}
+
+		value_type value() const {
+			return ~crc_;
+		}
+
+		// 合并相邻两段的结果，size_b为第二段的字节数
+		static value_type combine(value_type a, value_type b, uint64_t size_b) {
+			return buffer_internal::Crc32cKernel::multiply(a, buffer_internal::Crc32cKernel::xpow8n(size_b)) ^ b;
+		}
+
+		void reset() {
+			crc_ = ~0u;
+		}
+
+	private:
+		uint32_t crc_;
+	};
+
+	class Adler32 : public ChecksumT<Adler32> {
+	public:
+		typedef uint32_t value_type;
+		using ChecksumT<Adler32>::append;
+
+		static const uint32_t BASE = 65521;
+		// a/b在NMAX个字节之内不会溢出32位
+		static const size_t NMAX = 5552;
+
+		explicit Adler32(uint32_t value = 1):
+			a_(value & 0xffff),
+			b_(value >> 16) {
+		}
+
+		void append(const void* data, size_t size) {
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+			uint32_t a = a_, b = b_;
+			while (size > 0) {
+				size_t n = std::min<size_t>(size, (size_t)NMAX);
+				size -= n;
+				for (; n >= 8; n -= 8, p += 8) {
+					a += p[0]; b += a;
+					a += p[1]; b += a;
+					a += p[2]; b += a;
+					a += p[3]; b += a;
+					a += p[4]; b += a;
+					a += p[5]; b += a;
+					a += p[6]; b += a;
+					a += p[7]; b += a;
+				}
+				while (n--) {
+					a += *p++;
+					b += a;
+				}
+				a %= BASE;
+				b %= BASE;
+			}
+			a_ = a;
+			b_ = b;
+		}
+
+		value_type value() const {
+			return (b_ << 16) | a_;
+		}
+
+		// 合并相邻两段的结果，size_b为第二段的字节数
+		static value_type combine(value_type a, value_type b, uint64_t size_b) {
+			uint32_t rem = (uint32_t)(size_b % BASE);
+			uint32_t sum1 = a & 0xffff;
+			uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % BASE);
+			sum1 += (b & 0xffff) + BASE - 1;
+			sum2 += ((a >> 16) & 0xffff) + ((b >> 16) & 0xffff) + BASE - rem;
+			if (sum1 >= BASE)
+				sum1 -= BASE;
+			if (sum1 >= BASE)
+				sum1 -= BASE;
+			if (sum2 >= (BASE << 1))
+				sum2 -= (BASE << 1);
+			if (sum2 >= BASE)
+				sum2 -= BASE;
+			return sum1 | (sum2 << 16);
+		}
+
+		void reset() {
+			a_ = 1;
+			b_ = 0;
+		}
+
+	private:
+		uint32_t a_;
+		uint32_t b_;
+	};
+
+	class XXHash32 : public ChecksumT<XXHash32> {
+	public:
+		typedef uint32_t value_type;
+		using ChecksumT<XXHash32>::append;
+
+		static const uint32_t PRIME1 = 2654435761u;
+		static const uint32_t PRIME2 = 2246822519u;
+		static const uint32_t PRIME3 = 3266489917u;
+		static const uint32_t PRIME4 = 668265263u;
+		static const uint32_t PRIME5 = 374761393u;
+
+		explicit XXHash32(uint32_t seed = 0):
+			seed_(seed) {
+			reset();
+		}
+
+		void append(const void* data, size_t size) {
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+			total_ += size;
+			if (pending_ + size < 16) {
+				std::memcpy(buf_ + pending_, p, size);
+				pending_ += size;
+				return;
+			}
+			if (pending_ > 0) {
+				size_t n = 16 - pending_;
+				std::memcpy(buf_ + pending_, p, n);
+				consume(buf_);
+				p += n;
+				size -= n;
+				pending_ = 0;
+			}
+			for (; size >= 16; size -= 16, p += 16)
+				consume(p);
+			std::memcpy(buf_, p, size);
+			pending_ = size;
+		}
+
+		value_type value() const {
+			using buffer_internal::RotateLeft32;
+			uint32_t h;
+			if (total_ >= 16)
+				h = RotateLeft32(v_[0], 1) + RotateLeft32(v_[1], 7) + RotateLeft32(v_[2], 12) + RotateLeft32(v_[3], 18);
+			else
+				h = seed_ + PRIME5;
+			h += (uint32_t)total_;
+			const uint8_t* p = buf_;
+			size_t n = pending_;
+			for (; n >= 4; n -= 4, p += 4)
+				h = RotateLeft32(h + buffer_internal::ReadLittle<uint32_t>(p) * PRIME3, 17) * PRIME4;
+			for (; n > 0; n--, p++)
+				h = RotateLeft32(h + (*p) * PRIME5, 11) * PRIME1;
+			h ^= h >> 15;
+			h *= PRIME2;
+			h ^= h >> 13;
+			h *= PRIME3;
+			h ^= h >> 16;
+			return h;
+		}
+
+		void reset() {
+			v_[0] = seed_ + PRIME1 + PRIME2;
+			v_[1] = seed_ + PRIME2;
+			v_[2] = seed_;
+			v_[3] = seed_ - PRIME1;
+			total_ = 0;
+			pending_ = 0;
+		}
+
+	private:
+		uint32_t seed_;
+		uint32_t v_[4];
+		uint64_t total_;
+		size_t pending_;
+		uint8_t buf_[16];
+
+		static inline uint32_t round(uint32_t acc, uint32_t input) {
+			return buffer_internal::RotateLeft32(acc + input * PRIME2, 13) * PRIME1;
+		}
+
+		inline void consume(const uint8_t* p) {
+			v_[0] = round(v_[0], buffer_internal::ReadLittle<uint32_t>(p));
+			v_[1] = round(v_[1], buffer_internal::ReadLittle<uint32_t>(p + 4));
+			v_[2] = round(v_[2], buffer_internal::ReadLittle<uint32_t>(p + 8));
+			v_[3] = round(v_[3], buffer_internal::ReadLittle<uint32_t>(p + 12));
+		}
+	};
+
+	class XXHash64 : public ChecksumT<XXHash64> {
+	public:
+		typedef uint64_t value_type;
+		using ChecksumT<XXHash64>::append;
+
+		static const uint64_t PRIME1 = 11400714785074694791ULL;
+		static const uint64_t PRIME2 = 14029467366897019727ULL;
+		static const uint64_t PRIME3 = 1609587929392839161ULL;
+		static const uint64_t PRIME4 = 9650029242287828579ULL;
+		static const uint64_t PRIME5 = 2870177450012600261ULL;
+
+		explicit XXHash64(uint64_t seed = 0):
+			seed_(seed) {
+			reset();
+		}
+
+		void append(const void* data, size_t size) {
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+			total_ += size;
+			if (pending_ + size < 32) {
+				std::memcpy(buf_ + pending_, p, size);
+				pending_ += size;
+				return;
+			}
+			if (pending_ > 0) {
+				size_t n = 32 - pending_;
+				std::memcpy(buf_ + pending_, p, n);
+				consume(buf_);
+				p += n;
+				size -= n;
+				pending_ = 0;
+			}
+			for (; size >= 32; size -= 32, p += 32)
+				consume(p);
+			std::memcpy(buf_, p, size);
+			pending_ = size;
+		}
+
+		value_type value() const {
+			using buffer_internal::RotateLeft64;
+			using buffer_internal::ReadLittle;
+			uint64_t h;
+			if (total_ >= 32) {
+				h = RotateLeft64(v_[0], 1) + RotateLeft64(v_[1], 7) + RotateLeft64(v_[2], 12) + RotateLeft64(v_[3], 18);
+				for (int i = 0; i < 4; i++)
+					h = (h ^ round(0, v_[i])) * PRIME1 + PRIME4;
+			} else {
+				h = seed_ + PRIME5;
+			}
+			h += total_;
+			const uint8_t* p = buf_;
+			size_t n = pending_;
+			for (; n >= 8; n -= 8, p += 8)
+				h = RotateLeft64(h ^ round(0, ReadLittle<uint64_t>(p)), 27) * PRIME1 + PRIME4;
+			if (n >= 4) {
+				h = RotateLeft64(h ^ (uint64_t)ReadLittle<uint32_t>(p) * PRIME1, 23) * PRIME2 + PRIME3;
+				p += 4;
+				n -= 4;
+			}
+			for (; n > 0; n--, p++)
+				h = RotateLeft64(h ^ (*p) * PRIME5, 11) * PRIME1;
+			h ^= h >> 33;
+			h *= PRIME2;
+			h ^= h >> 29;
+			h *= PRIME3;
+			h ^= h >> 32;
+			return h;
+		}
+
+		void reset() {
+			v_[0] = seed_ + PRIME1 + PRIME2;
+			v_[1] = seed_ + PRIME2;
+			v_[2] = seed_;
+			v_[3] = seed_ - PRIME1;
+			total_ = 0;
+			pending_ = 0;
+		}
+
+	private:
+		uint64_t seed_;
+		uint64_t v_[4];
+		uint64_t total_;
+		size_t pending_;
+		uint8_t buf_[32];
+
+		static inline uint64_t round(uint64_t acc, uint64_t input) {
+			return buffer_internal::RotateLeft64(acc + input * PRIME2, 31) * PRIME1;
+		}
+
+		inline void consume(const uint8_t* p) {
+			v_[0] = round(v_[0], buffer_internal::ReadLittle<uint64_t>(p));
+			v_[1] = round(v_[1], buffer_internal::ReadLittle<uint64_t>(p + 8));
+			v_[2] = round(v_[2], buffer_internal::ReadLittle<uint64_t>(p + 16));
+			v_[3] = round(v_[3], buffer_internal::ReadLittle<uint64_t>(p + 24));
+		}
+	};
+
+	/////////////////////////////////////
+	// 一次计算
+
+	template<typename Checksum>
+	inline typename Checksum::value_type checksum(const void* data, size_t size) {
+		Checksum c;
+		c.append(data, size);
+		return c.value();
+	}
+
+	template<typename Checksum, typename _Ty, typename Continer>
+	inline typename Checksum::value_type checksum(const BufferT<_Ty, Continer>& buf) {
+		return checksum<Checksum>(buf.continer().begin(), buf.size());
+	}
+
+	// [pos, pos + count)，越界时抛出异常
+	template<typename Checksum, typename _Ty, typename Continer>
+	inline typename Checksum::value_type checksum(const BufferT<_Ty, Continer>& buf, size_t pos, size_t count) {
+		BufferSpanT<const _Ty> span = buf.span(pos, count);
+		return checksum<Checksum>(span.begin(), span.size());
+	}
+
+	template<typename Checksum, typename _Ty>
+	inline typename Checksum::value_type checksum(const BufferSpanT<_Ty>& span) {
+		return checksum<Checksum>(span.begin(), span.size());
+	}
+
+	// StreamBufferT未读取的数据
+	template<typename Checksum, typename _Ty, typename Buffer>
+	inline typename Checksum::value_type checksum(const StreamBufferT<_Ty, Buffer>& stream) {
+		size_t end = stream.data_end();
+		size_t pos = std::min<size_t>(stream.read_index(), end);
+		return checksum<Checksum>(stream.buf().continer().begin() + pos, end - pos);
+	}
+
+	/**
+		ChecksumStreamT，包装StreamBufferT，每次写入之后计算新写入的数据
+		从构造时的write_index开始计算，包装期间不能对StreamBufferT调用compact()；
+		write_span()/prepare()返回的空间在填充之后调用sync()或者commit()
+	*/
+	template<typename Checksum, typename Stream = StreamBufferT<uint8_t> >
+	class ChecksumStreamT {
+	public:
+		typedef typename Stream::size_type size_type;
+		typedef typename Stream::value_type value_type;
+
+		explicit ChecksumStreamT(Stream& stream, const Checksum& checksum = Checksum()):
+			stream_(stream),
+			checksum_(checksum),
+			checked_index_(stream.write_index()) {
+		}
+
+		template<typename _SrcTy>
+		inline void write(const _SrcTy& value) {
+			stream_.write(value);
+			sync();
+		}
+
+		template<typename _SrcTy>
+		inline void write_be(const _SrcTy& value) {
+			stream_.write_be(value);
+			sync();
+		}
+
+		template<typename _SrcTy>
+		inline void write_le(const _SrcTy& value) {
+			stream_.write_le(value);
+			sync();
+		}
+
+		template<typename _SrcTy>
+		inline void write_bytes(const _SrcTy* buf, size_type buf_size) {
+			stream_.write_bytes(buf, buf_size);
+			sync();
+		}
+
+		template<typename _SrcTy>
+		inline void write_be_array(const _SrcTy* src, size_type count) {
+			stream_.write_be_array(src, count);
+			sync();
+		}
+
+		template<typename _SrcTy>
+		inline void write_le_array(const _SrcTy* src, size_type count) {
+			stream_.write_le_array(src, count);
+			sync();
+		}
+
+		template<typename _SrcTy>
+		inline size_type write_varint(const _SrcTy& value) {
+			size_type n = stream_.write_varint(value);
+			sync();
+			return n;
+		}
+
+		template<typename _SrcTy>
+		inline size_type write_zigzag(const _SrcTy& value) {
+			size_type n = stream_.write_zigzag(value);
+			sync();
+			return n;
+		}
+
+		BufferSpanT<value_type> write_span(size_type count) {
+			return stream_.write_span(count);
+		}
+
+		BufferSpanT<value_type> prepare(size_type count) {
+			return stream_.prepare(count);
+		}
+
+		void commit(size_type count) {
+			stream_.commit(count);
+			sync();
+		}
+
+		// 计算[checked_index, write_index)
+		void sync() {
+			size_type write_index = stream_.write_index();
+			if (write_index > checked_index_) {
+				checksum_.append(stream_.buf().continer().begin() + checked_index_, write_index - checked_index_);
+				checked_index_ = write_index;
+			}
+		}
+
+		typename Checksum::value_type value() {
+			sync();
+			return checksum_.value();
+		}
+
+		// 重新开始计算，从当前的write_index开始
+		void reset() {
+			checksum_.reset();
+			checked_index_ = stream_.write_index();
+		}
+
+		Stream& stream() {
+			return stream_;
+		}
+
+	private:
+		Stream& stream_;
+		Checksum checksum_;
+		size_type checked_index_;
+
+		ChecksumStreamT(const ChecksumStreamT&);
+		ChecksumStreamT& operator=(const ChecksumStreamT&);
+	};
+
+} // namespace ftl
+
+#endif // FTL_CHECKSUM_H_
@@ -0,0 +1,783 @@
+#ifndef FTL_CODEC_H_
+#define FTL_CODEC_H_
+
+#include <climits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(FTL_BUFFER_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(FTL_BUFFER_ZSTD)
+#include <zstd.h>
+#endif
+#if defined(FTL_BUFFER_LZ4)
+#include <lz4frame.h>
+#endif
+
+#include "buffer.h"
+#include "buffer_chain.h"
+
+/**
+	流式压缩/解压，从StreamBufferT/BufferT/BufferChainT读取，直接写入另一个StreamBufferT的可写区域，
+	不经过临时的std::vector
+
+	编译选项(同时需要链接对应的库)：
+		FTL_BUFFER_ZLIB   ZlibCodec/GzipCodec/RawDeflateCodec   -lz
+		FTL_BUFFER_ZSTD   ZstdCodec                             -lzstd
+		FTL_BUFFER_LZ4    Lz4Codec(LZ4 frame格式)               -llz4
+
+	一次压缩：
+		目标按照Codec::bound()预留，整个过程只写一次
+
+		byte_buffer packed = compress<ZstdCodec>(payload);
+		byte_buffer payload = decompress<ZstdCodec>(packed);
+
+	流式：
+		输出的StreamBufferT使用kGrowableWrite，每次update之前按照输入的大小估计输出并且prepare，
+		完成后commit实际写入的字节数
+
+		CompressorT<Lz4Codec> encoder;
+		byte_streambuffer out(byte_streambuffer::kGrowableWrite);
+		encoder.update(chain, out);              // BufferChainT的每个分段
+		encoder.update(stream, out);             // StreamBufferT未读取的数据，读取之后read_index前进
+		encoder.finish(out);
+
+		DecompressorT<Lz4Codec> decoder;
+		decoder.set_max_output(64 << 20);        // 可选，解压之后超过64M时抛出CodecError
+		while (!decoder.update(input, out))      // input只消耗用到的部分，一帧结束时返回true
+			recv_more(input);
+
+		帧头中的原始大小(zstd/lz4)来自输入，只作为提示：第一次预留不超过输入的CONTENT_SIZE_RATIO倍，
+		之后输出写满时按照实际的输出翻倍，伪造的帧头不会导致一次分配巨大的内存
+
+	上下文：
+		压缩/解压的上下文(z_stream/ZSTD_CCtx/LZ4F_cctx)在析构时放回当前线程的缓存，下次构造时reset之后复用，
+		每个线程每种上下文最多缓存MAX_CACHED个
+
+	数据错误时抛出CodecError
+*/
+
+namespace ftl {
+
+	class CodecError : public std::runtime_error {
+	public:
+		explicit CodecError(const std::string& what):
+			std::runtime_error(what) {
+		}
+	};
+
+	namespace buffer_internal {
+
+		/**
+			线程本地的上下文缓存，Context需要默认构造
+		*/
+		template<typename Context>
+		class CodecContextCache {
+		public:
+			static const size_t MAX_CACHED = 4;
+
+			static Context* acquire() {
+				std::vector<Context*>& items = cache().items;
+				if (items.empty())
+					return new Context();
+				Context* rv = items.back();
+				items.pop_back();
+				return rv;
+			}
+
+			static void release(Context* context) {
+				std::vector<Context*>& items = cache().items;
+				if (items.size() < MAX_CACHED)
+					items.push_back(context);
+				else
+					delete context;
+			}
+
+			static size_t cached() {
+				return cache().items.size();
+			}
+
+		private:
+			struct Items {
+				std::vector<Context*> items;
+
+				~Items() {
+					for (size_t i = 0; i < items.size(); i++)
+						delete items[i];
+				}
+			};
+
+			static Items& cache() {
+				static thread_local Items items;
+				return items;
+			}
+		};
+
+		// 没有结束标记时，解压输出按照输入的INFLATE_RATIO倍估计
+		static const size_t INFLATE_RATIO = 4;
+		static const size_t MIN_OUTPUT_CHUNK = 4096;
+		// 帧头中的原始大小最多按照输入的CONTENT_SIZE_RATIO倍预留
+		static const size_t CONTENT_SIZE_RATIO = 64;
+		// 输出写满之后每次翻倍，单次prepare不超过MAX_OUTPUT_CHUNK(除非帧头给出了更大的可信大小)
+		static const size_t MAX_OUTPUT_CHUNK = 4 * 1024 * 1024;
+
+	} // namespace buffer_internal
+
+	/**
+		Codec需要提供：
+			DEFAULT_LEVEL
+			Compressor    reset(level)/pledge(size)/compress(in, in_size, out, out_size, finish)
+			Decompressor  reset()/decompress(in, in_size, out, out_size)
+			bound(size)   压缩size个字节最多输出的字节数
+			content_size(p, size)  从帧头读取解压之后的大小，未知时返回0
+		compress/decompress处理之后in/out前进，in_size/out_size减少；
+		compress在finish为false时返回输入是否已经全部处理并且没有等待输出的数据，finish为true时返回是否已经写入结束标记，
+		decompress返回是否到达帧的结尾
+	*/
+	template<typename Codec>
+	class CompressorT {
+	public:
+		typedef typename Codec::Compressor Context;
+		typedef buffer_internal::CodecContextCache<Context> Cache;
+
+		explicit CompressorT(int level = Codec::DEFAULT_LEVEL):
+			context_(Cache::acquire()),
+			level_(level),
+			total_in_(0),
+			total_out_(0) {
+			context_->reset(level);
+		}
+
+		~CompressorT() {
+			Cache::release(context_);
+		}
+
+		// 开始新的一帧
+		void reset() {
+			context_->reset(level_);
+			total_in_ = 0;
+			total_out_ = 0;
+		}
+
+		void reset(int level) {
+			level_ = level;
+			reset();
+		}
+
+		// 预先告知整个输入的大小，写入帧头(zstd/lz4)，需要在第一次update之前调用
+		void pledge(uint64_t size) {
+			context_->pledge(size);
+		}
+
+		template<typename Stream>
+		void update(const void* data, size_t size, Stream& out) {
+			run(reinterpret_cast<const uint8_t*>(data), size, out, false);
+		}
+
+		template<typename _Ty, typename Continer, typename Stream>
+		void update(const BufferT<_Ty, Continer>& in, Stream& out) {
+			update(in.continer().begin(), in.size() * sizeof(_Ty), out);
+		}
+
+		template<typename _Ty, typename Stream>
+		void update(const BufferSpanT<_Ty>& in, Stream& out) {
+			update(in.begin(), in.size() * sizeof(_Ty), out);
+		}
+
+		// 压缩in未读取的全部数据，in的read_index移动到结尾
+		template<typename _Ty, typename Buffer, typename Stream>
+		void update(StreamBufferT<_Ty, Buffer>& in, Stream& out) {
+			size_t size = in.data_end();
+			size_t pos = std::min<size_t>(in.read_index(), size);
+			update(in.buf().continer().begin() + pos, (size - pos) * sizeof(_Ty), out);
+			in.read_span(size - pos);
+		}
+
+		template<typename _Ty, typename Buffer, typename Stream>
+		void update(const BufferChainT<_Ty, Buffer>& in, Stream& out) {
+			for (size_t i = 0; i < in.segment_count(); i++)
+				update(in.segment_span(i), out);
+		}
+
+		// 写入剩余的数据和结束标记
+		template<typename Stream>
+		void finish(Stream& out) {
+			run(nullptr, 0, out, true);
+		}
+
+		uint64_t total_in() const {
+			return total_in_;
+		}
+
+		uint64_t total_out() const {
+			return total_out_;
+		}
+
+	private:
+		Context* context_;
+		int level_;
+		uint64_t total_in_;
+		uint64_t total_out_;
+
+		template<typename Stream>
+		void run(const uint8_t* in, size_t in_size, Stream& out, bool finish) {
+			static_assert(sizeof(typename Stream::value_type) == 1, "codec requires 8bit stream");
+			total_in_ += in_size;
+			for (;;) {
+				size_t chunk = std::max<size_t>(Codec::bound(in_size), buffer_internal::MIN_OUTPUT_CHUNK);
+				uint8_t* begin = reinterpret_cast<uint8_t*>(out.prepare(chunk).begin());
+				uint8_t* p = begin;
+				size_t avail = chunk;
+				bool done = context_->compress(in, in_size, p, avail, finish);
+				out.commit((size_t)(p - begin));
+				total_out_ += (size_t)(p - begin);
+				if (done)
+					return;
+			}
+		}
+
+		CompressorT(const CompressorT&);
+		CompressorT& operator=(const CompressorT&);
+	};
+
+	template<typename Codec>
+	class DecompressorT {
+	public:
+		typedef typename Codec::Decompressor Context;
+		typedef buffer_internal::CodecContextCache<Context> Cache;
+
+		DecompressorT():
+			context_(Cache::acquire()),
+			finished_(false),
+			started_(false),
+			total_in_(0),
+			total_out_(0),
+			max_output_(UINT64_MAX) {
+			context_->reset();
+		}
+
+		~DecompressorT() {
+			Cache::release(context_);
+		}
+
+		// 开始解压新的一帧
+		void reset() {
+			context_->reset();
+			finished_ = false;
+			started_ = false;
+			total_in_ = 0;
+			total_out_ = 0;
+		}
+
+		// 一帧解压之后的总大小上限，超过时update抛出CodecError，reset()不改变
+		void set_max_output(uint64_t size) {
+			max_output_ = size;
+		}
+
+		uint64_t max_output() const {
+			return max_output_;
+		}
+
+		/**
+			解压[data, data + size)，consumed返回用掉的字节数，帧结束之后的数据不处理；
+			返回是否到达帧的结尾
+		*/
+		template<typename Stream>
+		bool update(const void* data, size_t size, Stream& out, size_t* consumed = nullptr) {
+			static_assert(sizeof(typename Stream::value_type) == 1, "codec requires 8bit stream");
+			const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+			size_t in_size = size;
+			size_t chunk = estimate(in, in_size);
+			while (!finished_) {
+				// 最多多输出一个字节，用来判断是否超过max_output_
+				size_t avail = chunk;
+				if (max_output_ - total_out_ < (uint64_t)avail)
+					avail = (size_t)(max_output_ - total_out_) + 1;
+				uint8_t* begin = reinterpret_cast<uint8_t*>(out.prepare(avail).begin());
+				uint8_t* p = begin;
+				size_t before = in_size;
+				finished_ = context_->decompress(in, in_size, p, avail);
+				size_t produced = (size_t)(p - begin);
+				out.commit(produced);
+				total_out_ += produced;
+				if (FTL_BUFFER_UNLIKELY(total_out_ > max_output_))
+					throw CodecError("decompress output exceeds max_output");
+				// 输出没有写满并且输入用完，或者没有任何进展时等待更多的输入
+				if (avail > 0 && in_size == 0)
+					break;
+				if (produced == 0 && before == in_size)
+					break;
+				// 输出写满时按照实际的输出增长
+				if (avail == 0) {
+					if (chunk < buffer_internal::MIN_OUTPUT_CHUNK)
+						chunk = buffer_internal::MIN_OUTPUT_CHUNK;
+					else if (chunk < buffer_internal::MAX_OUTPUT_CHUNK)
+						chunk = std::min<size_t>(chunk * 2, buffer_internal::MAX_OUTPUT_CHUNK);
+				}
+			}
+			total_in_ += size - in_size;
+			if (consumed)
+				*consumed = size - in_size;
+			return finished_;
+		}
+
+		template<typename _Ty, typename Continer, typename Stream>
+		bool update(const BufferT<_Ty, Continer>& in, Stream& out, size_t* consumed = nullptr) {
+			return update(in.continer().begin(), in.size() * sizeof(_Ty), out, consumed);
+		}
+
+		template<typename _Ty, typename Stream>
+		bool update(const BufferSpanT<_Ty>& in, Stream& out, size_t* consumed = nullptr) {
+			return update(in.begin(), in.size() * sizeof(_Ty), out, consumed);
+		}
+
+		// 解压in未读取的数据，in的read_index只前进用掉的字节数
+		template<typename _Ty, typename Buffer, typename Stream>
+		bool update(StreamBufferT<_Ty, Buffer>& in, Stream& out) {
+			size_t size = in.data_end();
+			size_t pos = std::min<size_t>(in.read_index(), size);
+			size_t consumed = 0;
+			bool rv = update(in.buf().continer().begin() + pos, (size - pos) * sizeof(_Ty), out, &consumed);
+			in.read_span(consumed);
+			return rv;
+		}
+
+		// 依次解压每个分段，到达帧的结尾时停止
+		template<typename _Ty, typename Buffer, typename Stream>
+		bool update(const BufferChainT<_Ty, Buffer>& in, Stream& out) {
+			for (size_t i = 0; i < in.segment_count() && !finished_; i++)
+				update(in.segment_span(i), out);
+			return finished_;
+		}
+
+		bool finished() const {
+			return finished_;
+		}
+
+		uint64_t total_in() const {
+			return total_in_;
+		}
+
+		uint64_t total_out() const {
+			return total_out_;
+		}
+
+	private:
+		Context* context_;
+		bool finished_;
+		bool started_;
+		uint64_t total_in_;
+		uint64_t total_out_;
+		uint64_t max_output_;
+
+		/**
+			按照输入的比例估计，第一次使用帧头中的原始大小；
+			帧头不可信，原始大小不超过输入的CONTENT_SIZE_RATIO倍时才直接使用，否则按照上限预留，之后随着输出增长
+		*/
+		size_t estimate(const uint8_t* in, size_t in_size) {
+			size_t rv = std::max<size_t>(std::min<size_t>(in_size, SIZE_MAX / buffer_internal::CONTENT_SIZE_RATIO) * buffer_internal::INFLATE_RATIO,
+				buffer_internal::MIN_OUTPUT_CHUNK);
+			if (!started_) {
+				started_ = true;
+				uint64_t content = Codec::content_size(in, in_size);
+				if (content > 0) {
+					uint64_t trusted = std::max<uint64_t>((uint64_t)std::min<size_t>(in_size, SIZE_MAX / buffer_internal::CONTENT_SIZE_RATIO) * buffer_internal::CONTENT_SIZE_RATIO,
+						buffer_internal::MIN_OUTPUT_CHUNK);
+					rv = (size_t)std::min<uint64_t>(content, trusted);
+				}
+			}
+			return rv;
+		}
+
+		DecompressorT(const DecompressorT&);
+		DecompressorT& operator=(const DecompressorT&);
+	};
+
+	/////////////////////////////////////
+	// 一次压缩/解压
+
+	template<typename Codec, typename _Ty, typename Continer>
+	BufferT<_Ty, Continer> compress(const BufferT<_Ty, Continer>& src, int level = Codec::DEFAULT_LEVEL) {
+		StreamBufferT<_Ty, BufferT<_Ty, Continer> > out(StreamBufferT<_Ty, BufferT<_Ty, Continer> >::kGrowableWrite);
+		out.reserve(std::max<size_t>(Codec::bound(src.size()), buffer_internal::MIN_OUTPUT_CHUNK));
+		CompressorT<Codec> encoder(level);
+		encoder.pledge(src.size());
+		encoder.update(src, out);
+		encoder.finish(out);
+		return std::move(out.buf());
+	}
+
+	// size_hint为解压之后的大小，0时从帧头读取或者估计；数据不完整时抛出CodecError
+	template<typename Codec, typename _Ty, typename Continer>
+	BufferT<_Ty, Continer> decompress(const BufferT<_Ty, Continer>& src, size_t size_hint = 0) {
+		StreamBufferT<_Ty, BufferT<_Ty, Continer> > out(StreamBufferT<_Ty, BufferT<_Ty, Continer> >::kGrowableWrite);
+		if (size_hint > 0)
+			out.reserve(size_hint);
+		DecompressorT<Codec> decoder;
+		if (!decoder.update(src, out))
+			throw CodecError("decompress truncated input");
+		return std::move(out.buf());
+	}
+
+#if defined(FTL_BUFFER_ZLIB)
+
+	/**
+		zlib，WindowBits：15 zlib格式，31 gzip格式，-15 raw deflate
+	*/
+	template<int WindowBits>
+	struct DeflateCodecT {
+		static const int DEFAULT_LEVEL = Z_DEFAULT_COMPRESSION;
+
+		static size_t bound(size_t size) {
+			// compressBound加上gzip的头尾
+			return (size_t)::compressBound((uLong)std::min<size_t>(size, ULONG_MAX / 2)) + 18;
+		}
+
+		static uint64_t content_size(const uint8_t* p, size_t size) {
+			return 0;
+		}
+
+		class Compressor {
+		public:
+			Compressor():
+				initialized_(false),
+				level_(0) {
+				std::memset(&stream_, 0, sizeof(stream_));
+			}
+
+			~Compressor() {
+				if (initialized_)
+					::deflateEnd(&stream_);
+			}
+
+			void reset(int level) {
+				if (initialized_ && level == level_) {
+					::deflateReset(&stream_);
+					return;
+				}
+				if (initialized_)
+					::deflateEnd(&stream_);
+				std::memset(&stream_, 0, sizeof(stream_));
+				initialized_ = false;
+				if (::deflateInit2(&stream_, level, Z_DEFLATED, WindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+					throw CodecError("deflateInit2 failed");
+				initialized_ = true;
+				level_ = level;
+			}
+
+			void pledge(uint64_t size) {
+			}
+
+			bool compress(const uint8_t*& in, size_t& in_size, uint8_t*& out, size_t& out_size, bool finish) {
+				uInt avail_in = (uInt)std::min<size_t>(in_size, UINT_MAX);
+				uInt avail_out = (uInt)std::min<size_t>(out_size, UINT_MAX);
+				stream_.next_in = const_cast<Bytef*>(in);
+				stream_.avail_in = avail_in;
+				stream_.next_out = out;
+				stream_.avail_out = avail_out;
+				int rv = ::deflate(&stream_, (finish && avail_in == in_size) ? Z_FINISH : Z_NO_FLUSH);
+				if (rv == Z_STREAM_ERROR)
+					throw CodecError("deflate stream error");
+				size_t consumed = avail_in - stream_.avail_in;
+				size_t produced = avail_out - stream_.avail_out;
+				in += consumed;
+				in_size -= consumed;
+				out += produced;
+				out_size -= produced;
+				if (finish)
+					return rv == Z_STREAM_END;
+				return in_size == 0 && out_size > 0;
+			}
+
+		private:
+			z_stream stream_;
+			bool initialized_;
+			int level_;
+
+			Compressor(const Compressor&);
+			Compressor& operator=(const Compressor&);
+		};
+
+		class Decompressor {
+		public:
+			Decompressor() {
+				std::memset(&stream_, 0, sizeof(stream_));
+				if (::inflateInit2(&stream_, WindowBits) != Z_OK)
+					throw CodecError("inflateInit2 failed");
+			}
+
+			~Decompressor() {
+				::inflateEnd(&stream_);
+			}
+
+			void reset() {
+				::inflateReset(&stream_);
+			}
+
+			bool decompress(const uint8_t*& in, size_t& in_size, uint8_t*& out, size_t& out_size) {
+				uInt avail_in = (uInt)std::min<size_t>(in_size, UINT_MAX);
+				uInt avail_out = (uInt)std::min<size_t>(out_size, UINT_MAX);
+				stream_.next_in = const_cast<Bytef*>(in);
+				stream_.avail_in = avail_in;
+				stream_.next_out = out;
+				stream_.avail_out = avail_out;
+				int rv = ::inflate(&stream_, Z_NO_FLUSH);
+				if (rv == Z_NEED_DICT || rv == Z_DATA_ERROR || rv == Z_MEM_ERROR || rv == Z_STREAM_ERROR)
+					throw CodecError(std::string("inflate: ") + (stream_.msg ? stream_.msg : "error"));
+				size_t consumed = avail_in - stream_.avail_in;
+				size_t produced = avail_out - stream_.avail_out;
+				in += consumed;
+				in_size -= consumed;
+				out += produced;
+				out_size -= produced;
+				return rv == Z_STREAM_END;
+			}
+
+		private:
+			z_stream stream_;
+
+			Decompressor(const Decompressor&);
+			Decompressor& operator=(const Decompressor&);
+		};
+	};
+
+	typedef DeflateCodecT<15> ZlibCodec;
+	typedef DeflateCodecT<31> GzipCodec;
+	typedef DeflateCodecT<-15> RawDeflateCodec;
+
+#endif // FTL_BUFFER_ZLIB
+
+#if defined(FTL_BUFFER_ZSTD)
+
+	struct ZstdCodec {
+		static const int DEFAULT_LEVEL = 3;
+
+		static size_t bound(size_t size) {
+			return ZSTD_compressBound(size);
+		}
+
+		static uint64_t content_size(const uint8_t* p, size_t size) {
+			unsigned long long rv = ZSTD_getFrameContentSize(p, size);
+			if (rv == ZSTD_CONTENTSIZE_UNKNOWN || rv == ZSTD_CONTENTSIZE_ERROR)
+				return 0;
+			return (uint64_t)rv;
+		}
+
+		static void check(size_t rv) {
+			if (ZSTD_isError(rv))
+				throw CodecError(std::string("zstd: ") + ZSTD_getErrorName(rv));
+		}
+
+		class Compressor {
+		public:
+			Compressor():
+				context_(ZSTD_createCCtx()) {
+				if (!context_)
+					throw CodecError("ZSTD_createCCtx failed");
+			}
+
+			~Compressor() {
+				ZSTD_freeCCtx(context_);
+			}
+
+			void reset(int level) {
+				check(ZSTD_CCtx_reset(context_, ZSTD_reset_session_only));
+				check(ZSTD_CCtx_setParameter(context_, ZSTD_c_compressionLevel, level));
+			}
+
+			void pledge(uint64_t size) {
+				check(ZSTD_CCtx_setPledgedSrcSize(context_, size));
+			}
+
+			bool compress(const uint8_t*& in, size_t& in_size, uint8_t*& out, size_t& out_size, bool finish) {
+				ZSTD_inBuffer input = { in, in_size, 0 };
+				ZSTD_outBuffer output = { out, out_size, 0 };
+				size_t rv = ZSTD_compressStream2(context_, &output, &input, finish ? ZSTD_e_end : ZSTD_e_continue);
+				check(rv);
+				in += input.pos;
+				in_size -= input.pos;
+				out += output.pos;
+				out_size -= output.pos;
+				if (finish)
+					return rv == 0;
+				return in_size == 0 && out_size > 0;
+			}
+
+		private:
+			ZSTD_CCtx* context_;
+
+			Compressor(const Compressor&);
+			Compressor& operator=(const Compressor&);
+		};
+
+		class Decompressor {
+		public:
+			Decompressor():
+				context_(ZSTD_createDCtx()) {
+				if (!context_)
+					throw CodecError("ZSTD_createDCtx failed");
+			}
+
+			~Decompressor() {
+				ZSTD_freeDCtx(context_);
+			}
+
+			void reset() {
+				check(ZSTD_DCtx_reset(context_, ZSTD_reset_session_only));
+			}
+
+			bool decompress(const uint8_t*& in, size_t& in_size, uint8_t*& out, size_t& out_size) {
+				ZSTD_inBuffer input = { in, in_size, 0 };
+				ZSTD_outBuffer output = { out, out_size, 0 };
+				size_t rv = ZSTD_decompressStream(context_, &output, &input);
+				check(rv);
+				in += input.pos;
+				in_size -= input.pos;
+				out += output.pos;
+				out_size -= output.pos;
+				return rv == 0;
+			}
+
+		private:
+			ZSTD_DCtx* context_;
+
+			Decompressor(const Decompressor&);
+			Decompressor& operator=(const Decompressor&);
+		};
+	};
+
+#endif // FTL_BUFFER_ZSTD
+
+#if defined(FTL_BUFFER_LZ4)
+
+	/**
+		LZ4 frame格式，默认64K的块
+	*/
+	struct Lz4Codec {
+		static const int DEFAULT_LEVEL = 0;
+		static const size_t MAX_UPDATE_SIZE = 64 * 1024;	// 每次compressUpdate的输入，和默认的块大小相同
+		static const uint32_t MAGIC = 0x184d2204;
+
+		static size_t bound(size_t size) {
+			return LZ4F_HEADER_SIZE_MAX + LZ4F_compressBound(size, nullptr);
+		}
+
+		// 帧头FLG的第3位表示后面有8个字节的原始大小
+		static uint64_t content_size(const uint8_t* p, size_t size) {
+			if (size < 14 || buffer_internal::Endian::read<uint8_t, uint32_t, buffer_internal::Endian::kLittleEndian>(p) != MAGIC)
+				return 0;
+			if ((p[4] & 0x08) == 0)
+				return 0;
+			return buffer_internal::Endian::read<uint8_t, uint64_t, buffer_internal::Endian::kLittleEndian>(p + 6);
+		}
+
+		static void check(size_t rv) {
+			if (LZ4F_isError(rv))
+				throw CodecError(std::string("lz4: ") + LZ4F_getErrorName(rv));
+		}
+
+		class Compressor {
+		public:
+			Compressor():
+				context_(nullptr),
+				started_(false) {
+				check(LZ4F_createCompressionContext(&context_, LZ4F_VERSION));
+				std::memset(&prefs_, 0, sizeof(prefs_));
+			}
+
+			~Compressor() {
+				LZ4F_freeCompressionContext(context_);
+			}
+
+			void reset(int level) {
+				std::memset(&prefs_, 0, sizeof(prefs_));
+				prefs_.compressionLevel = level;
+				started_ = false;
+			}
+
+			void pledge(uint64_t size) {
+				prefs_.frameInfo.contentSize = size;
+			}
+
+			bool compress(const uint8_t*& in, size_t& in_size, uint8_t*& out, size_t& out_size, bool finish) {
+				if (!started_) {
+					if (out_size < LZ4F_HEADER_SIZE_MAX)
+						return false;
+					size_t n = LZ4F_compressBegin(context_, out, out_size, &prefs_);
+					check(n);
+					out += n;
+					out_size -= n;
+					started_ = true;
+				}
+				while (in_size > 0) {
+					size_t chunk = std::min<size_t>(in_size, (size_t)MAX_UPDATE_SIZE);
+					if (out_size < LZ4F_compressBound(chunk, &prefs_))
+						return false;
+					size_t n = LZ4F_compressUpdate(context_, out, out_size, in, chunk, nullptr);
+					check(n);
+					in += chunk;
+					in_size -= chunk;
+					out += n;
+					out_size -= n;
+				}
+				if (finish) {
+					if (out_size < LZ4F_compressBound(0, &prefs_))
+						return false;
+					size_t n = LZ4F_compressEnd(context_, out, out_size, nullptr);
+					check(n);
+					out += n;
+					out_size -= n;
+				}
+				return true;
+			}
+
+		private:
+			LZ4F_cctx* context_;
+			LZ4F_preferences_t prefs_;
+			bool started_;
+
+			Compressor(const Compressor&);
+			Compressor& operator=(const Compressor&);
+		};
+
+		class Decompressor {
+		public:
+			Decompressor():
+				context_(nullptr) {
+				check(LZ4F_createDecompressionContext(&context_, LZ4F_VERSION));
+			}
+
+			~Decompressor() {
+				LZ4F_freeDecompressionContext(context_);
+			}
+
+			void reset() {
+				LZ4F_resetDecompressionContext(context_);
+			}
+
+			bool decompress(const uint8_t*& in, size_t& in_size, uint8_t*& out, size_t& out_size) {
+				size_t src = in_size;
+				size_t dst = out_size;
+				size_t rv = LZ4F_decompress(context_, out, &dst, in, &src, nullptr);
+				check(rv);
+				in += src;
+				in_size -= src;
+				out += dst;
+				out_size -= dst;
+				return rv == 0;
+			}
+
+		private:
+			LZ4F_dctx* context_;
+
+			Decompressor(const Decompressor&);
+			Decompressor& operator=(const Decompressor&);
+		};
+	};
+
+#endif // FTL_BUFFER_LZ4
+
+} // namespace ftl
+
+#endif // FTL_CODEC_H_
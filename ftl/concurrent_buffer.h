@@ -0,0 +1,314 @@
+#ifndef FTL_CONCURRENT_BUFFER_H_
+#define FTL_CONCURRENT_BUFFER_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "buffer.h"
+#include "ring_buffer.h"
+
+/**
+	ConcurrentAppendBufferT，多个线程并发追加记录、一个消费者整批取走的缓冲区，存储使用BufferT，用于日志/监控数据的批量发送
+
+	写入：
+		reserve()通过一次fetch_add在当前批次中预留连续的空间，各个线程并行填充，commit()提交，
+		提交的长度累加在线程按照编号分配的分片上，不和其他线程争用同一个cache line；
+		当前批次剩余的空间不够时，记录写入当前线程的溢出区(每个批次的每个分片有一个溢出区，有自己的锁)，
+		超过批次容量的记录总是写入溢出区；写入过溢出区的线程在下次take()之前一直使用溢出区
+
+		byte_concurrent_buffer batch(1 << 20);
+		byte_concurrent_buffer::Reservation r = batch.reserve(4 + size);
+		buffer_internal::Endian::write<uint8_t, uint32_t, buffer_internal::Endian::kBigEndian>(r.begin(), size);
+		std::memcpy(r.begin() + 4, record, size);              // 直接填充r.begin()开始的r.size()个字节
+		batch.commit(r);
+
+		batch.append(record, size);                            // 等价于reserve() -> memcpy -> commit()
+
+	读取：
+		take()把当前批次和备用批次交换，关闭当前批次，等待已经预留的记录全部提交，然后和调用者的buffer交换存储，
+		这个批次的溢出区的记录追加在主批次之后；调用者下次把同一个buffer传给take()，稳定之后不再分配内存
+
+		byte_buffer out;
+		for (;;) {
+			batch.take(out);
+			send(fd, out.begin(), out.size(), 0);
+		}
+
+	每条记录在结果中是连续的，同一个线程的记录保持写入的顺序(同一个批次中先是主批次，然后是溢出区)；
+	预留之后必须调用commit()，没有提交的记录会让take()一直等待；take()可以从多个线程调用，互相串行
+	主批次和备用批次各占capacity字节的内存
+*/
+
+namespace ftl {
+
+	namespace buffer_internal {
+
+		// 每个线程固定的编号，用于选择溢出区
+		inline unsigned ThreadSlotIndex() {
+			static std::atomic<unsigned> next(0);
+			static thread_local unsigned index = next.fetch_add(1, std::memory_order_relaxed);
+			return index;
+		}
+
+	} // namespace buffer_internal
+
+	template<typename _Ty, typename Buffer = BufferT<_Ty> >
+	class ConcurrentAppendBufferT {
+		struct Batch;
+		struct Slot;
+
+	public:
+		typedef typename Buffer::value_type value_type;
+		typedef typename Buffer::pointer pointer;
+		typedef typename Buffer::size_type size_type;
+
+		/**
+			reserve()返回的一段连续空间，在主批次或者当前线程的溢出区中
+		*/
+		class Reservation {
+		public:
+			Reservation():
+				data_(nullptr),
+				size_(0),
+				batch_(nullptr),
+				slot_(nullptr) {
+			}
+
+			pointer begin() const {
+				return data_;
+			}
+
+			pointer end() const {
+				return data_ + size_;
+			}
+
+			size_type size() const {
+				return size_;
+			}
+
+			// 是否写入了溢出区
+			bool overflow() const {
+				return batch_ == nullptr && slot_ != nullptr;
+			}
+
+		private:
+			friend class ConcurrentAppendBufferT;
+
+			pointer data_;
+			size_type size_;
+			Batch* batch_;      // 主批次中的预留，overflow()时为nullptr
+			Slot* slot_;        // 主批次中的预留累加提交长度的分片，或者持有锁的溢出区
+		};
+
+		// slots为分片(提交计数和溢出区)的个数，0使用hardware_concurrency
+		explicit ConcurrentAppendBufferT(size_type capacity, unsigned int slots = 0):
+			capacity_(capacity),
+			slot_count_(slots ? slots : std::max(1u, std::thread::hardware_concurrency())) {
+			for (int i = 0; i < 2; i++) {
+				batches_[i].slots.reset(new buffer_internal::CacheLinePadded<Slot>[slot_count_]);
+				batches_[i].reset(capacity_, slot_count_);
+			}
+			// 备用批次保持关闭，take()交换为current_之后才打开
+			batches_[1].state.value.reserved.store(SEALED, std::memory_order_relaxed);
+			current_.value.store(&batches_[0], std::memory_order_relaxed);
+		}
+
+		/**
+			预留count个元素，当前批次的空间不够时使用溢出区，总是成功(溢出区分配内存失败时抛出std::bad_alloc)
+			主批次中的预留只有一次fetch_add，提交是分片上的一次fetch_add，不加锁；溢出区的预留持有溢出区的锁直到commit()
+		*/
+		Reservation reserve(size_type count) {
+			Reservation r;
+			r.size_ = count;
+			unsigned int index = buffer_internal::ThreadSlotIndex() % slot_count_;
+			if (count <= capacity_) {
+				for (;;) {
+					Batch* batch = current_.value.load(std::memory_order_acquire);
+					Slot& slot = batch->slots[index].value;
+					// 这个批次中已经写入过溢出区，继续使用溢出区，保持记录的顺序
+					if (slot.overflowed.load(std::memory_order_relaxed))
+						break;
+					State& state = batch->state.value;
+					size_type reserved = state.reserved.load(std::memory_order_relaxed);
+					// take()已经关闭这个批次，current_已经交换或者马上交换
+					if (FTL_BUFFER_UNLIKELY(reserved >= SEALED))
+						continue;
+					// 已经放不下时不再fetch_add，更小的记录还可以继续使用剩余的空间
+					if (reserved + count > capacity_)
+						break;
+					// acquire和take()打开批次时的release同步，看到reset()对base的修改
+					size_type offset = state.reserved.fetch_add(count, std::memory_order_acquire);
+					if (FTL_BUFFER_UNLIKELY(offset >= SEALED))
+						continue;
+					if (offset + count <= capacity_) {
+						r.data_ = batch->base + offset;
+						r.batch_ = batch;
+						r.slot_ = &slot;
+						return r;
+					}
+					// 只有一个预留会跨过容量，之前的记录都在offset之前
+					if (offset <= capacity_)
+						state.limit.store(offset, std::memory_order_release);
+					break;
+				}
+			}
+			return reserve_overflow(r, index);
+		}
+
+		void commit(const Reservation& r) {
+			if (r.batch_)
+				r.slot_->committed.fetch_add(r.size_, std::memory_order_release);
+			else if (r.slot_)
+				r.slot_->mutex.unlock();
+		}
+
+		void append(const _Ty* buf, size_type count) {
+			Reservation r = reserve(count);
+			if (count > 0)
+				std::memcpy(r.begin(), buf, count * sizeof(_Ty));
+			commit(r);
+		}
+
+		/**
+			取走当前批次：交换到备用批次，等待预留的记录全部提交，out和批次交换存储，out原来的内容被丢弃
+			这个批次的溢出区的记录追加在out之后
+		*/
+		void take(Buffer& out) {
+			std::lock_guard<std::mutex> lock(take_mutex_);
+			Batch* batch = current_.value.load(std::memory_order_relaxed);
+			Batch* next = batch == &batches_[0] ? &batches_[1] : &batches_[0];
+			current_.value.store(next, std::memory_order_seq_cst);
+			// 打开备用批次，release发布上次take()中reset()的修改
+			next->state.value.reserved.store(0, std::memory_order_release);
+			// 关闭当前批次：之后的fetch_add都看到SEALED，在这之前的预留都计入used
+			State& state = batch->state.value;
+			size_type used = state.reserved.fetch_add(SEALED, std::memory_order_acq_rel);
+			if (used > capacity_) {
+				// 等待跨过容量的预留写入limit
+				while ((used = state.limit.load(std::memory_order_acquire)) == NO_LIMIT)
+					std::this_thread::yield();
+			}
+			while (committed(*batch) != used)
+				std::this_thread::yield();
+			batch->data.truncate(used);
+			std::swap(out, batch->data);
+			batch->data.truncate(0);
+
+			for (unsigned int i = 0; i < slot_count_; i++) {
+				Slot& slot = batch->slots[i].value;
+				// 溢出区的预留在加锁之后检查current_，这里之后加锁的预留会写入新的批次
+				std::lock_guard<std::mutex> slot_lock(slot.mutex);
+				if (!slot.data.empty()) {
+					out += slot.data;
+					slot.data.truncate(0);
+				}
+				slot.overflowed.store(false, std::memory_order_relaxed);
+			}
+			batch->reset(capacity_, slot_count_);
+		}
+
+		Buffer take() {
+			Buffer rv;
+			take(rv);
+			return rv;
+		}
+
+		size_type capacity() const {
+			return capacity_;
+		}
+
+		unsigned int slot_count() const {
+			return slot_count_;
+		}
+
+	private:
+		// reserved的最高位，表示批次已经被take()关闭
+		static const size_type SEALED = (size_type)1 << (sizeof(size_type) * 8 - 1);
+		static const size_type NO_LIMIT = ~(size_type)0;
+
+		// 写入者共同修改的计数放在同一个cache line
+		struct State {
+			std::atomic<size_type> reserved;    // 已经预留的长度，可能因为跨过容量的预留超过capacity_，关闭之后加上SEALED
+			std::atomic<size_type> limit;       // 跨过容量的预留的起点，即批次的有效长度
+
+			State():
+				reserved(0),
+				limit(NO_LIMIT) {
+			}
+		};
+
+		// 每个线程编号对应的分片：主批次中提交的长度，以及这个批次的溢出区
+		struct Slot {
+			std::atomic<size_type> committed;
+			std::atomic<bool> overflowed;       // 这个批次中写入过溢出区，之后的记录都写入溢出区
+			std::mutex mutex;
+			Buffer data;
+
+			Slot():
+				committed(0),
+				overflowed(false) {
+			}
+		};
+
+		struct Batch {
+			Buffer data;
+			pointer base;
+			buffer_internal::CacheLinePadded<State> state;
+			std::unique_ptr<buffer_internal::CacheLinePadded<Slot>[]> slots;
+
+			Batch():
+				base(nullptr) {
+			}
+
+			// 只在批次关闭之后调用，之后打开批次时reserved的release写入发布这里的修改
+			void reset(size_type capacity, unsigned int slot_count) {
+				data.resize(capacity);
+				base = data.begin();
+				state.value.limit.store(NO_LIMIT, std::memory_order_relaxed);
+				for (unsigned int i = 0; i < slot_count; i++)
+					slots[i].value.committed.store(0, std::memory_order_relaxed);
+			}
+		};
+
+		size_type capacity_;
+		unsigned int slot_count_;
+		Batch batches_[2];
+		buffer_internal::CacheLinePadded<std::atomic<Batch*> > current_;
+		std::mutex take_mutex_;
+
+		ConcurrentAppendBufferT(const ConcurrentAppendBufferT&);
+		ConcurrentAppendBufferT& operator=(const ConcurrentAppendBufferT&);
+
+		size_type committed(const Batch& batch) const {
+			size_type rv = 0;
+			for (unsigned int i = 0; i < slot_count_; i++)
+				rv += batch.slots[i].value.committed.load(std::memory_order_acquire);
+			return rv;
+		}
+
+		FTL_BUFFER_NOINLINE Reservation reserve_overflow(Reservation& r, unsigned int index) {
+			for (;;) {
+				Batch* batch = current_.value.load(std::memory_order_acquire);
+				Slot& slot = batch->slots[index].value;
+				std::unique_lock<std::mutex> lock(slot.mutex);
+				// take()交换current_之后才对溢出区加锁，这里看到的还是batch时记录会被这个批次的take()取走
+				if (current_.value.load(std::memory_order_acquire) != batch)
+					continue;
+				slot.overflowed.store(true, std::memory_order_relaxed);
+				size_type offset = slot.data.size();
+				slot.data.resize(offset + r.size_);
+				r.data_ = slot.data.begin() + offset;
+				r.slot_ = &slot;
+				// commit()时解锁
+				lock.release();
+				return r;
+			}
+		}
+	};
+
+	typedef ConcurrentAppendBufferT<uint8_t> byte_concurrent_buffer;
+
+} // namespace ftl
+
+#endif // FTL_CONCURRENT_BUFFER_H_
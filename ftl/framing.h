@@ -0,0 +1,487 @@
+#ifndef FTL_FRAMING_H_
+#define FTL_FRAMING_H_
+
+#include "buffer.h"
+#include <iterator>
+#include <cstddef>
+
+/**
+	消息分帧：按照长度前缀或者分隔符，把BufferT/BufferSpanT/StreamBufferT中的数据切分为帧，
+	返回的帧是指向原来数据的BufferSpanT，不复制、不分配内存
+
+	格式：
+		FixedLengthPrefixT<_LenTy, endianness>    固定长度的前缀，例如Be32LengthPrefix：4字节大端的长度 + 数据
+		VarintLengthPrefix                        varint的长度 + 数据
+		DelimiterFrame                            数据 + 分隔符，例如"\r\n"，最长16字节
+
+		格式都有最大的帧长度，长度超过时返回kFrameError，避免被错误的长度拖住，默认64MB
+
+	遍历：
+		迭代器是前向迭代器，++时才解析下一帧，遇到不完整的帧或者格式错误时结束
+
+		FrameRangeT<Be32LengthPrefix> range = frames(buffer, Be32LengthPrefix());
+		for (BufferSpanT<const uint8_t> frame : range) {
+			...
+		}
+		range.consumed();      // 完整的帧的字节数，不完整的帧从这里开始
+		range.status();        // 结束的原因：kFrameIncomplete数据不够，kFrameError格式错误
+
+	StreamBufferT：
+		FrameReaderT在StreamBufferT未读取的数据上遍历，commit()时read_index前进到最后一个遍历到的完整的帧之后，
+		不完整的帧留在StreamBufferT中，下次收到数据之后继续
+
+		FrameReaderT<VarintLengthPrefix> reader(stream);
+		for (BufferSpanT<const uint8_t> frame : reader) {
+			handle(frame);
+		}
+		reader.commit();
+		if (reader.status() == kFrameError)
+			close();
+
+		BufferSpanT<const uint8_t> frame;
+		while (reader.next(frame))             // 逐个读取，每次都移动read_index
+			handle(frame);
+
+	帧的视图在写入StreamBufferT(可能重新分配内存)或者compact()之后失效
+*/
+
+namespace ftl {
+
+	enum FrameStatus {
+		kFrameComplete = 0,
+		kFrameIncomplete = 1,
+		kFrameError = 2
+	};
+
+	// 一帧的组成：header_size字节的前缀，payload_size字节的数据，trailer_size字节的分隔符
+	struct FrameInfo {
+		size_t header_size;
+		size_t payload_size;
+		size_t trailer_size;
+
+		FrameInfo():
+			header_size(0),
+			payload_size(0),
+			trailer_size(0) {
+		}
+
+		size_t size() const {
+			return header_size + payload_size + trailer_size;
+		}
+	};
+
+	namespace buffer_internal {
+		static const size_t DEFAULT_MAX_FRAME_SIZE = 64 * 1024 * 1024;
+	}
+
+	/**
+		固定长度的长度前缀，include_header为true时长度包括前缀自己
+		parse()返回kFrameComplete时info为完整的帧；kFrameIncomplete时如果已经读到长度，info为需要的大小
+	*/
+	template<typename _LenTy, buffer_internal::Endian::Endianness endianness = buffer_internal::Endian::kBigEndian>
+	class FixedLengthPrefixT {
+	public:
+		static_assert(std::is_unsigned<_LenTy>::value, "FixedLengthPrefixT need unsigned length type");
+
+		explicit FixedLengthPrefixT(size_t max_payload = buffer_internal::DEFAULT_MAX_FRAME_SIZE, bool include_header = false):
+			max_payload_(max_payload),
+			include_header_(include_header) {
+		}
+
+		FrameStatus parse(const uint8_t* p, size_t n, FrameInfo& info) const {
+			if (n < sizeof(_LenTy))
+				return kFrameIncomplete;
+			uint64_t length = buffer_internal::Endian::read<uint8_t, _LenTy, endianness>(p);
+			if (include_header_) {
+				if (length < sizeof(_LenTy))
+					return kFrameError;
+				length -= sizeof(_LenTy);
+			}
+			if (length > max_payload_)
+				return kFrameError;
+			info.header_size = sizeof(_LenTy);
+			info.payload_size = (size_t)length;
+			info.trailer_size = 0;
+			return n - sizeof(_LenTy) < length ? kFrameIncomplete : kFrameComplete;
+		}
+
+		// 写入一帧
+		template<typename Stream>
+		void write(Stream& stream, const uint8_t* payload, size_t size) const {
+			uint64_t length = size + (include_header_ ? sizeof(_LenTy) : 0);
+			if (size > max_payload_ || length > (uint64_t)(_LenTy)-1)
+				throw std::length_error("FixedLengthPrefixT frame too large");
+			stream.template write<_LenTy, endianness>((_LenTy)length);
+			stream.write_bytes(payload, size);
+		}
+
+	private:
+		size_t max_payload_;
+		bool include_header_;
+	};
+
+	typedef FixedLengthPrefixT<uint16_t, buffer_internal::Endian::kBigEndian> Be16LengthPrefix;
+	typedef FixedLengthPrefixT<uint32_t, buffer_internal::Endian::kBigEndian> Be32LengthPrefix;
+	typedef FixedLengthPrefixT<uint32_t, buffer_internal::Endian::kLittleEndian> Le32LengthPrefix;
+
+	// varint(LEB128)的长度前缀，长度最多32位
+	class VarintLengthPrefix {
+	public:
+		explicit VarintLengthPrefix(size_t max_payload = buffer_internal::DEFAULT_MAX_FRAME_SIZE):
+			max_payload_(max_payload) {
+		}
+
+		FrameStatus parse(const uint8_t* p, size_t n, FrameInfo& info) const {
+			uint32_t length = 0;
+			size_t header = buffer_internal::Varint::decode(p, n, length);
+			if (header == 0) {
+				// 已有的字节都有后续标记并且没有超过最大长度时只是不完整
+				size_t max_length = (size_t)buffer_internal::Varint::MaxLength<uint32_t>::value;
+				for (size_t i = 0; i < n; i++) {
+					if (i >= max_length || !(p[i] & 0x80))
+						return kFrameError;
+				}
+				return kFrameIncomplete;
+			}
+			if (length > max_payload_)
+				return kFrameError;
+			info.header_size = header;
+			info.payload_size = length;
+			info.trailer_size = 0;
+			return n - header < length ? kFrameIncomplete : kFrameComplete;
+		}
+
+		template<typename Stream>
+		void write(Stream& stream, const uint8_t* payload, size_t size) const {
+			if (size > max_payload_ || size > (size_t)UINT32_MAX)
+				throw std::length_error("VarintLengthPrefix frame too large");
+			stream.write_varint((uint32_t)size);
+			stream.write_bytes(payload, size);
+		}
+
+	private:
+		size_t max_payload_;
+	};
+
+	/**
+		分隔符结尾的帧，数据不包括分隔符；分隔符保存在对象内部，复制时不分配内存
+		不完整的帧每次都从头查找，max_payload限制了重复查找的长度
+	*/
+	class DelimiterFrame {
+	public:
+		static const size_t MAX_DELIMITER_SIZE = 16;
+
+		DelimiterFrame(const void* delimiter, size_t size, size_t max_payload = buffer_internal::DEFAULT_MAX_FRAME_SIZE):
+			size_(size),
+			max_payload_(max_payload) {
+			if (size == 0 || size > MAX_DELIMITER_SIZE)
+				throw std::invalid_argument("DelimiterFrame delimiter size must be in [1, 16]");
+			std::memcpy(delimiter_, delimiter, size);
+		}
+
+		explicit DelimiterFrame(const char* delimiter = "\r\n"):
+			DelimiterFrame(delimiter, std::strlen(delimiter)) {
+		}
+
+		FrameStatus parse(const uint8_t* p, size_t n, FrameInfo& info) const {
+			// 最多查找max_payload_ + size_个字节，找不到时是错误
+			bool limited = max_payload_ < n && n - max_payload_ >= size_;
+			size_t limit = limited ? max_payload_ + size_ : n;
+			size_t pos = buffer_internal::Search::find(p, limit, delimiter_, size_);
+			if (pos == buffer_internal::Search::npos)
+				return limited ? kFrameError : kFrameIncomplete;
+			info.header_size = 0;
+			info.payload_size = pos;
+			info.trailer_size = size_;
+			return kFrameComplete;
+		}
+
+		template<typename Stream>
+		void write(Stream& stream, const uint8_t* payload, size_t size) const {
+			if (size > max_payload_)
+				throw std::length_error("DelimiterFrame frame too large");
+			stream.write_bytes(payload, size);
+			stream.write_bytes(delimiter_, size_);
+		}
+
+	private:
+		uint8_t delimiter_[MAX_DELIMITER_SIZE];
+		size_t size_;
+		size_t max_payload_;
+	};
+
+	namespace buffer_internal {
+		// 遍历到的位置，多个迭代器共享，只增加
+		struct FrameProgress {
+			size_t consumed;
+			FrameStatus status;
+
+			FrameProgress():
+				consumed(0),
+				status(kFrameComplete) {
+			}
+		};
+	}
+
+	/**
+		帧的前向迭代器，*it是当前帧的数据，offset()是当前帧在数据中的位置；
+		遍历结束时等于end()，offset()为完整的帧的字节数
+	*/
+	template<typename Format>
+	class FrameIteratorT {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef BufferSpanT<const uint8_t> value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const value_type* pointer;
+		typedef const value_type& reference;
+
+		// end()
+		FrameIteratorT():
+			format_(nullptr),
+			data_(nullptr),
+			size_(0),
+			pos_(0),
+			status_(kFrameIncomplete),
+			progress_(nullptr) {
+		}
+
+		FrameIteratorT(const Format* format, const uint8_t* data, size_t size, buffer_internal::FrameProgress* progress = nullptr):
+			format_(format),
+			data_(data),
+			size_(size),
+			pos_(0),
+			status_(kFrameComplete),
+			progress_(progress) {
+			parse();
+		}
+
+		reference operator*() const {
+			return frame_;
+		}
+
+		pointer operator->() const {
+			return &frame_;
+		}
+
+		FrameIteratorT& operator++() {
+			pos_ += info_.size();
+			parse();
+			return *this;
+		}
+
+		FrameIteratorT operator++(int) {
+			FrameIteratorT rv(*this);
+			++*this;
+			return rv;
+		}
+
+		bool operator==(const FrameIteratorT& other) const {
+			if (done() || other.done())
+				return done() == other.done();
+			return data_ == other.data_ && pos_ == other.pos_;
+		}
+
+		bool operator!=(const FrameIteratorT& other) const {
+			return !(*this == other);
+		}
+
+		size_t offset() const {
+			return pos_;
+		}
+
+		// 当前帧的前缀/数据/分隔符的大小
+		const FrameInfo& info() const {
+			return info_;
+		}
+
+		// kFrameComplete表示指向一个完整的帧，否则是遍历结束的原因
+		FrameStatus status() const {
+			return status_;
+		}
+
+	private:
+		const Format* format_;
+		const uint8_t* data_;
+		size_t size_;
+		size_t pos_;
+		FrameInfo info_;
+		value_type frame_;
+		FrameStatus status_;
+		buffer_internal::FrameProgress* progress_;
+
+		bool done() const {
+			return status_ != kFrameComplete;
+		}
+
+		void parse() {
+			info_ = FrameInfo();
+			status_ = format_->parse(data_ + pos_, size_ - pos_, info_);
+			if (status_ == kFrameComplete)
+				frame_ = value_type(data_ + pos_ + info_.header_size, info_.payload_size);
+			else
+				frame_ = value_type();
+			if (progress_) {
+				// 完整的帧算作已经遍历，consumed在它之后；其他结果停在pos_
+				size_t end = status_ == kFrameComplete ? pos_ + info_.size() : pos_;
+				if (end >= progress_->consumed) {
+					progress_->consumed = end;
+					progress_->status = status_;
+				}
+			}
+		}
+	};
+
+	// 一段数据上的帧，begin()时才开始解析
+	template<typename Format>
+	class FrameRangeT {
+	public:
+		typedef FrameIteratorT<Format> iterator;
+		typedef iterator const_iterator;
+
+		FrameRangeT(const void* data, size_t size, const Format& format = Format()):
+			format_(format),
+			data_(static_cast<const uint8_t*>(data)),
+			size_(size) {
+		}
+
+		iterator begin() {
+			return iterator(&format_, data_, size_, &progress_);
+		}
+
+		iterator end() const {
+			return iterator();
+		}
+
+		// 已经遍历过的完整的帧的字节数
+		size_t consumed() const {
+			return progress_.consumed;
+		}
+
+		FrameStatus status() const {
+			return progress_.status;
+		}
+
+	private:
+		Format format_;
+		const uint8_t* data_;
+		size_t size_;
+		buffer_internal::FrameProgress progress_;
+	};
+
+	template<typename Format, typename _Ty, typename Continer>
+	inline FrameRangeT<Format> frames(const BufferT<_Ty, Continer>& buf, const Format& format) {
+		static_assert(sizeof(_Ty) == 1, "frames() need 8bit value_type");
+		return FrameRangeT<Format>(buf.begin(), buf.size(), format);
+	}
+
+	template<typename Format, typename _Ty>
+	inline FrameRangeT<Format> frames(const BufferSpanT<_Ty>& span, const Format& format) {
+		static_assert(sizeof(_Ty) == 1, "frames() need 8bit value_type");
+		return FrameRangeT<Format>(span.begin(), span.size(), format);
+	}
+
+	// StreamBufferT未读取的数据，不移动read_index
+	template<typename Format, typename _Ty, typename Buffer>
+	inline FrameRangeT<Format> frames(const StreamBufferT<_Ty, Buffer>& stream, const Format& format) {
+		static_assert(sizeof(_Ty) == 1, "frames() need 8bit value_type");
+		size_t end = stream.data_end();
+		size_t pos = std::min<size_t>(stream.read_index(), end);
+		return FrameRangeT<Format>(stream.buf().continer().begin() + pos, end - pos, format);
+	}
+
+	/**
+		StreamBufferT上的分帧，begin()从当前的read_index开始解析，commit()确认遍历过的帧
+		包装期间不能直接读取StreamBufferT，写入在commit()之后进行
+	*/
+	template<typename Format, typename Stream = StreamBufferT<uint8_t> >
+	class FrameReaderT {
+	public:
+		typedef FrameIteratorT<Format> iterator;
+		typedef typename Stream::size_type size_type;
+
+		static_assert(sizeof(typename Stream::value_type) == 1, "FrameReaderT need 8bit value_type");
+
+		explicit FrameReaderT(Stream& stream, const Format& format = Format()):
+			stream_(stream),
+			format_(format),
+			status_(kFrameComplete) {
+		}
+
+		iterator begin() {
+			progress_ = buffer_internal::FrameProgress();
+			return iterator(&format_, unread(), unread_size(), &progress_);
+		}
+
+		iterator end() const {
+			return iterator();
+		}
+
+		// read_index前进到遍历过的完整的帧之后
+		void commit() {
+			advance(progress_.consumed);
+			status_ = progress_.status;
+			progress_ = buffer_internal::FrameProgress();
+		}
+
+		// read_index前进到it指向的帧之前，it来自最近一次begin()
+		void commit(const iterator& it) {
+			advance(it.offset());
+			status_ = it.status();
+			progress_ = buffer_internal::FrameProgress();
+		}
+
+		// 读取一帧，read_index移动到这一帧之后；没有完整的帧时返回false，status()为原因
+		bool next(BufferSpanT<const uint8_t>& frame) {
+			const uint8_t* p = unread();
+			FrameInfo info;
+			status_ = format_.parse(p, unread_size(), info);
+			if (status_ != kFrameComplete)
+				return false;
+			frame = BufferSpanT<const uint8_t>(p + info.header_size, info.payload_size);
+			advance(info.size());
+			return true;
+		}
+
+		// 最近一次commit()/next()结束的原因
+		FrameStatus status() const {
+			return status_;
+		}
+
+		const Format& format() const {
+			return format_;
+		}
+
+		Stream& stream() {
+			return stream_;
+		}
+
+	private:
+		Stream& stream_;
+		Format format_;
+		FrameStatus status_;
+		buffer_internal::FrameProgress progress_;
+
+		FrameReaderT(const FrameReaderT&);
+		FrameReaderT& operator=(const FrameReaderT&);
+
+		const uint8_t* unread() const {
+			size_t pos = std::min<size_t>(stream_.read_index(), stream_.data_end());
+			return reinterpret_cast<const uint8_t*>(stream_.buf().continer().begin()) + pos;
+		}
+
+		size_t unread_size() const {
+			size_t end = stream_.data_end();
+			size_t pos = std::min<size_t>(stream_.read_index(), end);
+			return end - pos;
+		}
+
+		void advance(size_t n) {
+			if (n > 0)
+				stream_.read_span(n);
+		}
+	};
+
+} // namespace ftl
+
+#endif // FTL_FRAMING_H_
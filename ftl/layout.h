@@ -0,0 +1,284 @@
+#ifndef FTL_LAYOUT_H_
+#define FTL_LAYOUT_H_
+
+#include <tuple>
+#include <initializer_list>
+
+#include "buffer.h"
+
+/**
+	layout，编译期描述一个结构的字段布局，偏移和总长度在编译期计算，
+	整个结构只检查一次边界，字段的读写展开为直线代码
+
+	字段描述：
+		be<T>   大端的T，T为is_endian_basictype
+		le<T>   小端的T
+		uint8_t/int8_t/char  单字节字段
+
+		// uint16 type + uint32 length + double value(小端)
+		typedef layout<be<uint16_t>, be<uint32_t>, le<double> > header_layout;
+		header_layout::size;                // 14
+		header_layout::offset<1>::value;    // 2
+
+	读取：
+		header_layout::tuple_type header = header_layout::read(buffer, 0);
+		std::get<1>(header);
+
+		uint16_t type; uint32_t length; double value;
+		header_layout::read(buffer, 0, type, length, value);
+		header_layout::read(stream, type, length, value);   // StreamBufferT，read_index_前进size
+
+	写入：
+		header_layout::write(buffer, 0, 1, 100, 0.5);    // 写入已有的空间
+		header_layout::write(stream, 1, 100, 0.5);       // StreamBufferT，write_index_前进size
+		header_layout::append(buffer, 1, 100, 0.5);      // 追加到尾部
+*/
+
+namespace ftl {
+
+	template<typename T>
+	struct be {
+		static_assert(buffer_internal::is_endian_basictype<T>::value, "be<T> need is_endian_basictype");
+		typedef T value_type;
+		static const size_t size = sizeof(T);
+
+		template<typename _Ty>
+		static inline T read(const _Ty* p) {
+			return buffer_internal::Endian::read<_Ty, T, buffer_internal::Endian::kBigEndian>(p);
+		}
+
+		template<typename _Ty>
+		static inline void write(_Ty* p, const T& value) {
+			buffer_internal::Endian::write<_Ty, T, buffer_internal::Endian::kBigEndian>(p, value);
+		}
+	};
+
+	template<typename T>
+	struct le {
+		static_assert(buffer_internal::is_endian_basictype<T>::value, "le<T> need is_endian_basictype");
+		typedef T value_type;
+		static const size_t size = sizeof(T);
+
+		template<typename _Ty>
+		static inline T read(const _Ty* p) {
+			return buffer_internal::Endian::read<_Ty, T, buffer_internal::Endian::kLittleEndian>(p);
+		}
+
+		template<typename _Ty>
+		static inline void write(_Ty* p, const T& value) {
+			buffer_internal::Endian::write<_Ty, T, buffer_internal::Endian::kLittleEndian>(p, value);
+		}
+	};
+
+	namespace buffer_internal {
+
+		// 单字节字段可以直接写类型，其他字段必须是be<T>/le<T>
+		template<typename Field, bool is_8bit = is_8bit_basictype<Field>::value>
+		struct LayoutField : Field {
+		};
+
+		template<typename Field>
+		struct LayoutField<Field, true> {
+			typedef Field value_type;
+			static const size_t size = 1;
+
+			template<typename _Ty>
+			static inline Field read(const _Ty* p) {
+				return static_cast<Field>(*p);
+			}
+
+			template<typename _Ty>
+			static inline void write(_Ty* p, const Field& value) {
+				*p = static_cast<_Ty>(value);
+			}
+		};
+
+		template<size_t... I>
+		struct IndexSequence {
+		};
+
+		template<typename First, typename Second>
+		struct ConcatIndexSequence;
+
+		template<size_t... I, size_t... J>
+		struct ConcatIndexSequence<IndexSequence<I...>, IndexSequence<J...> > {
+			typedef IndexSequence<I..., (sizeof...(I) + J)...> type;
+		};
+
+		// 对半拆分，递归深度是log(N)，StaticContinerT的容量较大时也不会超过模板的递归深度
+		template<size_t N>
+		struct MakeIndexSequence {
+			typedef typename ConcatIndexSequence<typename MakeIndexSequence<N / 2>::type,
+				typename MakeIndexSequence<N - N / 2>::type>::type type;
+		};
+
+		template<>
+		struct MakeIndexSequence<0> {
+			typedef IndexSequence<> type;
+		};
+
+		template<>
+		struct MakeIndexSequence<1> {
+			typedef IndexSequence<0> type;
+		};
+
+		template<typename... Fields>
+		struct LayoutSize;
+
+		template<>
+		struct LayoutSize<> {
+			static const size_t value = 0;
+		};
+
+		template<typename Field, typename... Rest>
+		struct LayoutSize<Field, Rest...> {
+			static const size_t value = LayoutField<Field>::size + LayoutSize<Rest...>::value;
+		};
+
+		// 第I个字段的偏移
+		template<size_t I, typename... Fields>
+		struct LayoutOffset;
+
+		template<typename Field, typename... Rest>
+		struct LayoutOffset<0, Field, Rest...> {
+			static const size_t value = 0;
+		};
+
+		template<size_t I, typename Field, typename... Rest>
+		struct LayoutOffset<I, Field, Rest...> {
+			static const size_t value = LayoutField<Field>::size + LayoutOffset<I - 1, Rest...>::value;
+		};
+
+		// 用于在C++11中展开参数包
+		inline void LayoutExpand(std::initializer_list<int>) {
+		}
+
+	} // namespace buffer_internal
+
+	template<typename... Fields>
+	struct layout {
+		typedef std::tuple<typename buffer_internal::LayoutField<Fields>::value_type...> tuple_type;
+		typedef typename buffer_internal::MakeIndexSequence<sizeof...(Fields)>::type index_type;
+
+		static const size_t count = sizeof...(Fields);
+		static const size_t size = buffer_internal::LayoutSize<Fields...>::value;
+
+		template<size_t I>
+		struct offset {
+			static const size_t value = buffer_internal::LayoutOffset<I, Fields...>::value;
+		};
+
+		/////////////////////////////////////
+		// 直接操作指针，不检查边界
+
+		template<typename _Ty>
+		static inline tuple_type decode(const _Ty* p) {
+			return decode(p, index_type());
+		}
+
+		template<typename _Ty>
+		static inline void decode(const _Ty* p, typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			decode(p, index_type(), values...);
+		}
+
+		template<typename _Ty>
+		static inline void encode(_Ty* p, const typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			encode(p, index_type(), values...);
+		}
+
+		template<typename _Ty>
+		static inline void encode(_Ty* p, const tuple_type& values) {
+			encode_tuple(p, values, index_type());
+		}
+
+		/////////////////////////////////////
+		// BufferT，只检查一次[offset, offset + size)
+
+		template<typename _Ty, typename Continer>
+		static inline tuple_type read(const BufferT<_Ty, Continer>& buf, size_t pos) {
+			return decode(buf.span(pos, size).begin());
+		}
+
+		template<typename _Ty, typename Continer>
+		static inline void read(const BufferT<_Ty, Continer>& buf, size_t pos,
+			typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			decode(buf.span(pos, size).begin(), values...);
+		}
+
+		template<typename _Ty, typename Continer>
+		static inline void write(BufferT<_Ty, Continer>& buf, size_t pos,
+			const typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			encode(buf.span(pos, size).begin(), values...);
+		}
+
+		template<typename _Ty, typename Continer>
+		static inline void write(BufferT<_Ty, Continer>& buf, size_t pos, const tuple_type& values) {
+			encode(buf.span(pos, size).begin(), values);
+		}
+
+		template<typename _Ty, typename Continer>
+		static inline void append(BufferT<_Ty, Continer>& buf,
+			const typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			size_t pos = buf.size();
+			buf.resize(pos + size);
+			encode(buf.span(pos, size).begin(), values...);
+		}
+
+		/////////////////////////////////////
+		// StreamBufferT，读写位置前进size
+
+		template<typename _Ty, typename Buffer>
+		static inline tuple_type read(StreamBufferT<_Ty, Buffer>& stream) {
+			return decode(stream.read_span(size).begin());
+		}
+
+		template<typename _Ty, typename Buffer>
+		static inline void read(StreamBufferT<_Ty, Buffer>& stream,
+			typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			decode(stream.read_span(size).begin(), values...);
+		}
+
+		template<typename _Ty, typename Buffer>
+		static inline void write(StreamBufferT<_Ty, Buffer>& stream,
+			const typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			encode(stream.write_span(size).begin(), values...);
+		}
+
+		template<typename _Ty, typename Buffer>
+		static inline void write(StreamBufferT<_Ty, Buffer>& stream, const tuple_type& values) {
+			encode(stream.write_span(size).begin(), values);
+		}
+
+	private:
+		template<typename _Ty, size_t... I>
+		static inline tuple_type decode(const _Ty* p, buffer_internal::IndexSequence<I...>) {
+			return tuple_type(buffer_internal::LayoutField<Fields>::read(p + offset<I>::value)...);
+		}
+
+		template<typename _Ty, size_t... I>
+		static inline void decode(const _Ty* p, buffer_internal::IndexSequence<I...>,
+			typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			buffer_internal::LayoutExpand({ 0, (values = buffer_internal::LayoutField<Fields>::read(p + offset<I>::value), 0)... });
+		}
+
+		template<typename _Ty, size_t... I>
+		static inline void encode(_Ty* p, buffer_internal::IndexSequence<I...>,
+			const typename buffer_internal::LayoutField<Fields>::value_type&... values) {
+			buffer_internal::LayoutExpand({ 0, (buffer_internal::LayoutField<Fields>::write(p + offset<I>::value, values), 0)... });
+		}
+
+		template<typename _Ty, size_t... I>
+		static inline void encode_tuple(_Ty* p, const tuple_type& values, buffer_internal::IndexSequence<I...>) {
+			encode(p, index_type(), std::get<I>(values)...);
+		}
+	};
+
+	template<typename... Fields>
+	const size_t layout<Fields...>::size;
+
+	template<typename... Fields>
+	const size_t layout<Fields...>::count;
+
+} // namespace ftl
+
+#endif // FTL_LAYOUT_H_
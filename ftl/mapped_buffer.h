@@ -0,0 +1,366 @@
+#ifndef FTL_MAPPED_BUFFER_H_
+#define FTL_MAPPED_BUFFER_H_
+
+#include <memory>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include "buffer.h"
+
+/**
+	MappedFileT，把文件映射到内存的容器，用于BufferT/StreamBufferT，数据只存在于page cache中
+
+	模式：
+		kReadOnly     只读映射，不能写入
+		kCopyOnWrite  私有映射，可以写入，写入的页面复制一份，不会写回文件
+		kReadWrite    共享映射，写入直接修改文件
+
+		mapped_byte_buffer buffer(mapped_file::open("capture.bin"));
+		buffer.read_be<uint32_t>(0);
+
+		mapped_byte_streambuffer stream(mapped_byte_buffer(mapped_file::open("capture.bin")));
+		stream.buf().continer().advise(mapped_file::kSequential);
+
+	拷贝构造、赋值和slice()共享同一个映射，不能改变大小，resize()只能缩小
+	kReadOnly的映射不可写，非const的begin()/end()抛出std::system_error(std::errc::permission_denied)，
+	BufferT/StreamBufferT的写入接口因此在写入之前失败；读取使用const的接口，或者通过const引用访问
+*/
+
+namespace ftl {
+
+	namespace buffer_internal {
+
+		template<typename _Ty>
+		class MappedFileT {
+		public:
+			typedef _Ty value_type;
+			typedef _Ty& reference;
+			typedef _Ty& const_reference;
+			typedef _Ty* pointer;
+			typedef const _Ty* const_pointer;
+			typedef _Ty* iterator;
+			typedef const _Ty* const_iterator;
+			typedef size_t size_type;
+
+			enum Mode {
+				kReadOnly = 0,
+				kCopyOnWrite = 1,
+				kReadWrite = 2
+			};
+
+			// 访问方式提示，对应madvise
+			enum Advice {
+				kNormal = 0,
+				kSequential = 1,
+				kRandom = 2,
+				kWillNeed = 3,
+				kDontNeed = 4
+			};
+
+			MappedFileT():
+				buf_(nullptr),
+				size_(0) {
+			}
+
+			MappedFileT(const MappedFileT& other):
+				mapping_(other.mapping_),
+				buf_(other.buf_),
+				size_(other.size_) {
+			}
+
+			MappedFileT(MappedFileT&& other):
+				mapping_(std::move(other.mapping_)),
+				buf_(other.buf_),
+				size_(other.size_) {
+				other.buf_ = nullptr;
+				other.size_ = 0;
+			}
+
+			MappedFileT& operator=(const MappedFileT& other) {
+				mapping_ = other.mapping_;
+				buf_ = other.buf_;
+				size_ = other.size_;
+				return *this;
+			}
+
+			MappedFileT& operator=(MappedFileT&& other) {
+				mapping_ = std::move(other.mapping_);
+				buf_ = other.buf_;
+				size_ = other.size_;
+				other.buf_ = nullptr;
+				other.size_ = 0;
+				return *this;
+			}
+
+			// 映射整个文件，失败时抛出std::system_error
+			static MappedFileT open(const std::string& path, Mode mode = kReadOnly) {
+				std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>();
+				mapping->map(path, mode);
+				MappedFileT rv;
+				rv.buf_ = reinterpret_cast<pointer>(mapping->addr);
+				rv.size_ = mapping->length;
+				rv.mapping_ = mapping;
+				return rv;
+			}
+
+			inline iterator begin() {
+				if (FTL_BUFFER_UNLIKELY(mapping_ && mapping_->mode == kReadOnly))
+					xreadonly();
+				return buf_;
+			}
+
+			inline const_iterator begin() const {
+				return buf_;
+			}
+
+			inline iterator end() {
+				if (FTL_BUFFER_UNLIKELY(mapping_ && mapping_->mode == kReadOnly))
+					xreadonly();
+				return buf_ + size_;
+			}
+
+			inline const_iterator end() const {
+				return buf_ + size_;
+			}
+
+			size_type size() const {
+				return size_;
+			}
+
+			size_type capacity() const {
+				return size_;
+			}
+
+			bool empty() const {
+				return !size_;
+			}
+
+			Mode mode() const {
+				return mapping_ ? mapping_->mode : kReadOnly;
+			}
+
+			void resize(size_type size) {
+				if (size == 0)
+					clear();
+				else if (size > size_)
+					throw std::length_error("MappedFileT can not grow");
+				else
+					size_ = size;
+			}
+
+			void reserve(size_type size) {
+				if (size > size_)
+					throw std::length_error("MappedFileT can not grow");
+			}
+
+			void truncate(size_type size) {
+				if (size < size_)
+					size_ = size;
+			}
+
+			void shrink() {
+			}
+
+			void shrink_to_fit() {
+			}
+
+			void clear() {
+				mapping_.reset();
+				buf_ = nullptr;
+				size_ = 0;
+			}
+
+			MappedFileT slice(size_type offset, size_type count) const {
+				MappedFileT rv(*this);
+				rv.buf_ = buf_ + offset;
+				rv.size_ = count;
+				return rv;
+			}
+
+			// 对整个视图给出访问方式提示，例如顺序扫描时使用kSequential
+			void advise(Advice advice) const {
+				advise(0, size_, advice);
+			}
+
+			// 预读[offset, offset + count)
+			void prefetch(size_type offset, size_type count) const {
+				advise(offset, count, kWillNeed);
+			}
+
+			void advise(size_type offset, size_type count, Advice advice) const {
+				if (!mapping_ || offset >= size_)
+					return;
+				count = std::min<size_type>(count, size_ - offset);
+				if (count == 0)
+					return;
+				// 地址需要按照页对齐
+				size_t page = page_size();
+				uintptr_t start = reinterpret_cast<uintptr_t>(buf_ + offset);
+				uintptr_t aligned = start & ~(uintptr_t)(page - 1);
+				size_t length = count + (size_t)(start - aligned);
+#ifdef _WIN32
+				if (advice == kWillNeed) {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+					WIN32_MEMORY_RANGE_ENTRY range;
+					range.VirtualAddress = reinterpret_cast<PVOID>(aligned);
+					range.NumberOfBytes = length;
+					PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+				}
+#else
+				static const int advices[] = {
+					MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED
+				};
+				// 可写的私有映射上MADV_DONTNEED会丢弃修改，只在只读映射上使用
+				if (advice == kDontNeed && mapping_->mode != kReadOnly)
+					return;
+				::madvise(reinterpret_cast<void*>(aligned), length, advices[advice]);
+#endif
+			}
+
+		private:
+			struct Mapping {
+				void* addr;
+				size_t length;
+				Mode mode;
+#ifdef _WIN32
+				HANDLE file;
+				HANDLE handle;
+#endif
+
+				Mapping():
+					addr(nullptr),
+					length(0),
+					mode(kReadOnly)
+#ifdef _WIN32
+					, file(INVALID_HANDLE_VALUE),
+					handle(nullptr)
+#endif
+				{
+				}
+
+				~Mapping() {
+					unmap();
+				}
+
+#ifdef _WIN32
+				void map(const std::string& path, Mode map_mode) {
+					mode = map_mode;
+					DWORD access = (mode == kReadWrite ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ);
+					file = CreateFileA(path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+						OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+					if (file == INVALID_HANDLE_VALUE)
+						fail("MappedFileT open " + path);
+					LARGE_INTEGER file_size;
+					if (!GetFileSizeEx(file, &file_size))
+						fail("MappedFileT stat " + path);
+					length = (size_t)file_size.QuadPart;
+					if (length == 0)
+						return;
+					static const DWORD protects[] = { PAGE_READONLY, PAGE_WRITECOPY, PAGE_READWRITE };
+					static const DWORD views[] = { FILE_MAP_READ, FILE_MAP_COPY, FILE_MAP_WRITE };
+					handle = CreateFileMappingA(file, nullptr, protects[mode], 0, 0, nullptr);
+					if (!handle)
+						fail("MappedFileT CreateFileMapping " + path);
+					addr = MapViewOfFile(handle, views[mode], 0, 0, length);
+					if (!addr)
+						fail("MappedFileT MapViewOfFile " + path);
+				}
+
+				void unmap() {
+					if (addr)
+						UnmapViewOfFile(addr);
+					if (handle)
+						CloseHandle(handle);
+					if (file != INVALID_HANDLE_VALUE)
+						CloseHandle(file);
+					addr = nullptr;
+					handle = nullptr;
+					file = INVALID_HANDLE_VALUE;
+					length = 0;
+				}
+
+				void fail(const std::string& what) {
+					DWORD error = GetLastError();
+					unmap();
+					throw std::system_error((int)error, std::system_category(), what);
+				}
+#else
+				void map(const std::string& path, Mode map_mode) {
+					mode = map_mode;
+					int fd = ::open(path.c_str(), mode == kReadWrite ? O_RDWR : O_RDONLY);
+					if (fd < 0)
+						throw std::system_error(errno, std::generic_category(), "MappedFileT open " + path);
+					struct stat st;
+					if (::fstat(fd, &st) != 0) {
+						int error = errno;
+						::close(fd);
+						throw std::system_error(error, std::generic_category(), "MappedFileT stat " + path);
+					}
+					length = (size_t)st.st_size;
+					if (length == 0) {
+						::close(fd);
+						return;
+					}
+					int prot = (mode == kReadOnly ? PROT_READ : PROT_READ | PROT_WRITE);
+					int flags = (mode == kReadWrite ? MAP_SHARED : MAP_PRIVATE);
+					void* p = ::mmap(nullptr, length, prot, flags, fd, 0);
+					int error = errno;
+					::close(fd);
+					if (p == MAP_FAILED) {
+						length = 0;
+						throw std::system_error(error, std::generic_category(), "MappedFileT mmap " + path);
+					}
+					addr = p;
+				}
+
+				void unmap() {
+					if (addr)
+						::munmap(addr, length);
+					addr = nullptr;
+					length = 0;
+				}
+#endif
+			};
+
+			std::shared_ptr<Mapping> mapping_;
+			pointer buf_;
+			size_type size_;
+
+			[[noreturn]] FTL_BUFFER_NOINLINE FTL_BUFFER_COLD static void xreadonly() {
+				throw std::system_error(std::make_error_code(std::errc::permission_denied), "MappedFileT is read only");
+			}
+
+			static size_t page_size() {
+#ifdef _WIN32
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				return info.dwPageSize;
+#else
+				static const size_t page = (size_t)::sysconf(_SC_PAGESIZE);
+				return page;
+#endif
+			}
+		};
+
+	} // namespace buffer_internal
+
+	typedef buffer_internal::MappedFileT<uint8_t> mapped_file;
+	typedef BufferT<uint8_t, mapped_file> mapped_byte_buffer;
+	typedef StreamBufferT<uint8_t, mapped_byte_buffer> mapped_byte_streambuffer;
+
+} // namespace ftl
+
+#endif // FTL_MAPPED_BUFFER_H_
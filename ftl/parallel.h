@@ -0,0 +1,339 @@
+#ifndef FTL_PARALLEL_H_
+#define FTL_PARALLEL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "checksum.h"
+
+/**
+	大buffer的并行操作：fill/copy/equal/checksum/byte swap，按照线程数分块交给BufferThreadPool
+
+	阈值：
+		小于ParallelPolicy::threshold(默认4M)的buffer直接在调用线程执行，每个线程至少min_chunk(默认1M)
+
+	分块：
+		分块的边界按照页对齐(分块不小于8M时按照2M的大页对齐)，每一页只由一个线程访问，
+		第i块总是由pool中固定的第i个线程执行，parallel_copy的目标不初始化，
+		由执行的线程第一次写入，按照first-touch策略分配在该线程所在的NUMA节点上，之后同样分块的操作访问本地内存
+
+		byte_buffer snapshot = parallel_copy(state);
+		parallel_checksum<Crc32c>(snapshot);
+		parallel_fill(scratch, (uint8_t)0);
+
+	std::execution需要C++17，这里使用自己的线程池，任务中不能再调用parallel_*，嵌套调用直接串行执行
+*/
+
+namespace ftl {
+
+	/**
+		固定线程数的线程池，调用线程作为第0个线程参与执行
+	*/
+	class BufferThreadPool {
+	public:
+		// threads为总的并行度(包括调用线程)，0使用hardware_concurrency
+		explicit BufferThreadPool(unsigned int threads = 0):
+			concurrency_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+			generation_(0),
+			count_(0),
+			task_(nullptr),
+			remaining_(0),
+			stop_(false) {
+			for (unsigned int i = 1; i < concurrency_; i++)
+				workers_.push_back(std::thread(&BufferThreadPool::work, this, i));
+		}
+
+		~BufferThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				stop_ = true;
+			}
+			wake_.notify_all();
+			for (size_t i = 0; i < workers_.size(); i++)
+				workers_[i].join();
+		}
+
+		unsigned int concurrency() const {
+			return concurrency_;
+		}
+
+		/**
+			执行task(0)...task(count - 1)，任务i由第i % concurrency()个线程执行，返回时全部完成；
+			多个线程同时调用时依次执行，在pool的线程中调用时直接串行执行
+		*/
+		void run(size_t count, const std::function<void(size_t)>& task) {
+			if (count == 0)
+				return;
+			if (count == 1 || concurrency_ == 1 || in_pool()) {
+				for (size_t i = 0; i < count; i++)
+					task(i);
+				return;
+			}
+			std::lock_guard<std::mutex> run_lock(run_mutex_);
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				task_ = &task;
+				count_ = count;
+				remaining_ = std::min<size_t>(count, concurrency_) - 1;
+				generation_++;
+			}
+			wake_.notify_all();
+			in_pool() = true;
+			execute(0, count, task);
+			in_pool() = false;
+			std::unique_lock<std::mutex> lock(mutex_);
+			while (remaining_ > 0)
+				done_.wait(lock);
+			task_ = nullptr;
+		}
+
+	private:
+		unsigned int concurrency_;
+		std::vector<std::thread> workers_;
+		std::mutex run_mutex_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		uint64_t generation_;
+		size_t count_;
+		const std::function<void(size_t)>* task_;
+		size_t remaining_;		// 还没有完成的工作线程数
+		bool stop_;
+
+		static bool& in_pool() {
+			static thread_local bool flag = false;
+			return flag;
+		}
+
+		void execute(unsigned int index, size_t count, const std::function<void(size_t)>& task) {
+			for (size_t i = index; i < count; i += concurrency_)
+				task(i);
+		}
+
+		void work(unsigned int index) {
+			in_pool() = true;
+			uint64_t seen = 0;
+			std::unique_lock<std::mutex> lock(mutex_);
+			for (;;) {
+				while (!stop_ && generation_ == seen)
+					wake_.wait(lock);
+				if (stop_)
+					return;
+				seen = generation_;
+				if (index >= count_)
+					continue;
+				const std::function<void(size_t)>* task = task_;
+				size_t count = count_;
+				lock.unlock();
+				execute(index, count, *task);
+				lock.lock();
+				if (--remaining_ == 0)
+					done_.notify_one();
+			}
+		}
+
+		BufferThreadPool(const BufferThreadPool&);
+		BufferThreadPool& operator=(const BufferThreadPool&);
+	};
+
+	namespace buffer_internal {
+
+		// 默认的全局线程池，自定义时提供同样的static instance()即可
+		struct DefaultBufferThreadPool {
+			static BufferThreadPool& instance() {
+				static BufferThreadPool pool;
+				return pool;
+			}
+		};
+
+	} // namespace buffer_internal
+
+	struct ParallelPolicy {
+		static const size_t DEFAULT_THRESHOLD = 4 * 1024 * 1024;
+		static const size_t DEFAULT_MIN_CHUNK = 1024 * 1024;
+		static const size_t PAGE_ALIGN = 4096;
+		static const size_t HUGE_PAGE_ALIGN = 2 * 1024 * 1024;
+
+		size_t threshold;			// 小于threshold个字节时串行
+		size_t min_chunk;			// 每个分块的最小字节数
+		BufferThreadPool* pool;		// nullptr使用默认的线程池
+
+		ParallelPolicy(size_t threshold = DEFAULT_THRESHOLD, size_t min_chunk = DEFAULT_MIN_CHUNK, BufferThreadPool* pool = nullptr):
+			threshold(threshold),
+			min_chunk(min_chunk),
+			pool(pool) {
+		}
+
+		// 总是串行
+		static ParallelPolicy serial() {
+			return ParallelPolicy(SIZE_MAX);
+		}
+
+		BufferThreadPool& thread_pool() const {
+			return pool ? *pool : buffer_internal::DefaultBufferThreadPool::instance();
+		}
+	};
+
+	namespace buffer_internal {
+
+		/**
+			把[base, base + size)分为count块，边界按照地址对齐，并且是element_size的倍数
+		*/
+		class ParallelChunks {
+		public:
+			ParallelChunks(const void* base, size_t size, size_t element_size, const ParallelPolicy& policy, unsigned int concurrency):
+				base_(reinterpret_cast<uintptr_t>(base)),
+				size_(size),
+				element_size_(element_size),
+				count_(1),
+				chunk_(size),
+				align_(ParallelPolicy::PAGE_ALIGN) {
+				if (size < policy.threshold || concurrency <= 1)
+					return;
+				size_t min_chunk = std::max<size_t>(policy.min_chunk, (size_t)ParallelPolicy::PAGE_ALIGN);
+				count_ = std::max<size_t>(1, std::min<size_t>(concurrency, size / min_chunk));
+				chunk_ = (size + count_ - 1) / count_;
+				if (chunk_ >= 4 * ParallelPolicy::HUGE_PAGE_ALIGN)
+					align_ = ParallelPolicy::HUGE_PAGE_ALIGN;
+			}
+
+			size_t count() const {
+				return count_;
+			}
+
+			// 第index块的起始偏移
+			size_t offset(size_t index) const {
+				if (index == 0)
+					return 0;
+				if (index >= count_)
+					return size_;
+				uintptr_t p = base_ + index * chunk_;
+				p = (p + align_ - 1) / align_ * align_;
+				size_t rv = std::min<size_t>((size_t)(p - base_), size_);
+				return rv / element_size_ * element_size_;
+			}
+
+			// [offset(index), offset(index + 1))
+			size_t size(size_t index) const {
+				return offset(index + 1) - offset(index);
+			}
+
+		private:
+			uintptr_t base_;
+			size_t size_;
+			size_t element_size_;
+			size_t count_;
+			size_t chunk_;
+			size_t align_;
+		};
+
+		// fn(offset, size)对每一块执行一次，只有一块时在调用线程直接执行
+		template<typename Fn>
+		inline size_t ParallelFor(const void* base, size_t size, size_t element_size, const ParallelPolicy& policy, Fn fn) {
+			BufferThreadPool* pool = nullptr;
+			unsigned int concurrency = 1;
+			if (size >= policy.threshold) {
+				pool = &policy.thread_pool();
+				concurrency = pool->concurrency();
+			}
+			ParallelChunks chunks(base, size, element_size, policy, concurrency);
+			if (chunks.count() == 1) {
+				fn((size_t)0, size, (size_t)0);
+				return 1;
+			}
+			pool->run(chunks.count(), [&chunks, &fn](size_t index) {
+				fn(chunks.offset(index), chunks.size(index), index);
+			});
+			return chunks.count();
+		}
+
+	} // namespace buffer_internal
+
+	/////////////////////////////////////
+	// 并行操作
+
+	// [offset, offset + count)填充value，count为0时到结尾，和BufferT::fill相同
+	template<typename _Ty, typename Continer>
+	void parallel_fill(BufferT<_Ty, Continer>& buf, const _Ty& value, size_t offset = 0, size_t count = 0,
+		const ParallelPolicy& policy = ParallelPolicy()) {
+		if (offset >= buf.size())
+			return;
+		if (count == 0 || offset + count > buf.size())
+			count = buf.size() - offset;
+		_Ty* p = buf.begin() + offset;
+		buffer_internal::ParallelFor(p, count * sizeof(_Ty), sizeof(_Ty), policy, [p, &value](size_t pos, size_t size, size_t) {
+			std::fill(p + pos / sizeof(_Ty), p + (pos + size) / sizeof(_Ty), value);
+		});
+	}
+
+	// 复制一份，目标不初始化，由各个线程直接写入
+	template<typename _Ty, typename Continer>
+	BufferT<_Ty, Continer> parallel_copy(const BufferT<_Ty, Continer>& src, const ParallelPolicy& policy = ParallelPolicy()) {
+		BufferT<_Ty, Continer> rv(src.size());
+		if (src.size() == 0)
+			return rv;
+		const char* from = reinterpret_cast<const char*>(src.begin());
+		char* to = reinterpret_cast<char*>(rv.begin());
+		buffer_internal::ParallelFor(to, src.size() * sizeof(_Ty), sizeof(_Ty), policy, [from, to](size_t pos, size_t size, size_t) {
+			std::memcpy(to + pos, from + pos, size);
+		});
+		FTL_BUFFER_STAT_COPY(copy_bytes, src.size() * sizeof(_Ty));
+		return rv;
+	}
+
+	template<typename _Ty, typename Continer1, typename Continer2>
+	bool parallel_equal(const BufferT<_Ty, Continer1>& a, const BufferT<_Ty, Continer2>& b, const ParallelPolicy& policy = ParallelPolicy()) {
+		if (a.size() != b.size())
+			return false;
+		if (a.size() == 0)
+			return true;
+		const uint8_t* pa = reinterpret_cast<const uint8_t*>(a.begin());
+		const uint8_t* pb = reinterpret_cast<const uint8_t*>(b.begin());
+		std::atomic<bool> equal(true);
+		buffer_internal::ParallelFor(pa, a.size() * sizeof(_Ty), sizeof(_Ty), policy, [pa, pb, &equal](size_t pos, size_t size, size_t) {
+			// 其他分块已经不同时跳过
+			if (equal.load(std::memory_order_relaxed) && !buffer_internal::Search::equal(pa + pos, pb + pos, size))
+				equal.store(false, std::memory_order_relaxed);
+		});
+		return equal.load();
+	}
+
+	/**
+		分块计算之后用Checksum::combine合并，Crc32c/Adler32支持，XXHash不能合并
+	*/
+	template<typename Checksum, typename _Ty, typename Continer>
+	typename Checksum::value_type parallel_checksum(const BufferT<_Ty, Continer>& buf, const ParallelPolicy& policy = ParallelPolicy()) {
+		typedef typename Checksum::value_type value_type;
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(buf.begin());
+		size_t size = buf.size() * sizeof(_Ty);
+		std::vector<std::pair<value_type, size_t> > parts(size >= policy.threshold ? policy.thread_pool().concurrency() : 1);
+		size_t count = buffer_internal::ParallelFor(p, size, 1, policy, [p, &parts](size_t pos, size_t n, size_t index) {
+			parts[index] = std::make_pair(checksum<Checksum>(p + pos, n), n);
+		});
+		value_type rv = parts[0].first;
+		for (size_t i = 1; i < count; i++)
+			rv = Checksum::combine(rv, parts[i].first, parts[i].second);
+		return rv;
+	}
+
+	// 按照_SrcTy的大小原地翻转字节序，用于整块的大小端转换
+	template<typename _SrcTy, typename _Ty, typename Continer>
+	void parallel_byte_swap(BufferT<_Ty, Continer>& buf, const ParallelPolicy& policy = ParallelPolicy()) {
+		static_assert(sizeof(_SrcTy) == 2 || sizeof(_SrcTy) == 4 || sizeof(_SrcTy) == 8, "byte swap requires 2/4/8 bytes type");
+		char* p = reinterpret_cast<char*>(buf.begin());
+		size_t size = buf.size() * sizeof(_Ty) / sizeof(_SrcTy) * sizeof(_SrcTy);
+		if (size == 0)
+			return;
+		buffer_internal::ParallelFor(p, size, sizeof(_SrcTy), policy, [p](size_t pos, size_t n, size_t) {
+			buffer_internal::ByteSwapArray<sizeof(_SrcTy)>::copy(p + pos, p + pos, n / sizeof(_SrcTy));
+		});
+	}
+
+} // namespace ftl
+
+#endif // FTL_PARALLEL_H_
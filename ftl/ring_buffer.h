@@ -0,0 +1,304 @@
+#ifndef FTL_RING_BUFFER_H_
+#define FTL_RING_BUFFER_H_
+
+#include <atomic>
+#include <thread>
+
+#include "buffer.h"
+
+/**
+	RingBufferT，固定容量、无锁的字节环形缓冲区，存储使用BufferT
+
+	模式：
+		MultiProducer = false  单生产者/单消费者(SPSC)
+		MultiProducer = true   多生产者/单消费者(MPSC)，生产者通过CAS预留空间，按照预留的顺序提交
+
+	写入：
+		write()/write_be()/write_le()一次写入全部数据，空间不足时返回false，不会写入一部分
+
+		byte_ring_buffer ring(4096);
+		ring.write_be(uint32_t(0x01020304));
+
+		// 零拷贝写入：预留空间 -> 直接填充 -> 提交，环绕时数据分为first/second两段
+		byte_ring_buffer::Region region = ring.reserve(16);
+		if (region.size() > 0) {
+			...
+			ring.commit(region);
+		}
+
+	读取：
+		只能有一个消费者，peek()返回可读的区域，consume()丢弃已经处理的数据
+
+		uint32_t value;
+		if (ring.read_be(value)) { ... }
+*/
+
+#ifndef FTL_CACHE_LINE_SIZE
+#define FTL_CACHE_LINE_SIZE 64
+#endif
+
+namespace ftl {
+
+	namespace buffer_internal {
+
+		// 独占一个cache line的索引，避免生产者和消费者之间的伪共享
+		template<typename T>
+		struct CacheLinePadded {
+			char pad0[FTL_CACHE_LINE_SIZE];
+			T value;
+			char pad1[FTL_CACHE_LINE_SIZE - sizeof(T) % FTL_CACHE_LINE_SIZE];
+
+			CacheLinePadded():
+				value() {
+			}
+		};
+
+	} // namespace buffer_internal
+
+	template<typename _Ty, bool MultiProducer = false, typename Buffer = BufferT<_Ty> >
+	class RingBufferT {
+	public:
+		typedef typename Buffer::value_type value_type;
+		typedef typename Buffer::pointer pointer;
+		typedef typename Buffer::const_pointer const_pointer;
+		typedef typename Buffer::size_type size_type;
+
+		/**
+			一段可能环绕的区域，second只有在环绕时才不为空
+		*/
+		template<typename _SpanTy>
+		struct RegionT {
+			BufferSpanT<_SpanTy> first;
+			BufferSpanT<_SpanTy> second;
+			size_type start;
+
+			RegionT():
+				start(0) {
+			}
+
+			size_type size() const {
+				return first.size() + second.size();
+			}
+
+			// 把buf复制到区域的offset位置
+			void copy_from(size_type offset, const _Ty* buf, size_type count) const {
+				size_type n = 0;
+				if (offset < first.size()) {
+					n = std::min<size_type>(count, first.size() - offset);
+					std::memcpy(first.begin() + offset, buf, n);
+					offset = 0;
+				} else {
+					offset -= first.size();
+				}
+				if (count > n)
+					std::memcpy(second.begin() + offset, buf + n, count - n);
+			}
+
+			// 从区域的offset位置复制到buf
+			void copy_to(size_type offset, _Ty* buf, size_type count) const {
+				size_type n = 0;
+				if (offset < first.size()) {
+					n = std::min<size_type>(count, first.size() - offset);
+					std::memcpy(buf, first.begin() + offset, n);
+					offset = 0;
+				} else {
+					offset -= first.size();
+				}
+				if (count > n)
+					std::memcpy(buf + n, second.begin() + offset, count - n);
+			}
+		};
+
+		typedef RegionT<_Ty> Region;
+		typedef RegionT<const _Ty> ConstRegion;
+
+		// capacity向上取整为2的幂
+		explicit RingBufferT(size_type capacity):
+			buffer_(round_capacity(capacity)),
+			mask_(buffer_.size() - 1),
+			data_(buffer_.begin()) {
+		}
+
+		inline size_type capacity() const {
+			return mask_ + 1;
+		}
+
+		// 当前可读的字节数
+		inline size_type size() const {
+			return tail_.value.load(std::memory_order_acquire) - head_.value.load(std::memory_order_acquire);
+		}
+
+		inline bool empty() const {
+			return size() == 0;
+		}
+
+		/////////////////////////////////////
+		// producer functions
+
+		// 预留count个字节，空间不足时返回空的区域
+		Region reserve(size_type count) {
+			Region region;
+			if (count == 0 || count > capacity())
+				return region;
+			size_type start;
+			if (MultiProducer) {
+				start = reserve_.value.load(std::memory_order_relaxed);
+				do {
+					if (count > capacity() - (start - head_.value.load(std::memory_order_acquire)))
+						return region;
+				} while (!reserve_.value.compare_exchange_weak(start, start + count,
+					std::memory_order_acq_rel, std::memory_order_relaxed));
+			} else {
+				start = tail_.value.load(std::memory_order_relaxed);
+				if (count > capacity() - (start - cached_head_.value)) {
+					cached_head_.value = head_.value.load(std::memory_order_acquire);
+					if (count > capacity() - (start - cached_head_.value))
+						return region;
+				}
+			}
+			return make_region<_Ty>(start, count);
+		}
+
+		// 预留最多max_count个字节，只能用于单生产者，配合commit(region, count)使用，例如直接recv到ring中
+		Region prepare(size_type max_count) {
+			static_assert(!MultiProducer, "prepare() only support single producer, call reserve()");
+			size_type start = tail_.value.load(std::memory_order_relaxed);
+			cached_head_.value = head_.value.load(std::memory_order_acquire);
+			size_type count = std::min<size_type>(max_count, capacity() - (start - cached_head_.value));
+			return make_region<_Ty>(start, count);
+		}
+
+		// 提交预留的区域，多生产者时按照预留的顺序提交，前面的生产者没有提交时会等待
+		void commit(const Region& region) {
+			commit(region, region.size());
+		}
+
+		void commit(const Region& region, size_type count) {
+			if (region.size() == 0)
+				return;
+			if (MultiProducer) {
+				size_type spins = 0;
+				while (tail_.value.load(std::memory_order_acquire) != region.start) {
+					if (++spins > 64)
+						std::this_thread::yield();
+				}
+				tail_.value.store(region.start + region.size(), std::memory_order_release);
+			} else {
+				tail_.value.store(region.start + std::min<size_type>(count, region.size()), std::memory_order_release);
+			}
+		}
+
+		// 写入全部数据，空间不足时返回false
+		bool write(const _Ty* buf, size_type count) {
+			Region region = reserve(count);
+			if (region.size() == 0)
+				return count == 0;
+			region.copy_from(0, buf, count);
+			commit(region);
+			return true;
+		}
+
+		template<typename _SrcTy, enum buffer_internal::Endian::Endianness endianness>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_SrcTy>::value, bool>::type
+			write(const _SrcTy& value) {
+			_Ty tmp[sizeof(_SrcTy)];
+			buffer_internal::Endian::write<_Ty, _SrcTy, endianness>(tmp, value);
+			return write(tmp, sizeof(_SrcTy));
+		}
+
+		template<typename _SrcTy>
+		inline bool write_be(const _SrcTy& value) {
+			return write<_SrcTy, buffer_internal::Endian::kBigEndian>(value);
+		}
+
+		template<typename _SrcTy>
+		inline bool write_le(const _SrcTy& value) {
+			return write<_SrcTy, buffer_internal::Endian::kLittleEndian>(value);
+		}
+
+		/////////////////////////////////////
+		// consumer functions
+
+		// 当前全部可读的区域
+		ConstRegion peek() const {
+			size_type start = head_.value.load(std::memory_order_relaxed);
+			size_type count = tail_.value.load(std::memory_order_acquire) - start;
+			return make_region<const _Ty>(start, count);
+		}
+
+		// 丢弃count个已经处理的字节
+		void consume(size_type count) {
+			size_type head = head_.value.load(std::memory_order_relaxed);
+			count = std::min<size_type>(count, tail_.value.load(std::memory_order_acquire) - head);
+			head_.value.store(head + count, std::memory_order_release);
+		}
+
+		// 读取count个字节，数据不足时返回false
+		bool read(_Ty* buf, size_type count) {
+			ConstRegion region = peek();
+			if (region.size() < count)
+				return false;
+			region.copy_to(0, buf, count);
+			consume(count);
+			return true;
+		}
+
+		template<typename _RetTy, enum buffer_internal::Endian::Endianness endianness>
+		inline typename std::enable_if<buffer_internal::is_endian_basictype<_RetTy>::value, bool>::type
+			read(_RetTy& value) {
+			_Ty tmp[sizeof(_RetTy)];
+			if (!read(tmp, sizeof(_RetTy)))
+				return false;
+			value = buffer_internal::Endian::read<_Ty, _RetTy, endianness>(tmp);
+			return true;
+		}
+
+		template<typename _RetTy>
+		inline bool read_be(_RetTy& value) {
+			return read<_RetTy, buffer_internal::Endian::kBigEndian>(value);
+		}
+
+		template<typename _RetTy>
+		inline bool read_le(_RetTy& value) {
+			return read<_RetTy, buffer_internal::Endian::kLittleEndian>(value);
+		}
+
+	private:
+		Buffer buffer_;
+		size_type mask_;
+		pointer data_;
+
+		buffer_internal::CacheLinePadded<std::atomic<size_type> > head_;	// 消费者读取位置
+		buffer_internal::CacheLinePadded<std::atomic<size_type> > tail_;	// 已提交的写入位置
+		buffer_internal::CacheLinePadded<std::atomic<size_type> > reserve_;	// 多生产者已预留的位置
+		buffer_internal::CacheLinePadded<size_type> cached_head_;			// 单生产者缓存的head_
+
+		RingBufferT(const RingBufferT&);
+		RingBufferT& operator=(const RingBufferT&);
+
+		static size_type round_capacity(size_type capacity) {
+			size_type rv = 1;
+			while (rv < capacity)
+				rv <<= 1;
+			return rv;
+		}
+
+		template<typename _SpanTy>
+		inline RegionT<_SpanTy> make_region(size_type start, size_type count) const {
+			RegionT<_SpanTy> region;
+			region.start = start;
+			size_type offset = start & mask_;
+			size_type n = std::min<size_type>(count, capacity() - offset);
+			region.first = BufferSpanT<_SpanTy>(data_ + offset, n);
+			if (count > n)
+				region.second = BufferSpanT<_SpanTy>(data_, count - n);
+			return region;
+		}
+	};
+
+	typedef RingBufferT<uint8_t> byte_ring_buffer;
+	typedef RingBufferT<uint8_t, true> mpsc_byte_ring_buffer;
+
+} // namespace ftl
+
+#endif // FTL_RING_BUFFER_H_
@@ -0,0 +1,509 @@
+#ifndef FTL_SLAB_ALLOCATOR_H_
+#define FTL_SLAB_ALLOCATOR_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdlib>
+
+#include "buffer.h"
+#include "thread_cache.h"
+
+/**
+	SlabAllocator，按尺寸分级的slab/arena分配器，可以直接作为SimpleBufferT的_Alloc参数
+
+	分级：
+		32/64/128/.../16K字节，共10级，和SimpleBufferT的倍增策略一致，
+		同一级别内的reallocate不需要移动数据；大于16K的请求直接走malloc/realloc
+
+	分配：
+		每个线程有一个本地的空闲链表(ThreadCache)，分配/释放优先走本地链表，不需要加锁，
+		本地链表为空或者过长时，才批量和SlabArena交换；统计计数同样在线程本地，stats()时汇总，
+		峰值在批量交换、large分配和stats()时采样
+
+		slab_byte_buffer buffer(32, 0);
+		SlabArena::Stats stats = DefaultSlabArena::instance().stats();
+
+	重置：
+		SlabArena::reset()一次性释放该arena的所有chunk，调用前必须保证该arena分配出去的buffer都已经释放，
+		各线程本地链表中缓存的块会在下次访问时自动丢弃
+*/
+
+namespace ftl {
+
+	namespace buffer_internal {
+
+		class SlabArena {
+		public:
+			static const size_t CHUNK_SIZE = 64 * 1024;
+			static const size_t MIN_SLAB_SIZE = 32;
+			static const size_t MAX_SLAB_SIZE = 16 * 1024;
+			static const unsigned int CLASS_COUNT = 10;
+			static const uint32_t LARGE_CLASS = 0xffffffff;
+
+			struct Stats {
+				size_t chunk_bytes;		// 从系统申请的chunk总字节数
+				size_t large_bytes;		// 超过MAX_SLAB_SIZE，直接malloc的字节数
+				size_t in_use_bytes;	// 已经分配出去的slab块，按级别大小计算
+				size_t requested_bytes;	// 调用方实际请求的字节数(含large)
+				size_t peak_bytes;		// in_use_bytes + large_bytes 的峰值，在慢速路径和stats()时采样
+				size_t alloc_count;
+				size_t free_count;
+
+				// 内部碎片：slab块中没有被请求使用的比例
+				double internal_fragmentation() const {
+					size_t small_requested = requested_bytes - large_bytes;
+					return in_use_bytes == 0 ? 0.0 : 1.0 - (double)small_requested / in_use_bytes;
+				}
+
+				// 外部碎片：chunk中没有分配出去的比例(空闲链表 + 未切分的尾部)
+				double external_fragmentation() const {
+					return chunk_bytes == 0 ? 0.0 : 1.0 - (double)in_use_bytes / chunk_bytes;
+				}
+			};
+
+			struct BlockHeader {
+				uint32_t size_class;
+				uint32_t epoch;
+				uint64_t size;	// 请求的字节数
+			};
+
+			typedef buffer_internal::FreeNode FreeNode;
+
+			// 统计计数的下标，每个SlabThreadCache一份Counters
+			enum Counter {
+				kLargeBytes,
+				kInUseBytes,
+				kRequestedBytes,
+				kAllocCount,
+				kFreeCount,
+				kCounterCount
+			};
+			typedef ThreadStatsT<kCounterCount> Counters;
+
+			SlabArena():
+				free_lists_(),
+				chunk_cur_(nullptr),
+				chunk_end_(nullptr),
+				epoch_(1),
+				chunk_bytes_(0),
+				peak_bytes_(0) {
+				registry_.attach(&shared_);
+			}
+
+			~SlabArena() {
+				registry_.detach(&shared_);
+				release_chunks();
+			}
+
+			static inline unsigned int size_class(size_t size) {
+				unsigned int cls = 0;
+				while ((MIN_SLAB_SIZE << cls) < size)
+					++cls;
+				return cls;
+			}
+
+			static inline size_t class_size(unsigned int cls) {
+				return MIN_SLAB_SIZE << cls;
+			}
+
+			static inline BlockHeader* header(void* p) {
+				return reinterpret_cast<BlockHeader*>(p) - 1;
+			}
+
+			uint32_t epoch() const {
+				return epoch_.load(std::memory_order_acquire);
+			}
+
+			// 线程缓存的计数，线程缓存创建/销毁时调用
+			void attach(Counters* counters) {
+				registry_.attach(counters);
+			}
+
+			void detach(Counters* counters) {
+				registry_.detach(counters);
+			}
+
+			// 从空闲链表或者chunk中取出一个块，返回的块未设置header
+			FreeNode* acquire(unsigned int cls) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				return acquire_locked(cls);
+			}
+
+			// 批量取出count个块，串成链表返回，线程缓存的慢速路径，同时采样峰值
+			FreeNode* acquire_batch(unsigned int cls, unsigned int count) {
+				FreeNode* head = nullptr;
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					for (unsigned int i = 0; i < count; i++) {
+						FreeNode* node = acquire_locked(cls);
+						if (!node)
+							break;
+						node->next = head;
+						head = node;
+					}
+				}
+				sample_peak();
+				return head;
+			}
+
+			// 归还一条链表，last为链表尾部
+			void release_batch(unsigned int cls, FreeNode* head, FreeNode* last, uint32_t epoch) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (epoch != epoch_.load(std::memory_order_relaxed))
+					return;
+				last->next = free_lists_[cls];
+				free_lists_[cls] = head;
+			}
+
+			/////////////////////////////////////
+			// 不经过线程缓存的分配，计数使用arena共享的一份，加锁修改
+
+			void* allocate(size_t size) {
+				std::lock_guard<std::mutex> lock(shared_mutex_);
+				if (size > MAX_SLAB_SIZE)
+					return allocate_large(size, shared_);
+				unsigned int cls = size_class(size);
+				FreeNode* node = acquire(cls);
+				if (!node)
+					return nullptr;
+				void* rv = on_allocated(node, cls, size, shared_);
+				sample_peak();
+				return rv;
+			}
+
+			void deallocate(void* p) {
+				if (!p)
+					return;
+				std::lock_guard<std::mutex> lock(shared_mutex_);
+				BlockHeader* h = header(p);
+				if (h->size_class == LARGE_CLASS) {
+					deallocate_large(h, shared_);
+					return;
+				}
+				unsigned int cls = h->size_class;
+				uint32_t epoch = h->epoch;
+				if (!on_deallocated(h, shared_))
+					return;
+				FreeNode* node = reinterpret_cast<FreeNode*>(h);
+				release_batch(cls, node, node, epoch);
+			}
+
+			void* reallocate(void* p, size_t size) {
+				if (!p)
+					return allocate(size);
+				BlockHeader* h = header(p);
+				if (h->size_class == LARGE_CLASS && size > MAX_SLAB_SIZE) {
+					std::lock_guard<std::mutex> lock(shared_mutex_);
+					return reallocate_large(h, size, shared_);
+				}
+				if (h->size_class != LARGE_CLASS && size <= class_size(h->size_class)) {
+					std::lock_guard<std::mutex> lock(shared_mutex_);
+					resize_block(h, size, shared_);
+					return p;
+				}
+				void* np = allocate(size);
+				if (np) {
+					std::memcpy(np, p, std::min<size_t>((size_t)h->size, size));
+					deallocate(p);
+				}
+				return np;
+			}
+
+			/////////////////////////////////////
+			// 以下由线程缓存调用，只维护统计和header，不涉及链表，counters是调用线程自己的计数
+
+			inline void* on_allocated(FreeNode* node, unsigned int cls, size_t size, Counters& counters) {
+				BlockHeader* h = reinterpret_cast<BlockHeader*>(node);
+				h->size_class = cls;
+				h->epoch = epoch();
+				h->size = size;
+				counters.add(kInUseBytes, class_size(cls));
+				counters.add(kRequestedBytes, size);
+				counters.add(kAllocCount, 1);
+				return h + 1;
+			}
+
+			// 返回false表示该块属于reset之前的epoch，不能再使用
+			inline bool on_deallocated(BlockHeader* h, Counters& counters) {
+				if (h->epoch != epoch())
+					return false;
+				counters.sub(kInUseBytes, class_size(h->size_class));
+				counters.sub(kRequestedBytes, (size_t)h->size);
+				counters.add(kFreeCount, 1);
+				return true;
+			}
+
+			inline void resize_block(BlockHeader* h, size_t size, Counters& counters) {
+				if (h->epoch == epoch()) {
+					counters.add(kRequestedBytes, size);
+					counters.sub(kRequestedBytes, (size_t)h->size);
+				}
+				h->size = size;
+			}
+
+			void* allocate_large(size_t size, Counters& counters) {
+				BlockHeader* h = reinterpret_cast<BlockHeader*>(::malloc(sizeof(BlockHeader) + size));
+				if (!h)
+					return nullptr;
+				h->size_class = LARGE_CLASS;
+				h->epoch = epoch();
+				h->size = size;
+				counters.add(kLargeBytes, size);
+				counters.add(kRequestedBytes, size);
+				counters.add(kAllocCount, 1);
+				sample_peak();
+				return h + 1;
+			}
+
+			void deallocate_large(BlockHeader* h, Counters& counters) {
+				if (h->epoch == epoch()) {
+					counters.sub(kLargeBytes, (size_t)h->size);
+					counters.sub(kRequestedBytes, (size_t)h->size);
+					counters.add(kFreeCount, 1);
+				}
+				::free(h);
+			}
+
+			void* reallocate_large(BlockHeader* h, size_t size, Counters& counters) {
+				size_t old_size = (size_t)h->size;
+				bool current = (h->epoch == epoch());
+				BlockHeader* nh = reinterpret_cast<BlockHeader*>(::realloc(h, sizeof(BlockHeader) + size));
+				if (!nh)
+					return nullptr;
+				if (!current) {
+					nh->epoch = epoch();
+				} else {
+					counters.sub(kLargeBytes, old_size);
+					counters.sub(kRequestedBytes, old_size);
+				}
+				counters.add(kLargeBytes, size);
+				counters.add(kRequestedBytes, size);
+				nh->size = size;
+				sample_peak();
+				return nh + 1;
+			}
+
+			// 释放所有chunk，清空统计，之前分配的slab块全部失效
+			void reset() {
+				std::lock_guard<std::mutex> lock(mutex_);
+				release_chunks();
+				epoch_.fetch_add(1, std::memory_order_release);
+				chunk_bytes_ = 0;
+				registry_.clear();
+				peak_bytes_.store(0, std::memory_order_relaxed);
+			}
+
+			Stats stats() const {
+				Stats s;
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					s.chunk_bytes = chunk_bytes_;
+				}
+				size_t values[kCounterCount];
+				registry_.sum(values);
+				s.large_bytes = values[kLargeBytes];
+				s.in_use_bytes = values[kInUseBytes];
+				s.requested_bytes = values[kRequestedBytes];
+				s.alloc_count = values[kAllocCount];
+				s.free_count = values[kFreeCount];
+				s.peak_bytes = update_peak(s.in_use_bytes + s.large_bytes);
+				return s;
+			}
+
+		private:
+			mutable std::mutex mutex_;
+			FreeNode* free_lists_[CLASS_COUNT];
+			std::vector<char*> chunks_;
+			char* chunk_cur_;
+			char* chunk_end_;
+			std::atomic<uint32_t> epoch_;
+			size_t chunk_bytes_;
+			mutable std::atomic<size_t> peak_bytes_;
+			StatsRegistryT<kCounterCount> registry_;
+			// 不经过线程缓存的分配使用的计数，由shared_mutex_保护
+			std::mutex shared_mutex_;
+			Counters shared_;
+
+			SlabArena(const SlabArena&);
+			SlabArena& operator=(const SlabArena&);
+
+			FreeNode* acquire_locked(unsigned int cls) {
+				FreeNode* node = free_lists_[cls];
+				if (node) {
+					free_lists_[cls] = node->next;
+					return node;
+				}
+
+				size_t block_size = sizeof(BlockHeader) + class_size(cls);
+				if (chunk_cur_ == nullptr || (size_t)(chunk_end_ - chunk_cur_) < block_size) {
+					char* chunk = reinterpret_cast<char*>(::malloc(CHUNK_SIZE));
+					if (!chunk)
+						return nullptr;
+					chunks_.push_back(chunk);
+					chunk_bytes_ += CHUNK_SIZE;
+					chunk_cur_ = chunk;
+					chunk_end_ = chunk + CHUNK_SIZE;
+				}
+				node = reinterpret_cast<FreeNode*>(chunk_cur_);
+				chunk_cur_ += block_size;
+				return node;
+			}
+
+			void release_chunks() {
+				for (size_t i = 0; i < chunks_.size(); i++)
+					::free(chunks_[i]);
+				chunks_.clear();
+				std::fill(free_lists_, free_lists_ + CLASS_COUNT, (FreeNode*)nullptr);
+				chunk_cur_ = chunk_end_ = nullptr;
+			}
+
+			// 汇总所有线程的计数更新峰值，只在慢速路径调用
+			void sample_peak() const {
+				size_t values[kCounterCount];
+				registry_.sum(values);
+				update_peak(values[kInUseBytes] + values[kLargeBytes]);
+			}
+
+			size_t update_peak(size_t value) const {
+				size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+				while (value > peak && !peak_bytes_.compare_exchange_weak(peak, value, std::memory_order_relaxed)) {
+				}
+				return std::max(peak, value);
+			}
+		};
+		/**
+			线程本地的空闲链表，每级最多缓存MAX_CACHED个块，超过后把一半归还给arena；
+			统计计数也在线程本地，分配/释放不修改arena共享的原子变量
+		*/
+		class SlabThreadCache {
+		public:
+			static const unsigned int MAX_CACHED = 64;
+			static const unsigned int REFILL_COUNT = 16;
+
+			explicit SlabThreadCache(SlabArena& arena):
+				arena_(arena),
+				epoch_(arena.epoch()) {
+				arena_.attach(&counters_);
+			}
+
+			~SlabThreadCache() {
+				if (check_epoch()) {
+					for (unsigned int cls = 0; cls < SlabArena::CLASS_COUNT; cls++)
+						flush(cls, (unsigned int)cache_.count(cls));
+				}
+				arena_.detach(&counters_);
+			}
+
+			inline void* allocate(size_t size) {
+				if (size > SlabArena::MAX_SLAB_SIZE)
+					return arena_.allocate_large(size, counters_);
+				check_epoch();
+				unsigned int cls = SlabArena::size_class(size);
+				SlabArena::FreeNode* node = cache_.pop(cls);
+				if (!node) {
+					SlabArena::FreeNode* batch = arena_.acquire_batch(cls, REFILL_COUNT);
+					if (!batch)
+						return nullptr;
+					cache_.push_list(cls, batch);
+					node = cache_.pop(cls);
+				}
+				return arena_.on_allocated(node, cls, size, counters_);
+			}
+
+			inline void deallocate(void* p) {
+				if (!p)
+					return;
+				SlabArena::BlockHeader* h = SlabArena::header(p);
+				if (h->size_class == SlabArena::LARGE_CLASS) {
+					arena_.deallocate_large(h, counters_);
+					return;
+				}
+				check_epoch();
+				unsigned int cls = h->size_class;
+				if (!arena_.on_deallocated(h, counters_))
+					return;
+				cache_.push(cls, reinterpret_cast<SlabArena::FreeNode*>(h));
+				if (cache_.count(cls) > MAX_CACHED)
+					flush(cls, MAX_CACHED / 2);
+			}
+
+			inline void* reallocate(void* p, size_t size) {
+				if (!p)
+					return allocate(size);
+				SlabArena::BlockHeader* h = SlabArena::header(p);
+				if (h->size_class == SlabArena::LARGE_CLASS) {
+					if (size > SlabArena::MAX_SLAB_SIZE)
+						return arena_.reallocate_large(h, size, counters_);
+				} else if (size <= SlabArena::class_size(h->size_class)) {
+					arena_.resize_block(h, size, counters_);
+					return p;
+				}
+				void* np = allocate(size);
+				if (np) {
+					std::memcpy(np, p, std::min<size_t>((size_t)h->size, size));
+					deallocate(p);
+				}
+				return np;
+			}
+
+		private:
+			SlabArena& arena_;
+			uint32_t epoch_;
+			FreeListCacheT<SlabArena::CLASS_COUNT> cache_;
+			SlabArena::Counters counters_;
+
+			// arena被reset之后，本地缓存的块已经失效，直接丢弃
+			inline bool check_epoch() {
+				uint32_t epoch = arena_.epoch();
+				if (epoch == epoch_)
+					return true;
+				cache_.clear();
+				epoch_ = epoch;
+				return false;
+			}
+
+			void flush(unsigned int cls, unsigned int count) {
+				SlabArena::FreeNode* head;
+				SlabArena::FreeNode* last;
+				if (cache_.take(cls, count, head, last) > 0)
+					arena_.release_batch(cls, head, last, epoch_);
+			}
+		};
+
+		// 默认的全局arena，自定义arena时提供同样的static instance()即可
+		struct DefaultSlabArena {
+			static SlabArena& instance() {
+				static SlabArena arena;
+				return arena;
+			}
+		};
+
+		template<typename T, typename Arena = DefaultSlabArena>
+		struct SlabAllocator {
+			T* allocate(size_t size) {
+				return reinterpret_cast<T*>(cache().allocate(size));
+			}
+
+			void deallocate(T* p) {
+				return cache().deallocate(p);
+			}
+
+			T* reallocate(T* p, size_t size) {
+				return reinterpret_cast<T*>(cache().reallocate(p, size));
+			}
+
+			static SlabThreadCache& cache() {
+				static thread_local SlabThreadCache thread_cache(Arena::instance());
+				return thread_cache;
+			}
+		};
+
+	} // namespace buffer_internal
+
+	typedef BufferT<uint8_t, buffer_internal::SimpleBufferT<uint8_t, buffer_internal::SlabAllocator<uint8_t> > > slab_byte_buffer;
+	typedef StreamBufferT<uint8_t, slab_byte_buffer> slab_byte_streambuffer;
+
+} // namespace ftl
+
+#endif // FTL_SLAB_ALLOCATOR_H_
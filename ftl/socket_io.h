@@ -0,0 +1,967 @@
+#ifndef FTL_SOCKET_IO_H_
+#define FTL_SOCKET_IO_H_
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <climits>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+// winsock2.h需要在windows.h之前，所以在其他ftl头文件之前包含
+#include <winsock2.h>
+#include <windows.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <time.h>
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define FTL_BUFFER_IO_URING
+#endif
+#endif
+#endif
+
+#include "buffer.h"
+
+/**
+	socket异步I/O适配器，recv直接写入StreamBufferT的可写区域(write_index之后)，send直接发送可读区域(read_index之后)，
+	不经过临时数组
+
+	StreamBufferT使用kGrowableWrite，recv时prepare(max)，完成后commit实际收到的字节数，send完成后read_index前进；
+	kFixedWrite的stream不能recv(抛出std::invalid_argument)，否则没有写入的部分也会作为可读的数据发送出去；
+	操作完成之前stream必须有效，并且不能读写stream
+
+	结果：
+		回调参数result >= 0为传输的字节数，recv返回0表示对端关闭，
+		< 0为错误码取负，Linux为errno，Windows为WSAGetLastError()
+
+	同步：
+		SocketIo::recv_some(fd, stream, 4096);
+		SocketIo::send_some(fd, stream);
+
+	异步：
+		EpollLoop      Linux，就绪通知，fd需要设置为非阻塞
+		IoUringLoop    Linux 5.1+，提交recv/send，register_buffer()之后落在注册区域内的操作使用READ_FIXED/WRITE_FIXED
+		IocpLoop       Windows，WSARecv/WSASend + 完成端口，socket需要先associate()
+
+		byte_streambuffer input(byte_streambuffer::kGrowableWrite);
+		IoLoop loop;
+		loop.async_recv(fd, input, 4096, [&](int result) {
+			if (result > 0)
+				parse(input);
+		});
+		while (running)
+			loop.run_once(100);
+
+	回调都在run_once()中调用，async_recv/async_send不会直接调用回调，回调中可以再次提交操作；
+	同一个fd同时最多一个recv和一个send，recv和send使用不同的stream
+*/
+
+namespace ftl {
+
+#ifdef _WIN32
+	typedef SOCKET socket_type;
+#else
+	typedef int socket_type;
+#endif
+
+	// result >= 0为字节数，< 0为错误码取负
+	typedef std::function<void(int result)> IoCallback;
+
+	namespace buffer_internal {
+
+		inline int LastSocketError() {
+#ifdef _WIN32
+			return ::WSAGetLastError();
+#else
+			return errno;
+#endif
+		}
+
+		inline bool WouldBlock(int error) {
+#ifdef _WIN32
+			return error == WSAEWOULDBLOCK;
+#else
+			return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+		}
+
+		// StreamBufferT的可读/可写区域，字节流才能直接传给socket
+		template<typename Stream>
+		struct StreamRegion {
+			typedef typename Stream::value_type value_type;
+			static_assert(sizeof(value_type) == 1, "socket io requires 8bit stream");
+
+			// [write_index, write_index + max)，buffer的size()需要跟随write_index，只支持kGrowableWrite
+			static inline BufferSpanT<value_type> writable(Stream& stream, size_t max) {
+				if (stream.write_mode() != Stream::kGrowableWrite)
+					throw std::invalid_argument("socket recv requires kGrowableWrite stream");
+				return stream.prepare(max);
+			}
+
+			// stream当前的整块存储[begin, begin + capacity)，重新分配之后地址或者大小改变
+			static inline BufferSpanT<const value_type> storage(const Stream& stream) {
+				return BufferSpanT<const value_type>(stream.buf().continer().begin(), stream.buf().capacity());
+			}
+
+			// [read_index, data_end())，不包括进行中的recv预留的空间
+			static inline BufferSpanT<const value_type> readable(const Stream& stream) {
+				size_t size = stream.data_end();
+				size_t pos = std::min<size_t>(stream.read_index(), size);
+				return BufferSpanT<const value_type>(stream.buf().continer().begin() + pos, size - pos);
+			}
+
+			static inline void received(Stream& stream, int result) {
+				stream.commit(result > 0 ? (size_t)result : 0);
+			}
+
+			static inline void sent(Stream& stream, int result) {
+				if (result > 0)
+					stream.read_span((size_t)result);
+			}
+		};
+
+		// 等待完成的操作，实现在回调中更新stream之后调用用户的回调
+		struct SocketOp {
+#ifdef _WIN32
+			OVERLAPPED overlapped;
+#endif
+			socket_type fd;
+			bool recv;
+			void* data;
+			size_t size;
+			const void* owner;					// 所属的stream
+			BufferSpanT<const uint8_t> storage;	// 提交时stream的整块存储，IoUringLoop用来判断注册是否仍然有效
+			std::function<int()> attempt;		// EpollLoop：就绪之后执行的同步操作
+			std::function<void(int)> done;		// 更新stream，调用用户的回调
+
+			SocketOp(socket_type fd, bool recv, void* data, size_t size):
+				fd(fd),
+				recv(recv),
+				data(data),
+				size(size),
+				owner(nullptr) {
+#ifdef _WIN32
+				std::memset(&overlapped, 0, sizeof(overlapped));
+#endif
+			}
+		};
+
+		template<typename Stream>
+		inline SocketOp* MakeRecvOp(socket_type fd, Stream& stream, size_t max, const IoCallback& callback) {
+			BufferSpanT<typename Stream::value_type> region = StreamRegion<Stream>::writable(stream, max);
+			SocketOp* op = new SocketOp(fd, true, region.begin(), region.size());
+			op->owner = &stream;
+			op->storage = StreamRegion<Stream>::storage(stream);
+			Stream* s = &stream;
+			op->done = [s, callback](int result) {
+				StreamRegion<Stream>::received(*s, result);
+				if (callback)
+					callback(result);
+			};
+			return op;
+		}
+
+		template<typename Stream>
+		inline SocketOp* MakeSendOp(socket_type fd, Stream& stream, const IoCallback& callback) {
+			BufferSpanT<const typename Stream::value_type> region = StreamRegion<Stream>::readable(stream);
+			SocketOp* op = new SocketOp(fd, false, const_cast<typename Stream::value_type*>(region.begin()), region.size());
+			op->owner = &stream;
+			op->storage = StreamRegion<Stream>::storage(stream);
+			Stream* s = &stream;
+			op->done = [s, callback](int result) {
+				StreamRegion<Stream>::sent(*s, result);
+				if (callback)
+					callback(result);
+			};
+			return op;
+		}
+
+	} // namespace buffer_internal
+
+	/**
+		同步的recv/send，非阻塞socket没有数据时返回-EAGAIN(-WSAEWOULDBLOCK)
+	*/
+	struct SocketIo {
+		static int recv(socket_type fd, void* data, size_t size) {
+			for (;;) {
+#ifdef _WIN32
+				int n = ::recv(fd, reinterpret_cast<char*>(data), (int)std::min<size_t>(size, INT_MAX), 0);
+#else
+				ssize_t n = ::recv(fd, data, size, 0);
+#endif
+				if (n >= 0)
+					return (int)n;
+				int error = buffer_internal::LastSocketError();
+#ifndef _WIN32
+				if (error == EINTR)
+					continue;
+#endif
+				return -error;
+			}
+		}
+
+		static int send(socket_type fd, const void* data, size_t size) {
+			for (;;) {
+#ifdef _WIN32
+				int n = ::send(fd, reinterpret_cast<const char*>(data), (int)std::min<size_t>(size, INT_MAX), 0);
+#elif defined(MSG_NOSIGNAL)
+				ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+#else
+				ssize_t n = ::send(fd, data, size, 0);
+#endif
+				if (n >= 0)
+					return (int)n;
+				int error = buffer_internal::LastSocketError();
+#ifndef _WIN32
+				if (error == EINTR)
+					continue;
+#endif
+				return -error;
+			}
+		}
+
+		// 最多接收max个字节到stream的可写区域
+		template<typename Stream>
+		static int recv_some(socket_type fd, Stream& stream, size_t max) {
+			BufferSpanT<typename Stream::value_type> region = buffer_internal::StreamRegion<Stream>::writable(stream, max);
+			int result = recv(fd, region.begin(), region.size());
+			buffer_internal::StreamRegion<Stream>::received(stream, result);
+			return result;
+		}
+
+		// 发送stream的可读区域，返回实际发送的字节数
+		template<typename Stream>
+		static int send_some(socket_type fd, Stream& stream) {
+			BufferSpanT<const typename Stream::value_type> region = buffer_internal::StreamRegion<Stream>::readable(stream);
+			int result = send(fd, region.begin(), region.size());
+			buffer_internal::StreamRegion<Stream>::sent(stream, result);
+			return result;
+		}
+	};
+
+#if defined(__linux__)
+
+	/**
+		EpollLoop，fd就绪之后执行recv/send，提交时先尝试一次，没有数据才注册EPOLLIN/EPOLLOUT
+	*/
+	class EpollLoop {
+	public:
+		EpollLoop():
+			epfd_(::epoll_create1(EPOLL_CLOEXEC)) {
+			if (epfd_ < 0)
+				throw std::system_error(errno, std::generic_category(), "EpollLoop epoll_create1");
+		}
+
+		~EpollLoop() {
+			for (size_t i = 0; i < ready_.size(); i++)
+				delete ready_[i].first;
+			for (std::unordered_map<int, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+				delete it->second.recv;
+				delete it->second.send;
+			}
+			::close(epfd_);
+		}
+
+		template<typename Stream>
+		void async_recv(socket_type fd, Stream& stream, size_t max, const IoCallback& callback) {
+			buffer_internal::SocketOp* op = buffer_internal::MakeRecvOp(fd, stream, max, callback);
+			op->attempt = [op]() { return SocketIo::recv(op->fd, op->data, op->size); };
+			submit(op);
+		}
+
+		template<typename Stream>
+		void async_send(socket_type fd, Stream& stream, const IoCallback& callback) {
+			buffer_internal::SocketOp* op = buffer_internal::MakeSendOp(fd, stream, callback);
+			op->attempt = [op]() { return SocketIo::send(op->fd, op->data, op->size); };
+			submit(op);
+		}
+
+		// 取消fd上等待的操作，回调在下一次run_once()时以-ECANCELED调用
+		void cancel(socket_type fd) {
+			std::unordered_map<int, Entry>::iterator it = entries_.find(fd);
+			if (it == entries_.end())
+				return;
+			if (it->second.recv)
+				ready_.push_back(std::make_pair(it->second.recv, -ECANCELED));
+			if (it->second.send)
+				ready_.push_back(std::make_pair(it->second.send, -ECANCELED));
+			if (it->second.events)
+				::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+			entries_.erase(it);
+		}
+
+		// 等待最多timeout_ms毫秒(-1一直等待)，返回完成的操作数
+		size_t run_once(int timeout_ms = -1) {
+			if (ready_.empty() && !entries_.empty()) {
+				epoll_event events[64];
+				int n = ::epoll_wait(epfd_, events, 64, timeout_ms);
+				for (int i = 0; i < n; i++)
+					on_event(events[i].data.fd, events[i].events);
+			}
+			return complete_ready();
+		}
+
+		// 等待中的操作数
+		size_t pending() const {
+			size_t rv = ready_.size();
+			for (std::unordered_map<int, Entry>::const_iterator it = entries_.begin(); it != entries_.end(); ++it)
+				rv += (it->second.recv ? 1 : 0) + (it->second.send ? 1 : 0);
+			return rv;
+		}
+
+	private:
+		struct Entry {
+			buffer_internal::SocketOp* recv;
+			buffer_internal::SocketOp* send;
+			uint32_t events;	// 已经注册的事件
+
+			Entry():
+				recv(nullptr),
+				send(nullptr),
+				events(0) {
+			}
+		};
+
+		int epfd_;
+		std::unordered_map<int, Entry> entries_;
+		std::vector<std::pair<buffer_internal::SocketOp*, int> > ready_;
+
+		void submit(buffer_internal::SocketOp* op) {
+			Entry& entry = entries_[op->fd];
+			buffer_internal::SocketOp*& slot = (op->recv ? entry.recv : entry.send);
+			if (slot) {
+				ready_.push_back(std::make_pair(op, -EBUSY));
+				return;
+			}
+			int result = op->attempt();
+			if (!buffer_internal::WouldBlock(-result)) {
+				ready_.push_back(std::make_pair(op, result));
+				update(op->fd, entry);
+				return;
+			}
+			slot = op;
+			update(op->fd, entry);
+		}
+
+		void on_event(int fd, uint32_t events) {
+			std::unordered_map<int, Entry>::iterator it = entries_.find(fd);
+			if (it == entries_.end())
+				return;
+			Entry& entry = it->second;
+			bool error = (events & (EPOLLERR | EPOLLHUP)) != 0;
+			if (entry.recv && (error || (events & EPOLLIN)))
+				retry(entry.recv);
+			if (entry.send && (error || (events & EPOLLOUT)))
+				retry(entry.send);
+			update(fd, entry);
+		}
+
+		void retry(buffer_internal::SocketOp*& slot) {
+			int result = slot->attempt();
+			if (buffer_internal::WouldBlock(-result))
+				return;
+			ready_.push_back(std::make_pair(slot, result));
+			slot = nullptr;
+		}
+
+		// 按照等待的操作修改注册的事件，没有等待的操作时删除
+		void update(int fd, Entry& entry) {
+			uint32_t events = (entry.recv ? (uint32_t)EPOLLIN : 0) | (entry.send ? (uint32_t)EPOLLOUT : 0);
+			if (events == entry.events) {
+				if (!events)
+					entries_.erase(fd);
+				return;
+			}
+			epoll_event ev;
+			std::memset(&ev, 0, sizeof(ev));
+			ev.events = events;
+			ev.data.fd = fd;
+			if (!events) {
+				::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+				entries_.erase(fd);
+				return;
+			}
+			if (::epoll_ctl(epfd_, entry.events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) != 0) {
+				// 注册失败的操作直接以错误完成
+				int error = errno;
+				if (entry.recv)
+					ready_.push_back(std::make_pair(entry.recv, -error));
+				if (entry.send)
+					ready_.push_back(std::make_pair(entry.send, -error));
+				if (entry.events)
+					::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+				entries_.erase(fd);
+				return;
+			}
+			entry.events = events;
+		}
+
+		size_t complete_ready() {
+			std::vector<std::pair<buffer_internal::SocketOp*, int> > ready;
+			ready.swap(ready_);
+			for (size_t i = 0; i < ready.size(); i++) {
+				std::unique_ptr<buffer_internal::SocketOp> op(ready[i].first);
+				op->done(ready[i].second);
+			}
+			return ready.size();
+		}
+
+		EpollLoop(const EpollLoop&);
+		EpollLoop& operator=(const EpollLoop&);
+	};
+
+	typedef EpollLoop IoLoop;
+
+#endif // __linux__
+
+#if defined(FTL_BUFFER_IO_URING)
+
+	/**
+		IoUringLoop，直接使用io_uring系统调用，不依赖liburing
+
+		注册缓冲区：
+			register_buffer(stream)把stream当前的[begin, begin + capacity)注册给内核，
+			之后这个stream的recv/send使用IORING_OP_READ_FIXED/WRITE_FIXED，省去每次操作时的页面映射；
+			注册属于stream对象和注册时的存储(地址和容量)，其他stream即使复用了同样的地址也不会使用这个注册；
+			stream重新分配之后注册失效，操作使用普通的IORING_OP_RECV/SEND，没有使用注册缓冲区的操作在执行时，
+			失效的注册从内核中注销，所以注册之前先reserve足够的容量；stream析构之前调用unregister_buffer()
+
+		超时：
+			内核支持IORING_FEAT_EXT_ARG(5.11+)时run_once()的超时通过io_uring_enter传入，
+			否则提交一个IORING_OP_TIMEOUT，超时的完成事件不会传给调用者
+
+		内核不支持io_uring时构造函数抛出std::system_error，可以回退到EpollLoop
+	*/
+	class IoUringLoop {
+	public:
+		explicit IoUringLoop(unsigned int entries = 256):
+			ring_fd_(-1),
+			sq_ring_(nullptr),
+			cq_ring_(nullptr),
+			sqes_(nullptr),
+			sq_ring_size_(0),
+			cq_ring_size_(0),
+			to_submit_(0),
+			last_fixed_(false),
+			stale_(false) {
+			std::memset(&params_, 0, sizeof(params_));
+			ring_fd_ = (int)::syscall(__NR_io_uring_setup, entries, &params_);
+			if (ring_fd_ < 0)
+				throw std::system_error(errno, std::generic_category(), "IoUringLoop io_uring_setup");
+			if (!map_rings()) {
+				int error = errno;
+				unmap_rings();
+				::close(ring_fd_);
+				throw std::system_error(error, std::generic_category(), "IoUringLoop mmap");
+			}
+		}
+
+		~IoUringLoop() {
+			unmap_rings();
+			::close(ring_fd_);
+			for (std::unordered_set<buffer_internal::SocketOp*>::iterator it = inflight_.begin(); it != inflight_.end(); ++it)
+				delete *it;
+			for (size_t i = 0; i < ready_.size(); i++)
+				delete ready_[i].first;
+		}
+
+		template<typename Stream>
+		void async_recv(socket_type fd, Stream& stream, size_t max, const IoCallback& callback) {
+			submit(buffer_internal::MakeRecvOp(fd, stream, max, callback));
+		}
+
+		template<typename Stream>
+		void async_send(socket_type fd, Stream& stream, const IoCallback& callback) {
+			submit(buffer_internal::MakeSendOp(fd, stream, callback));
+		}
+
+		/**
+			注册stream当前的存储，返回注册的序号，序号在注销其他注册之后可能改变；所有注册的区域一起提交给内核，
+			同一个stream再次注册时替换原来的注册，失败时抛出std::system_error
+		*/
+		template<typename Stream>
+		size_t register_buffer(const Stream& stream) {
+			BufferSpanT<const typename Stream::value_type> storage = buffer_internal::StreamRegion<Stream>::storage(stream);
+			if (!storage.begin() || !storage.size())
+				throw std::invalid_argument("IoUringLoop register_buffer empty stream");
+			if (!fixed_ops_.empty())
+				throw std::logic_error("IoUringLoop register_buffer with fixed operations in flight");
+			Registration r;
+			r.owner = &stream;
+			r.base = storage.begin();
+			r.length = storage.size();
+			std::vector<Registration> registrations;
+			for (size_t i = 0; i < registrations_.size(); i++) {
+				if (registrations_[i].owner != r.owner && !registrations_[i].stale)
+					registrations.push_back(registrations_[i]);
+			}
+			registrations.push_back(r);
+			apply_buffers(registrations);
+			return registrations_.size() - 1;
+		}
+
+		// 注销stream的注册，使用这个注册的操作完成之后生效
+		template<typename Stream>
+		void unregister_buffer(const Stream& stream) {
+			for (size_t i = 0; i < registrations_.size(); i++) {
+				if (registrations_[i].owner == &stream)
+					mark_stale(registrations_[i]);
+			}
+			flush_stale();
+		}
+
+		void unregister_buffers() {
+			if (registrations_.empty())
+				return;
+			if (!fixed_ops_.empty()) {
+				for (size_t i = 0; i < registrations_.size(); i++)
+					mark_stale(registrations_[i]);
+				return;
+			}
+			::syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+			registrations_.clear();
+			stale_ = false;
+		}
+
+		// 仍然有效的注册数
+		size_t registered_count() const {
+			size_t rv = 0;
+			for (size_t i = 0; i < registrations_.size(); i++) {
+				if (!registrations_[i].stale)
+					rv++;
+			}
+			return rv;
+		}
+
+		// 提交并等待最多timeout_ms毫秒(-1一直等待)，返回完成的操作数
+		size_t run_once(int timeout_ms = -1) {
+			if (ready_.empty() && (to_submit_ > 0 || !inflight_.empty())) {
+				bool wait = timeout_ms != 0 && cq_ready() == 0 && !inflight_.empty();
+				enter(wait, timeout_ms);
+				reap();
+			}
+			std::vector<std::pair<buffer_internal::SocketOp*, int> > ready;
+			ready.swap(ready_);
+			for (size_t i = 0; i < ready.size(); i++) {
+				std::unique_ptr<buffer_internal::SocketOp> op(ready[i].first);
+				op->done(ready[i].second);
+			}
+			return ready.size();
+		}
+
+		size_t pending() const {
+			return inflight_.size() + ready_.size();
+		}
+
+		// 最近一次提交的操作是否使用了注册的缓冲区
+		bool last_fixed() const {
+			return last_fixed_;
+		}
+
+	private:
+		int ring_fd_;
+		io_uring_params params_;
+		void* sq_ring_;
+		void* cq_ring_;
+		io_uring_sqe* sqes_;
+		size_t sq_ring_size_;
+		size_t cq_ring_size_;
+		unsigned int to_submit_;
+		bool last_fixed_;
+
+		// 一个注册的缓冲区，下标和内核中的buf_index相同
+		struct Registration {
+			const void* owner;
+			const void* base;
+			size_t length;
+			bool stale;		// stream已经重新分配或者被注销，等待从内核中注销
+
+			Registration():
+				owner(nullptr),
+				base(nullptr),
+				length(0),
+				stale(false) {
+			}
+		};
+
+		std::vector<Registration> registrations_;
+		bool stale_;
+		std::unordered_set<buffer_internal::SocketOp*> inflight_;
+		std::unordered_set<buffer_internal::SocketOp*> fixed_ops_;		// 使用注册缓冲区的操作，不为空时不能修改内核中的注册
+		std::vector<std::pair<buffer_internal::SocketOp*, int> > ready_;
+		__kernel_timespec timeout_ts_;
+
+		// IORING_OP_TIMEOUT的user_data，操作的指针不会为0
+		static const uint64_t TIMEOUT_USER_DATA = 0;
+
+		unsigned int* sq_field(uint32_t offset) const {
+			return reinterpret_cast<unsigned int*>(reinterpret_cast<uint8_t*>(sq_ring_) + offset);
+		}
+
+		unsigned int* cq_field(uint32_t offset) const {
+			return reinterpret_cast<unsigned int*>(reinterpret_cast<uint8_t*>(cq_ring_) + offset);
+		}
+
+		bool map_rings() {
+			sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned int);
+			cq_ring_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+			if (params_.features & IORING_FEAT_SINGLE_MMAP)
+				sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+			void* p = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+			if (p == MAP_FAILED)
+				return false;
+			sq_ring_ = p;
+			if (params_.features & IORING_FEAT_SINGLE_MMAP) {
+				cq_ring_ = sq_ring_;
+			} else {
+				p = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+				if (p == MAP_FAILED)
+					return false;
+				cq_ring_ = p;
+			}
+			p = ::mmap(nullptr, params_.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+			if (p == MAP_FAILED)
+				return false;
+			sqes_ = reinterpret_cast<io_uring_sqe*>(p);
+			return true;
+		}
+
+		void unmap_rings() {
+			if (sqes_)
+				::munmap(sqes_, params_.sq_entries * sizeof(io_uring_sqe));
+			if (cq_ring_ && cq_ring_ != sq_ring_)
+				::munmap(cq_ring_, cq_ring_size_);
+			if (sq_ring_)
+				::munmap(sq_ring_, sq_ring_size_);
+			sqes_ = nullptr;
+			sq_ring_ = cq_ring_ = nullptr;
+		}
+
+		// 只在没有使用注册缓冲区的操作时调用
+		void apply_buffers(const std::vector<Registration>& registrations) {
+			if (!registrations_.empty())
+				::syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+			registrations_.clear();
+			stale_ = false;
+			if (registrations.empty())
+				return;
+			std::vector<iovec> buffers(registrations.size());
+			for (size_t i = 0; i < registrations.size(); i++) {
+				buffers[i].iov_base = const_cast<void*>(registrations[i].base);
+				buffers[i].iov_len = registrations[i].length;
+			}
+			if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, &buffers.front(), (unsigned int)buffers.size()) != 0)
+				throw std::system_error(errno, std::generic_category(), "IoUringLoop register_buffer");
+			registrations_ = registrations;
+		}
+
+		void mark_stale(Registration& r) {
+			if (!r.stale) {
+				r.stale = true;
+				stale_ = true;
+			}
+		}
+
+		// 没有使用注册缓冲区的操作时，把失效的注册从内核中注销，其余的重新注册
+		void flush_stale() {
+			if (!stale_ || !fixed_ops_.empty())
+				return;
+			std::vector<Registration> registrations;
+			for (size_t i = 0; i < registrations_.size(); i++) {
+				if (!registrations_[i].stale)
+					registrations.push_back(registrations_[i]);
+			}
+			// 重新注册失败时全部使用普通的recv/send
+			try {
+				apply_buffers(registrations);
+			} catch (const std::system_error&) {
+			}
+		}
+
+		/**
+			op所属的stream的注册，注册之后stream重新分配(存储的地址或者容量改变)时注册失效，返回-1；
+			只有注册时的stream才能使用，释放之后被其他stream复用的地址不会匹配
+		*/
+		int fixed_index(const buffer_internal::SocketOp* op) {
+			for (size_t i = 0; i < registrations_.size(); i++) {
+				Registration& r = registrations_[i];
+				if (r.stale || r.owner != op->owner)
+					continue;
+				if (op->storage.begin() != r.base || op->storage.size() != r.length) {
+					mark_stale(r);
+					return -1;
+				}
+				const uint8_t* p = reinterpret_cast<const uint8_t*>(op->data);
+				const uint8_t* base = reinterpret_cast<const uint8_t*>(r.base);
+				if (p >= base && op->size <= r.length && (size_t)(p - base) <= r.length - op->size)
+					return (int)i;
+				return -1;
+			}
+			return -1;
+		}
+
+		io_uring_sqe* get_sqe() {
+			unsigned int mask = *sq_field(params_.sq_off.ring_mask);
+			unsigned int tail = *sq_field(params_.sq_off.tail);
+			unsigned int head = __atomic_load_n(sq_field(params_.sq_off.head), __ATOMIC_ACQUIRE);
+			if (tail - head >= params_.sq_entries) {
+				enter(false, 0);
+				head = __atomic_load_n(sq_field(params_.sq_off.head), __ATOMIC_ACQUIRE);
+				if (tail - head >= params_.sq_entries)
+					return nullptr;
+			}
+			io_uring_sqe* sqe = &sqes_[tail & mask];
+			std::memset(sqe, 0, sizeof(*sqe));
+			sq_field(params_.sq_off.array)[tail & mask] = tail & mask;
+			return sqe;
+		}
+
+		void push_sqe() {
+			unsigned int* tail = sq_field(params_.sq_off.tail);
+			__atomic_store_n(tail, *tail + 1, __ATOMIC_RELEASE);
+			to_submit_++;
+		}
+
+		void submit(buffer_internal::SocketOp* op) {
+			io_uring_sqe* sqe = get_sqe();
+			if (!sqe) {
+				ready_.push_back(std::make_pair(op, -EBUSY));
+				return;
+			}
+			int index = fixed_index(op);
+			last_fixed_ = index >= 0;
+			if (index >= 0) {
+				fixed_ops_.insert(op);
+				sqe->opcode = op->recv ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+				sqe->buf_index = (uint16_t)index;
+				// socket不能定位，偏移为-1表示当前位置
+				sqe->off = (uint64_t)-1;
+			} else {
+				sqe->opcode = op->recv ? IORING_OP_RECV : IORING_OP_SEND;
+#if defined(MSG_NOSIGNAL)
+				if (!op->recv)
+					sqe->msg_flags = MSG_NOSIGNAL;
+#endif
+			}
+			sqe->fd = op->fd;
+			sqe->addr = (uint64_t)(uintptr_t)op->data;
+			sqe->len = (uint32_t)std::min<size_t>(op->size, 0x7fffffff);
+			sqe->user_data = (uint64_t)(uintptr_t)op;
+			inflight_.insert(op);
+			push_sqe();
+			flush_stale();
+		}
+
+		unsigned int cq_ready() const {
+			unsigned int head = *cq_field(params_.cq_off.head);
+			unsigned int tail = __atomic_load_n(cq_field(params_.cq_off.tail), __ATOMIC_ACQUIRE);
+			return tail - head;
+		}
+
+		void enter(bool wait, int timeout_ms) {
+			bool ext_arg = false;
+#if defined(IORING_FEAT_EXT_ARG) && defined(IORING_ENTER_EXT_ARG)
+			ext_arg = (params_.features & IORING_FEAT_EXT_ARG) != 0;
+#endif
+			// 不支持EXT_ARG时提交一个超时操作，超时或者有其他操作完成时io_uring_enter返回
+			if (wait && timeout_ms > 0 && !ext_arg) {
+				io_uring_sqe* sqe = get_sqe();
+				if (!sqe) {
+					wait = false;
+				} else {
+					timeout_ts_.tv_sec = timeout_ms / 1000;
+					timeout_ts_.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+					sqe->opcode = IORING_OP_TIMEOUT;
+					sqe->fd = -1;
+					sqe->addr = (uint64_t)(uintptr_t)&timeout_ts_;
+					sqe->len = 1;
+					sqe->off = 0;
+					sqe->user_data = TIMEOUT_USER_DATA;
+					push_sqe();
+				}
+			}
+			for (;;) {
+				unsigned int flags = wait ? IORING_ENTER_GETEVENTS : 0;
+				void* arg = nullptr;
+				size_t arg_size = 0;
+#if defined(IORING_FEAT_EXT_ARG) && defined(IORING_ENTER_EXT_ARG)
+				__kernel_timespec ts;
+				io_uring_getevents_arg ext;
+				if (wait && timeout_ms > 0 && ext_arg) {
+					ts.tv_sec = timeout_ms / 1000;
+					ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+					std::memset(&ext, 0, sizeof(ext));
+					ext.sigmask_sz = _NSIG / 8;
+					ext.ts = (uint64_t)(uintptr_t)&ts;
+					flags |= IORING_ENTER_EXT_ARG;
+					arg = &ext;
+					arg_size = sizeof(ext);
+				}
+#endif
+				long n = ::syscall(__NR_io_uring_enter, ring_fd_, to_submit_, wait ? 1 : 0, flags, arg, arg_size);
+				if (n >= 0) {
+					to_submit_ -= std::min<unsigned int>(to_submit_, (unsigned int)n);
+					return;
+				}
+				if (errno == EINTR)
+					continue;
+				// ETIME为超时，EBUSY为完成队列满，先处理完成的操作
+				return;
+			}
+		}
+
+		void reap() {
+			unsigned int* head_ptr = cq_field(params_.cq_off.head);
+			unsigned int mask = *cq_field(params_.cq_off.ring_mask);
+			unsigned int head = *head_ptr;
+			unsigned int tail = __atomic_load_n(cq_field(params_.cq_off.tail), __ATOMIC_ACQUIRE);
+			io_uring_cqe* cqes = reinterpret_cast<io_uring_cqe*>(reinterpret_cast<uint8_t*>(cq_ring_) + params_.cq_off.cqes);
+			for (; head != tail; head++) {
+				const io_uring_cqe& cqe = cqes[head & mask];
+				if (cqe.user_data == TIMEOUT_USER_DATA)
+					continue;
+				buffer_internal::SocketOp* op = reinterpret_cast<buffer_internal::SocketOp*>((uintptr_t)cqe.user_data);
+				inflight_.erase(op);
+				fixed_ops_.erase(op);
+				ready_.push_back(std::make_pair(op, (int)cqe.res));
+			}
+			__atomic_store_n(head_ptr, head, __ATOMIC_RELEASE);
+			flush_stale();
+		}
+
+		IoUringLoop(const IoUringLoop&);
+		IoUringLoop& operator=(const IoUringLoop&);
+	};
+
+#endif // FTL_BUFFER_IO_URING
+
+#ifdef _WIN32
+
+	/**
+		IocpLoop，WSARecv/WSASend直接使用stream的区域，通过完成端口通知，
+		socket需要先associate()，关闭socket之后等待中的操作以错误完成
+	*/
+	class IocpLoop {
+	public:
+		IocpLoop():
+			port_(::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1)),
+			inflight_(0) {
+			if (!port_)
+				throw std::system_error((int)::GetLastError(), std::system_category(), "IocpLoop CreateIoCompletionPort");
+		}
+
+		~IocpLoop() {
+			for (size_t i = 0; i < ready_.size(); i++)
+				delete ready_[i].first;
+			::CloseHandle(port_);
+		}
+
+		// 把socket关联到完成端口，失败时抛出std::system_error
+		void associate(socket_type fd) {
+			if (!::CreateIoCompletionPort(reinterpret_cast<HANDLE>(fd), port_, 0, 0))
+				throw std::system_error((int)::GetLastError(), std::system_category(), "IocpLoop associate");
+		}
+
+		template<typename Stream>
+		void async_recv(socket_type fd, Stream& stream, size_t max, const IoCallback& callback) {
+			submit(buffer_internal::MakeRecvOp(fd, stream, max, callback));
+		}
+
+		template<typename Stream>
+		void async_send(socket_type fd, Stream& stream, const IoCallback& callback) {
+			submit(buffer_internal::MakeSendOp(fd, stream, callback));
+		}
+
+		// 立即取消fd上的操作，回调以-WSA_OPERATION_ABORTED调用
+		void cancel(socket_type fd) {
+			::CancelIoEx(reinterpret_cast<HANDLE>(fd), nullptr);
+		}
+
+		size_t run_once(int timeout_ms = -1) {
+			if (ready_.empty() && inflight_ > 0) {
+				OVERLAPPED_ENTRY entries[64];
+				ULONG count = 0;
+				if (::GetQueuedCompletionStatusEx(port_, entries, 64, &count, timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms, FALSE)) {
+					for (ULONG i = 0; i < count; i++) {
+						// overlapped是SocketOp的第一个成员
+						buffer_internal::SocketOp* op = reinterpret_cast<buffer_internal::SocketOp*>(entries[i].lpOverlapped);
+						DWORD bytes = 0, flags = 0;
+						int result;
+						if (::WSAGetOverlappedResult(op->fd, &op->overlapped, &bytes, FALSE, &flags))
+							result = (int)bytes;
+						else
+							result = -::WSAGetLastError();
+						inflight_--;
+						ready_.push_back(std::make_pair(op, result));
+					}
+				}
+			}
+			std::vector<std::pair<buffer_internal::SocketOp*, int> > ready;
+			ready.swap(ready_);
+			for (size_t i = 0; i < ready.size(); i++) {
+				std::unique_ptr<buffer_internal::SocketOp> op(ready[i].first);
+				op->done(ready[i].second);
+			}
+			return ready.size();
+		}
+
+		size_t pending() const {
+			return inflight_ + ready_.size();
+		}
+
+	private:
+		HANDLE port_;
+		size_t inflight_;
+		std::vector<std::pair<buffer_internal::SocketOp*, int> > ready_;
+
+		void submit(buffer_internal::SocketOp* op) {
+			WSABUF buf;
+			buf.buf = reinterpret_cast<char*>(op->data);
+			buf.len = (ULONG)std::min<size_t>(op->size, 0x7fffffff);
+			DWORD flags = 0;
+			int rv = op->recv ?
+				::WSARecv(op->fd, &buf, 1, nullptr, &flags, &op->overlapped, nullptr) :
+				::WSASend(op->fd, &buf, 1, nullptr, 0, &op->overlapped, nullptr);
+			if (rv == SOCKET_ERROR) {
+				int error = ::WSAGetLastError();
+				if (error != WSA_IO_PENDING) {
+					ready_.push_back(std::make_pair(op, -error));
+					return;
+				}
+			}
+			// 立即完成时同样会投递到完成端口
+			inflight_++;
+		}
+
+		IocpLoop(const IocpLoop&);
+		IocpLoop& operator=(const IocpLoop&);
+	};
+
+	typedef IocpLoop IoLoop;
+
+#endif // _WIN32
+
+} // namespace ftl
+
+#endif // FTL_SOCKET_IO_H_
@@ -0,0 +1,219 @@
+#ifndef FTL_STATIC_BUFFER_H_
+#define FTL_STATIC_BUFFER_H_
+
+#include "buffer.h"
+#include "layout.h"
+
+/**
+	StaticBufferT<N>，容量固定为N字节的BufferT，数据保存在对象内部，不分配内存，可以放在栈上或者作为全局常量
+	读写/字节序/varint等接口和BufferT/StreamBufferT完全相同，超过N字节的增长抛出std::length_error，内容不变
+
+		StaticStreamBufferT<1500> packet(StaticStreamBufferT<1500>::kGrowableWrite);
+		packet.write_be(uint16_t(0x0800));
+		packet.write_bytes(payload, size);          // 超过1500字节时抛出std::length_error
+
+	编译期构造：
+		with_be()/with_le()/with_string()返回追加之后的新容器，都是constexpr，可以预先计算固定的头部
+
+		constexpr StaticBufferT<8> kHeader(static_bytes<8>().with_string("FT").with_be<uint16_t>(1).with_le<uint32_t>(64));
+		static_assert(kHeader.size() == 8 && kHeader.continer().at(2) == 0, "");
+		stream.write_bytes(kHeader.begin(), kHeader.size());
+
+		编译期的编码每次都生成N个元素，只适合容量较小的头部；C++11的std::array没有constexpr的访问，内部使用数组
+	构造时整个数组初始化为0(constexpr构造的要求)，N较大时有相应的开销
+*/
+
+namespace ftl {
+
+	namespace buffer_internal {
+
+		template<typename _Ty, size_t N>
+		class StaticContinerT {
+		public:
+			static_assert(N > 0, "StaticContinerT need N > 0");
+			static_assert(sizeof(_Ty) == 1, "StaticContinerT need 8bit value_type");
+
+			typedef _Ty value_type;
+			typedef _Ty& reference;
+			typedef _Ty& const_reference;
+			typedef _Ty* pointer;
+			typedef const _Ty* const_pointer;
+			typedef _Ty* iterator;
+			typedef const _Ty* const_iterator;
+			typedef size_t size_type;
+
+			constexpr StaticContinerT():
+				buf_(),
+				size_(0) {
+			}
+
+			explicit StaticContinerT(size_type size):
+				buf_(),
+				size_(checked_size(size)) {
+			}
+
+			StaticContinerT(size_type size, const _Ty& value):
+				buf_(),
+				size_(checked_size(size)) {
+				std::memset(buf_, value, size);
+			}
+
+			StaticContinerT(const_pointer buf, size_type size):
+				buf_(),
+				size_(checked_size(size)) {
+				if (size > 0)
+					std::memcpy(buf_, buf, size);
+			}
+
+			StaticContinerT(const_pointer begin, const_pointer end):
+				buf_(),
+				size_(checked_size(end - begin)) {
+				if (size_ > 0)
+					std::memcpy(buf_, begin, size_);
+			}
+
+			explicit StaticContinerT(const std::vector<_Ty>& vec):
+				buf_(),
+				size_(checked_size(vec.size())) {
+				if (size_ > 0)
+					std::memcpy(buf_, &vec.front(), size_);
+			}
+
+			constexpr size_type size() const {
+				return size_;
+			}
+
+			constexpr bool empty() const {
+				return size_ == 0;
+			}
+
+			constexpr size_type capacity() const {
+				return N;
+			}
+
+			// 编译期也可以使用，i不检查
+			constexpr _Ty at(size_type i) const {
+				return buf_[i];
+			}
+
+			void resize(size_type size) {
+				size_ = checked_size(size);
+			}
+
+			void truncate(size_type size) {
+				if (size < size_)
+					size_ = size;
+			}
+
+			// 容量固定，只检查是否超过N
+			void reserve(size_type size) {
+				checked_size(size);
+			}
+
+			void commit(size_type count) {
+				size_ = checked_size(size_ + count);
+			}
+
+			iterator begin() {
+				return buf_;
+			}
+
+			constexpr const_iterator begin() const {
+				return buf_;
+			}
+
+			iterator end() {
+				return buf_ + size_;
+			}
+
+			constexpr const_iterator end() const {
+				return buf_ + size_;
+			}
+
+			void push_back(const StaticContinerT& other) {
+				size_type size = checked_size(size_ + other.size_);
+				std::memmove(buf_ + size_, other.buf_, other.size_);
+				size_ = size;
+			}
+
+			void shrink() {
+			}
+
+			void shrink_to_fit() {
+			}
+
+			void clear() {
+				size_ = 0;
+			}
+
+			StaticContinerT slice(size_type offset, size_type count) const {
+				return StaticContinerT(buf_ + offset, count);
+			}
+
+			// 追加一个整数，返回新的容器，超过N时编译失败(编译期)或者抛出std::length_error(运行时)
+			template<typename _SrcTy>
+			constexpr StaticContinerT with_be(_SrcTy value) const {
+				static_assert(std::is_integral<_SrcTy>::value, "with_be() need integral type");
+				return StaticContinerT(*this, (uint64_t)value, sizeof(_SrcTy), true, typename MakeIndexSequence<N>::type());
+			}
+
+			template<typename _SrcTy>
+			constexpr StaticContinerT with_le(_SrcTy value) const {
+				static_assert(std::is_integral<_SrcTy>::value, "with_le() need integral type");
+				return StaticContinerT(*this, (uint64_t)value, sizeof(_SrcTy), false, typename MakeIndexSequence<N>::type());
+			}
+
+			// 追加字符串常量，不包括结尾的0
+			template<size_t M>
+			constexpr StaticContinerT with_string(const char (&str)[M]) const {
+				return StaticContinerT(*this, str, M - 1, typename MakeIndexSequence<N>::type());
+			}
+
+		private:
+			_Ty buf_[N];
+			size_type size_;
+
+			template<size_t... I>
+			constexpr StaticContinerT(const StaticContinerT& src, uint64_t value, size_type bytes, bool big_endian, IndexSequence<I...>):
+				buf_{ src.integer_at(I, value, bytes, big_endian)... },
+				size_(checked_size(src.size_ + bytes)) {
+			}
+
+			template<size_t... I>
+			constexpr StaticContinerT(const StaticContinerT& src, const char* str, size_type bytes, IndexSequence<I...>):
+				buf_{ src.string_at(I, str, bytes)... },
+				size_(checked_size(src.size_ + bytes)) {
+			}
+
+			// 追加bytes字节的value之后第i个元素
+			constexpr _Ty integer_at(size_type i, uint64_t value, size_type bytes, bool big_endian) const {
+				return i < size_ ? buf_[i] :
+					(i < size_ + bytes ? (_Ty)(uint8_t)(value >> (8 * (big_endian ? size_ + bytes - 1 - i : i - size_))) : _Ty());
+			}
+
+			constexpr _Ty string_at(size_type i, const char* str, size_type bytes) const {
+				return i < size_ ? buf_[i] : (i < size_ + bytes ? (_Ty)str[i - size_] : _Ty());
+			}
+
+			static constexpr size_type checked_size(size_type size) {
+				return size <= N ? size : throw std::length_error("StaticContinerT capacity exceeded");
+			}
+		};
+
+	} // namespace buffer_internal
+
+	template<size_t N>
+	using StaticBufferT = BufferT<uint8_t, buffer_internal::StaticContinerT<uint8_t, N> >;
+
+	template<size_t N>
+	using StaticStreamBufferT = StreamBufferT<uint8_t, StaticBufferT<N> >;
+
+	// 编译期构造的起点：static_bytes<N>().with_be<uint16_t>(...)
+	template<size_t N>
+	constexpr buffer_internal::StaticContinerT<uint8_t, N> static_bytes() {
+		return buffer_internal::StaticContinerT<uint8_t, N>();
+	}
+
+} // namespace ftl
+
+#endif // FTL_STATIC_BUFFER_H_
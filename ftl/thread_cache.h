@@ -0,0 +1,196 @@
+#ifndef FTL_THREAD_CACHE_H_
+#define FTL_THREAD_CACHE_H_
+
+#include <atomic>
+#include <mutex>
+
+#include "buffer.h"
+
+/**
+	SlabAllocator和BufferPool共用的线程缓存组件
+
+	FreeListCacheT<N>：
+		按级别分组的侵入式空闲链表，只由所属线程访问，不加锁
+
+	ThreadStatsT<N> / StatsRegistryT<N>：
+		每个线程一份的统计计数，计数只由所属线程写入，使用普通的load + store，
+		分配/释放的快速路径上没有原子的读-改-写，也不会和其他线程争用同一个cache line；
+		读取时加锁遍历所有线程的计数求和，线程退出时计数合并到registry
+		一个块在另一个线程释放时，两个线程的计数各自增减，按照模2^64求和的结果仍然正确
+*/
+
+namespace ftl {
+
+	namespace buffer_internal {
+
+		struct FreeNode {
+			FreeNode* next;
+		};
+
+		template<unsigned int N>
+		class FreeListCacheT {
+		public:
+			FreeListCacheT() {
+				clear();
+			}
+
+			inline FreeNode* pop(unsigned int cls) {
+				FreeNode* node = heads_[cls];
+				if (node) {
+					heads_[cls] = node->next;
+					counts_[cls]--;
+				}
+				return node;
+			}
+
+			inline void push(unsigned int cls, FreeNode* node) {
+				node->next = heads_[cls];
+				heads_[cls] = node;
+				counts_[cls]++;
+			}
+
+			// 放入一条以nullptr结尾的链表
+			void push_list(unsigned int cls, FreeNode* head) {
+				while (head) {
+					FreeNode* next = head->next;
+					push(cls, head);
+					head = next;
+				}
+			}
+
+			// 从头部取出最多count个节点，last返回链表的尾部，返回取出的个数
+			unsigned int take(unsigned int cls, unsigned int count, FreeNode*& head, FreeNode*& last) {
+				head = last = heads_[cls];
+				if (count == 0 || head == nullptr)
+					return 0;
+				unsigned int n = 1;
+				while (n < count && last->next) {
+					last = last->next;
+					n++;
+				}
+				heads_[cls] = last->next;
+				last->next = nullptr;
+				counts_[cls] -= n;
+				return n;
+			}
+
+			size_t count(unsigned int cls) const {
+				return counts_[cls];
+			}
+
+			// 对每个节点调用f(cls, node)并清空
+			template<typename F>
+			void drain(F f) {
+				for (unsigned int cls = 0; cls < N; cls++) {
+					while (FreeNode* node = pop(cls))
+						f(cls, node);
+				}
+			}
+
+			// 丢弃所有节点，不释放
+			void clear() {
+				std::fill(heads_, heads_ + N, (FreeNode*)nullptr);
+				std::fill(counts_, counts_ + N, (size_t)0);
+			}
+
+		private:
+			FreeNode* heads_[N];
+			size_t counts_[N];
+		};
+
+		template<unsigned int N>
+		struct ThreadStatsT {
+			std::atomic<size_t> values[N];
+			ThreadStatsT* prev;
+			ThreadStatsT* next;
+
+			ThreadStatsT():
+				prev(nullptr),
+				next(nullptr) {
+				clear();
+			}
+
+			// 只能由所属线程(或者持有同一把锁的线程)调用
+			inline void add(unsigned int i, size_t v) {
+				values[i].store(values[i].load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+			}
+
+			inline void sub(unsigned int i, size_t v) {
+				add(i, (size_t)0 - v);
+			}
+
+			size_t get(unsigned int i) const {
+				return values[i].load(std::memory_order_relaxed);
+			}
+
+			void clear() {
+				for (unsigned int i = 0; i < N; i++)
+					values[i].store(0, std::memory_order_relaxed);
+			}
+		};
+
+		template<unsigned int N>
+		class StatsRegistryT {
+		public:
+			typedef ThreadStatsT<N> Counters;
+
+			StatsRegistryT():
+				head_(nullptr) {
+				std::fill(retired_, retired_ + N, (size_t)0);
+			}
+
+			void attach(Counters* counters) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				counters->prev = nullptr;
+				counters->next = head_;
+				if (head_)
+					head_->prev = counters;
+				head_ = counters;
+			}
+
+			// 线程退出时调用，计数合并到retired_
+			void detach(Counters* counters) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (unsigned int i = 0; i < N; i++)
+					retired_[i] += counters->get(i);
+				if (counters->prev)
+					counters->prev->next = counters->next;
+				else
+					head_ = counters->next;
+				if (counters->next)
+					counters->next->prev = counters->prev;
+				counters->prev = counters->next = nullptr;
+			}
+
+			void sum(size_t (&out)[N]) const {
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (unsigned int i = 0; i < N; i++)
+					out[i] = retired_[i];
+				for (const Counters* p = head_; p; p = p->next) {
+					for (unsigned int i = 0; i < N; i++)
+						out[i] += p->get(i);
+				}
+			}
+
+			// 清空所有计数，调用时不能有线程正在修改计数
+			void clear() {
+				std::lock_guard<std::mutex> lock(mutex_);
+				std::fill(retired_, retired_ + N, (size_t)0);
+				for (Counters* p = head_; p; p = p->next)
+					p->clear();
+			}
+
+		private:
+			mutable std::mutex mutex_;
+			Counters* head_;
+			size_t retired_[N];
+
+			StatsRegistryT(const StatsRegistryT&);
+			StatsRegistryT& operator=(const StatsRegistryT&);
+		};
+
+	} // namespace buffer_internal
+
+} // namespace ftl
+
+#endif // FTL_THREAD_CACHE_H_
@@ -1,151 +1,2031 @@
-#include "ftl/buffer.h"
-
-#include <iostream>
-#include <assert.h>
-
-using namespace ftl;
-using namespace ftl::buffer_internal;
-using namespace std;
-
-
-void TestByteBuffer1() {
-	byte_buffer buf1;
-	assert((buf1.size() == 0));
-
-	byte_buffer::value_type local_array[] = {1,2,3};
-	byte_buffer buf2(local_array, sizeof(local_array));
-	assert((buf2.size() == sizeof(local_array)));
-
-	byte_buffer buf3(std::move(buf2));
-	assert((buf2.size() == 0));
-	assert((buf3.size() == sizeof(local_array)));
-
-	std::vector<uint8_t> vec = {1,2,3};
-	auto buf4 = byte_buffer::ref(&vec);
-	assert((buf4.size() == vec.size()));
-
-	byte_buffer buf5(std::move(vec));
-	assert((buf5.size() == vec.size()));
-
-}
-
-void read_test() {
-	byte_buffer::value_type local_array[] = { 0xff, 0xee, 0xdd };
-	byte_buffer buf1(local_array, sizeof(local_array));
-	assert((buf1.read_char(0) == (char)0xff));
-	assert((buf1.read_byte(0) == 0xff));
-	assert((buf1.read<int8_t>(0) == (int8_t)0xff));
-	assert((buf1.read_be<uint16_t>(0) == 0xffee));
-	assert((buf1.read_le<uint16_t>(0) == 0xeeff));
-}
-
-void write_test() {
-	byte_buffer buf1(16);
-	byte_buffer::value_type local_array[] = { 0xff, 0xee, 0xdd, 0xcc };
-	std::string str("abc");
-	buf1.write_bytes(local_array, sizeof(local_array));
-	buf1.write_bytes(str.data(), str.length());
-
-	buf1.write(char(1), 0);
-	buf1.write((unsigned char)(2), 0);
-	buf1.write((signed char)(1), 0);
-	buf1.write(uint16_t(0xffee), 0);
-
-	// uint16_t test_array[] = {0xffee, 0xddcc};
-	// buf1.write_bytes(test_array, sizeof(test_array));
-}
-
-void cast_test() {
-	byte_buffer buf1(10, 5);
-	char* p1 = buf1.cast_to<char>();
-	uint8_t* p2 = buf1.cast_to<uint8_t>();
-	int8_t* p3 = buf1.cast_to<int8_t>();
-}
-
-void grow_test() {
-	byte_buffer buf;
-	for (size_t i = 0; i < 1024; i++) {
-		buf.append((uint8_t)0);
-	}
-
-	assert((buf.size() == 1024));
-	buf.append((uint8_t)0);
-}
-
-void append_test() {
-	byte_buffer buf1;
-	buf1.append(char(1));
-	buf1.append((unsigned char)(2));
-	buf1.append((signed char)(1));
-	buf1.append(uint16_t(0xffee));
-	buf1.append_be(uint16_t(0xffee));
-	buf1.append_le(uint16_t(0xffee));
-}
-
-void append_buf_test() {
-	std::string str("123");
-	std::vector<uint8_t> vec = {0xff, 0xee, 0xdd};
-	int8_t buf[] = {-10, -20, -30};
-	byte_buffer buf1;
-	buf1.append(str.data(), str.length());
-	buf1.append(&vec.front(), vec.size());
-	buf1.append(buf, sizeof(buf));
-	assert((buf1.size() == 9));
-	buf1.append(&vec);
-	assert((buf1.size() == 12));
-}
-
-
-void test_streambuffer() {
-	uint8_t ary[] = {1,2,3,4,5,6,7,8};
-	int ary_sum = 0;
-	for (auto i : ary) {
-		ary_sum += i;
-	}
-	byte_streambuffer buf(ary, sizeof(ary));
-	int count = 0;
-	while (!buf.read_eof()) {
-		count += buf.read<uint8_t>();
-	}
-
-	assert(ary_sum == count);
-
-	byte_streambuffer ref_buf = byte_streambuffer::ref(ary, sizeof(ary));
-	count = 0;
-	while (!ref_buf.read_eof()) {
-		count += ref_buf.read<uint8_t>();
-	}
-	assert(ary_sum == count);
-
-}
-
-void test_streambuffer1() {
-	byte_streambuffer buf(10, 0);
-	int sum1 = 0;
-	uint8_t i = 1;
-	while (!buf.write_eof()) {
-		sum1 += i;
-		buf.write(i++);
-	}
-	int sum2 = 0;
-	while (!buf.read_eof())	{
-		sum2 += buf.read<uint8_t>();
-	}
-	assert(sum2 == sum1);
-}
-
-int main(int argc, char* argv[]) {
-
-    //vector_buffer vec_buf;
-
-	TestByteBuffer1();
-	read_test();
-	write_test();
-	append_test();
-	cast_test();
-	grow_test();
-	append_buf_test();
-	test_streambuffer();
-	test_streambuffer1();
-	return 0;
+#include "ftl/buffer.h"
+#include "ftl/slab_allocator.h"
+#include "ftl/buffer_chain.h"
+#include "ftl/mapped_buffer.h"
+#include "ftl/ring_buffer.h"
+#include "ftl/layout.h"
+#include "ftl/buffer_pool.h"
+#include "ftl/aligned_allocator.h"
+#include "ftl/checksum.h"
+#include "ftl/socket_io.h"
+#include "ftl/codec.h"
+#include "ftl/parallel.h"
+#include "ftl/bit_stream.h"
+#include "ftl/framing.h"
+#include "ftl/static_buffer.h"
+#include "ftl/concurrent_buffer.h"
+
+#include <iostream>
+#include <assert.h>
+#include <thread>
+
+using namespace ftl;
+using namespace ftl::buffer_internal;
+using namespace std;
+
+
+void TestByteBuffer1() {
+	byte_buffer buf1;
+	assert((buf1.size() == 0));
+
+	byte_buffer::value_type local_array[] = {1,2,3};
+	byte_buffer buf2(local_array, sizeof(local_array));
+	assert((buf2.size() == sizeof(local_array)));
+
+	byte_buffer buf3(std::move(buf2));
+	assert((buf2.size() == 0));
+	assert((buf3.size() == sizeof(local_array)));
+
+	std::vector<uint8_t> vec = {1,2,3};
+	auto buf4 = byte_buffer::ref(&vec);
+	assert((buf4.size() == vec.size()));
+
+	byte_buffer buf5(std::move(vec));
+	assert((buf5.size() == 3 && vec.empty() && buf5.begin() == buf4.begin()));
+
+}
+
+void read_test() {
+	byte_buffer::value_type local_array[] = { 0xff, 0xee, 0xdd };
+	byte_buffer buf1(local_array, sizeof(local_array));
+	assert((buf1.read_char(0) == (char)0xff));
+	assert((buf1.read_byte(0) == 0xff));
+	assert((buf1.read<int8_t>(0) == (int8_t)0xff));
+	assert((buf1.read_be<uint16_t>(0) == 0xffee));
+	assert((buf1.read_le<uint16_t>(0) == 0xeeff));
+	assert((buf1.read<uint16_t>(0) == (Endian::isBigEndian() ? 0xffee : 0xeeff)));
+	assert((Endian::CurrentEndian() == (Endian::detect_big_endian() ? Endian::kBigEndian : Endian::kLittleEndian)));
+	assert((ByteSwap(uint64_t(0x0102030405060708ULL)) == 0x0807060504030201ULL));
+}
+
+void write_test() {
+	byte_buffer buf1(16);
+	byte_buffer::value_type local_array[] = { 0xff, 0xee, 0xdd, 0xcc };
+	std::string str("abc");
+	buf1.write_bytes(local_array, sizeof(local_array));
+	buf1.write_bytes(str.data(), str.length());
+
+	buf1.write(char(1), 0);
+	buf1.write((unsigned char)(2), 0);
+	buf1.write((signed char)(1), 0);
+	buf1.write(uint16_t(0xffee), 0);
+
+	// uint16_t test_array[] = {0xffee, 0xddcc};
+	// buf1.write_bytes(test_array, sizeof(test_array));
+}
+
+void cast_test() {
+	byte_buffer buf1(10, 5);
+	char* p1 = buf1.cast_to<char>();
+	uint8_t* p2 = buf1.cast_to<uint8_t>();
+	int8_t* p3 = buf1.cast_to<int8_t>();
+}
+
+void grow_test() {
+	byte_buffer buf;
+	for (size_t i = 0; i < 1024; i++) {
+		buf.append((uint8_t)0);
+	}
+
+	assert((buf.size() == 1024));
+	buf.append((uint8_t)0);
+}
+
+void append_test() {
+	byte_buffer buf1;
+	buf1.append(char(1));
+	buf1.append((unsigned char)(2));
+	buf1.append((signed char)(1));
+	buf1.append(uint16_t(0xffee));
+	buf1.append_be(uint16_t(0xffee));
+	buf1.append_le(uint16_t(0xffee));
+}
+
+void append_buf_test() {
+	std::string str("123");
+	std::vector<uint8_t> vec = {0xff, 0xee, 0xdd};
+	int8_t buf[] = {-10, -20, -30};
+	byte_buffer buf1;
+	buf1.append(str.data(), str.length());
+	buf1.append(&vec.front(), vec.size());
+	buf1.append(buf, sizeof(buf));
+	assert((buf1.size() == 9));
+	buf1.append(&vec);
+	assert((buf1.size() == 12));
+}
+
+
+void test_streambuffer() {
+	uint8_t ary[] = {1,2,3,4,5,6,7,8};
+	int ary_sum = 0;
+	for (auto i : ary) {
+		ary_sum += i;
+	}
+	byte_streambuffer buf(ary, sizeof(ary));
+	int count = 0;
+	while (!buf.read_eof()) {
+		count += buf.read<uint8_t>();
+	}
+
+	assert(ary_sum == count);
+
+	byte_streambuffer ref_buf = byte_streambuffer::ref(ary, sizeof(ary));
+	count = 0;
+	while (!ref_buf.read_eof()) {
+		count += ref_buf.read<uint8_t>();
+	}
+	assert(ary_sum == count);
+
+}
+
+void test_streambuffer1() {
+	byte_streambuffer buf(10, 0);
+	int sum1 = 0;
+	uint8_t i = 1;
+	while (!buf.write_eof()) {
+		sum1 += i;
+		buf.write(i++);
+	}
+	int sum2 = 0;
+	while (!buf.read_eof())	{
+		sum2 += buf.read<uint8_t>();
+	}
+	assert(sum2 == sum1);
+}
+
+void test_growable_stream() {
+	byte_streambuffer fixed(4, 0);
+	fixed.write_be(uint32_t(1));
+	bool thrown = false;
+	try {
+		fixed.write((uint8_t)1);
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite, 16);
+	assert((stream.write_mode() == byte_streambuffer::kGrowableWrite && stream.buf().capacity() >= 16));
+	for (uint32_t i = 0; i < 1000; i++) {
+		stream.write_be(i);
+	}
+	stream.write((uint8_t)0xff);
+	stream.write_bytes("abc", 3);
+	uint16_t values[3] = { 1, 2, 3 };
+	stream.write_le_array(values, 3);
+	stream.write_varint(uint32_t(300));
+	stream.write_span(2).write_be(uint16_t(0xffee), 0);
+	assert((stream.buf().size() == 4000 + 1 + 3 + 6 + 2 + 2));
+
+	for (uint32_t i = 0; i < 500; i++) {
+		assert((stream.read_be<uint32_t>() == i));
+	}
+	size_t capacity = stream.buf().capacity();
+	stream.compact();
+	assert((stream.buf().size() == 2000 + 14 && stream.buf().capacity() == capacity));
+	assert((stream.read_be<uint32_t>() == 500));
+
+	// 模拟recv，prepare的空间只提交实际写入的部分
+	BufferSpanT<uint8_t> space = stream.prepare(100);
+	space.write_be(uint32_t(0x01020304), 0);
+	stream.commit(4);
+	assert((stream.buf().size() == 2018));
+
+	for (uint32_t i = 501; i < 1000; i++) {
+		assert((stream.read_be<uint32_t>() == i));
+	}
+	assert((stream.read<uint8_t>() == 0xff));
+	stream.read_span(3);
+	uint16_t out[3];
+	stream.read_le_array(out, 3);
+	assert((out[2] == 3));
+	assert((stream.read_varint<uint32_t>() == 300));
+	assert((stream.read_be<uint16_t>() == 0xffee));
+	assert((stream.read_be<uint32_t>() == 0x01020304));
+	assert(stream.read_eof());
+
+	// 全部读取之后compact不释放内存
+	const uint8_t* p = stream.buf().begin();
+	stream.compact();
+	assert((stream.buf().size() == 0 && stream.buf().begin() == p));
+	stream.write_be(uint16_t(0x0102));
+	assert((stream.read_be<uint16_t>() == 0x0102));
+
+	// 固定模式下compact保持size，剩余空间可以继续写入
+	byte_streambuffer fixed2(8, 0);
+	fixed2.write_be(uint32_t(0x0a0b0c0d));
+	fixed2.read_be<uint16_t>();
+	fixed2.compact();
+	assert((fixed2.buf().size() == 8 && fixed2.read_be<uint16_t>() == 0x0c0d));
+	fixed2.write_be(uint32_t(0));
+	fixed2.write_be(uint16_t(0));
+	assert(fixed2.write_eof());
+}
+
+void test_inline_buffer() {
+	typedef SimpleBufferT<uint8_t, DefaultAllocator<uint8_t>, 32, 64> inline_continer;
+	inline_continer c1(10, 1);
+	assert((c1.is_inline() && c1.capacity() == 64));
+
+	inline_continer c2(c1);
+	assert((c2.is_inline() && c2.size() == 10 && c2.begin()[9] == 1));
+
+	inline_continer c3(std::move(c2));
+	assert((c3.is_inline() && c3.size() == 10 && c3.begin()[9] == 1));
+	assert((c2.size() == 0 && c2.is_inline()));
+
+	small_byte_buffer buf1;
+	for (size_t i = 0; i < 64; i++) {
+		buf1.append((uint8_t)i);
+	}
+	assert((buf1.capacity() == 64));
+	buf1.append((uint8_t)64);
+	assert((buf1.capacity() > 64 && buf1.read_byte(64) == 64 && buf1.read_byte(0) == 0));
+
+	small_byte_buffer buf2;
+	buf2 = buf1;
+	assert((buf2 == buf1));
+	buf2.resize(8);
+	buf2.shrink();
+	buf2.shrink();
+	buf2.shrink();
+	assert((buf2.capacity() == 64 && buf2.read_byte(7) == 7));
+
+	uint8_t ary[] = {1, 2, 3, 4};
+	small_byte_buffer buf3 = small_byte_buffer::ref(ary, sizeof(ary));
+	assert((buf3.begin() == ary));
+	buf3.append((uint8_t)5);
+	assert((buf3.begin() != ary && buf3.capacity() == 64 && buf3.read_byte(4) == 5));
+	buf3 = std::move(buf1);
+	assert((buf3.size() == 65 && buf3.read_byte(64) == 64));
+}
+
+void test_shared_buffer() {
+	shared_byte_buffer buf1(16, 1);
+	const shared_byte_buffer& cbuf1 = buf1;
+	shared_byte_buffer buf2(buf1);
+	const shared_byte_buffer& cbuf2 = buf2;
+	assert((cbuf2.begin() == cbuf1.begin()));
+
+	shared_byte_buffer slice = buf1.slice(4, 8);
+	const shared_byte_buffer& cslice = slice;
+	assert((slice.size() == 8 && cslice.begin() == cbuf1.begin() + 4));
+
+	buf2.write((uint8_t)2, 0);
+	assert((buf2.read_byte(0) == 2 && buf1.read_byte(0) == 1 && cslice.read_byte(0) == 1));
+	assert((cbuf2.begin() != cbuf1.begin()));
+
+	slice.append((uint8_t)3);
+	assert((slice.size() == 9 && slice.read_byte(8) == 3 && buf1.read_byte(12) == 1));
+
+	shared_byte_buffer buf3;
+	buf3 = buf1;
+	buf3 += buf3;
+	assert((buf3.size() == 32 && buf1.size() == 16));
+
+	shared_byte_streambuffer stream(8, 5);
+	shared_byte_streambuffer stream_copy(stream);
+	assert((stream.read<uint8_t>() == 5));
+	const shared_byte_buffer& stream_buf1 = stream.buf();
+	const shared_byte_buffer& stream_buf2 = stream_copy.buf();
+	assert((stream_buf1.begin() == stream_buf2.begin()));
+
+	byte_buffer buf4(16, 1);
+	byte_buffer slice4 = buf4.slice(8, 100);
+	assert((slice4.size() == 8 && slice4.begin() != buf4.begin() + 8));
+}
+
+void test_buffer_chain() {
+	byte_buffer header(3, 1);
+	byte_buffer payload(5, 2);
+	byte_buffer_chain chain;
+	chain.append(std::move(header));
+	chain.append_be(uint16_t(0x0304));
+	chain.append(std::move(payload));
+	assert((chain.size() == 10 && chain.segment_count() == 3));
+
+	struct iovec iov[4];
+	assert((chain.to_iovec(iov, 4) == 3));
+	assert((iov[0].iov_len == 3 && iov[1].iov_len == 2 && iov[2].iov_len == 5));
+
+	byte_buffer_chain::Reader reader = chain.reader();
+	assert((reader.read<uint8_t>() == 1));
+	assert((reader.read_be<uint32_t>() == 0x01010304));
+	uint8_t tmp[5];
+	reader.read_bytes(tmp, sizeof(tmp));
+	assert((tmp[4] == 2 && reader.read_eof()));
+
+	chain.consume(4);
+	assert((chain.size() == 6 && chain.to_iovec().size() == 2));
+	byte_buffer flat = chain.flatten();
+	assert((flat.size() == 6 && flat.read_byte(0) == 4 && flat.read_byte(5) == 2));
+
+	shared_byte_buffer frame(64, 7);
+	shared_byte_buffer_chain shared_chain;
+	shared_chain.append(frame);
+	shared_chain.append(frame.slice(0, 8));
+	const shared_byte_buffer& cframe = frame;
+	assert((shared_chain.segment(0).begin() == cframe.begin()));
+	assert((shared_chain.reader().read_le<uint64_t>() == 0x0707070707070707ULL));
+}
+
+void test_endian_array() {
+	uint16_t src16[37];
+	uint32_t src32[37];
+	double src64[37];
+	for (int i = 0; i < 37; i++) {
+		src16[i] = (uint16_t)(0x0102 * i);
+		src32[i] = 0x01020304u * i;
+		src64[i] = i * 1.5;
+	}
+
+	byte_buffer buf;
+	buf.append_be_array(src16, 37);
+	buf.append_le_array(src32, 37);
+	buf.append_be_array(src64, 37);
+	assert((buf.size() == 37 * 14));
+	assert((buf.read_be<uint16_t>(2 * 5) == src16[5]));
+	assert((buf.read_le<uint32_t>(74 + 4 * 36) == src32[36]));
+	assert((buf.read_be<double>(74 + 148 + 8 * 33) == src64[33]));
+
+	uint16_t dst16[37];
+	uint32_t dst32[37];
+	double dst64[37];
+	buf.read_be_array(0, dst16, 37);
+	buf.read_le_array(74, dst32, 37);
+	buf.read_be_array(74 + 148, dst64, 37);
+	assert((std::memcmp(src16, dst16, sizeof(src16)) == 0));
+	assert((std::memcmp(src32, dst32, sizeof(src32)) == 0));
+	assert((std::memcmp(src64, dst64, sizeof(src64)) == 0));
+
+	bool thrown = false;
+	try {
+		buf.read_be_array(buf.size() - 2, dst32, 1);
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	byte_streambuffer stream(37 * 4, 0);
+	stream.write_be_array(src32, 37);
+	assert((stream.write_eof()));
+	assert((stream.read_be<uint32_t>() == src32[0]));
+	stream.read_be_array(dst32 + 1, 36);
+	assert((std::memcmp(src32, dst32, sizeof(src32)) == 0 && stream.read_eof()));
+
+	// 每种实现都和逐个翻转的结果比较，覆盖不足16字节、16/32字节整数倍和剩余部分
+	typedef buffer_internal::ByteSwapKernels ByteSwapKernels;
+	const ByteSwapKernels::Isa best = ByteSwapKernels::isa();
+	const ByteSwapKernels::Isa isas[] = { ByteSwapKernels::kScalar, ByteSwapKernels::kSsse3, ByteSwapKernels::kAvx2, ByteSwapKernels::kNeon };
+	char src[8 * 37];
+	for (size_t i = 0; i < sizeof(src); i++)
+		src[i] = (char)(i * 7 + 3);
+	for (size_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+		if (!ByteSwapKernels::set_isa(isas[k]))
+			continue;
+		for (size_t count = 0; count <= 37; count++) {
+			char dst[8 * 37], ref[8 * 37];
+			buffer_internal::ByteSwapArray<2>::copy(dst, src, count);
+			buffer_internal::ByteSwapArrayScalar<2>::copy(ref, src, count);
+			assert((std::memcmp(dst, ref, count * 2) == 0));
+			buffer_internal::ByteSwapArray<4>::copy(dst, src, count);
+			buffer_internal::ByteSwapArrayScalar<4>::copy(ref, src, count);
+			assert((std::memcmp(dst, ref, count * 4) == 0));
+			buffer_internal::ByteSwapArray<8>::copy(dst, src, count);
+			buffer_internal::ByteSwapArrayScalar<8>::copy(ref, src, count);
+			assert((std::memcmp(dst, ref, count * 8) == 0));
+		}
+	}
+	ByteSwapKernels::set_isa(best);
+	assert((ByteSwapKernels::isa() == ByteSwapKernels::detect()));
+}
+
+void test_span() {
+	byte_buffer buf(16, 0);
+	BufferSpanT<uint8_t> wspan = buf.span(2, 8);
+	wspan.write_be(uint16_t(0x0102), 0);
+	wspan.write_le(uint32_t(0x06050403), 2);
+	wspan.write((uint8_t)7, 6);
+
+	const byte_buffer& cbuf = buf;
+	BufferSpanT<const uint8_t> rspan = cbuf.span(2, 8);
+	assert((rspan.size() == 8));
+	assert((rspan.read_be<uint32_t>(0) == 0x01020304));
+	assert((rspan.read_byte(6) == 7));
+	assert((rspan.subspan(4, 2).read_be<uint16_t>(0) == 0x0506));
+
+	bool thrown = false;
+	try {
+		buf.span(10, 7);
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	byte_streambuffer stream(buf.begin(), buf.size());
+	stream.read<uint16_t>();
+	BufferSpanT<const uint8_t> frame = stream.read_span(4);
+	assert((frame.read_be<uint32_t>(0) == 0x01020304 && stream.read<uint8_t>() == 5));
+	BufferSpanT<uint8_t> out = stream.write_span(4);
+	out.write_be(uint32_t(0xffeeddcc), 0);
+	assert((stream.buf().read_be<uint32_t>(0) == 0xffeeddcc));
+}
+
+void test_mapped_buffer() {
+	const char* path = "mapped_buffer_test.bin";
+	uint8_t data[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+	FILE* fp = fopen(path, "wb");
+	assert(fp);
+	fwrite(data, 1, sizeof(data), fp);
+	fclose(fp);
+
+	{
+		mapped_byte_buffer buf(mapped_file::open(path));
+		assert((buf.size() == sizeof(data)));
+		assert((buf.read_be<uint32_t>(4) == 0x05060708));
+		buf.continer().advise(mapped_file::kSequential);
+		buf.continer().prefetch(0, buf.size());
+
+		mapped_byte_buffer slice = buf.slice(2, 4);
+		assert((slice.read_be<uint16_t>(0) == 0x0304));
+
+		mapped_byte_streambuffer stream(std::move(buf));
+		assert((stream.read_be<uint64_t>() == 0x0102030405060708ULL && stream.read_eof()));
+
+		mapped_byte_buffer cow(mapped_file::open(path, mapped_file::kCopyOnWrite));
+		cow.write((uint8_t)0xff, 0);
+		assert((cow.read_byte(0) == 0xff));
+		assert((mapped_byte_buffer(mapped_file::open(path)).read_byte(0) == 0x01));
+
+		// 只读映射拒绝写入，读取不受影响
+		mapped_byte_buffer ro(mapped_file::open(path));
+		bool denied = false;
+		try {
+			ro.write((uint8_t)0xff, 0);
+		} catch (std::system_error& e) {
+			denied = (e.code() == std::errc::permission_denied);
+		}
+		assert(denied);
+		denied = false;
+		try {
+			ro.begin();
+		} catch (std::system_error&) {
+			denied = true;
+		}
+		assert(denied);
+		const mapped_byte_buffer& cro = ro;
+		assert((cro.begin()[0] == 0x01 && ro.read_be<uint16_t>(0) == 0x0102));
+		mapped_byte_streambuffer ro_stream(std::move(ro));
+		denied = false;
+		try {
+			ro_stream.write_be((uint32_t)1);
+		} catch (std::system_error&) {
+			denied = true;
+		}
+		assert((denied && ro_stream.read_be<uint32_t>() == 0x01020304));
+	}
+
+	bool thrown = false;
+	try {
+		mapped_file::open("not_exist_mapped_buffer_test.bin");
+	} catch (std::system_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+	remove(path);
+}
+
+struct TestSlabArena {
+	static SlabArena& instance() {
+		static SlabArena arena;
+		return arena;
+	}
+};
+
+void test_slab_allocator() {
+	typedef BufferT<uint8_t, SimpleBufferT<uint8_t, SlabAllocator<uint8_t, TestSlabArena> > > test_buffer;
+	SlabArena& arena = TestSlabArena::instance();
+	{
+		test_buffer buf;
+		for (size_t i = 0; i < 1024; i++) {
+			buf.append((uint8_t)i);
+		}
+		assert((buf.size() == 1024));
+		assert((buf.read_byte(1023) == (uint8_t)1023));
+		assert((arena.stats().in_use_bytes == 1024));
+
+		test_buffer large(64 * 1024, 1);
+		assert((arena.stats().large_bytes == 64 * 1024));
+		large.append((uint8_t)2);
+		assert((large.read_byte(64 * 1024) == 2));
+		assert((large.read_byte(0) == 1));
+
+		void* p = arena.allocate(100);
+		SlabArena::Stats stats = arena.stats();
+		assert((stats.in_use_bytes == 1024 + 128));
+		assert((stats.internal_fragmentation() > 0));
+		arena.deallocate(p);
+		assert((stats.peak_bytes >= stats.in_use_bytes + stats.large_bytes));
+	}
+	// 在另一个线程分配、当前线程释放，线程退出之后计数仍然计入stats()
+	test_buffer* moved = nullptr;
+	std::thread t([&moved]() {
+		moved = new test_buffer(200, 5);
+	});
+	t.join();
+	assert((arena.stats().in_use_bytes == 256 && arena.stats().alloc_count >= 1));
+	delete moved;
+	SlabArena::Stats stats = arena.stats();
+	assert((stats.in_use_bytes == 0 && stats.large_bytes == 0 && stats.requested_bytes == 0));
+	assert((stats.alloc_count == stats.free_count));
+
+	arena.reset();
+	assert((arena.stats().chunk_bytes == 0));
+	test_buffer buf(100, 3);
+	assert((buf.read_byte(99) == 3));
+
+	slab_byte_buffer buf2(32, 0);
+	buf2.append_be(uint32_t(0x01020304));
+	assert((buf2.read_be<uint32_t>(32) == 0x01020304));
+}
+
+void test_ring_buffer() {
+	byte_ring_buffer ring(10);
+	assert((ring.capacity() == 16 && ring.empty()));
+	assert(ring.write_be(uint32_t(0x01020304)));
+	assert(ring.write_le(uint64_t(0x0102030405060708ULL)));
+	assert((ring.size() == 12));
+	assert(!ring.write_be(uint64_t(0)));
+
+	uint32_t value32 = 0;
+	assert((ring.read_be(value32) && value32 == 0x01020304));
+	// 环绕写入
+	assert(ring.write_be(uint64_t(0x1112131415161718ULL)));
+	uint64_t value64 = 0;
+	assert((ring.read_le(value64) && value64 == 0x0102030405060708ULL));
+	assert((ring.read_be(value64) && value64 == 0x1112131415161718ULL));
+	assert((ring.empty() && !ring.read_be(value64)));
+
+	byte_ring_buffer::Region region = ring.prepare(100);
+	assert((region.size() == 16 && region.first.size() == 16 - 4 && region.second.size() == 4));
+	region.first.write_be(uint16_t(0xaabb), 0);
+	ring.commit(region, 2);
+	byte_ring_buffer::ConstRegion readable = ring.peek();
+	assert((readable.size() == 2 && readable.first.read_be<uint16_t>(0) == 0xaabb));
+	ring.consume(2);
+
+	mpsc_byte_ring_buffer mpsc(256);
+	const uint32_t count = 10000;
+	std::thread producers[2];
+	for (uint32_t i = 0; i < 2; i++) {
+		producers[i] = std::thread([&mpsc, i, count]() {
+			for (uint32_t n = 0; n < count; n++) {
+				while (!mpsc.write_be(uint32_t((i << 24) | n)))
+					std::this_thread::yield();
+			}
+		});
+	}
+	uint32_t expected[2] = {0, 0};
+	for (uint32_t n = 0; n < count * 2; n++) {
+		uint32_t value = 0;
+		while (!mpsc.read_be(value))
+			std::this_thread::yield();
+		assert(((value & 0xffffff) == expected[value >> 24]++));
+	}
+	for (uint32_t i = 0; i < 2; i++)
+		producers[i].join();
+	assert((mpsc.empty() && expected[0] == count && expected[1] == count));
+}
+
+void test_vector_buffer() {
+	vector_buffer buf(4, 0);
+	buf.write_be(uint32_t(0x01020304), 0);
+	buf.append_le(uint16_t(0x0506));
+	assert((buf.size() == 6 && buf.read_le<uint16_t>(4) == 0x0506));
+	vector_buffer slice = buf.slice(1, 2);
+	assert((slice.read_be<uint16_t>(0) == 0x0203));
+}
+
+void test_adopt_release() {
+	// vector的内存直接被接管，交出时原样归还
+	std::vector<uint8_t> vec(1000, 7);
+	const uint8_t* data = &vec.front();
+	byte_buffer buf(std::move(vec));
+	assert((vec.empty() && buf.begin() == data && buf.size() == 1000));
+	buf.write((uint8_t)9, 999);
+	buf.truncate(500);
+	std::vector<uint8_t> out = buf.release_vector();
+	assert((buf.empty() && &out.front() == data && out.size() == 500 && out[0] == 7));
+
+	// 超过接管的大小时复制，之前的内存被释放
+	byte_buffer grown = byte_buffer::adopt(std::move(out));
+	grown.append_be(uint32_t(0x01020304));
+	assert((grown.begin() != data && grown.size() == 504 && grown.read_be<uint32_t>(500) == 0x01020304));
+	out = grown.release_vector();
+	assert((out.size() == 504 && out[503] == 4));
+
+	std::string str(100, 'x');
+	const char* str_data = str.data();
+	char_buffer chars = char_buffer::adopt(std::move(str));
+	assert((chars.begin() == str_data && chars.size() == 100));
+	chars.truncate(10);
+	std::string str_out = chars.release_string();
+	assert((str_out.data() == str_data && str_out == std::string(10, 'x')));
+	byte_buffer copied(out);
+	assert((copied.release_string().size() == 504 && copied.empty()));
+	// 空的string没有可以复制的数据，没有内联存储时也不访问buf_
+	byte_buffer empty_adopted = byte_buffer::adopt(std::string());
+	assert((empty_adopted.empty()));
+	empty_adopted.append_be(uint16_t(0x0102));
+	assert((empty_adopted.size() == 2 && empty_adopted.read_be<uint16_t>(0) == 0x0102));
+
+	// 小于内联存储时复制到对象内部
+	std::vector<uint8_t> small(10, 1);
+	small_byte_buffer inline_buf = small_byte_buffer::adopt(std::move(small));
+	assert((small.empty() && inline_buf.continer().is_inline() && inline_buf.size() == 10));
+
+	// unique_ptr：deleter是_Alloc时作为自己的内存，否则持有到不再使用
+	byte_buffer::size_type size = 0;
+	byte_buffer heap(out);
+	std::unique_ptr<uint8_t[], byte_buffer::continer_type::deleter_type> raw = heap.release(&size);
+	assert((size == 504 && raw && heap.empty() && raw[500] == 1));
+	uint8_t* raw_data = raw.get();
+	byte_buffer owned = byte_buffer::adopt(std::move(raw), size);
+	assert((!raw && owned.begin() == raw_data && owned.release(&size).get() == raw_data));
+	std::unique_ptr<uint8_t[]> foreign(new uint8_t[64]());
+	uint8_t* foreign_data = foreign.get();
+	byte_buffer from_foreign = byte_buffer::adopt(std::move(foreign), 64);
+	assert((from_foreign.begin() == foreign_data && from_foreign.size() == 64));
+	std::unique_ptr<uint8_t[], byte_buffer::continer_type::deleter_type> copy = from_foreign.release(&size);
+	assert((size == 64 && copy.get() != foreign_data && copy[63] == 0));
+	byte_buffer empty_buf;
+	assert((!empty_buf.release(&size) && size == 0));
+
+	vector_buffer vbuf = vector_buffer::adopt(std::vector<uint8_t>(100, 3));
+	const uint8_t* vdata = vbuf.begin();
+	assert((&vbuf.release_vector().front() == vdata && vbuf.empty()));
+}
+
+void test_layout() {
+	typedef layout<be<uint16_t>, uint8_t, be<uint32_t>, le<double> > test_layout_t;
+	static_assert(test_layout_t::size == 15, "layout size");
+	static_assert(test_layout_t::offset<2>::value == 3 && test_layout_t::offset<3>::value == 7, "layout offset");
+
+	byte_buffer buf(2, 0);
+	test_layout_t::append(buf, 0x0102, 0x03, 0x04050607, 0.5);
+	assert((buf.size() == 17));
+	assert((buf.read_be<uint16_t>(2) == 0x0102 && buf.read_byte(4) == 0x03));
+	assert((buf.read_be<uint32_t>(5) == 0x04050607 && buf.read_le<double>(9) == 0.5));
+
+	test_layout_t::tuple_type values = test_layout_t::read(buf, 2);
+	assert((std::get<0>(values) == 0x0102 && std::get<2>(values) == 0x04050607 && std::get<3>(values) == 0.5));
+
+	uint16_t a = 0;
+	uint8_t b = 0;
+	uint32_t c = 0;
+	double d = 0;
+	test_layout_t::write(buf, 2, 0x1112, 0x13, 0x14151617, 1.5);
+	test_layout_t::read(buf, 2, a, b, c, d);
+	assert((a == 0x1112 && b == 0x13 && c == 0x14151617 && d == 1.5));
+
+	bool thrown = false;
+	try {
+		test_layout_t::read(buf, 3);
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	typedef layout<le<uint32_t> > single_layout_t;
+	byte_streambuffer stream(single_layout_t::size * 2, 0);
+	single_layout_t::write(stream, 0x01020304);
+	single_layout_t::write(stream, single_layout_t::tuple_type(0x05060708));
+	assert((stream.write_eof()));
+	single_layout_t::read(stream, c);
+	assert((c == 0x01020304 && std::get<0>(single_layout_t::read(stream)) == 0x05060708 && stream.read_eof()));
+}
+
+void test_varint() {
+	assert((Varint::length(uint32_t(0)) == 1 && Varint::length(uint32_t(127)) == 1 && Varint::length(uint32_t(128)) == 2));
+	assert((Varint::length(uint64_t(-1)) == 10 && Varint::length(uint32_t(-1)) == 5));
+	assert((Varint::ZigZagEncode(int32_t(-1)) == 1 && Varint::ZigZagEncode(int32_t(1)) == 2));
+	assert((Varint::ZigZagDecode(Varint::ZigZagEncode(int64_t(INT64_MIN))) == INT64_MIN));
+
+	byte_buffer buf;
+	assert((buf.append_varint(uint32_t(300)) == 2));
+	assert((buf.read_byte(0) == 0xac && buf.read_byte(1) == 0x02));
+	assert((buf.append_zigzag(int64_t(-2)) == 1));
+	assert((buf.append_varint(uint64_t(-1)) == 10));
+
+	// 少于8个字节和多于8个字节，分别走逐字节和一次读取8个字节的路径
+	size_t length = 0;
+	assert((buf.read_varint<uint32_t>(0, &length) == 300 && length == 2));
+	assert((buf.read_zigzag<int64_t>(2) == -2));
+	assert((buf.read_varint<uint64_t>(3, &length) == uint64_t(-1) && length == 10));
+
+	const uint64_t values[] = {0, 1, 127, 128, 16383, 16384, 0xffffffffULL, 1ULL << 55, 1ULL << 56, 1ULL << 63};
+	const size_t count = sizeof(values) / sizeof(values[0]);
+	byte_buffer buf2;
+	for (size_t i = 0; i < count; i++)
+		buf2.append_varint(values[i]);
+	buf2.append((uint8_t)0);
+	uint64_t decoded[count];
+	size_t consumed = buf2.read_varint_array(0, decoded, count);
+	assert((consumed == buf2.size() - 1));
+	for (size_t i = 0; i < count; i++)
+		assert((decoded[i] == values[i]));
+
+	// 32位最多5个字节
+	bool thrown = false;
+	try {
+		buf.read_varint<uint32_t>(3);
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	thrown = false;
+	try {
+		// 不完整的varint
+		byte_buffer truncated(buf.begin() + 3, 9);
+		truncated.read_varint<uint64_t>(0);
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	byte_streambuffer stream(16, 0);
+	assert((stream.write_varint(uint32_t(1) << 31) == 5));
+	assert((stream.write_zigzag(int32_t(-64)) == 1));
+	assert((stream.write_varint(uint64_t(1234567)) == 3));
+	assert((stream.read_varint<uint32_t>() == (uint32_t(1) << 31)));
+	assert((stream.read_zigzag<int32_t>() == -64));
+	uint64_t tail[1];
+	stream.read_varint_array(tail, 1);
+	assert((tail[0] == 1234567));
+}
+
+void test_prepare_commit() {
+	byte_buffer buf(4, 1);
+	buf.reserve(100);
+	assert((buf.capacity() >= 100 && buf.size() == 4));
+	const uint8_t data[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+	BufferSpanT<uint8_t> space = buf.prepare(16);
+	assert((space.size() == 16 && space.begin() == buf.begin() + 4));
+	std::memcpy(space.begin(), data, sizeof(data));
+	buf.commit(sizeof(data));
+	assert((buf.size() == 10 && buf.read_be<uint16_t>(4) == 0x0102 && buf.read_byte(9) == 0x06));
+
+	bool thrown = false;
+	try {
+		buf.commit(buf.capacity());
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	// 共享的slice在prepare时复制，不会改写原来的数据
+	shared_byte_buffer shared(8, 7);
+	shared_byte_buffer slice = shared.slice(0, 4);
+	BufferSpanT<uint8_t> shared_space = slice.prepare(2);
+	shared_space.write_be(uint16_t(0x0102), 0);
+	slice.commit(2);
+	assert((slice.size() == 6 && slice.read_be<uint16_t>(4) == 0x0102));
+	assert((shared.read_byte(4) == 7 && shared.read_byte(5) == 7));
+
+	small_byte_buffer small;
+	std::memcpy(small.prepare(8).begin(), data, 6);
+	small.commit(6);
+	assert((small.continer().is_inline() && small.size() == 6));
+	assert((small.read_byte(5) == 0x06));
+
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	BufferSpanT<uint8_t> stream_space = stream.prepare(sizeof(data));
+	std::memcpy(stream_space.begin(), data, sizeof(data));
+	stream.commit(4);
+	assert((stream.buf().size() == 4));
+	stream_space = stream.prepare(2);
+	assert((stream_space.begin() == stream.buf().begin() + 4));
+	stream.commit(2);
+	assert((stream.write_eof() && stream.read_be<uint32_t>() == 0x01020304));
+
+	// 预留的空间在commit()之前不可读：读取、查找、checksum()和frames()都停在data_end()
+	BufferSpanT<uint8_t> pending = stream.prepare(64);
+	std::memset(pending.begin(), 0xab, pending.size());
+	assert((stream.buf().size() == 70 && stream.data_end() == 6 && !stream.read_eof()));
+	assert((stream.find((uint8_t)0xab) == byte_streambuffer::npos && stream.compare(data + 4, 2) == 0));
+	assert((checksum<Crc32c>(stream) == checksum<Crc32c>(data + 4, 2)));
+	assert((frames(stream, Be16LengthPrefix()).begin() == frames(stream, Be16LengthPrefix()).end()));
+	assert((stream.read_be<uint16_t>() == 0x0506 && stream.read_eof()));
+	thrown = false;
+	try {
+		stream.read<uint8_t>();
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert((thrown));
+	stream.commit(3);
+	assert((stream.data_end() == 9 && stream.buf().size() == 9 && stream.read_span(3).size() == 3 && stream.read_eof()));
+
+	// kFixedWrite只能在buffer_.size()之内prepare，不扩大buffer
+	byte_streambuffer fixed(8, 0);
+	fixed.write_be(uint16_t(0x0102));
+	BufferSpanT<uint8_t> fixed_space = fixed.prepare(6);
+	assert((fixed_space.begin() == fixed.buf().begin() + 2 && fixed.buf().size() == 8));
+	std::memcpy(fixed_space.begin(), data, 4);
+	fixed.commit(4);
+	thrown = false;
+	try {
+		fixed.prepare(3);
+	} catch (std::out_of_range&) {
+		thrown = true;
+	}
+	assert((thrown && fixed.buf().size() == 8 && fixed.write_index() == 6));
+	fixed.prepare(2);
+	fixed.commit(2);
+	assert((fixed.write_eof() && fixed.read_be<uint32_t>() == 0x01020102));
+}
+
+void test_buffer_policy() {
+	assert((GeometricGrowth<>::grow(64, 65, 32) == 128));
+	assert((GeometricGrowth<3, 2>::grow(64, 65, 32) == 96));
+	assert((GeometricGrowth<>::grow(0, 1, 32) == 32 && GeometricGrowth<>::grow(64, 1000, 32) == 1000));
+	assert((PageRoundedGrowth<>::grow(3000, 3001, 32) == 8192 && PageRoundedGrowth<>::grow(100, 101, 32) == 200));
+	assert((SizeClassGrowth<>::size_class(1) == 8 && SizeClassGrowth<>::size_class(8) == 8 && SizeClassGrowth<>::size_class(9) == 16));
+	assert((SizeClassGrowth<>::size_class(16) == 16 && SizeClassGrowth<>::size_class(17) == 32 && SizeClassGrowth<>::size_class(32) == 32));
+	assert((SizeClassGrowth<>::size_class(33) == 48 && SizeClassGrowth<>::size_class(49) == 64 && SizeClassGrowth<>::size_class(64) == 64));
+	assert((SizeClassGrowth<>::size_class(65) == 80 && SizeClassGrowth<>::size_class(128) == 128 && SizeClassGrowth<>::size_class(129) == 160));
+	assert((SizeClassGrowth<>::size_class(257) == 320 && SizeClassGrowth<>::size_class(320) == 320));
+	assert((SizeClassGrowth<>::size_class(4097) == 5120 && SizeClassGrowth<>::size_class(5120) == 5120));
+
+	// 默认策略：使用不到一半容量时收缩
+	byte_buffer buf(1000, 1);
+	buf.resize(100);
+	buf.shrink();
+	buf.shrink();
+	assert((buf.capacity() == 1000));
+	buf.shrink();
+	assert((buf.capacity() == 100 && buf.read_byte(99) == 1));
+	buf.resize(60);
+	buf.shrink();
+	buf.shrink();
+	buf.shrink();
+	assert((buf.capacity() == 100));
+
+	typedef SimpleBufferT<uint8_t, DefaultAllocator<uint8_t>, 32, 0,
+		BufferPolicyT<SizeClassGrowth<GeometricGrowth<3, 2> >, HysteresisShrink<1, 4, 1> > > policy_continer;
+	BufferT<uint8_t, policy_continer> buf2(100, 2);
+	assert((buf2.capacity() == 112));
+	buf2.append((uint8_t)3);
+	assert((buf2.capacity() == 112));
+	buf2.resize(113);
+	assert((buf2.capacity() == 192 && buf2.read_byte(100) == 3));
+	buf2.resize(50);
+	buf2.shrink();
+	buf2.shrink();
+	assert((buf2.capacity() == 192));
+	buf2.resize(20);
+	buf2.shrink();
+	buf2.shrink();
+	assert((buf2.capacity() == 40 && buf2.read_byte(19) == 2));
+}
+
+struct TestBufferPool {
+	static BufferPool& instance() {
+		static BufferPool pool(2, 4096);
+		return pool;
+	}
+};
+
+void test_buffer_pool() {
+	typedef PoolAllocator<uint8_t, TestBufferPool> test_allocator;
+	typedef BufferT<uint8_t, SimpleBufferT<uint8_t, test_allocator> > test_buffer;
+	typedef StreamBufferT<uint8_t, test_buffer> test_streambuffer;
+	BufferPool& pool = TestBufferPool::instance();
+	assert((BufferPool::bucket(1) == 0 && BufferPool::bucket(256) == 0 && BufferPool::bucket(257) == 1));
+	assert((BufferPool::bucket(8 * 1024 * 1024) == 15 && BufferPool::bucket(8 * 1024 * 1024 + 1) == BufferPool::BUCKET_COUNT));
+	{
+		test_buffer buf(100, 1);
+		assert((pool.stats().miss_count == 1 && pool.stats().cached_bytes == 0));
+	}
+	assert((pool.stats().cached_bytes == 256));
+	const uint8_t* p = nullptr;
+	{
+		test_buffer buf(100, 2);
+		p = buf.begin();
+		assert((pool.stats().hit_count == 1 && pool.stats().cached_bytes == 0));
+		// 同一个桶内增长不需要移动数据
+		buf.resize(150);
+		assert((buf.begin() == p && buf.read_byte(99) == 2));
+		buf.resize(256);
+		buf.append((uint8_t)3);
+		assert((buf.read_byte(256) == 3 && buf.read_byte(0) == 2));
+	}
+	assert((pool.stats().cached_bytes == 256 + 512));
+
+	{
+		test_streambuffer stream(test_streambuffer::kGrowableWrite, 1000);
+		assert((pool.stats().hit_count == 1 && pool.stats().miss_count == 3));
+		stream.prepare(4).write_be(uint32_t(0x01020304), 0);
+		stream.commit(4);
+		assert((stream.read_be<uint32_t>() == 0x01020304));
+	}
+	assert((pool.stats().cached_bytes == 256 + 512 + 1024));
+
+	// 每个桶最多缓存2个，总共不超过4096字节
+	{
+		test_buffer a(2000), b(2000), c(2000);
+	}
+	BufferPool::Stats stats = pool.stats();
+	assert((stats.cached_bytes == 256 + 512 + 1024 + 2048 && stats.free_count == 2));
+
+	test_allocator::trim_thread();
+	assert((pool.stats().cached_bytes == 0));
+
+	{
+		test_buffer buf(100);
+	}
+	assert((pool.stats().cached_bytes == 256));
+	pool.trim();
+	{
+		test_buffer buf(16 * 1024 * 1024, 5);
+		assert((buf.read_byte(16 * 1024 * 1024 - 1) == 5));
+		assert((pool.stats().cached_bytes == 0));
+	}
+
+	pooled_byte_buffer buf2;
+	buf2.reserve(100);
+	assert((buf2.size() == 0 && buf2.capacity() >= 100));
+	buf2.append_be(uint16_t(0xffee));
+	assert((buf2.read_be<uint16_t>(0) == 0xffee));
+
+	// 其他线程的计数在stats()中求和，线程退出时缓存释放，计数保留
+	test_allocator::trim_thread();
+	stats = pool.stats();
+	std::thread worker([]() {
+		test_buffer a(100), b(100);
+		assert((TestBufferPool::instance().stats().cached_bytes == 0));
+	});
+	worker.join();
+	BufferPool::Stats after = pool.stats();
+	assert((after.miss_count == stats.miss_count + 2 && after.free_count == stats.free_count + 2 && after.cached_bytes == 0));
+}
+
+void test_aligned_allocator() {
+	typedef AlignedAllocator<uint8_t, 4096> direct_allocator;
+	typedef BufferT<uint8_t, SimpleBufferT<uint8_t, direct_allocator> > direct_buffer;
+	direct_buffer buf(100, 1);
+	assert(((reinterpret_cast<uintptr_t>(buf.begin()) & 4095) == 0));
+	for (size_t i = 0; i < 10000; i++) {
+		buf.append((uint8_t)i);
+	}
+	assert(((reinterpret_cast<uintptr_t>(buf.begin()) & 4095) == 0));
+	assert((buf.read_byte(99) == 1 && buf.read_byte(100 + 9999) == (uint8_t)9999));
+	assert(!direct_allocator::mapped(buf.begin()));
+
+	aligned_byte_buffer buf2(10, 0);
+	assert(((reinterpret_cast<uintptr_t>(buf2.begin()) & 63) == 0));
+
+	// 超过64K使用映射，增长时使用mremap
+	typedef AlignedAllocator<uint8_t, 64, 64 * 1024> mapped_allocator;
+	typedef BufferT<uint8_t, SimpleBufferT<uint8_t, mapped_allocator> > mapped_buffer;
+	mapped_buffer large(32 * 1024, 2);
+	assert(!mapped_allocator::mapped(large.begin()));
+	large.resize(100 * 1024);
+	assert((mapped_allocator::mapped(large.begin()) && large.read_byte(32 * 1024 - 1) == 2));
+	large.write((uint8_t)3, 100 * 1024 - 1);
+	large.resize(1024 * 1024);
+	assert((mapped_allocator::mapped(large.begin()) && large.read_byte(100 * 1024 - 1) == 3));
+	assert(((reinterpret_cast<uintptr_t>(large.begin()) & 63) == 0));
+	large.resize(16 * 1024);
+	large.continer().shrink_to_fit();
+	assert((!mapped_allocator::mapped(large.begin()) && large.read_byte(0) == 2));
+
+	huge_byte_buffer huge(4 * 1024 * 1024, 5);
+	assert((huge.read_byte(4 * 1024 * 1024 - 1) == 5));
+
+	// 映射的块没有头部，N * 2M的数据从2M对齐的地址开始
+	typedef AlignedAllocator<uint8_t, 64, FTL_HUGE_PAGE_SIZE> huge_allocator;
+	huge_allocator alloc;
+	uint8_t* p = alloc.allocate(2 * FTL_HUGE_PAGE_SIZE);
+	assert((p && huge_allocator::mapped(p) && (reinterpret_cast<uintptr_t>(p) & (FTL_HUGE_PAGE_SIZE - 1)) == 0));
+	p[0] = 1;
+	p[2 * FTL_HUGE_PAGE_SIZE - 1] = 2;
+	p = alloc.reallocate(p, 3 * FTL_HUGE_PAGE_SIZE);
+	assert((p && huge_allocator::mapped(p) && p[0] == 1 && p[2 * FTL_HUGE_PAGE_SIZE - 1] == 2));
+	p[3 * FTL_HUGE_PAGE_SIZE - 1] = 3;
+	p = alloc.reallocate(p, 1024);
+	assert((p && !huge_allocator::mapped(p) && p[0] == 1));
+	alloc.deallocate(p);
+}
+
+void test_search() {
+	Search::Isa isas[] = { Search::kScalar, Search::kSse2, Search::kAvx2, Search::kNeon };
+	Search::Isa best = Search::isa();
+	assert((best == Search::detect()));
+	std::vector<uint8_t> data(1000);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = (uint8_t)('a' + (i * 7) % 23);
+	}
+	byte_buffer buf(&data.front(), data.size());
+	for (size_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+		if (!Search::set_isa(isas[k]))
+			continue;
+		assert((Search::isa() == isas[k]));
+		for (size_t pos = 0; pos < 100; pos += 7) {
+			// 每个位置和长度都和std::search/std::find_first_of的结果一致
+			for (size_t len = 1; len < 6; len++) {
+				std::vector<uint8_t>::iterator it = std::search(data.begin() + pos, data.end(), data.begin() + 300, data.begin() + 300 + len);
+				assert((buf.find(&data[300], len, pos) == (size_t)(it - data.begin())));
+			}
+			assert((buf.find((uint8_t)'w', pos) == (size_t)(std::find(data.begin() + pos, data.end(), 'w') - data.begin())));
+			const char set[] = "wv";
+			assert((buf.find_first_of(set, 2, pos) == (size_t)(std::find_first_of(data.begin() + pos, data.end(), set, set + 2) - data.begin())));
+		}
+		assert((buf.find((uint8_t)'z') == byte_buffer::npos));
+		assert((buf.find("zz", 2) == byte_buffer::npos));
+		assert((buf.find("", 0, 10) == 10));
+		const char big_set[] = "zyxwvutsrqponmlkjihg";
+		assert((buf.find_first_of(big_set, sizeof(big_set) - 1) == 1));
+
+		// 匹配在末尾的情况
+		byte_buffer tail(&data.front(), data.size());
+		tail.append_be(uint16_t(0x0d0a));
+		assert((tail.find("\r\n", 2) == 1000 && tail.find((uint8_t)'\n') == 1001));
+
+		byte_buffer other(buf);
+		assert((other == buf && other.compare(buf) == 0));
+		other.write((uint8_t)0xff, 999);
+		assert((!(other == buf) && buf.compare(other) < 0 && other.compare(buf) > 0));
+		other.write((uint8_t)0, 17);
+		assert((other.compare(buf) < 0));
+		assert((buf.compare(&data.front(), 999) > 0));
+		assert((buf.equal(&data.front(), data.size())));
+	}
+	Search::set_isa(best);
+	assert(!Search::set_isa((Search::Isa)100));
+
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	const char text[] = "GET / HTTP/1.1\r\nHost: a\r\n\r\n";
+	stream.write_bytes(text, sizeof(text) - 1);
+	size_t n = stream.find("\r\n", 2);
+	assert((n == 14 && stream.starts_with("GET ", 4)));
+	stream.read_span(n + 2);
+	assert((stream.find("\r\n", 2) == 7 && stream.find((uint8_t)':') == 4));
+	assert((stream.find_first_of(" :", 2) == 4));
+	stream.read_span(9);
+	assert((stream.equal("\r\n", 2) && stream.compare("\r\n\r", 3) < 0));
+	assert((stream.find((uint8_t)'x') == byte_streambuffer::npos));
+}
+
+void test_large_copy() {
+	LargeCopy::Method methods[] = { LargeCopy::kMemcpy, LargeCopy::kRepMovsb, LargeCopy::kNonTemporal };
+	LargeCopy::Method best = LargeCopy::method();
+	size_t threshold = LargeCopy::threshold();
+	assert((best == LargeCopy::kMemcpy && best == LargeCopy::detect() && threshold == LargeCopy::default_threshold()));
+	size_t llc = LargeCopy::last_level_cache_size();
+	assert((threshold == (llc ? llc / 4 * 3 : (size_t)1024 * 1024)));
+	std::vector<uint8_t> src(5000);
+	for (size_t i = 0; i < src.size(); i++) {
+		src[i] = (uint8_t)(i * 13 + (i >> 8));
+	}
+	// 阈值设置得很小，让每次拷贝都经过大块拷贝的路径
+	LargeCopy::set_threshold(1);
+	for (size_t k = 0; k < sizeof(methods) / sizeof(methods[0]); k++) {
+		if (!LargeCopy::set_method(methods[k]))
+			continue;
+		assert((LargeCopy::method() == methods[k]));
+		// 不同的对齐和长度，包括不足一次循环和头尾都不对齐的情况
+		std::vector<uint8_t> dst(src.size() + 32);
+		for (size_t offset = 0; offset < 17; offset += 3) {
+			for (size_t n = 0; n < 300; n += 37) {
+				std::fill(dst.begin(), dst.end(), (uint8_t)0xcc);
+				LargeCopy::copy(&dst[offset], &src[1], n);
+				assert((std::equal(src.begin() + 1, src.begin() + 1 + n, dst.begin() + offset)));
+				assert((dst[offset + n] == 0xcc && (offset == 0 || dst[offset - 1] == 0xcc)));
+			}
+		}
+
+		byte_buffer buf(&src.front(), src.size());
+		byte_buffer copy(buf);
+		assert((copy == buf));
+		byte_buffer assigned;
+		assigned = buf;
+		assigned += copy;
+		assert((assigned.size() == 10000 && assigned.slice(5000, 5000) == buf));
+		assert((buf.slice(7, 4000).equal(&src[7], 4000)));
+		shared_byte_buffer shared(&src.front(), src.size());
+		shared_byte_buffer shared_copy(shared);
+		shared_copy.append(&src.front(), 100);
+		assert((shared_copy.size() == 5100 && shared_copy.slice(5000, 100).equal(&src.front(), 100) && shared.equal(&src.front(), src.size())));
+		byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+		stream.write_bytes(&src.front(), src.size());
+		assert((stream.equal(&src.front(), src.size())));
+	}
+	LargeCopy::set_method(best);
+	assert(!LargeCopy::set_method((LargeCopy::Method)100));
+
+	// 阈值之上的拷贝，默认阈值是最后一级缓存的3/4，测试时降低到1MB
+	for (size_t k = 0; k < sizeof(methods) / sizeof(methods[0]); k++) {
+		if (!LargeCopy::set_method(methods[k]))
+			continue;
+		LargeCopy::set_threshold(1024 * 1024);
+		byte_buffer large(2 * 1024 * 1024 + 5, 0x3c);
+		large.write((uint8_t)1, large.size() - 1);
+		byte_buffer large_copy(large);
+		assert((large_copy == large));
+	}
+	LargeCopy::set_threshold(threshold);
+	LargeCopy::set_method(best);
+}
+
+void test_bit_stream() {
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	BitStreamT<byte_streambuffer> bits(stream);
+	// ue(0..3) = 1 010 011 00100
+	for (uint64_t v = 0; v < 4; v++) {
+		bits.write_ue(v);
+	}
+	assert((bits.pending_bits() == 12 && stream.write_index() == 0));
+	bits.sync_write();
+	assert((stream.write_index() == 2 && stream.read<uint8_t>() == 0xa6 && stream.read<uint8_t>() == 0x40));
+
+	// 随机宽度的字段，覆盖跨越64位缓存和超过56位的读取
+	std::vector<std::pair<uint64_t, unsigned> > fields;
+	uint64_t seed = 12345;
+	for (size_t i = 0; i < 2000; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		unsigned n = (unsigned)(seed >> 58) + 1;
+		uint64_t v = seed ^ (seed << 13);
+		if (n < 64)
+			v &= ((uint64_t)1 << n) - 1;
+		fields.push_back(std::make_pair(v, n));
+		bits.write_bits(v, n);
+	}
+	bits.write_se(-5);
+	bits.write_se(7);
+	bits.write_ue(0xffffffffULL);
+	bits.write_ue(1ULL << 62);
+	bits.write_bit(true);
+	bits.sync_write();
+	stream.write_be(uint16_t(0xbeef));
+
+	bits.reset_read();
+	for (size_t i = 0; i < fields.size(); i++) {
+		assert((bits.read_bits(fields[i].second) == fields[i].first));
+	}
+	assert((bits.read_se() == -5 && bits.read_se() == 7));
+	assert((bits.read_ue() == 0xffffffffULL && bits.read_ue() == (1ULL << 62)));
+	assert((bits.peek_bits(1) == 1 && bits.read_bit() && !bits.read_aligned()));
+	bits.sync_read();
+	assert((bits.bits_left() == 16 && stream.read_be<uint16_t>() == 0xbeef));
+
+	// 越界时不改变读取的位置
+	stream.write_be(uint16_t(0x0001));
+	bits.reset_read();
+	bits.skip_bits(3);
+	bool thrown = false;
+	try {
+		bits.read_bits(14);
+	} catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	assert((thrown && bits.bits_left() == 13));
+	thrown = false;
+	try {
+		bits.read_ue();
+	} catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	assert((thrown && bits.bits_left() == 13 && bits.read_bits(13) == 1));
+
+	// 整字节的跳过
+	stream.write_be(uint64_t(0x0102030405060708ULL));
+	stream.write_be(uint64_t(0x1112131415161718ULL));
+	bits.sync_read();
+	bits.skip_bits(4);
+	bits.skip_bits(8 * 9);
+	assert((bits.read_bits(12) == 0x213 && bits.bits_left() == 40));
+}
+
+void test_framing() {
+	// 长度前缀，最后一帧不完整
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	Be32LengthPrefix be32;
+	const uint8_t payload[] = "0123456789";
+	be32.write(stream, payload, 3);
+	be32.write(stream, payload, 0);
+	be32.write(stream, payload, 10);
+	stream.write_be(uint32_t(5));
+	stream.write_bytes(payload, 2);
+
+	FrameReaderT<Be32LengthPrefix> reader(stream, be32);
+	std::vector<size_t> sizes;
+	for (BufferSpanT<const uint8_t> frame : reader) {
+		assert((std::equal(frame.begin(), frame.end(), payload)));
+		sizes.push_back(frame.size());
+	}
+	reader.commit();
+	assert((sizes.size() == 3 && sizes[0] == 3 && sizes[1] == 0 && sizes[2] == 10));
+	assert((reader.status() == kFrameIncomplete && stream.read_index() == 25));
+	// 收到剩余的数据之后继续
+	stream.write_bytes(payload + 2, 3);
+	BufferSpanT<const uint8_t> frame;
+	assert((reader.next(frame) && frame.size() == 5 && std::equal(frame.begin(), frame.end(), payload)));
+	assert((!reader.next(frame) && reader.status() == kFrameIncomplete && stream.read_index() == stream.write_index()));
+
+	// 前向迭代器可以多次遍历，commit(it)只确认it之前的帧
+	be32.write(stream, payload, 1);
+	be32.write(stream, payload, 2);
+	FrameReaderT<Be32LengthPrefix>::iterator it = reader.begin();
+	FrameReaderT<Be32LengthPrefix>::iterator second = it;
+	++second;
+	assert((it != second && second->size() == 2 && it->size() == 1 && std::distance(it, reader.end()) == 2));
+	reader.commit(second);
+	assert((reader.next(frame) && frame.size() == 2 && !reader.next(frame)));
+
+	// 遍历中途停止，commit()之后read_index在最后一个遍历到的帧之后
+	be32.write(stream, payload, 1);
+	be32.write(stream, payload, 2);
+	be32.write(stream, payload, 3);
+	size_t start = stream.read_index();
+	for (BufferSpanT<const uint8_t> f : reader) {
+		if (f.size() == 2)
+			break;
+	}
+	reader.commit();
+	assert((stream.read_index() == start + 11 && reader.status() == kFrameComplete));
+	assert((reader.next(frame) && frame.size() == 3 && !reader.next(frame)));
+
+	// varint前缀和格式错误
+	byte_streambuffer vstream(byte_streambuffer::kGrowableWrite);
+	VarintLengthPrefix varint(300);
+	std::vector<uint8_t> big(200, 'x');
+	varint.write(vstream, &big.front(), big.size());
+	varint.write(vstream, payload, 4);
+	const uint8_t bad[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 };
+	vstream.write_bytes(bad, sizeof(bad));
+	FrameRangeT<VarintLengthPrefix> range = frames(vstream, varint);
+	size_t total = 0;
+	for (FrameRangeT<VarintLengthPrefix>::iterator i = range.begin(); i != range.end(); ++i) {
+		total += i->size();
+	}
+	assert((total == 204 && range.consumed() == 207 && range.status() == kFrameError && vstream.read_index() == 0));
+	FrameInfo info;
+	assert((varint.parse(bad, 3, info) == kFrameIncomplete));
+	const uint8_t too_large[] = { 0xad, 0x02 };
+	assert((varint.parse(too_large, sizeof(too_large), info) == kFrameError));
+	Be16LengthPrefix inclusive(1024, true);
+	byte_buffer header;
+	header.append_be(uint16_t(1));
+	assert((inclusive.parse(header.begin(), header.size(), info) == kFrameError));
+	header.write_be(uint16_t(6), 0);
+	header.append_be(uint16_t(7));
+	assert((inclusive.parse(header.begin(), header.size(), info) == kFrameIncomplete && info.payload_size == 4));
+
+	// 分隔符
+	const char text[] = "a\r\nbc\r\n\r\nd";
+	byte_buffer lines;
+	lines.append(text, sizeof(text) - 1);
+	FrameRangeT<DelimiterFrame> line_range = frames(lines, DelimiterFrame());
+	std::vector<std::string> values;
+	for (BufferSpanT<const uint8_t> line : line_range) {
+		values.push_back(std::string(line.begin(), line.end()));
+	}
+	assert((values.size() == 3 && values[0] == "a" && values[1] == "bc" && values[2].empty()));
+	assert((line_range.consumed() == 9 && line_range.status() == kFrameIncomplete));
+	DelimiterFrame short_lines("\n", 1, 4);
+	assert((short_lines.parse(reinterpret_cast<const uint8_t*>("abcd\n"), 5, info) == kFrameComplete && info.payload_size == 4));
+	assert((short_lines.parse(reinterpret_cast<const uint8_t*>("abcde\n"), 6, info) == kFrameError));
+	assert((short_lines.parse(reinterpret_cast<const uint8_t*>("abcd"), 4, info) == kFrameIncomplete));
+}
+
+// 编译期计算的头部
+constexpr StaticBufferT<8> kStaticHeader(static_bytes<8>().with_string("FT").with_be<uint16_t>(0x0102).with_le<uint32_t>(64));
+static_assert(kStaticHeader.size() == 8 && kStaticHeader.capacity() == 8, "static header size");
+static_assert(kStaticHeader.continer().at(0) == 'F' && kStaticHeader.continer().at(3) == 0x02 && kStaticHeader.continer().at(4) == 64, "static header content");
+
+void test_static_buffer() {
+	assert((kStaticHeader.read_be<uint16_t>(2) == 0x0102 && kStaticHeader.read_le<uint32_t>(4) == 64));
+
+	StaticBufferT<16> buf;
+	buf.append_be(uint32_t(0x01020304));
+	buf.append_le(uint64_t(0x1112131415161718ULL));
+	buf.append_varint(uint32_t(300));
+	assert((buf.size() == 14 && buf.read_be<uint32_t>(0) == 0x01020304 && buf.read_le<uint64_t>(4) == 0x1112131415161718ULL));
+	assert((buf.read_varint<uint32_t>(12) == 300));
+	// 超过容量时抛出异常，内容不变
+	bool thrown = false;
+	try {
+		buf.append_be(uint32_t(1));
+	} catch (const std::length_error&) {
+		thrown = true;
+	}
+	assert((thrown && buf.size() == 14));
+	StaticBufferT<16> copy(buf);
+	copy += buf.slice(0, 2);
+	assert((copy.size() == 16 && copy.read_be<uint16_t>(14) == 0x0102 && copy.slice(0, 14) == buf));
+
+	// 在栈上构造一个包
+	StaticStreamBufferT<64> packet(StaticStreamBufferT<64>::kGrowableWrite);
+	packet.write_bytes(kStaticHeader.begin(), kStaticHeader.size());
+	packet.write_be(uint16_t(0xbeef));
+	std::vector<uint8_t> payload(54, 7);
+	packet.write_bytes(&payload.front(), payload.size());
+	assert((packet.write_index() == 64 && packet.read_be<uint16_t>() == 0x4654));
+	thrown = false;
+	try {
+		packet.write(uint8_t(1));
+	} catch (const std::length_error&) {
+		thrown = true;
+	}
+	assert((thrown && packet.write_index() == 64));
+	thrown = false;
+	try {
+		StaticStreamBufferT<64> reserved(StaticStreamBufferT<64>::kGrowableWrite, 65);
+	} catch (const std::length_error&) {
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+void test_concurrent_buffer() {
+	byte_concurrent_buffer batch(32, 2);
+	uint8_t record[40];
+	for (int i = 0; i < 40; i++)
+		record[i] = (uint8_t)i;
+	for (int i = 0; i < 3; i++)
+		batch.append(record + i, 10);
+	// 主批次剩余2个字节，之后的记录写入溢出区
+	byte_concurrent_buffer::Reservation r = batch.reserve(10);
+	assert((r.overflow() && r.size() == 10));
+	std::memcpy(r.begin(), record + 3, 10);
+	batch.commit(r);
+	// 主批次还放得下，但是这个线程已经写入过溢出区，下次take()之前继续使用溢出区，保持顺序
+	r = batch.reserve(2);
+	assert((r.overflow()));
+	std::memcpy(r.begin(), record + 20, 2);
+	batch.commit(r);
+	batch.append(record, 40);
+	byte_buffer out;
+	batch.take(out);
+	assert((out.size() == 30 + 10 + 2 + 40));
+	assert((out.slice(0, 10) == byte_buffer(record, 10) && out.slice(20, 10) == byte_buffer(record + 2, 10)));
+	assert((out.slice(30, 10) == byte_buffer(record + 3, 10) && out.slice(40, 2) == byte_buffer(record + 20, 2)));
+	assert((out.slice(42, 40) == byte_buffer(record, 40)));
+	batch.take(out);
+	assert((out.empty()));
+	// take()之后回到主批次
+	r = batch.reserve(5);
+	assert((!r.overflow()));
+	std::memcpy(r.begin(), record, 5);
+	batch.commit(r);
+	assert((batch.take().slice(0, 5) == byte_buffer(record, 5)));
+	// 超过容量的记录之后，更小的记录同样写入溢出区
+	batch.append(record, 40);
+	r = batch.reserve(1);
+	assert((r.overflow()));
+	batch.commit(r);
+	assert((batch.take().size() == 41));
+
+	// 多个线程并发写入，消费者同时取走：每条记录完整出现一次，同一个线程的记录保持顺序
+	const int threads = 4;
+	const uint32_t count = 5000;
+	byte_concurrent_buffer shared(1024, 2);
+	std::atomic<int> done(0);
+	std::vector<byte_buffer> batches;
+	std::thread consumer([&]() {
+		while (done.load() < threads)
+			batches.push_back(shared.take());
+	});
+	std::thread producers[threads];
+	for (int t = 0; t < threads; t++) {
+		producers[t] = std::thread([&shared, &done, t, count]() {
+			for (uint32_t seq = 0; seq < count; seq++) {
+				uint8_t len = (uint8_t)(seq % 50);
+				byte_concurrent_buffer::Reservation r = shared.reserve(7 + len);
+				Endian::write<uint8_t, uint16_t, Endian::kBigEndian>(r.begin(), (uint16_t)t);
+				Endian::write<uint8_t, uint32_t, Endian::kBigEndian>(r.begin() + 2, seq);
+				r.begin()[6] = len;
+				std::memset(r.begin() + 7, (uint8_t)seq, len);
+				shared.commit(r);
+			}
+			done++;
+		});
+	}
+	for (int t = 0; t < threads; t++)
+		producers[t].join();
+	consumer.join();
+	batches.push_back(shared.take());
+
+	std::vector<std::vector<bool> > seen(threads, std::vector<bool>(count, false));
+	std::vector<uint32_t> next_seq(threads, 0);
+	uint32_t total = 0;
+	for (size_t i = 0; i < batches.size(); i++) {
+		const byte_buffer& b = batches[i];
+		size_t offset = 0;
+		while (offset < b.size()) {
+			uint16_t t = b.read_be<uint16_t>(offset);
+			uint32_t seq = b.read_be<uint32_t>(offset + 2);
+			uint8_t len = b.read_byte(offset + 6);
+			assert((t < threads && seq < count && len == seq % 50 && !seen[t][seq] && seq == next_seq[t]));
+			next_seq[t]++;
+			for (uint8_t j = 0; j < len; j++)
+				assert((b.read_byte(offset + 7 + j) == (uint8_t)seq));
+			seen[t][seq] = true;
+			total++;
+			offset += 7 + len;
+		}
+	}
+	assert((total == threads * count));
+}
+
+void test_serialize() {
+	byte_buffer buf;
+	assert((buf.append_string("hello") == 6 && buf.size() == 6 && buf.read_byte(0) == 5));
+	std::vector<uint32_t> ids = { 1, 2, 0x01020304 };
+	assert((buf.append_be_vector(ids) == 13 && buf.read_byte(6) == 3 && buf.read_be<uint32_t>(15) == 0x01020304));
+	std::vector<uint16_t> shorts = { 0x0102, 0x0304 };
+	buf.append_le_vector(shorts);
+	assert((buf.read_le<uint16_t>(20) == 0x0102));
+	std::vector<std::string> names = { "a", "", "xyz" };
+	buf.append_be_vector(names);
+	std::map<std::string, uint32_t> scores = { { "alice", 1 }, { "bob", 2 } };
+	buf.append_be_map(scores);
+	std::unordered_map<uint32_t, std::vector<int16_t> > nested = { { 7, { -1, 2 } }, { 9, {} } };
+	buf.append_le_map(nested);
+	std::vector<std::pair<uint8_t, std::string> > pairs = { { 1, "one" }, { 2, "two" } };
+	buf.append_be_vector(pairs);
+	buf.append_string(std::string());
+
+	std::string str;
+	size_t offset = buf.read_string(0, str);
+	assert((offset == 6 && str == "hello"));
+	size_t length = 0;
+	BufferSpanT<const uint8_t> span = buf.read_string_span(0, &length);
+	assert((length == 6 && span.size() == 5 && std::memcmp(span.begin(), "hello", 5) == 0));
+	// 读取到预先分配的容器，复用已有的容量
+	std::vector<uint32_t> ids2;
+	ids2.reserve(16);
+	const uint32_t* data = ids2.data();
+	offset += buf.read_be_vector(offset, ids2);
+	assert((ids2 == ids && ids2.data() == data));
+	std::vector<uint16_t> shorts2;
+	offset += buf.read_le_vector(offset, shorts2);
+	assert((shorts2 == shorts));
+	std::vector<std::string> names2;
+	offset += buf.read_be_vector(offset, names2);
+	assert((names2 == names));
+	std::map<std::string, uint32_t> scores2 = { { "stale", 3 } };
+	offset += buf.read_be_map(offset, scores2);
+	assert((scores2 == scores));
+	std::unordered_map<uint32_t, std::vector<int16_t> > nested2;
+	offset += buf.read_le_map(offset, nested2);
+	assert((nested2 == nested));
+	std::vector<std::pair<uint8_t, std::string> > pairs2;
+	offset += buf.read_be_vector(offset, pairs2);
+	assert((pairs2 == pairs));
+	offset += buf.read_string(offset, str);
+	assert((str.empty() && offset == buf.size()));
+
+	// 数据不完整或者长度前缀超过剩余的数据时抛出异常，不按照长度前缀分配内存
+	bool thrown = false;
+	try {
+		buf.slice(0, 10).read_be_vector(6, ids2);
+	} catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+	byte_buffer bad;
+	bad.append_varint(uint64_t(1) << 60);
+	thrown = false;
+	try {
+		bad.read_be_vector(0, ids2);
+	} catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	stream.write_string("method");
+	stream.write_be_vector(ids);
+	stream.write_le_map(scores);
+	assert((stream.write_index() == 7 + 13 + 19));
+	stream.read_string(str);
+	assert((str == "method"));
+	stream.read_be_vector(ids2);
+	assert((ids2 == ids));
+	size_t index = stream.read_index();
+	std::map<std::string, uint32_t> scores3;
+	stream.read_le_map(scores3);
+	assert((scores3 == scores));
+	thrown = false;
+	try {
+		stream.read_string(str);
+	} catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	assert((thrown && index < stream.read_index() && stream.read_index() == stream.write_index()));
+	byte_streambuffer text(byte_streambuffer::kGrowableWrite);
+	text.write_string("span");
+	BufferSpanT<const uint8_t> view = text.read_string_span();
+	assert((view.size() == 4 && std::memcmp(view.begin(), "span", 4) == 0 && text.read_index() == 5));
+	text.write_varint(uint32_t(10));
+	index = text.read_index();
+	thrown = false;
+	try {
+		text.read_string_span();
+	} catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	assert((thrown && text.read_index() == index));
+}
+
+void test_checksum() {
+	const char digits[] = "123456789";
+	assert((checksum<Crc32c>(digits, 9) == 0xe3069283));
+	assert((checksum<Adler32>("Wikipedia", 9) == 0x11e60398));
+	assert((checksum<XXHash32>("", 0) == 0x02cc5d05 && checksum<XXHash32>("abc", 3) == 0x32d153ff));
+	assert((checksum<XXHash64>("", 0) == 0xef46db3751d8e999ULL && checksum<XXHash64>("abc", 3) == 0x44bc2cf5ad770999ULL));
+
+	byte_buffer buf(10000);
+	for (size_t i = 0; i < buf.size(); i++) {
+		buf.write((uint8_t)(i * 7 + 3), i);
+	}
+	assert((checksum<Crc32c>(buf) == 0x4eb72655));
+	assert((checksum<Adler32>(buf) == 0x0d817116));
+	assert((checksum<XXHash32>(buf) == 0xff59cea3));
+	assert((checksum<XXHash64>(buf) == 0xb195585f9792dbcaULL));
+	XXHash32 seeded32(1);
+	seeded32.append(buf.span(0, 100));
+	XXHash64 seeded64(1);
+	seeded64.append(buf.span(0, 100));
+	assert((seeded32.value() == 0xd84f75a0 && seeded64.value() == 0x8d8957e68f02c7ceULL));
+
+	// 所有实现的结果一致，覆盖3路并行的各种长度
+	Crc32cKernel::Isa best = Crc32cKernel::isa();
+	Crc32cKernel::Isa isas[] = { Crc32cKernel::kScalar, Crc32cKernel::kSse42, Crc32cKernel::kSse42Pclmul, Crc32cKernel::kArmCrc };
+	for (size_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+		if (!Crc32cKernel::set_isa(isas[k]))
+			continue;
+		assert((Crc32cKernel::isa() == isas[k]));
+		for (size_t len = 0; len < 4000; len += 37) {
+			const uint8_t* p = buf.continer().begin() + (len % 5);
+			assert((Crc32cKernel::update(~0u, p, len) == Crc32cKernel::UpdateScalar(~0u, p, len)));
+		}
+		assert((checksum<Crc32c>(buf) == 0x4eb72655));
+	}
+	Crc32cKernel::set_isa(best);
+
+	// 分段计算和一次计算相同
+	size_t splits[] = { 0, 1, 15, 16, 17, 31, 33, 100, 4095 };
+	for (size_t i = 0; i < sizeof(splits) / sizeof(splits[0]); i++) {
+		size_t n = splits[i];
+		Crc32c crc;
+		Adler32 adler;
+		XXHash32 xx32;
+		XXHash64 xx64;
+		for (size_t pos = 0; pos < buf.size(); pos += n + 1) {
+			size_t count = std::min<size_t>(n + 1, buf.size() - pos);
+			crc.append(buf.span(pos, count));
+			adler.append(buf.span(pos, count));
+			xx32.append(buf.span(pos, count));
+			xx64.append(buf.span(pos, count));
+		}
+		assert((crc.value() == 0x4eb72655 && adler.value() == 0x0d817116));
+		assert((xx32.value() == 0xff59cea3 && xx64.value() == 0xb195585f9792dbcaULL));
+	}
+	// 从之前的结果继续计算
+	Crc32c resume(checksum<Crc32c>(buf, 0, 5000));
+	resume.append(buf.span(5000, 5000));
+	assert((resume.value() == 0x4eb72655));
+	assert((checksum<Crc32c>(buf, 0, 9) == checksum<Crc32c>(buf.span(0, 9))));
+	bool bad_range = false;
+	try {
+		checksum<Crc32c>(buf, 9990, 11);
+	} catch (const std::out_of_range&) {
+		bad_range = true;
+	}
+	assert(bad_range);
+
+	// 写入时计算
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	stream.write_be(uint32_t(0));
+	ChecksumStreamT<Crc32c> writer(stream);
+	writer.write_be(uint32_t(0x01020304));
+	writer.write_varint(300u);
+	writer.write_bytes(digits, 9);
+	BufferSpanT<uint8_t> space = writer.prepare(2);
+	std::memcpy(space.begin(), "ab", 2);
+	writer.commit(2);
+	uint32_t crc = writer.value();
+	stream.write_be(crc);
+	assert((crc == checksum<Crc32c>(stream.buf(), 4, stream.write_index() - 8)));
+	stream.read_be<uint32_t>();
+	assert((checksum<Crc32c>(stream) == checksum<Crc32c>(stream.buf().span(4, stream.buf().size() - 4))));
+	writer.reset();
+	assert((writer.value() == 0));
+}
+
+#if defined(__linux__)
+template<typename Loop>
+void test_io_loop(Loop& loop, int fds[2]) {
+	byte_streambuffer output(byte_streambuffer::kGrowableWrite);
+	byte_streambuffer input(byte_streambuffer::kGrowableWrite);
+	input.reserve(64 * 1024);
+	for (uint32_t i = 0; i < 1000; i++) {
+		output.write_be(i);
+	}
+	// 没有数据时等待，发送之后在回调中继续接收
+	int received = 0;
+	std::function<void(int)> on_recv = [&](int result) {
+		assert(result > 0);
+		received += result;
+		if (received < 4000)
+			loop.async_recv(fds[1], input, 1000, on_recv);
+	};
+	loop.async_recv(fds[1], input, 1000, on_recv);
+	loop.run_once(0);
+	assert((received == 0 && input.write_index() == 0));
+	int sent = 0;
+	std::function<void(int)> on_send = [&](int result) {
+		assert(result > 0);
+		sent += result;
+		if (output.read_index() < output.buf().size())
+			loop.async_send(fds[0], output, on_send);
+	};
+	loop.async_send(fds[0], output, on_send);
+	while (received < 4000)
+		loop.run_once(1000);
+	assert((sent == 4000 && received == 4000 && loop.pending() == 0));
+	assert((input.write_index() == 4000 && input.buf().size() == 4000));
+	for (uint32_t i = 0; i < 1000; i++) {
+		assert((input.read_be<uint32_t>() == i));
+	}
+
+	// 对端关闭时recv返回0
+	byte_streambuffer tail(byte_streambuffer::kGrowableWrite);
+	int result = -1;
+	::shutdown(fds[0], SHUT_WR);
+	loop.async_recv(fds[1], tail, 100, [&](int n) { result = n; });
+	while (loop.pending() > 0)
+		loop.run_once(1000);
+	assert((result == 0 && tail.buf().size() == 0));
+}
+
+void test_socket_io() {
+	int fds[2];
+	assert((::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0));
+	byte_streambuffer output(byte_streambuffer::kGrowableWrite);
+	byte_streambuffer input(byte_streambuffer::kGrowableWrite);
+	assert((SocketIo::recv_some(fds[1], input, 100) == -EAGAIN && input.buf().size() == 0));
+	// kFixedWrite的stream不能作为接收缓冲区
+	byte_streambuffer fixed_input(100, 0);
+	bool rejected = false;
+	try {
+		SocketIo::recv_some(fds[1], fixed_input, 100);
+	} catch (const std::invalid_argument&) {
+		rejected = true;
+	}
+	assert((rejected && fixed_input.write_index() == 0));
+	output.write_bytes("ping", 4);
+	assert((SocketIo::send_some(fds[0], output) == 4 && output.read_index() == 4));
+	assert((SocketIo::recv_some(fds[1], input, 100) == 4 && input.write_index() == 4 && input.buf().size() == 4));
+	assert((input.starts_with("ping", 4)));
+
+	EpollLoop epoll;
+	test_io_loop(epoll, fds);
+	::close(fds[0]);
+	::close(fds[1]);
+
+#if defined(FTL_BUFFER_IO_URING)
+	std::unique_ptr<IoUringLoop> ring;
+	try {
+		ring.reset(new IoUringLoop(64));
+	} catch (const std::system_error&) {
+		// 内核不支持或者被禁用
+	}
+	if (ring) {
+		assert((::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0));
+		test_io_loop(*ring, fds);
+		::close(fds[0]);
+		::close(fds[1]);
+
+		// 注册的缓冲区
+		assert((::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0));
+		byte_streambuffer fixed_in(byte_streambuffer::kGrowableWrite);
+		byte_streambuffer fixed_out(byte_streambuffer::kGrowableWrite);
+		fixed_in.reserve(4096);
+		fixed_out.reserve(4096);
+		fixed_out.write_bytes("registered", 10);
+		assert((ring->register_buffer(fixed_in) == 0 && ring->register_buffer(fixed_out) == 1));
+		int sent = -1, received = -1;
+		ring->async_send(fds[0], fixed_out, [&](int n) { sent = n; });
+		assert(ring->last_fixed());
+		ring->async_recv(fds[1], fixed_in, 100, [&](int n) { received = n; });
+		assert(ring->last_fixed());
+		while (ring->pending() > 0)
+			ring->run_once(1000);
+		assert((sent == 10 && received == 10 && fixed_in.starts_with("registered", 10)));
+		// 超过注册区域时使用普通的recv/send
+		fixed_out.write_bytes(std::string(8192, 'x').data(), 8192);
+		ring->async_send(fds[0], fixed_out, [&](int n) { sent = n; });
+		assert(!ring->last_fixed());
+		while (ring->pending() > 0)
+			ring->run_once(1000);
+		assert((sent == 8192));
+		// fixed_out重新分配之后注册失效并且从内核中注销，fixed_in的注册不变
+		assert((ring->registered_count() == 1));
+		ring->async_recv(fds[1], fixed_in, 100, [&](int n) { received = n; });
+		assert(ring->last_fixed());
+		while (received < 0 || ring->pending() > 0)
+			ring->run_once(1000);
+		// 其他stream即使地址落在注册区域内也不使用注册
+		byte_streambuffer alias = byte_streambuffer::ref(fixed_in.buf().begin() + 2048, 1024);
+		alias.set_write_mode(byte_streambuffer::kGrowableWrite);
+		fixed_out.write_bytes("x", 1);
+		ring->async_send(fds[0], fixed_out, [&](int n) { sent = n; });
+		ring->async_recv(fds[1], alias, 1, [&](int n) { received = n; });
+		assert(!ring->last_fixed());
+		while (ring->pending() > 0)
+			ring->run_once(1000);
+		ring->unregister_buffer(fixed_in);
+		assert((ring->registered_count() == 0));
+		ring->unregister_buffers();
+		assert((ring->registered_count() == 0));
+
+		::close(fds[0]);
+		::close(fds[1]);
+
+		// 没有数据时等待timeout_ms之后返回
+		assert((::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0));
+		byte_streambuffer idle(byte_streambuffer::kGrowableWrite);
+		ring->async_recv(fds[1], idle, 100, [&](int n) { received = n; });
+		assert((ring->run_once(10) == 0 && ring->pending() == 1));
+		::shutdown(fds[0], SHUT_WR);
+		while (ring->pending() > 0)
+			ring->run_once(1000);
+		assert((received == 0));
+		::close(fds[0]);
+		::close(fds[1]);
+	}
+#endif
+}
+#endif
+
+#if defined(FTL_BUFFER_ZLIB) || defined(FTL_BUFFER_ZSTD) || defined(FTL_BUFFER_LZ4)
+template<typename Codec>
+void test_codec_roundtrip() {
+	byte_buffer payload;
+	for (int i = 0; i < 5000; i++) {
+		char line[64];
+		int n = snprintf(line, sizeof(line), "GET /item/%d HTTP/1.1\r\n", i % 97);
+		payload.append(line, n);
+	}
+	uint32_t seed = 12345;
+	for (int i = 0; i < 10000; i++) {
+		seed = seed * 1103515245 + 12345;
+		payload.append((uint8_t)(seed >> 24));
+	}
+
+	byte_buffer packed = compress<Codec>(payload);
+	assert((packed.size() < payload.size()));
+	assert((decompress<Codec>(packed) == payload));
+	assert((decompress<Codec>(packed, payload.size()) == payload));
+
+	// 从chain的各个分段压缩，分多次接收解压
+	typedef typename CompressorT<Codec>::Cache Cache;
+	size_t cached = Cache::cached();
+	byte_buffer_chain chain;
+	chain.append(payload.slice(0, 1000));
+	chain.append(payload.slice(1000, 50000));
+	chain.append(payload.slice(51000, payload.size() - 51000));
+	byte_streambuffer stream(byte_streambuffer::kGrowableWrite);
+	{
+		CompressorT<Codec> encoder;
+		assert((Cache::cached() + 1 == cached || cached == 0));
+		encoder.update(chain, stream);
+		encoder.finish(stream);
+		assert((encoder.total_in() == payload.size() && encoder.total_out() == stream.write_index()));
+	}
+	assert((Cache::cached() == std::max<size_t>(cached, 1)));
+	stream.write_bytes("tail", 4);
+
+	byte_streambuffer input(byte_streambuffer::kGrowableWrite);
+	byte_streambuffer output(byte_streambuffer::kGrowableWrite);
+	DecompressorT<Codec> decoder;
+	bool finished = false;
+	while (!finished) {
+		size_t n = std::min<size_t>(777, stream.buf().size() - stream.read_index());
+		input.write_bytes(stream.read_span(n).begin(), n);
+		finished = decoder.update(input, output);
+	}
+	assert((output.buf() == payload && decoder.total_out() == payload.size()));
+	// 帧后面的数据不处理
+	while (stream.read_index() < stream.buf().size())
+		input.write((uint8_t)stream.read<uint8_t>());
+	assert((input.buf().size() - input.read_index() == 4 && input.starts_with("tail", 4)));
+
+	// 同一个上下文继续处理下一帧
+	decoder.reset();
+	byte_streambuffer second(byte_streambuffer::kGrowableWrite);
+	assert((decoder.update(packed, second) && second.buf() == payload));
+
+	bool error = false;
+	try {
+		byte_buffer garbage(packed.slice(0, 32));
+		garbage.append("................................................................", 64);
+		decompress<Codec>(garbage);
+	} catch (const CodecError&) {
+		error = true;
+	}
+	assert(error);
+}
+
+// 帧头声称1T的原始大小，解压时原样复制输入
+struct LyingHeaderCodec {
+	static uint64_t content_size(const uint8_t* p, size_t size) {
+		return (uint64_t)1 << 40;
+	}
+
+	struct Decompressor {
+		void reset() {
+		}
+
+		bool decompress(const uint8_t*& in, size_t& in_size, uint8_t*& out, size_t& out_size) {
+			size_t n = std::min<size_t>(in_size, out_size);
+			std::memcpy(out, in, n);
+			in += n;
+			in_size -= n;
+			out += n;
+			out_size -= n;
+			return false;
+		}
+	};
+};
+
+void test_codec() {
+	// 伪造的帧头不会按照声称的大小预留，输出随着实际的数据增长
+	{
+		byte_buffer input(1000, 7);
+		byte_streambuffer out(byte_streambuffer::kGrowableWrite);
+		DecompressorT<LyingHeaderCodec> decoder;
+		assert((!decoder.update(input, out) && out.write_index() == 1000));
+		assert((out.buf().capacity() < 1024 * 1024 && out.buf().read_byte(999) == 7));
+
+		DecompressorT<LyingHeaderCodec> limited;
+		limited.set_max_output(500);
+		byte_streambuffer small(byte_streambuffer::kGrowableWrite);
+		bool error = false;
+		try {
+			limited.update(input, small);
+		} catch (const CodecError&) {
+			error = true;
+		}
+		assert((error && small.write_index() == 501 && limited.total_out() == 501));
+	}
+#if defined(FTL_BUFFER_ZLIB)
+	test_codec_roundtrip<ZlibCodec>();
+	test_codec_roundtrip<GzipCodec>();
+	test_codec_roundtrip<RawDeflateCodec>();
+	byte_buffer small;
+	small.append("hello", 5);
+	byte_buffer gz = compress<GzipCodec>(small);
+	assert((gz.read<uint8_t>(0) == 0x1f && gz.read<uint8_t>(1) == 0x8b));
+
+	// 解压之后超过max_output时抛出CodecError
+	byte_buffer zeros = compress<ZlibCodec>(byte_buffer(1 << 20, 0));
+	DecompressorT<ZlibCodec> bomb;
+	bomb.set_max_output(64 * 1024);
+	byte_streambuffer inflated(byte_streambuffer::kGrowableWrite);
+	bool exceeded = false;
+	try {
+		bomb.update(zeros, inflated);
+	} catch (const CodecError&) {
+		exceeded = true;
+	}
+	assert((exceeded && inflated.write_index() <= 64 * 1024 + 1));
+	bomb.reset();
+	bomb.set_max_output(1 << 20);
+	byte_streambuffer exact(byte_streambuffer::kGrowableWrite);
+	assert((bomb.update(zeros, exact) && exact.write_index() == (1 << 20)));
+#endif
+#if defined(FTL_BUFFER_ZSTD)
+	test_codec_roundtrip<ZstdCodec>();
+#endif
+#if defined(FTL_BUFFER_LZ4)
+	test_codec_roundtrip<Lz4Codec>();
+	byte_buffer lz = compress<Lz4Codec>(byte_buffer(100000));
+	assert((Lz4Codec::content_size(lz.continer().begin(), lz.size()) == 100000));
+#endif
+}
+#endif
+
+void test_parallel() {
+	BufferThreadPool pool(4);
+	assert((pool.concurrency() == 4));
+	ParallelPolicy policy(64 * 1024, 4096, &pool);
+
+	byte_buffer src(1000 * 1000 + 3);
+	for (size_t i = 0; i < src.size(); i++) {
+		src.write((uint8_t)(i * 31 + (i >> 12)), i);
+	}
+	byte_buffer copy = parallel_copy(src, policy);
+	assert((copy == src && parallel_equal(copy, src, policy)));
+	copy.write((uint8_t)(copy.read<uint8_t>(copy.size() - 1) + 1), copy.size() - 1);
+	assert((!parallel_equal(copy, src, policy) && !parallel_equal(copy.slice(0, 10), src, policy)));
+
+	// 分块的边界按照页对齐并且是元素大小的倍数
+	ParallelChunks chunks(src.begin() + 1, 800000, 4, policy, pool.concurrency());
+	assert((chunks.count() == 4 && chunks.offset(0) == 0 && chunks.offset(4) == 800000));
+	for (size_t i = 1; i < chunks.count(); i++) {
+		assert((chunks.offset(i) % 4 == 0 && chunks.offset(i) > chunks.offset(i - 1)));
+		assert(((4096 - (uintptr_t)(src.begin() + 1 + chunks.offset(i)) % 4096) % 4096 < 4));
+	}
+	ParallelChunks small(src.begin(), 1000, 1, policy, pool.concurrency());
+	assert((small.count() == 1 && small.size(0) == 1000));
+
+	// 合并分段的校验和
+	assert((Crc32c::combine(checksum<Crc32c>(src, 0, 1000), checksum<Crc32c>(src, 1000, 5000), 5000) == checksum<Crc32c>(src, 0, 6000)));
+	assert((Crc32c::combine(checksum<Crc32c>(src, 0, 1000), checksum<Crc32c>("", 0), 0) == checksum<Crc32c>(src, 0, 1000)));
+	assert((Adler32::combine(checksum<Adler32>(src, 0, 70000), checksum<Adler32>(src, 70000, 100000), 100000) == checksum<Adler32>(src, 0, 170000)));
+	assert((parallel_checksum<Crc32c>(src, policy) == checksum<Crc32c>(src)));
+	assert((parallel_checksum<Adler32>(src, policy) == checksum<Adler32>(src)));
+	assert((parallel_checksum<Crc32c>(src, ParallelPolicy::serial()) == checksum<Crc32c>(src)));
+
+	byte_buffer filled(src);
+	parallel_fill(filled, (uint8_t)0x5a, 10, 500000, policy);
+	byte_buffer expected(src);
+	expected.fill((uint8_t)0x5a, 10, 500000);
+	assert((filled == expected));
+	parallel_fill(filled, (uint8_t)0, 0, 0, policy);
+	assert((filled.read<uint8_t>(0) == 0 && filled.read<uint8_t>(filled.size() - 1) == 0));
+
+	byte_buffer swapped(src);
+	parallel_byte_swap<uint32_t>(swapped, policy);
+	for (size_t i = 0; i + 4 <= src.size(); i += 4093 * 4) {
+		assert((swapped.read_be<uint32_t>(i) == src.read_le<uint32_t>(i)));
+	}
+	assert((swapped.read<uint8_t>(src.size() - 1) == src.read<uint8_t>(src.size() - 1)));
+	parallel_byte_swap<uint32_t>(swapped, policy);
+	assert((swapped == src));
+
+	// 任务中嵌套调用时串行执行
+	std::atomic<int> total(0);
+	pool.run(8, [&](size_t) {
+		pool.run(3, [&](size_t) { total++; });
+	});
+	assert((total == 24));
+
+	// 默认的线程池和阈值
+	byte_buffer large(8 * 1024 * 1024);
+	parallel_fill(large, (uint8_t)1);
+	byte_buffer large_copy = parallel_copy(large);
+	assert((parallel_equal(large, large_copy) && large_copy.read<uint8_t>(large.size() - 1) == 1));
+}
+
+int main(int argc, char* argv[]) {
+
+	TestByteBuffer1();
+	read_test();
+	write_test();
+	append_test();
+	cast_test();
+	grow_test();
+	append_buf_test();
+	test_streambuffer();
+	test_streambuffer1();
+	test_slab_allocator();
+	test_inline_buffer();
+	test_shared_buffer();
+	test_buffer_chain();
+	test_endian_array();
+	test_span();
+	test_mapped_buffer();
+	test_ring_buffer();
+	test_vector_buffer();
+	test_adopt_release();
+	test_layout();
+	test_varint();
+	test_prepare_commit();
+	test_buffer_policy();
+	test_buffer_pool();
+	test_growable_stream();
+	test_aligned_allocator();
+	test_search();
+	test_large_copy();
+	test_bit_stream();
+	test_framing();
+	test_static_buffer();
+	test_concurrent_buffer();
+	test_serialize();
+	test_checksum();
+#if defined(__linux__)
+	test_socket_io();
+#endif
+#if defined(FTL_BUFFER_ZLIB) || defined(FTL_BUFFER_ZSTD) || defined(FTL_BUFFER_LZ4)
+	test_codec();
+#endif
+	test_parallel();
+	return 0;
 }
\ No newline at end of file
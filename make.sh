@@ -1 +1,6 @@
- g++ -g -Wall -fpermissive  -std=c++11 main.cc -o test
\ No newline at end of file
+if [ "$1" = "bench" ]; then
+ g++ -O2 -Wall -fpermissive  -std=c++11 bench.cc -o bench -lbenchmark -pthread
+else
+ g++ -g -Wall -fpermissive  -std=c++11 main.cc -o test -pthread -DFTL_BUFFER_ZLIB -lz
+ g++ -g -Wall -fpermissive  -std=c++11 stats_test.cc -o stats_test -pthread -DFTL_BUFFER_STATS
+fi
\ No newline at end of file
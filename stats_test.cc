@@ -0,0 +1,69 @@
+// 统计计数的测试，和main.cc分开编译：main.cc使用默认的配置，这里使用-DFTL_BUFFER_STATS
+#if !defined(FTL_BUFFER_STATS)
+#error "stats_test.cc requires -DFTL_BUFFER_STATS"
+#endif
+#include "ftl/buffer.h"
+
+#include <assert.h>
+#include <thread>
+
+using namespace ftl;
+using namespace ftl::buffer_internal;
+
+static size_t g_hook_bytes = 0;
+
+void test_buffer_stats() {
+	BufferStats::Counters base = BufferStats::thread_snapshot();
+	{
+		byte_buffer buf(64, 0);
+		BufferStats::Counters c = BufferStats::thread_snapshot();
+		assert((c.alloc_count == base.alloc_count + 1 && c.alloc_bytes >= base.alloc_bytes + 64));
+
+		byte_buffer copy(buf);
+		byte_buffer part = buf.slice(0, 16);
+		c = BufferStats::thread_snapshot();
+		assert((c.copy_count == base.copy_count + 2 && c.copy_bytes == base.copy_bytes + 64 + 16));
+
+		uint8_t external[8] = { 0 };
+		byte_buffer ref = byte_buffer::ref(external, sizeof(external));
+		BufferStats::set_copy_hook([](const char* name, size_t bytes) { g_hook_bytes += bytes; });
+		ref.append((uint8_t)1);
+		BufferStats::set_copy_hook(nullptr);
+		c = BufferStats::thread_snapshot();
+		assert((c.promote_count == base.promote_count + 1 && c.promote_bytes == base.promote_bytes + 8));
+		assert((g_hook_bytes == 8));
+
+		shared_byte_buffer shared(32, 1);
+		shared_byte_buffer other(shared);
+		other.write((uint8_t)2, 0);
+		assert((BufferStats::thread_snapshot().copy_bytes == c.copy_bytes + 32));
+
+		bool thrown = false;
+		try {
+			buf.read_be<uint32_t>(100);
+		} catch (std::out_of_range&) {
+			thrown = true;
+		}
+		assert(thrown);
+		assert((BufferStats::thread_snapshot().bounds_failures == base.bounds_failures + 1));
+	}
+
+	// 其他线程退出后汇总到snapshot()
+	BufferStats::Counters before = BufferStats::snapshot();
+	std::thread t([]() {
+		byte_buffer buf(100, 0);
+		byte_buffer copy(buf);
+	});
+	t.join();
+	BufferStats::Counters after = BufferStats::snapshot();
+	assert((after.copy_bytes >= before.copy_bytes + 100 && after.alloc_count >= before.alloc_count + 2));
+	assert((after.to_string().find("copy_bytes=") != std::string::npos));
+
+	BufferStats::reset();
+	assert((BufferStats::snapshot().alloc_count == 0));
+}
+
+int main(int argc, char* argv[]) {
+	test_buffer_stats();
+	return 0;
+}